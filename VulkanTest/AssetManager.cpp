@@ -1,12 +1,25 @@
 #include "AssetManager.h"
+#include "CpuProfiler.h"
 #include <iostream>
 
-AssetManager::AssetManager(VulkanDevice* device, VulkanCommandPool* commandPool) : m_pDevice(device), m_pCommandPool(commandPool)
+AssetManager::AssetManager(VulkanDevice* device, VulkanMemoryAllocator* allocator, VulkanCommandPool* commandPool)
+	: m_pDevice(device), m_pAllocator(allocator), m_pCommandPool(commandPool)
 {
-	if (!m_pDevice || !m_pCommandPool)
+	if (!m_pDevice || !m_pAllocator || !m_pCommandPool)
 	{
-		throw std::runtime_error("AssetManager requires valid VulkanDevice and VulkanCommandPool pointers!");
+		throw std::runtime_error("AssetManager requires valid VulkanDevice, VulkanMemoryAllocator and VulkanCommandPool pointers!");
 	}
+
+	m_GeometryBuffer = std::make_unique<VulkanGeometryBuffer>();
+	m_GeometryBuffer->create(
+		m_pDevice->getLogicalDevice(),
+		*m_pAllocator,
+		m_pDevice->getGraphicsQueue(),
+		m_pCommandPool->getVkCommandPool(),
+		INITIAL_GEOMETRY_VERTEX_CAPACITY,
+		INITIAL_GEOMETRY_INDEX_BYTES,
+		m_pDevice->isIndexTypeUint8Enabled()
+	);
 }
 
 AssetManager::~AssetManager()
@@ -19,13 +32,11 @@ void AssetManager::cleanup()
     
     m_Materials.clear();
 
-    for (auto& pair : m_Meshes) {
-        if (pair.second) {
-            if (pair.second->vertexBuffer) pair.second->vertexBuffer->destroy();
-            if (pair.second->indexBuffer) pair.second->indexBuffer->destroy();
-        }
-    }
     m_Meshes.clear();
+    m_Models.clear();
+
+    if (m_GeometryBuffer) m_GeometryBuffer->destroy();
+    m_GeometryBuffer.reset();
 
     // The unique_ptr/shared_ptr destructors will handle memory, but we need
     // to explicitly call destroy() on the Vulkan objects.
@@ -232,12 +243,14 @@ std::shared_ptr<ModelData> AssetManager::loadGltfModel(const std::string& path)
         return m_Models[path];
     }
 
+    CPU_PROFILE_ZONE("Load glTF Model");
     std::cout << "Loading glTF model with materials: " << path << std::endl;
 
     auto gltfResult = ModelLoader::loadGLTFModelWithMaterials(
         path,
         m_pDevice->getLogicalDevice(),
         m_pDevice->getPhysicalDevice(),
+        *m_pAllocator,
         m_pDevice->getGraphicsQueue(),
         m_pCommandPool->getVkCommandPool()    
     );
@@ -251,6 +264,7 @@ std::shared_ptr<ModelData> AssetManager::loadGltfModel(const std::string& path)
     {
         if (m_Materials.find(material->name) == m_Materials.end())
         {
+            material->sortId = m_NextMaterialSortId++;
             m_Materials[material->name] = material;
         }
     }
@@ -258,25 +272,9 @@ std::shared_ptr<ModelData> AssetManager::loadGltfModel(const std::string& path)
     for (size_t i = 0; i < gltfResult.meshVertices.size(); ++i)
     {
         MeshData meshData;
-        meshData.vertexBuffer = std::make_unique<VulkanVertexBuffer>();
-        meshData.vertexBuffer->create(
-            m_pDevice->getLogicalDevice(),
-            m_pDevice->getPhysicalDevice(),
-            m_pDevice->getGraphicsQueue(),
-            m_pCommandPool->getVkCommandPool(),
-            gltfResult.meshVertices[i]
-        );
-
-        meshData.indexBuffer = std::make_unique<VulkanIndexBuffer>();
-        meshData.indexBuffer->create(
-            m_pDevice->getLogicalDevice(),
-            m_pDevice->getPhysicalDevice(),
-            m_pDevice->getGraphicsQueue(),
-            m_pCommandPool->getVkCommandPool(),
-            gltfResult.meshIndices[i]
-        );
-
-        meshData.indexCount = static_cast<uint32_t>(gltfResult.meshIndices[i].size());
+        meshData.geometry = m_GeometryBuffer->upload(gltfResult.meshVertices[i], gltfResult.meshIndices[i]);
+        meshData.bounds = BoundingVolume::fromVertices(gltfResult.meshVertices[i]);
+        meshData.sortId = m_NextMeshSortId++;
         modelData->meshes.push_back(std::move(meshData));
     }
 
@@ -291,6 +289,7 @@ std::shared_ptr<ModelData> AssetManager::loadGltfModel(const std::string& path)
         }
         else {
             // This is a brand new material. Add it to the cache.
+            mat->sortId = m_NextMaterialSortId++;
             m_Materials[mat->name] = mat;
         }
     }
@@ -299,6 +298,21 @@ std::shared_ptr<ModelData> AssetManager::loadGltfModel(const std::string& path)
     return modelData;
 }
 
+void AssetManager::unloadGltfModel(const std::string& path)
+{
+    auto it = m_Models.find(path);
+    if (it == m_Models.end())
+    {
+        return;
+    }
+
+    for (const auto& mesh : it->second->meshes)
+    {
+        m_GeometryBuffer->release(mesh.geometry);
+    }
+    m_Models.erase(it);
+}
+
 std::vector<RenderableObject> AssetManager::createRenderableObjectsFromGltf(const SceneObjectDefinition& def)
 {
     auto modelData = loadGltfModel(def.meshPath);
@@ -313,9 +327,13 @@ std::vector<RenderableObject> AssetManager::createRenderableObjectsFromGltf(cons
     for (size_t i = 0; i < modelData->meshes.size(); ++i)
     {
         RenderableObject renderable{};
-        renderable.vertexBuffer = modelData->meshes[i].vertexBuffer.get();
-        renderable.indexBuffer = modelData->meshes[i].indexBuffer.get();
-        renderable.indexCount = modelData->meshes[i].indexCount;
+        const GeometryRange& geometry = modelData->meshes[i].geometry;
+        renderable.firstIndex = geometry.firstIndex;
+        renderable.vertexOffset = static_cast<int32_t>(geometry.vertexOffset);
+        renderable.indexCount = geometry.indexCount;
+        renderable.indexType = geometry.indexType;
+        renderable.localBounds = modelData->meshes[i].bounds;
+        renderable.meshSortId = modelData->meshes[i].sortId;
 
         int materialIndex = modelData->meshMaterialIndices[i];
         renderable.material = modelData->materials[materialIndex];
@@ -354,6 +372,7 @@ std::vector<RenderableObject> AssetManager::createRenderableObjectsFromGltf(cons
         //model = glm::scale(model, def.scale);
         //renderable.modelMatrix = model;
         renderable.modelMatrix = globalObjectTransform * modelData->meshWorldMatrices[i];
+        renderable.isStatic = def.isStatic;
 
         renderables.push_back(renderable);
     }
@@ -368,11 +387,13 @@ std::shared_ptr<VulkanTexture> AssetManager::getOrLoadTexture(const std::string&
     }
 
     // Otherwise, load it, cache it, and return it
+    CPU_PROFILE_ZONE("Load Texture");
     std::cout << "Loading new texture: " << path << std::endl;
     auto newTexture = std::make_shared<VulkanTexture>();
     newTexture->createTexture2D(
         m_pDevice->getLogicalDevice(),
         m_pDevice->getPhysicalDevice(),
+        *m_pAllocator,
         m_pDevice->getGraphicsQueue(),
         m_pCommandPool->getVkCommandPool(),
         path,
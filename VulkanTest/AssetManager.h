@@ -9,6 +9,7 @@
 #include "VulkanCommandPool.h"
 #include "VulkanVertexBuffer.h"
 #include "VulkanIndexBuffer.h"
+#include "VulkanGeometryBuffer.h"
 #include "VulkanTexture.h"
 #include "ModelLoader.h"
 #include "Renderable.h"
@@ -16,9 +17,9 @@
 
 struct MeshData
 {
-	std::unique_ptr<VulkanVertexBuffer> vertexBuffer;
-	std::unique_ptr<VulkanIndexBuffer> indexBuffer;
-	uint32_t indexCount = 0;
+	GeometryRange geometry; // range inside the shared geometry buffer
+	BoundingVolume bounds;  // local space, computed at import
+	uint32_t sortId = 0;    // small dense id for draw sort keys, assigned at upload
 };
 
 struct ModelData
@@ -40,7 +41,7 @@ public:
 		EMISSIVE
 	};
 
-	AssetManager(VulkanDevice* device, VulkanCommandPool* commandPool);
+	AssetManager(VulkanDevice* device, VulkanMemoryAllocator* allocator, VulkanCommandPool* commandPool);
 	~AssetManager();
 
 	AssetManager(const AssetManager&) = delete;
@@ -55,11 +56,15 @@ public:
 	std::map<std::string, std::shared_ptr<Material>>& getMaterials();
 
 	std::shared_ptr<ModelData> loadGltfModel(const std::string& path);
+	// returns the model's geometry ranges to the shared buffer, renderables using it must be dropped first
+	void unloadGltfModel(const std::string& path);
 	std::vector<RenderableObject> createRenderableObjectsFromGltf(
 		const SceneObjectDefinition& def
 	);
 
 	std::shared_ptr<VulkanTexture> getOrLoadTexture(const std::string& path, bool sRGB = false);
+
+	VulkanGeometryBuffer* getGeometryBuffer() const { return m_GeometryBuffer.get(); }
 private:
 
 	void cleanup();
@@ -70,14 +75,22 @@ private:
 
 	// Pointers to essential Vulkan components (owned by VulkanEngine).
 	VulkanDevice* m_pDevice;
+	VulkanMemoryAllocator* m_pAllocator;
 	VulkanCommandPool* m_pCommandPool;
 
 	// Caches for all loaded assets.
 	// The string key is typically the file path.
 	std::map<std::string, std::shared_ptr<MeshData>> m_Meshes;
 	std::map<std::string, std::shared_ptr<Material>> m_Materials;
+	uint32_t m_NextMaterialSortId = 0;
+	uint32_t m_NextMeshSortId = 0;
 	std::map<std::string, std::shared_ptr<VulkanTexture>> m_Textures;
 	std::map<std::string, std::shared_ptr<ModelData>> m_Models;
 
+	// all static mesh vertices / indices live here
+	std::unique_ptr<VulkanGeometryBuffer> m_GeometryBuffer;
+	static constexpr uint32_t INITIAL_GEOMETRY_VERTEX_CAPACITY = 256 * 1024;
+	static constexpr uint32_t INITIAL_GEOMETRY_INDEX_BYTES = 4 * 1024 * 1024;
+
 	std::string getTextureMapTypeDefaultFilePath(TextureMap texType);
 };
@@ -0,0 +1,66 @@
+#pragma once
+// BoundingVolume.h
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "ModelLoader.h"
+
+// Axis aligned box (center / half extents) plus a bounding sphere around the same center.
+// Computed once per mesh at import, then moved into world space per renderable.
+struct BoundingVolume
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	glm::vec3 extents = glm::vec3(0.0f);
+	float radius = 0.0f;
+
+	static BoundingVolume fromVertices(const std::vector<Vertex>& vertices)
+	{
+		BoundingVolume bounds{};
+		if (vertices.empty())
+		{
+			return bounds;
+		}
+
+		glm::vec3 minPos = vertices[0].pos;
+		glm::vec3 maxPos = vertices[0].pos;
+		for (const Vertex& vertex : vertices)
+		{
+			minPos = glm::min(minPos, vertex.pos);
+			maxPos = glm::max(maxPos, vertex.pos);
+		}
+		bounds.center = (minPos + maxPos) * 0.5f;
+		bounds.extents = (maxPos - minPos) * 0.5f;
+
+		// tighter than the box's half diagonal for round meshes
+		float radiusSquared = 0.0f;
+		for (const Vertex& vertex : vertices)
+		{
+			glm::vec3 offset = vertex.pos - bounds.center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		bounds.radius = std::sqrt(radiusSquared);
+		return bounds;
+	}
+
+	// the world box encloses the rotated local box (Arvo), the sphere scales with the largest axis
+	BoundingVolume transformed(const glm::mat4& model) const
+	{
+		BoundingVolume result{};
+		result.center = glm::vec3(model * glm::vec4(center, 1.0f));
+
+		glm::mat3 absolute(model);
+		for (int column = 0; column < 3; column++)
+		{
+			absolute[column] = glm::abs(absolute[column]);
+		}
+		result.extents = absolute * extents;
+
+		float maxScale = std::max(glm::length(glm::vec3(model[0])),
+			std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		result.radius = radius * maxScale;
+		return result;
+	}
+};
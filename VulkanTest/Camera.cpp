@@ -117,6 +117,16 @@ glm::mat4 Camera::getProjectionMatrix() const
 	return glm::perspective(glm::radians(fov), aspectRatio, near, far);
 }
 
+float Camera::getNearPlane() const
+{
+	return near;
+}
+
+float Camera::getFarPlane() const
+{
+	return far;
+}
+
 void Camera::updateCameraVectors()
 {
     // Calculate the new Front vector based on Yaw and Pitch (Y-UP system)
@@ -17,6 +17,8 @@ public:
 	glm::vec3 getCameraDirection() const;
 	glm::mat4 calculateViewMatrix() const;
 	glm::mat4 getProjectionMatrix() const;
+	float getNearPlane() const;
+	float getFarPlane() const;
 
 private:
 	glm::vec3 position;
@@ -0,0 +1,236 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	struct ThreadBuffer
+	{
+		std::vector<CpuProfiler::Event> events = std::vector<CpuProfiler::Event>(CpuProfiler::THREAD_BUFFER_EVENTS);
+		std::atomic<uint64_t> written{ 0 };  // events ever written; the release store publishes each one
+		std::atomic<bool> retired{ false };  // its thread exited
+		uint64_t read = 0;                   // under registryMutex, like everything below
+		bool free = false;                   // retired and drained, the next new thread takes it
+		uint32_t thread = 0;
+	};
+
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers; // index is the thread index of the events
+	std::vector<std::string> threadNames;
+	std::deque<CpuProfiler::Frame> frames;               // main thread only
+	uint64_t frameStart = 0;
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	// marks the buffer retired when its thread exits
+	struct ThreadRegistration
+	{
+		ThreadBuffer* buffer = nullptr;
+		uint32_t depth = 0;
+
+		~ThreadRegistration()
+		{
+			if (buffer)
+			{
+				buffer->retired.store(true, std::memory_order_release);
+			}
+		}
+	};
+	thread_local ThreadRegistration registration;
+
+	ThreadBuffer* registerThread()
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (auto& buffer : buffers)
+		{
+			if (buffer->free)
+			{
+				buffer->free = false;
+				buffer->retired.store(false, std::memory_order_relaxed);
+				threadNames[buffer->thread] = "Thread " + std::to_string(buffer->thread);
+				return buffer.get();
+			}
+		}
+
+		buffers.push_back(std::make_unique<ThreadBuffer>());
+		ThreadBuffer* buffer = buffers.back().get();
+		buffer->thread = static_cast<uint32_t>(buffers.size() - 1);
+		threadNames.push_back("Thread " + std::to_string(buffer->thread));
+		return buffer;
+	}
+
+	ThreadBuffer* localBuffer()
+	{
+		if (!registration.buffer)
+		{
+			registration.buffer = registerThread();
+		}
+		return registration.buffer;
+	}
+
+	// the writer may lap the slots while they are copied, so whatever it could have overwritten is
+	// dropped again by checking its count afterwards
+	void drain(ThreadBuffer& buffer, std::vector<CpuProfiler::Event>& out)
+	{
+		const uint64_t capacity = CpuProfiler::THREAD_BUFFER_EVENTS;
+		uint64_t written = buffer.written.load(std::memory_order_acquire);
+		uint64_t first = std::max(buffer.read, written > capacity ? written - capacity : 0);
+		size_t copiedFrom = out.size();
+		for (uint64_t index = first; index < written; index++)
+		{
+			out.push_back(buffer.events[index & (capacity - 1)]);
+		}
+
+		uint64_t after = buffer.written.load(std::memory_order_acquire);
+		uint64_t valid = after > capacity ? after - capacity : 0;
+		if (valid > first)
+		{
+			size_t lost = static_cast<size_t>(std::min(valid, written) - first);
+			out.erase(out.begin() + copiedFrom, out.begin() + copiedFrom + lost);
+		}
+		buffer.read = written;
+	}
+
+	void writeJsonString(std::ostream& stream, const std::string& text)
+	{
+		stream << '"';
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				stream << '\\' << c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				stream << ' ';
+			}
+			else
+			{
+				stream << c;
+			}
+		}
+		stream << '"';
+	}
+}
+
+std::atomic<bool> CpuProfiler::enabled{ true };
+
+void CpuProfiler::setEnabled(bool enable)
+{
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+uint64_t CpuProfiler::now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - epoch).count());
+}
+
+void CpuProfiler::beginFrame()
+{
+	frameStart = now();
+}
+
+void CpuProfiler::endFrame()
+{
+	Frame frame;
+	frame.start = frameStart;
+	frame.end = now();
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (auto& buffer : buffers)
+		{
+			if (buffer->free) continue;
+			// retired before draining: everything the thread wrote is visible by now
+			bool retired = buffer->retired.load(std::memory_order_acquire);
+			drain(*buffer, frame.events);
+			buffer->free = retired;
+		}
+	}
+
+	// while switched off only what was still in flight comes in, the history stays as it was otherwise
+	if (!isEnabled() && frame.events.empty())
+	{
+		return;
+	}
+	frames.push_back(std::move(frame));
+	while (frames.size() > HISTORY_FRAMES)
+	{
+		frames.pop_front();
+	}
+}
+
+void CpuProfiler::setThreadName(const char* name)
+{
+	ThreadBuffer* buffer = localBuffer();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	threadNames[buffer->thread] = name;
+}
+
+const std::deque<CpuProfiler::Frame>& CpuProfiler::getFrames()
+{
+	return frames;
+}
+
+std::vector<std::string> CpuProfiler::getThreadNames()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return threadNames;
+}
+
+bool CpuProfiler::writeChromeTrace(const std::string& path)
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// timestamps in microseconds; one process, a track per thread
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	auto separator = [&]() { file << (first ? "\n" : ",\n"); first = false; };
+
+	std::vector<std::string> names = getThreadNames();
+	for (uint32_t thread = 0; thread < names.size(); thread++)
+	{
+		separator();
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":";
+		writeJsonString(file, names[thread]);
+		file << "}}";
+	}
+	for (const Frame& frame : frames)
+	{
+		for (const Event& event : frame.events)
+		{
+			separator();
+			file << "{\"name\":";
+			writeJsonString(file, event.name);
+			file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+				<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << '}';
+		}
+	}
+	file << "\n]}\n";
+	return file.good();
+}
+
+uint32_t CpuProfiler::enterZone()
+{
+	return registration.depth++;
+}
+
+void CpuProfiler::leaveZone(const char* name, uint64_t start, uint32_t depth)
+{
+	uint64_t end = now();
+	registration.depth = depth;
+
+	ThreadBuffer* buffer = localBuffer();
+	uint64_t index = buffer->written.load(std::memory_order_relaxed);
+	buffer->events[index & (THREAD_BUFFER_EVENTS - 1)] = { name, start, end, depth, buffer->thread };
+	buffer->written.store(index + 1, std::memory_order_release);
+}
@@ -0,0 +1,113 @@
+#pragma once
+// CpuProfiler.h
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// 0 compiles the zones out; with it on, a zone costs one relaxed load and a branch while
+// profiling is switched off
+#ifndef CPU_PROFILER
+#define CPU_PROFILER 1
+#endif
+
+// CPU frame profiler. CPU_PROFILE_ZONE("name") times the rest of its scope in nanoseconds and, when the
+// scope closes, appends the zone to the calling thread's own ring buffer. Only that thread writes the
+// buffer and only the main thread reads it, in endFrame, through one atomic count, so recording never
+// locks; a thread takes the registry lock once, for its first zone. Buffers of threads that exited are
+// handed to the next new thread, so short lived workers do not pile them up.
+// endFrame moves everything recorded since the last call into the frame history, which the UI timeline
+// and writeChromeTrace read.
+class CpuProfiler
+{
+public:
+	static constexpr uint32_t THREAD_BUFFER_EVENTS = 16384; // a power of two; a thread recording more per frame loses the oldest
+	static constexpr uint32_t HISTORY_FRAMES = 300;
+
+	struct Event
+	{
+		const char* name;   // zone names are string literals, only the pointer is kept
+		uint64_t start;     // nanoseconds since the profiler started
+		uint64_t end;
+		uint32_t depth;     // zones still open on the thread when this one began
+		uint32_t thread;    // index into getThreadNames()
+	};
+
+	struct Frame
+	{
+		uint64_t start = 0;
+		uint64_t end = 0;
+		std::vector<Event> events; // every thread, in the order the zones closed
+	};
+
+	static void setEnabled(bool enable);
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+	static uint64_t now();
+
+	// main thread, around each frame
+	static void beginFrame();
+	static void endFrame();
+
+	// the calling thread's name in the timeline and the trace; others are "Thread n"
+	static void setThreadName(const char* name);
+
+	static const std::deque<Frame>& getFrames(); // main thread only, oldest first
+	static std::vector<std::string> getThreadNames();
+	// the whole history as Chrome trace events (chrome://tracing, Perfetto)
+	static bool writeChromeTrace(const std::string& path);
+
+	// what CpuProfileZone goes through
+	static uint32_t enterZone();
+	static void leaveZone(const char* name, uint64_t start, uint32_t depth);
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+// Times its scope, or up to end() for sections that do not have a scope of their own. Zones on one
+// thread have to close in the reverse order they opened
+class CpuProfileZone
+{
+public:
+	explicit CpuProfileZone(const char* zoneName)
+		: name(zoneName), start(0), depth(0), active(false)
+	{
+#if CPU_PROFILER
+		active = CpuProfiler::isEnabled();
+		if (active)
+		{
+			depth = CpuProfiler::enterZone();
+			start = CpuProfiler::now();
+		}
+#endif
+	}
+
+	~CpuProfileZone() { end(); }
+
+	CpuProfileZone(const CpuProfileZone&) = delete;
+	CpuProfileZone& operator=(const CpuProfileZone&) = delete;
+
+	void end()
+	{
+		if (active)
+		{
+			CpuProfiler::leaveZone(name, start, depth);
+			active = false;
+		}
+	}
+
+private:
+	const char* name;
+	uint64_t start;
+	uint32_t depth;
+	bool active;
+};
+
+#if CPU_PROFILER
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+#define CPU_PROFILE_ZONE(name) CpuProfileZone CPU_PROFILE_CONCAT(cpuProfileZone, __LINE__)(name)
+#else
+#define CPU_PROFILE_ZONE(name)
+#endif
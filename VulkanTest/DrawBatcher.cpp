@@ -0,0 +1,40 @@
+#include "DrawBatcher.h"
+
+void DrawBatcher::build(const std::vector<RenderableObject>& renderables, const std::vector<DrawItem>& items,
+	bool wireframeMode, uint32_t instanceBase, uint32_t* instanceIds, std::vector<DrawBatch>& batches)
+{
+	batches.clear();
+
+	for (uint32_t i = 0; i < items.size(); i++)
+	{
+		const RenderableObject& renderable = renderables[items[i].renderableIndex];
+		PipelineHandle pipeline = wireframeMode ? renderable.material->wireframePipelineHandle : renderable.material->pipelineHandle;
+		instanceIds[i] = renderable.objectIndex;
+
+		if (!batches.empty())
+		{
+			DrawBatch& last = batches.back();
+			if (last.pipelineHandle == pipeline
+				&& last.material == renderable.material.get()
+				&& last.firstIndex == renderable.firstIndex
+				&& last.vertexOffset == renderable.vertexOffset
+				&& last.indexCount == renderable.indexCount
+				&& last.indexType == renderable.indexType)
+			{
+				last.instanceCount++;
+				continue;
+			}
+		}
+
+		DrawBatch batch{};
+		batch.firstIndex = renderable.firstIndex;
+		batch.vertexOffset = renderable.vertexOffset;
+		batch.indexCount = renderable.indexCount;
+		batch.indexType = renderable.indexType;
+		batch.material = renderable.material.get();
+		batch.pipelineHandle = pipeline;
+		batch.firstInstance = instanceBase + i;
+		batch.instanceCount = 1;
+		batches.push_back(batch);
+	}
+}
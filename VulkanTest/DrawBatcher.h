@@ -0,0 +1,19 @@
+#pragma once
+// DrawBatcher.h
+#include <vector>
+#include <cstdint>
+
+#include "Renderable.h"
+#include "DrawSorter.h"
+
+// Merges runs of sorted draws that share pipeline, material and mesh range into one instanced
+// draw. Each batch's object ids are written contiguously, the vertex shader reads them back
+// through gl_InstanceIndex, so ten thousand copies of one prop become a single draw.
+// Only neighbours are merged, which keeps blended draws in their back to front order.
+class DrawBatcher
+{
+public:
+	// instanceIds receives one object id per item; batch firstInstance values start at instanceBase
+	static void build(const std::vector<RenderableObject>& renderables, const std::vector<DrawItem>& items,
+		bool wireframeMode, uint32_t instanceBase, uint32_t* instanceIds, std::vector<DrawBatch>& batches);
+};
@@ -0,0 +1,97 @@
+#include "DrawSorter.h"
+
+#include <algorithm>
+#include <array>
+
+uint64_t DrawSorter::makeKey(bool blended, PipelineHandle pipeline, uint32_t materialId,
+	VkIndexType indexType, uint32_t meshId, float normalizedDepth)
+{
+	uint64_t depth = static_cast<uint64_t>(std::clamp(normalizedDepth, 0.0f, 1.0f) * 65535.0f);
+	uint64_t pipelineBits = static_cast<uint64_t>(pipeline) & 0xFFFu;
+	uint64_t materialBits = static_cast<uint64_t>(materialId) & 0xFFFFu;
+
+	if (blended)
+	{
+		return (1ull << 63)
+			| ((0xFFFFu - depth) << 47)
+			| (pipelineBits << 35)
+			| (materialBits << 19)
+			| (static_cast<uint64_t>(meshId) & 0x7FFFFu);
+	}
+
+	uint64_t indexTypeBits = indexType == VK_INDEX_TYPE_UINT8_EXT ? 0 : (indexType == VK_INDEX_TYPE_UINT16 ? 1 : 2);
+	return (pipelineBits << 51)
+		| (materialBits << 35)
+		| (indexTypeBits << 33)
+		| ((static_cast<uint64_t>(meshId) & 0x1FFFFu) << 16)
+		| depth;
+}
+
+void DrawSorter::sort(std::vector<DrawItem>& items)
+{
+	scratch.resize(items.size());
+
+	DrawItem* source = items.data();
+	DrawItem* destination = scratch.data();
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		std::array<uint32_t, 256> counts{};
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			counts[(source[i].key >> shift) & 0xFF]++;
+		}
+		if (items.empty() || counts[(source[0].key >> shift) & 0xFF] == items.size())
+		{
+			continue; // every key has the same byte here, the pass would not move anything
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t& count : counts)
+		{
+			uint32_t bucketSize = count;
+			count = offset;
+			offset += bucketSize;
+		}
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			destination[counts[(source[i].key >> shift) & 0xFF]++] = source[i];
+		}
+		std::swap(source, destination);
+	}
+
+	if (source != items.data())
+	{
+		std::copy(source, source + items.size(), items.data());
+	}
+}
+
+uint32_t DrawSorter::countBinds(const std::vector<RenderableObject>& renderables, const std::vector<DrawItem>& items, bool wireframeMode)
+{
+	uint32_t binds = 0;
+	PipelineHandle boundPipeline = INVALID_PIPELINE_HANDLE;
+	const Material* boundMaterial = nullptr;
+	VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+	for (const DrawItem& item : items)
+	{
+		const RenderableObject& renderable = renderables[item.renderableIndex];
+		PipelineHandle pipeline = wireframeMode ? renderable.material->wireframePipelineHandle : renderable.material->pipelineHandle;
+
+		if (pipeline != boundPipeline)
+		{
+			boundPipeline = pipeline;
+			binds++;
+		}
+		if (renderable.material.get() != boundMaterial)
+		{
+			boundMaterial = renderable.material.get();
+			binds++;
+		}
+		if (renderable.indexType != boundIndexType)
+		{
+			boundIndexType = renderable.indexType;
+			binds++;
+		}
+	}
+	return binds;
+}
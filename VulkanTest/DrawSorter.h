@@ -0,0 +1,38 @@
+#pragma once
+// DrawSorter.h
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "Renderable.h"
+#include "VulkanPipelineLibrary.h"
+
+// One draw: its 64 bit sort key and the renderable it came from
+struct DrawItem
+{
+	uint64_t key;
+	uint32_t renderableIndex;
+};
+
+// Orders draws so consecutive ones share as much state as possible.
+// Key layout, most significant first:
+//   opaque:  [63] 0 | [62..51] pipeline | [50..35] material | [34..33] index type | [32..16] mesh | [15..0] depth, front to back
+//   blended: [63] 1 | [62..47] depth, back to front | [46..35] pipeline | [34..19] material | [18..0] mesh
+// so opaque draws come first grouped by state, and blended draws stay correctly ordered.
+// Fields are truncated to their width; a collision only costs a redundant bind.
+class DrawSorter
+{
+public:
+	static uint64_t makeKey(bool blended, PipelineHandle pipeline, uint32_t materialId,
+		VkIndexType indexType, uint32_t meshId, float normalizedDepth);
+
+	// LSD radix sort on the key, 8 bits per pass; passes where every key shares the byte are skipped
+	void sort(std::vector<DrawItem>& items);
+
+	// pipeline, material and index buffer binds VulkanRenderer would issue for this order
+	static uint32_t countBinds(const std::vector<RenderableObject>& renderables, const std::vector<DrawItem>& items, bool wireframeMode);
+
+private:
+	std::vector<DrawItem> scratch;
+};
@@ -0,0 +1,202 @@
+#include "FrustumCuller.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <thread>
+
+#include <immintrin.h>
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+{
+	// Gribb / Hartmann: glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	auto row = [&viewProjection](int i)
+	{
+		return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	};
+
+	Frustum frustum{};
+	frustum.planes[0] = row(3) + row(0); // left
+	frustum.planes[1] = row(3) - row(0); // right
+	frustum.planes[2] = row(3) + row(1); // bottom (top once y is flipped, the pair is the same)
+	frustum.planes[3] = row(3) - row(1); // top
+	frustum.planes[4] = row(3) + row(2); // near, conservative for a [0, 1] depth range
+	frustum.planes[5] = row(3) - row(2); // far
+	return frustum;
+}
+
+bool Frustum::intersects(const BoundingVolume& worldBounds) const
+{
+	for (const glm::vec4& plane : planes)
+	{
+		glm::vec3 normal(plane);
+		float distance = glm::dot(normal, worldBounds.center) + plane.w;
+		float reach = glm::dot(glm::abs(normal), worldBounds.extents);
+		if (distance + reach < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FrustumCuller::resize(uint32_t count)
+{
+	objectCount = count;
+	size_t padded = ((count + LANE_PADDING - 1) / LANE_PADDING) * LANE_PADDING;
+	centerX.resize(padded, 0.0f);
+	centerY.resize(padded, 0.0f);
+	centerZ.resize(padded, 0.0f);
+	extentX.resize(padded, 0.0f);
+	extentY.resize(padded, 0.0f);
+	extentZ.resize(padded, 0.0f);
+	visibility.resize(padded, 0);
+}
+
+void FrustumCuller::setBounds(uint32_t index, const BoundingVolume& worldBounds)
+{
+	centerX[index] = worldBounds.center.x;
+	centerY[index] = worldBounds.center.y;
+	centerZ[index] = worldBounds.center.z;
+	extentX[index] = worldBounds.extents.x;
+	extentY[index] = worldBounds.extents.y;
+	extentZ[index] = worldBounds.extents.z;
+}
+
+void FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visibleIndices)
+{
+	CPU_PROFILE_ZONE("Frustum Cull");
+	visibleIndices.clear();
+
+	uint32_t workers = 1;
+	if (objectCount >= PARALLEL_THRESHOLD)
+	{
+		workers = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_WORKERS);
+	}
+
+	if (workers == 1)
+	{
+		cullRange(frustum, 0, objectCount);
+	}
+	else
+	{
+		// chunks start on a lane boundary so no two workers touch the same SIMD group
+		uint32_t chunk = (objectCount + workers - 1) / workers;
+		chunk = ((chunk + LANE_PADDING - 1) / LANE_PADDING) * LANE_PADDING;
+
+		std::vector<std::future<void>> jobs;
+		for (uint32_t begin = chunk; begin < objectCount; begin += chunk)
+		{
+			uint32_t end = std::min(begin + chunk, objectCount);
+			jobs.push_back(std::async(std::launch::async, [this, &frustum, begin, end]()
+			{
+				cullRange(frustum, begin, end);
+			}));
+		}
+		cullRange(frustum, 0, std::min(chunk, objectCount)); // the calling thread takes the first chunk
+		for (auto& job : jobs)
+		{
+			job.get();
+		}
+	}
+
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		if (visibility[i])
+		{
+			visibleIndices.push_back(i);
+		}
+	}
+	visibleCount = static_cast<uint32_t>(visibleIndices.size());
+}
+
+void FrustumCuller::cullRange(const Frustum& frustum, uint32_t begin, uint32_t end)
+{
+	CPU_PROFILE_ZONE("Cull Range");
+	// A box is outside once its most positive corner along a plane normal is behind that plane:
+	// dot(n, c) + dot(|n|, e) + w < 0. Padding lanes are computed but never read back.
+#if defined(__AVX__)
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+		planeX[p] = _mm256_set1_ps(plane.x);
+		planeY[p] = _mm256_set1_ps(plane.y);
+		planeZ[p] = _mm256_set1_ps(plane.z);
+		planeW[p] = _mm256_set1_ps(plane.w);
+		absX[p] = _mm256_set1_ps(std::fabs(plane.x));
+		absY[p] = _mm256_set1_ps(std::fabs(plane.y));
+		absZ[p] = _mm256_set1_ps(std::fabs(plane.z));
+	}
+	const __m256 zero = _mm256_setzero_ps();
+
+	for (uint32_t i = begin; i < end; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(&centerX[i]);
+		__m256 cy = _mm256_loadu_ps(&centerY[i]);
+		__m256 cz = _mm256_loadu_ps(&centerZ[i]);
+		__m256 ex = _mm256_loadu_ps(&extentX[i]);
+		__m256 ey = _mm256_loadu_ps(&extentY[i]);
+		__m256 ez = _mm256_loadu_ps(&extentZ[i]);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(planeZ[p], cz));
+			distance = _mm256_add_ps(distance, planeW[p]);
+			__m256 reach = _mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey));
+			reach = _mm256_add_ps(reach, _mm256_mul_ps(absZ[p], ez));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		for (uint32_t lane = 0; lane < 8; lane++)
+		{
+			visibility[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+		}
+	}
+#else
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+		planeX[p] = _mm_set1_ps(plane.x);
+		planeY[p] = _mm_set1_ps(plane.y);
+		planeZ[p] = _mm_set1_ps(plane.z);
+		planeW[p] = _mm_set1_ps(plane.w);
+		absX[p] = _mm_set1_ps(std::fabs(plane.x));
+		absY[p] = _mm_set1_ps(std::fabs(plane.y));
+		absZ[p] = _mm_set1_ps(std::fabs(plane.z));
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	for (uint32_t i = begin; i < end; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(&centerX[i]);
+		__m128 cy = _mm_loadu_ps(&centerY[i]);
+		__m128 cz = _mm_loadu_ps(&centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&extentX[i]);
+		__m128 ey = _mm_loadu_ps(&extentY[i]);
+		__m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy));
+			distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[p], cz));
+			distance = _mm_add_ps(distance, planeW[p]);
+			__m128 reach = _mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey));
+			reach = _mm_add_ps(reach, _mm_mul_ps(absZ[p], ez));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			visibility[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+		}
+	}
+#endif
+}
@@ -0,0 +1,51 @@
+#pragma once
+// FrustumCuller.h
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "BoundingVolume.h"
+
+// Six planes (xyz normal pointing inside, w distance), extracted from a view projection matrix
+struct Frustum
+{
+	glm::vec4 planes[6];
+
+	static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+	// single box test, for the few objects that are not worth a batched cull
+	bool intersects(const BoundingVolume& worldBounds) const;
+};
+
+// Frustum culls world space boxes kept in structure-of-arrays form, so one SIMD plane test
+// covers 4 (SSE) or 8 (AVX builds) objects. Large scenes are split across worker threads.
+// Indices are whatever the caller uses, the engine passes renderable indices.
+class FrustumCuller
+{
+public:
+	static constexpr uint32_t PARALLEL_THRESHOLD = 8192; // below this a single thread is faster
+	static constexpr uint32_t MAX_WORKERS = 8;
+
+	void resize(uint32_t count);
+	void setBounds(uint32_t index, const BoundingVolume& worldBounds);
+
+	// fills visibleIndices in ascending order
+	void cull(const Frustum& frustum, std::vector<uint32_t>& visibleIndices);
+
+	uint32_t getObjectCount() const { return objectCount; }
+	uint32_t getVisibleCount() const { return visibleCount; }
+	uint32_t getCulledCount() const { return objectCount - visibleCount; }
+
+private:
+	static constexpr uint32_t LANE_PADDING = 8; // arrays are padded so the last SIMD load stays in bounds
+
+	uint32_t objectCount = 0;
+	uint32_t visibleCount = 0;
+
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	std::vector<uint8_t> visibility;
+
+	void cullRange(const Frustum& frustum, uint32_t begin, uint32_t end);
+};
@@ -6,14 +6,21 @@
 
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+
 #include "Window.h"
 #include "VulkanDevice.h"
 #include "VulkanSurface.h"
 #include "VulkanSwapChain.h"
 #include "VulkanCommandPool.h"
-#include "VulkanRenderPass.h"
 #include "VulkanUniformBuffers.h"
 #include "VulkanGlobals.h"
+#include "VulkanClusteredLighting.h"
+#include "VulkanDynamicResolution.h"
+#include "VulkanGpuProfiler.h"
+#include "CpuProfiler.h"
 #include "Renderable.h"
 
 ImGuiManager::ImGuiManager(
@@ -22,7 +29,9 @@ ImGuiManager::ImGuiManager(
 	VulkanDevice& device,
     VulkanSurface& surface,
 	VulkanSwapChain& swapchain, 
-	VulkanCommandPool& commandPool) :
+	VulkanCommandPool& commandPool,
+    VkRenderPass renderPass,
+    uint32_t subpass) :
 	m_device(device)
 {
 
@@ -52,8 +61,6 @@ ImGuiManager::ImGuiManager(
         throw std::runtime_error("Failed to create descriptor pool for ImGui!");
     }
 
-    initRenderPass(swapchain.getImageFormat());
-
     ImGui::CreateContext();
 
     ImGuiIO& io = ImGui::GetIO();
@@ -67,12 +74,12 @@ ImGuiManager::ImGuiManager(
     init_info.Instance = instance.getVkInstance();
     init_info.PhysicalDevice = device.getPhysicalDevice();
     init_info.Device = device.getLogicalDevice();
-    init_info.RenderPass = m_renderPass;
+    init_info.RenderPass = renderPass; // the UI is a subpass of the frame graph's scene render pass
     init_info.QueueFamily = findQueueFamilies(device.getPhysicalDevice(), surface.getVkSurface()).graphicsFamily.value();
     init_info.Queue = device.getGraphicsQueue();
     init_info.PipelineCache = VK_NULL_HANDLE;
     init_info.DescriptorPool = m_descriptorPool;
-    init_info.Subpass = 0;
+    init_info.Subpass = subpass;
     init_info.MinImageCount = VulkanGlobals::MAX_FRAMES_IN_FLIGHT;
     init_info.ImageCount = static_cast<uint32_t>(swapchain.getImageViews().size());
     init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
@@ -91,7 +98,6 @@ ImGuiManager::~ImGuiManager()
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
-    vkDestroyRenderPass(m_device.getLogicalDevice(), m_renderPass, nullptr);
     vkDestroyDescriptorPool(m_device.getLogicalDevice(), m_descriptorPool, nullptr);
 }
 
@@ -108,24 +114,14 @@ void ImGuiManager::buildUI(SceneDebugContextPacket& sceneDebugContextPacket)
 {
     drawControlPanel(sceneDebugContextPacket);
     drawLightingPanel(sceneDebugContextPacket);
+    drawGpuProfilerPanel(sceneDebugContextPacket);
+    drawCpuProfilerPanel();
 }
 
-void ImGuiManager::render(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, VkExtent2D swapChainExtent)
+void ImGuiManager::render(VkCommandBuffer commandBuffer)
 {
     ImGui::Render();
-
-    VkRenderPassBeginInfo info = {};
-    info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    info.renderPass = m_renderPass;
-    info.framebuffer = framebuffer;
-    info.renderArea.extent = swapChainExtent;
-    info.renderArea.offset = { 0, 0 };
-    info.clearValueCount = 0;
-    info.pClearValues = nullptr;
-
-    vkCmdBeginRenderPass(commandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
     ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
-    vkCmdEndRenderPass(commandBuffer);
 }
 
 
@@ -143,61 +139,221 @@ void ImGuiManager::check_vk_result(VkResult err)
     }
 }
 
-VkRenderPass ImGuiManager::getRenderPass() const
+void ImGuiManager::drawControlPanel(SceneDebugContextPacket& sceneDebugContextPacket)
 {
-    return m_renderPass;
+    ImGui::Begin("Engine Controls");
+    ImGui::Checkbox("Wireframe Mode", &sceneDebugContextPacket.wireframeMode);
+    ImGui::Text("Renderables: %u visible, %u culled", sceneDebugContextPacket.visibleRenderables, sceneDebugContextPacket.culledRenderables);
+    if (sceneDebugContextPacket.gpuCulling && *sceneDebugContextPacket.gpuCulling)
+    {
+        ImGui::Text("GPU culled: %u frustum, %u occlusion", sceneDebugContextPacket.frustumCulledObjects, sceneDebugContextPacket.occlusionCulledObjects);
+    }
+    ImGui::Text("State binds: %u unsorted, %u sorted", sceneDebugContextPacket.bindsUnsorted, sceneDebugContextPacket.bindsSorted);
+    ImGui::Text("Draw calls: %u", sceneDebugContextPacket.drawCalls);
+    if (sceneDebugContextPacket.gpuCulling)
+    {
+        ImGui::Checkbox("GPU Culling", sceneDebugContextPacket.gpuCulling);
+    }
+    if (sceneDebugContextPacket.occlusionCulling)
+    {
+        ImGui::Checkbox("Hi-Z Occlusion Culling", sceneDebugContextPacket.occlusionCulling);
+    }
+    if (sceneDebugContextPacket.depthPrepass)
+    {
+        ImGui::Checkbox("Depth Pre-pass", sceneDebugContextPacket.depthPrepass);
+    }
+    if (sceneDebugContextPacket.animateObjects)
+    {
+        ImGui::Checkbox("Animate Dynamic Objects", sceneDebugContextPacket.animateObjects);
+    }
+    if (sceneDebugContextPacket.commandReplay)
+    {
+        ImGui::Checkbox("Replay Scene Commands", sceneDebugContextPacket.commandReplay);
+        ImGui::Text("Scene commands: %s, %llu recordings", sceneDebugContextPacket.sceneCommandsReplayed ? "replayed" : "recorded",
+            static_cast<unsigned long long>(sceneDebugContextPacket.sceneCommandRecords));
+    }
+    if (sceneDebugContextPacket.overdraw > 0.0f)
+    {
+        ImGui::Text("Overdraw: %.2f fragments per pixel", sceneDebugContextPacket.overdraw);
+    }
+    if (sceneDebugContextPacket.renderScale)
+    {
+        if (sceneDebugContextPacket.dynamicResolution)
+        {
+            ImGui::Checkbox("Dynamic Resolution", sceneDebugContextPacket.dynamicResolution);
+        }
+        if (sceneDebugContextPacket.dynamicResolution && *sceneDebugContextPacket.dynamicResolution)
+        {
+            ImGui::SliderFloat("Target GPU ms", sceneDebugContextPacket.targetFrameTime, 4.0f, 50.0f, "%.1f");
+        }
+        else
+        {
+            ImGui::SliderFloat("Render Scale", sceneDebugContextPacket.renderScale,
+                VulkanDynamicResolution::MIN_SCALE, VulkanDynamicResolution::MAX_SCALE, "%.2f");
+        }
+        ImGui::Text("Render resolution: %ux%u (%.0f%%), GPU %.2f ms",
+            sceneDebugContextPacket.renderExtent.width, sceneDebugContextPacket.renderExtent.height,
+            *sceneDebugContextPacket.renderScale * 100.0f, sceneDebugContextPacket.gpuFrameTime);
+    }
+    ImGui::Text("Render graph: %u passes (%u culled), %u render passes, %u barriers",
+        sceneDebugContextPacket.graphPasses, sceneDebugContextPacket.graphCulledPasses,
+        sceneDebugContextPacket.graphRenderPasses, sceneDebugContextPacket.graphBarriers);
+    /*ImGui::SliderFloat("Tessellation Level", &sceneDebugContextPacket.tessellationUbo.tessellationLevel, 1.0f, 64.0f);
+    ImGui::SliderFloat("Displacement Scale", &sceneDebugContextPacket.tessellationUbo.displacementScale, 0.0f, 0.2f);*/
+    ImGui::End();
 }
 
-void ImGuiManager::initRenderPass(VkFormat swapChainFormat)
+void ImGuiManager::drawGpuProfilerPanel(SceneDebugContextPacket& sceneDebugContextPacket)
 {
-    
-    VkAttachmentDescription attachment = {};
-    attachment.format = swapChainFormat;
-    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
-    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference color_attachment = {};
-    color_attachment.attachment = 0;
-    color_attachment.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &color_attachment;
-
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo info = {};
-    info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    info.attachmentCount = 1;
-    info.pAttachments = &attachment;
-    info.subpassCount = 1;
-    info.pSubpasses = &subpass;
-    info.dependencyCount = 1;
-    info.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(m_device.getLogicalDevice(), &info, nullptr, &m_renderPass) != VK_SUCCESS) { // You might need a way to set the handle in your class
-        throw std::runtime_error("Could not create Dear ImGui's render pass");
+    VulkanGpuProfiler* profiler = sceneDebugContextPacket.gpuProfiler;
+    if (!profiler)
+    {
+        return;
+    }
+
+    ImGui::Begin("GPU Profiler");
+    bool enabled = profiler->isEnabled();
+    if (ImGui::Checkbox("Enabled", &enabled))
+    {
+        profiler->setEnabled(enabled);
+    }
+    bool capturing = profiler->isCapturingCsv();
+    if (ImGui::Checkbox("Write gpu_profile.csv", &capturing))
+    {
+        if (capturing)
+        {
+            profiler->startCsvCapture("gpu_profile.csv");
+        }
+        else
+        {
+            profiler->stopCsvCapture();
+        }
+    }
+
+    // every zone scales to its own peak, the overlay gives the average
+    for (const VulkanGpuProfiler::Zone& zone : profiler->getZones())
+    {
+        char overlay[32];
+        std::snprintf(overlay, sizeof(overlay), "%.3f ms", zone.average);
+        ImGui::PlotLines(zone.name.c_str(), zone.history.data(), static_cast<int>(zone.history.size()),
+            static_cast<int>(profiler->getHistoryOffset()), overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
     }
+
+    if (!profiler->getBakeZones().empty())
+    {
+        ImGui::Separator();
+        ImGui::Text("IBL bake");
+        for (const VulkanGpuProfiler::BakeZone& zone : profiler->getBakeZones())
+        {
+            ImGui::Text("%s: %.3f ms", zone.name.c_str(), zone.milliseconds);
+        }
+    }
+    ImGui::End();
 }
 
-void ImGuiManager::drawControlPanel(SceneDebugContextPacket& sceneDebugContextPacket)
+void ImGuiManager::drawCpuProfilerPanel()
 {
-    ImGui::Begin("Engine Controls");
-    ImGui::Checkbox("Wireframe Mode", &sceneDebugContextPacket.wireframeMode);
-    /*ImGui::SliderFloat("Tessellation Level", &sceneDebugContextPacket.tessellationUbo.tessellationLevel, 1.0f, 64.0f);
-    ImGui::SliderFloat("Displacement Scale", &sceneDebugContextPacket.tessellationUbo.displacementScale, 0.0f, 0.2f);*/
+    ImGui::Begin("CPU Profiler");
+    // switching recording off freezes the history, the slider below then picks the frame to inspect
+    bool enabled = CpuProfiler::isEnabled();
+    if (ImGui::Checkbox("Enabled", &enabled))
+    {
+        CpuProfiler::setEnabled(enabled);
+        m_CpuProfilerFrame = 0;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Write cpu_trace.json"))
+    {
+        m_CpuTraceStatus = CpuProfiler::writeChromeTrace("cpu_trace.json") ? "written" : "failed";
+    }
+    if (m_CpuTraceStatus)
+    {
+        ImGui::SameLine();
+        ImGui::Text("%s", m_CpuTraceStatus);
+    }
+
+    const std::deque<CpuProfiler::Frame>& frames = CpuProfiler::getFrames();
+    if (frames.empty())
+    {
+        ImGui::End();
+        return;
+    }
+
+    std::vector<float> frameTimes;
+    frameTimes.reserve(frames.size());
+    for (const CpuProfiler::Frame& frame : frames)
+    {
+        frameTimes.push_back(static_cast<float>(frame.end - frame.start) / 1000000.0f);
+    }
+    // capped at two 60 Hz frames so the startup frame does not flatten the rest
+    ImGui::PlotHistogram("Frames", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, nullptr,
+        0.0f, 33.3f, ImVec2(0.0f, 50.0f));
+
+    int last = static_cast<int>(frames.size()) - 1;
+    if (enabled)
+    {
+        m_CpuProfilerFrame = 0;
+    }
+    else
+    {
+        ImGui::SliderInt("Frames back", &m_CpuProfilerFrame, 0, last);
+    }
+    m_CpuProfilerFrame = std::min(std::max(m_CpuProfilerFrame, 0), last);
+    const CpuProfiler::Frame& frame = frames[last - m_CpuProfilerFrame];
+    uint64_t frameDuration = std::max<uint64_t>(frame.end - frame.start, 1);
+    ImGui::Text("Frame: %.3f ms, %zu zones", frameDuration / 1000000.0, frame.events.size());
+
+    // a row per thread, a lane per nesting depth; zones are cut to the frame, some start before it
+    std::vector<std::string> threadNames = CpuProfiler::getThreadNames();
+    std::vector<int> threadDepths(threadNames.size(), -1);
+    for (const CpuProfiler::Event& event : frame.events)
+    {
+        if (event.thread < threadDepths.size())
+        {
+            threadDepths[event.thread] = std::max(threadDepths[event.thread], static_cast<int>(event.depth));
+        }
+    }
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+    float laneHeight = ImGui::GetTextLineHeightWithSpacing();
+    for (uint32_t thread = 0; thread < threadNames.size(); thread++)
+    {
+        if (threadDepths[thread] < 0) continue;
+
+        ImGui::Text("%s", threadNames[thread].c_str());
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImGui::PushID(static_cast<int>(thread));
+        ImGui::InvisibleButton("timeline", ImVec2(width, laneHeight * (threadDepths[thread] + 1)));
+        bool rowHovered = ImGui::IsItemHovered();
+        ImGui::PopID();
+
+        for (const CpuProfiler::Event& event : frame.events)
+        {
+            if (event.thread != thread || event.end < frame.start || event.start > frame.end) continue;
+
+            uint64_t start = std::max(event.start, frame.start) - frame.start;
+            uint64_t end = std::min(event.end, frame.end) - frame.start;
+            ImVec2 min(origin.x + width * static_cast<float>(start) / frameDuration, origin.y + laneHeight * event.depth);
+            ImVec2 max(std::max(origin.x + width * static_cast<float>(end) / frameDuration, min.x + 1.0f), min.y + laneHeight - 1.0f);
+
+            // the colour follows the name, so a zone keeps it from frame to frame
+            uint32_t hash = 2166136261u;
+            for (const char* c = event.name; *c; c++)
+            {
+                hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+            }
+            drawList->AddRectFilled(min, max, ImColor::HSV((hash % 360) / 360.0f, 0.55f, 0.75f));
+            drawList->PushClipRect(min, max, true);
+            drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32(255, 255, 255, 255), event.name);
+            drawList->PopClipRect();
+
+            if (rowHovered && ImGui::IsMouseHoveringRect(min, max))
+            {
+                ImGui::SetTooltip("%s: %.3f ms", event.name, (event.end - event.start) / 1000000.0);
+            }
+        }
+    }
     ImGui::End();
 }
 
@@ -212,6 +368,24 @@ void ImGuiManager::drawLightingPanel(SceneDebugContextPacket& sceneDebugContextP
 
     ImGui::ColorEdit3("Color", &sceneDebugContextPacket.sceneLighingUbo.dirLight.color.r);
     ImGui::DragFloat("Intensity", &sceneDebugContextPacket.sceneLighingUbo.dirLight.color.w, 0.1f, 0.0f, 100.0f); // 'w' is intensity
+    if (sceneDebugContextPacket.shadows)
+    {
+        ImGui::Checkbox("Shadows", sceneDebugContextPacket.shadows);
+    }
+    ImGui::Text("Shadow cascades redrawn: %u of %u, %u draws", sceneDebugContextPacket.shadowCascadesDrawn,
+        SHADOW_CASCADE_COUNT, sceneDebugContextPacket.shadowBatches);
+
+    ImGui::Separator();
+    ImGui::Text("Point / Spot Lights");
+    if (sceneDebugContextPacket.localLights)
+    {
+        ImGui::Checkbox("Enabled", sceneDebugContextPacket.localLights);
+    }
+    ImGui::Text("Lights: %u", sceneDebugContextPacket.localLightCount);
+    ImGui::Text("Clusters: %u x %u x %u", VulkanClusteredLighting::CLUSTER_X, VulkanClusteredLighting::CLUSTER_Y, VulkanClusteredLighting::CLUSTER_Z);
+    ImGui::Text("Lights per cluster: %.2f avg, %u max",
+        static_cast<float>(sceneDebugContextPacket.clusterLightIndices) / VulkanClusteredLighting::CLUSTER_COUNT,
+        sceneDebugContextPacket.busiestClusterLights);
 
     ImGui::End();
 }
@@ -21,7 +21,9 @@ public:
 		VulkanDevice& device,
 		VulkanSurface& surface,
 		VulkanSwapChain& swapchain,
-		VulkanCommandPool& commandPool
+		VulkanCommandPool& commandPool,
+		VkRenderPass renderPass,
+		uint32_t subpass
 	);
 	~ImGuiManager();
 
@@ -32,21 +34,23 @@ public:
 	//void buildUI(bool& wireframeMode, TessellationUBO& tessUboData); // passing state
 	void buildUI(SceneDebugContextPacket& sceneDebugContextPacket);
 	//void render(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer);
-	void render(VkCommandBuffer commandBuffer, VkFramebuffer framebuffer, VkExtent2D swapChainExtent);
+	// inside the render pass and subpass given to the constructor
+	void render(VkCommandBuffer commandBuffer);
 
 	static void check_vk_result(VkResult err);
 
-	VkRenderPass getRenderPass() const;
-
 private:
-	void initRenderPass(VkFormat swapChainFormat);
 	//VkExtent2D m_swapChainExtent;
 	VulkanDevice& m_device;
 	VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
-	VkRenderPass m_renderPass = VK_NULL_HANDLE;
 
 	void drawControlPanel(SceneDebugContextPacket& sceneDebugContextPacket);
 	void drawLightingPanel(SceneDebugContextPacket& sceneDebugContextPacket);
 	void drawObjectsPanel(SceneDebugContextPacket& sceneDebugContextPacket);
+	void drawGpuProfilerPanel(SceneDebugContextPacket& sceneDebugContextPacket);
+	void drawCpuProfilerPanel();
+
+	int m_CpuProfilerFrame = 0;              // frames back from the newest, picked while recording is off
+	const char* m_CpuTraceStatus = nullptr;  // outcome of the last trace dump
 };
 
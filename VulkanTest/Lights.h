@@ -1,6 +1,7 @@
 #pragma once
 // Lights.h
 #include <glm/glm.hpp>
+#include <cstdint>
 
 struct DirectionalLight
 {
@@ -8,10 +9,49 @@ struct DirectionalLight
 	glm::vec4 color;     // w component is intensity
 };
 
+struct PointLight
+{
+	glm::vec3 position;
+	float range;         // no light reaches past this, also bounds the light for clustering
+	glm::vec4 color;     // w component is intensity
+};
+
+struct SpotLight
+{
+	glm::vec3 position;
+	float range;
+	glm::vec3 direction;
+	float innerAngle;    // radians from the axis, full intensity inside
+	glm::vec4 color;     // w component is intensity
+	float outerAngle;    // radians, no light outside
+};
+
+
+constexpr uint32_t SHADOW_CASCADE_COUNT = 4; // cascadeViewProjection[4] in shader.frag
 
 // this structure gets sent to the GPU
 struct SceneLightingUBO
 {
 	DirectionalLight dirLight;
 	glm::vec4 viewPosition; // camera
-};
\ No newline at end of file
+	// directional light shadows, written by VulkanShadowCascades::writeLighting
+	glm::mat4 cascadeViewProjection[SHADOW_CASCADE_COUNT];
+	glm::vec4 cascadeSplits;     // view depth each cascade reaches
+	glm::vec4 cascadeTexelSizes; // world units per shadow map texel
+	glm::vec4 shadowParams;      // x shadows on, y depth bias, z normal offset in texels, w 1 / shadow map size
+};
+
+// point and spot lights in one storage buffer, mirrors Light in shader.frag and cluster.comp (std430)
+constexpr uint32_t GPU_LIGHT_POINT = 0;
+constexpr uint32_t GPU_LIGHT_SPOT = 1;
+
+struct GpuLight
+{
+	glm::vec4 position;  // xyz world position, w range
+	glm::vec4 color;     // w component is intensity
+	glm::vec4 direction; // xyz spot direction, unused for point lights
+	float spotCosInner;
+	float spotCosOuter;
+	uint32_t type;       // GPU_LIGHT_POINT or GPU_LIGHT_SPOT
+	uint32_t padding;
+};
@@ -6,6 +6,7 @@
 #include "VulkanTexture.h"
 #include "VulkanGlobals.h"
 #include "MaterialPBR.h"
+#include "VulkanPipelineLibrary.h"
 class VulkanTexture;
 
 //struct Material
@@ -62,6 +63,33 @@ struct Material
 	std::vector<VkDescriptorSet> frameSpecificDescriptorSets;
 	bool doubleSided = false;
 
+	enum class AlphaMode { OPAQUE_MODE, MASK_MODE, BLEND_MODE };
+	AlphaMode alphaMode = AlphaMode::OPAQUE_MODE;
+	float alphaCutoff = 0.5f;
+
+	// handles into VulkanPipelineLibrary, assigned once the material is loaded
+	PipelineHandle pipelineHandle = INVALID_PIPELINE_HANDLE;
+	PipelineHandle wireframePipelineHandle = INVALID_PIPELINE_HANDLE;
+	// depth pre-pass variants, only opaque materials get them
+	PipelineHandle depthOnlyPipelineHandle = INVALID_PIPELINE_HANDLE;
+	PipelineHandle depthEqualPipelineHandle = INVALID_PIPELINE_HANDLE; // main pass once depth is laid down
+
+	// small dense id for draw sort keys, assigned when AssetManager caches the material
+	uint32_t sortId = 0;
+
+	// slot in the bindless material buffer, UINT32_MAX until VulkanBindlessMaterials registers it
+	uint32_t bindlessIndex = UINT32_MAX;
+
 	Material() : frameSpecificDescriptorSets(VulkanGlobals::MAX_FRAMES_IN_FLIGHT) {}
 
+	// the maps shader.frag has to sample, picks the pipeline variant (MaterialFeatureBits)
+	uint32_t getFeatureMask() const
+	{
+		uint32_t mask = 0;
+		if (uboData.hasAlbedoMap) mask |= MATERIAL_FEATURE_ALBEDO_MAP;
+		if (uboData.hasMetallicRoughnessMap) mask |= MATERIAL_FEATURE_METALLIC_ROUGHNESS_MAP;
+		if (uboData.hasOcclusionMap) mask |= MATERIAL_FEATURE_OCCLUSION_MAP;
+		if (uboData.hasEmissiveMap) mask |= MATERIAL_FEATURE_EMISSIVE_MAP;
+		return mask;
+	}
 };
\ No newline at end of file
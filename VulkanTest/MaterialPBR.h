@@ -1,6 +1,7 @@
 #pragma once
 // MaterialPBR.h
 #include <glm/glm.hpp>
+#include <cstdint>
 
 struct MaterialUBO {
     alignas(16) glm::vec4 baseColorFactor;
@@ -15,7 +16,30 @@ struct MaterialUBO {
     alignas(4) int hasOcclusionMap;
     alignas(4) int hasEmissiveMap;
 
-    alignas(4) float padding1;
-    alignas(4) int padding2;
+    alignas(4) float alphaCutoff;
+    alignas(4) int alphaMode; // 0 opaque, 1 mask, 2 blend (matches Material::AlphaMode)
     alignas(4) int padding3;
-};
\ No newline at end of file
+};
+
+// std430 element of the bindless material buffer (shader.frag with BINDLESS).
+// Texture fields index the global texture array, BINDLESS_NO_TEXTURE when the map is absent.
+constexpr uint32_t BINDLESS_NO_TEXTURE = 0xFFFFFFFFu;
+
+struct BindlessMaterialData {
+    alignas(16) glm::vec4 baseColorFactor;
+    alignas(16) glm::vec4 emissiveFactor;
+
+    alignas(4) float metallicFactor;
+    alignas(4) float roughnessFactor;
+    alignas(4) float alphaCutoff;
+    alignas(4) int alphaMode;
+
+    alignas(4) uint32_t albedoTexture;
+    alignas(4) uint32_t normalTexture;
+    alignas(4) uint32_t metallicRoughnessTexture;
+    alignas(4) uint32_t occlusionTexture;
+    alignas(4) uint32_t emissiveTexture;
+    alignas(4) uint32_t padding0;
+    alignas(4) uint32_t padding1;
+    alignas(4) uint32_t padding2;
+};
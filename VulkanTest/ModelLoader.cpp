@@ -15,6 +15,7 @@
 #include <iostream>
 #include "Material.h"
 #include "VulkanTexture.h"
+#include "TransformSystem.h"
 
 
 
@@ -517,7 +518,7 @@ void ModelLoader::createPrimitive(float radius, PrimitiveModelType modelType, st
 	}
 }
 
-GltfLoadResult ModelLoader::loadGLTFModelWithMaterials(const std::string& path, VkDevice device, VkPhysicalDevice physicalDevice, VkQueue graphicsQueue, VkCommandPool commandPool)
+GltfLoadResult ModelLoader::loadGLTFModelWithMaterials(const std::string& path, VkDevice device, VkPhysicalDevice physicalDevice, VulkanMemoryAllocator& allocator, VkQueue graphicsQueue, VkCommandPool commandPool)
 {
 	tinygltf::Model model;
 	tinygltf::TinyGLTF loader;
@@ -547,7 +548,7 @@ GltfLoadResult ModelLoader::loadGLTFModelWithMaterials(const std::string& path,
 			}
 		}
 		std::cout << "Loading texture: " << model.images[model.textures[i].source].uri << std::endl;
-		result.textures[i] = loadGltfTexture(model, static_cast<int>(i), device, physicalDevice, graphicsQueue, commandPool, path, isSrgb);
+		result.textures[i] = loadGltfTexture(model, static_cast<int>(i), device, physicalDevice, allocator, graphicsQueue, commandPool, path, isSrgb);
 	}
 	// --- 2. Load Materials ---
 	result.materials.reserve(model.materials.size());
@@ -555,7 +556,7 @@ GltfLoadResult ModelLoader::loadGLTFModelWithMaterials(const std::string& path,
 		result.materials.push_back(createMaterialFromGltf(model, gltfMaterial, result.textures, path, device, physicalDevice, graphicsQueue, commandPool));
 	}
 	if (result.materials.empty()) {
-		result.materials.push_back(createDefaultGltfMaterial("DefaultMaterial", device, physicalDevice, graphicsQueue, commandPool));
+		result.materials.push_back(createDefaultGltfMaterial("DefaultMaterial", device, physicalDevice, allocator, graphicsQueue, commandPool));
 	}
 
 	// --- 3. Load Meshes (Primitives) ---
@@ -661,65 +662,78 @@ GltfLoadResult ModelLoader::loadGLTFModelWithMaterials(const std::string& path,
 	result.meshWorldMatrices.resize(meshes.size(), glm::mat4(1.0f));
 
 	const tinygltf::Scene& scene = model.scenes[model.defaultScene > -1 ? model.defaultScene : 0];
-	for (int nodeIndex : scene.nodes)
-	{
-		processNode(model, model.nodes[nodeIndex], glm::mat4(1.0f), result);
-	}
-	return result;
-}
 
-void ModelLoader::processNode(const tinygltf::Model& model, const tinygltf::Node& node, const glm::mat4& parentTransform, GltfLoadResult& result)
-{
-	glm::mat4 localTransform = glm::mat4(1.0f);
-	if (node.matrix.size() == 16)
+	// flatten the node hierarchy depth first, so parents come before their children, then resolve
+	// every world matrix in one pass instead of multiplying down the recursion
+	TransformSystem transforms;
+	std::vector<int> nodeMeshes;
+	std::vector<std::pair<int, uint32_t>> pendingNodes; // gltf node, parent transform node
+	for (auto it = scene.nodes.rbegin(); it != scene.nodes.rend(); ++it)
 	{
-		localTransform = glm::make_mat4(node.matrix.data());
+		pendingNodes.push_back({ *it, TransformSystem::INVALID_NODE });
 	}
-	else
+	while (!pendingNodes.empty())
 	{
-		glm::mat4 t = glm::mat4(1.0f);
-		glm::mat4 r = glm::mat4(1.0f);
-		glm::mat4 s = glm::mat4(1.0f);
-		if (node.translation.size() == 3)
-		{
-			t = glm::translate(localTransform, glm::vec3(
-				static_cast<float>(node.translation[0]),
-				static_cast<float>(node.translation[1]),
-				static_cast<float>(node.translation[2])
-			));
-		}
-		if (node.rotation.size() == 4)
+		auto [nodeIndex, parent] = pendingNodes.back();
+		pendingNodes.pop_back();
+
+		const tinygltf::Node& node = model.nodes[nodeIndex];
+		uint32_t transformNode = addNodeTransform(transforms, node, parent);
+		nodeMeshes.push_back(node.mesh);
+		for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
 		{
-			glm::quat q(
-				static_cast<float>(node.rotation[3]), // w
-				static_cast<float>(node.rotation[0]), // x
-				static_cast<float>(node.rotation[1]), // y
-				static_cast<float>(node.rotation[2]) // z
-			);
-			r = glm::mat4_cast(q);
+			pendingNodes.push_back({ *it, transformNode });
 		}
-		if (node.scale.size() == 3)
+	}
+	transforms.update();
+
+	// a mesh used by several nodes keeps the last one, as before
+	for (uint32_t node = 0; node < transforms.getNodeCount(); node++)
+	{
+		if (nodeMeshes[node] > -1)
 		{
-			s = glm::scale(localTransform, glm::vec3(
-				static_cast<float>(node.scale[0]),
-				static_cast<float>(node.scale[1]),
-				static_cast<float>(node.scale[2])
-			));
+			result.meshWorldMatrices[nodeMeshes[node]] = transforms.getWorldMatrix(node);
 		}
-		localTransform = t * r * s;
 	}
+	return result;
+}
 
-	glm::mat4 globalTransform = parentTransform * localTransform;
-
-	if (node.mesh > -1)
+uint32_t ModelLoader::addNodeTransform(TransformSystem& transforms, const tinygltf::Node& node, uint32_t parent)
+{
+	if (node.matrix.size() == 16)
 	{
-		result.meshWorldMatrices[node.mesh] = globalTransform;
+		return transforms.addNode(parent, glm::make_mat4(node.matrix.data())); // glTF forbids shear, so this splits cleanly
 	}
 
-	for (int childIndex : node.children)
+	glm::vec3 translation(0.0f);
+	glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale(1.0f);
+	if (node.translation.size() == 3)
+	{
+		translation = glm::vec3(
+			static_cast<float>(node.translation[0]),
+			static_cast<float>(node.translation[1]),
+			static_cast<float>(node.translation[2])
+		);
+	}
+	if (node.rotation.size() == 4)
 	{
-		processNode(model, model.nodes[childIndex], globalTransform, result);
+		rotation = glm::quat(
+			static_cast<float>(node.rotation[3]), // w
+			static_cast<float>(node.rotation[0]), // x
+			static_cast<float>(node.rotation[1]), // y
+			static_cast<float>(node.rotation[2]) // z
+		);
 	}
+	if (node.scale.size() == 3)
+	{
+		scale = glm::vec3(
+			static_cast<float>(node.scale[0]),
+			static_cast<float>(node.scale[1]),
+			static_cast<float>(node.scale[2])
+		);
+	}
+	return transforms.addNode(parent, translation, rotation, scale);
 }
 
 std::shared_ptr<VulkanTexture> ModelLoader::loadGltfTexture(
@@ -727,6 +741,7 @@ std::shared_ptr<VulkanTexture> ModelLoader::loadGltfTexture(
 	int textureIndex, 
 	VkDevice device, 
 	VkPhysicalDevice physicalDevice, 
+	VulkanMemoryAllocator& allocator, 
 	VkQueue graphicsQueue, 
 	VkCommandPool commandPool, 
 	const std::string& gltfFilePath,
@@ -750,13 +765,13 @@ std::shared_ptr<VulkanTexture> ModelLoader::loadGltfTexture(
 				return nullptr; // Return null if file is missing
 			}
 			// Load from file
-			vulkanTexture->createTexture2D(device, physicalDevice, graphicsQueue, commandPool, imagePath, sRGB);
+			vulkanTexture->createTexture2D(device, physicalDevice, allocator, graphicsQueue, commandPool, imagePath, sRGB);
 
 		}
 		else if (!image.image.empty()) {
 			// Load from embedded memory
 			vulkanTexture->createTexture2DFromMemory(
-				device, physicalDevice, graphicsQueue, commandPool,
+				device, physicalDevice, allocator, graphicsQueue, commandPool,
 				image.image.data(),
 				image.width, image.height, image.component, sRGB
 			);
@@ -854,7 +869,17 @@ std::shared_ptr<Material> ModelLoader::createMaterialFromGltf(
 	//	material->emissiveMap = loadDefaultTexture("emissive", device, physicalDevice, graphicsQueue, commandPool);
 	//}
 
-	//material->alphaCutoff = static_cast<float>(gltfMaterial.alphaCutoff);
+	if (gltfMaterial.alphaMode == "MASK")
+	{
+		material->alphaMode = Material::AlphaMode::MASK_MODE;
+	}
+	else if (gltfMaterial.alphaMode == "BLEND")
+	{
+		material->alphaMode = Material::AlphaMode::BLEND_MODE;
+	}
+	material->alphaCutoff = static_cast<float>(gltfMaterial.alphaCutoff);
+	material->uboData.alphaMode = static_cast<int>(material->alphaMode);
+	material->uboData.alphaCutoff = material->alphaCutoff;
 	
 	// ----------- TODO : DEBUG doublesided ---------------
 	material->doubleSided = gltfMaterial.doubleSided;
@@ -896,6 +921,7 @@ std::shared_ptr<VulkanTexture> ModelLoader::loadDefaultTexture(
 	const std::string& textureType,
 	VkDevice device, 
 	VkPhysicalDevice physicalDevice, 
+	VulkanMemoryAllocator& allocator, 
 	VkQueue graphicsQueue, 
 	VkCommandPool commandPool)
 {
@@ -949,7 +975,7 @@ std::shared_ptr<VulkanTexture> ModelLoader::loadDefaultTexture(
 	
 	try 
 	{
-		texture->createTexture2D(device, physicalDevice, graphicsQueue, commandPool, defaultPath);
+		texture->createTexture2D(device, physicalDevice, allocator, graphicsQueue, commandPool, defaultPath);
 		return texture;
 	}
 	catch (const std::exception& e)
@@ -960,20 +986,20 @@ std::shared_ptr<VulkanTexture> ModelLoader::loadDefaultTexture(
 	}
 }
 
-std::shared_ptr<Material> ModelLoader::createDefaultGltfMaterial(const std::string& name, VkDevice device, VkPhysicalDevice physicalDevice, VkQueue graphicsQueue, VkCommandPool commandPool)
+std::shared_ptr<Material> ModelLoader::createDefaultGltfMaterial(const std::string& name, VkDevice device, VkPhysicalDevice physicalDevice, VulkanMemoryAllocator& allocator, VkQueue graphicsQueue, VkCommandPool commandPool)
 {
 	std::cout << "Creating default Gltf Material" << std::endl;
 	auto material = std::make_shared<Material>();
 	material->name = name;
 	//material->useOrm = false; // Use separate textures for default material
 
-	material->albedoMap = loadDefaultTexture("albedo", device, physicalDevice, graphicsQueue, commandPool);
-	material->normalMap = loadDefaultTexture("normal", device, physicalDevice, graphicsQueue, commandPool);
-	material->occlusionMap = loadDefaultTexture("ao", device, physicalDevice, graphicsQueue, commandPool);
-	material->metallicRoughnessMap = loadDefaultTexture("metallicRoughness", device, physicalDevice, graphicsQueue, commandPool);
+	material->albedoMap = loadDefaultTexture("albedo", device, physicalDevice, allocator, graphicsQueue, commandPool);
+	material->normalMap = loadDefaultTexture("normal", device, physicalDevice, allocator, graphicsQueue, commandPool);
+	material->occlusionMap = loadDefaultTexture("ao", device, physicalDevice, allocator, graphicsQueue, commandPool);
+	material->metallicRoughnessMap = loadDefaultTexture("metallicRoughness", device, physicalDevice, allocator, graphicsQueue, commandPool);
 	//material->metallnessMap = loadDefaultTexture("metalness", device, physicalDevice, graphicsQueue, commandPool);
 	//material->displacementMap = loadDefaultTexture("displacement", device, physicalDevice, graphicsQueue, commandPool);
-	material->emissiveMap = loadDefaultTexture("emissive", device, physicalDevice, graphicsQueue, commandPool);
+	material->emissiveMap = loadDefaultTexture("emissive", device, physicalDevice, allocator, graphicsQueue, commandPool);
 
 	//material->baseColorFactor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 	//material->metallicFactor = 0.0f;
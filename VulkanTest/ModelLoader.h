@@ -92,7 +92,9 @@ enum class MeshFileType
 
 // forward declaration
 class VulkanTexture;
+class VulkanMemoryAllocator;
 struct Material;
+class TransformSystem;
 
 struct GltfLoadResult
 {
@@ -120,15 +122,16 @@ public:
 		const std::string& path,
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
+		VulkanMemoryAllocator& allocator,
 		VkQueue graphicsQueue,
 		VkCommandPool commandPool
 	);
 
-	static void processNode(
-		const tinygltf::Model& model,
+	// adds the node's local transform under parent, returns its transform node
+	static uint32_t addNodeTransform(
+		TransformSystem& transforms,
 		const tinygltf::Node& node,
-		const glm::mat4& parentTransform,
-		GltfLoadResult& result
+		uint32_t parent
 	);
 
 private:
@@ -138,6 +141,7 @@ private:
 		int textureIndex,
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
+		VulkanMemoryAllocator& allocator,
 		VkQueue graphicsQueue,
 		VkCommandPool commandPool,
 		const std::string& gltfFilePath,
@@ -160,6 +164,7 @@ private:
 		const std::string& textureType,
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
+		VulkanMemoryAllocator& allocator,
 		VkQueue graphicsQueue,
 		VkCommandPool commandPool
 	);
@@ -168,6 +173,7 @@ private:
 		const std::string& name,
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
+		VulkanMemoryAllocator& allocator,
 		VkQueue graphicsQueue,
 		VkCommandPool commandPool
 	);
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <array>
 
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
@@ -11,6 +12,9 @@
 #include "VulkanGlobals.h"
 #include "Material.h"
 #include "ModelLoader.h"
+#include "BoundingVolume.h"
+#include "FrustumCuller.h"
+#include "Lights.h"
 
 // Defines objects in the scene
 struct SceneObjectDefinition
@@ -32,6 +36,8 @@ struct SceneObjectDefinition
     glm::vec3 rotationAngles = glm::vec3(0.0f); // in degrees
     glm::vec3 scale = glm::vec3(1.0f);
 
+    bool isStatic = true; // static transforms are uploaded once, dynamic ones are dirty tracked per frame
+
     PrimitiveModelType defaultModel = PrimitiveModelType::CREATE_NULL;
     MeshFileType meshFileType = MeshFileType::FILE_NULL;
 };
@@ -40,13 +46,22 @@ class VulkanVertexBuffer;
 class VulkanIndexBuffer;
 class VulkanTexture;
 class Camera;
+class VulkanGpuCulling;
+class VulkanParallelCommandRecorder;
+class VulkanHiZPyramid;
+class VulkanClusteredLighting;
+class VulkanShadowCascades;
+class VulkanPipelineStatistics;
+class VulkanGpuProfiler;
 
 struct RenderableObject
 {
-    // Pointers to shared resources
-    VulkanVertexBuffer* vertexBuffer = nullptr;
-    VulkanIndexBuffer* indexBuffer = nullptr;
+    // Range inside the shared geometry buffer
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
     uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32; // narrowest type the mesh's vertex count allows
+    uint32_t meshSortId = 0; // the mesh's dense id, the mesh field of the draw sort key
     //VulkanTexture* texture = nullptr;
 
     // Pointer to a shared material
@@ -54,10 +69,37 @@ struct RenderableObject
 
     // Object's transformation  
     glm::mat4 modelMatrix = glm::mat4(1.0f);
+    BoundingVolume localBounds; // mesh bounds, moved to world space by FrustumCuller::setBounds callers
+
+    // Id in VulkanObjectDataBuffer, written to the instance id buffer and looked up by gl_InstanceIndex
+    uint32_t objectIndex = 0;
+    bool isStatic = true;
 
     RenderableObject() = default;
 };
 
+// One instanced draw built by DrawBatcher from renderables sharing mesh range, material and pipeline
+struct DrawBatch
+{
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    Material* material = nullptr;
+    PipelineHandle pipelineHandle = INVALID_PIPELINE_HANDLE; // already resolved for wireframe mode
+    // range in the instance id buffer (set 2), each entry is an object id
+    uint32_t firstInstance = 0;
+    uint32_t instanceCount = 0;
+};
+
+// casters of one shadow cascade, drawn into its layer with the packet's shadow pipeline
+struct ShadowCascadeDraws
+{
+    bool draw = false; // false: the cascade is cached and still valid, nothing to draw
+    std::vector<DrawBatch> batches;
+    VkDescriptorSet instanceDescriptorSet = VK_NULL_HANDLE; // set 2, object ids of every batch instance
+};
+
 struct SkyboxData {
     VkPipeline pipeline = VK_NULL_HANDLE;
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
@@ -67,14 +109,38 @@ struct SkyboxData {
 };
 
 struct RenderPacket {
-    std::vector<RenderableObject> pbrRenderables;
-    VkDeviceSize dynamicUboAlignment;
-    VkPipeline pbrPipeline;
-    //VkPipeline pbrPipeline_doubleSided;
+    std::vector<DrawBatch> pbrBatches;
+    uint64_t drawListGeneration = 0; // moves whenever pbrBatches does; the scene key uses it instead of every batch
+    VkBuffer geometryVertexBuffer = VK_NULL_HANDLE; // shared by every pbr renderable
+    VkBuffer geometryIndexBuffer = VK_NULL_HANDLE;
+    VkDescriptorSet objectDataDescriptorSet = VK_NULL_HANDLE; // set 1, this frame's object data
+    VkDescriptorSet instanceDescriptorSet = VK_NULL_HANDLE; // set 2, object ids of every batch instance
+    VkDescriptorSet bindlessDescriptorSet = VK_NULL_HANDLE; // set 0 for every material, null when bindless is off
+    VulkanPipelineLibrary* pipelineLibrary = nullptr; // resolves each material's pipeline handle
+    VulkanGpuCulling* gpuCulling = nullptr; // culls and draws non blended renderables on the GPU, pbrBatches then only hold blended ones
+    Frustum cullFrustum{};
+    glm::mat4 cullViewProjection{ 1.0f }; // what the frame renders with, the next frame's occlusion test reprojects with it
+    bool occlusionCulling = false; // gpuCulling also tests against hiZPyramid, only once it holds last frame's depth
+    VulkanHiZPyramid* hiZPyramid = nullptr; // set along with gpuCulling
+    bool buildHiZ = false; // next frame tests occlusion, so the pyramid is rebuilt from this frame's depth
+    VulkanClusteredLighting* clusteredLighting = nullptr; // bins point and spot lights, its set 3 is what shader.frag shades with
+    VulkanPipelineStatistics* pipelineStatistics = nullptr; // counts fragment shader invocations for the overdraw readout
+    VulkanGpuProfiler* gpuProfiler = nullptr; // timestamps around the passes, null while profiling is off
+    bool depthPrepass = false; // opaque materials lay down depth first, then shade with an EQUAL test
+    uint32_t objectDataGeneration = 0; // VulkanObjectDataBuffer::getDescriptorGeneration, cached scene commands are stale once it moves
+    uint32_t bindlessGeneration = 0; // VulkanBindlessMaterials::getDescriptorGeneration, same for a regrown material buffer
+    VulkanParallelCommandRecorder* parallelRecorder = nullptr; // records large batch lists on worker threads
+    bool wireframeMode = false;
     VkPipelineLayout pbrLayout;
+    VkExtent2D renderExtent{ 0, 0 }; // scene colour and depth: the swap chain extent times the render scale
 
     std::optional<SkyboxData> skyboxData;
-    // shadow pass for future
+
+    VulkanShadowCascades* shadowCascades = nullptr; // directional light shadow maps, null when shadows are off
+    std::array<ShadowCascadeDraws, SHADOW_CASCADE_COUNT> shadowDraws;
+    VkPipeline shadowPipeline = VK_NULL_HANDLE;
+    VkPipelineLayout shadowLayout = VK_NULL_HANDLE; // sets 1 and 2 as in pbrLayout, the cascade's matrix as push constant
+    VkBuffer geometryPositionBuffer = VK_NULL_HANDLE; // positions only, what the shadow pipeline reads
 };
 
 //struct TessellationUBO;
@@ -87,4 +153,36 @@ struct SceneDebugContextPacket {
     Camera* mainCamera = nullptr;
     float deltaTime = 0.0f;
     std::vector<RenderableObject>& pbrRenderables;
+    uint32_t visibleRenderables = 0; // every renderable, with GPU culling on its read back counts included
+    uint32_t culledRenderables = 0;
+    uint32_t bindsUnsorted = 0; // state binds the visible draws would need in scene order
+    uint32_t bindsSorted = 0;
+    uint32_t drawCalls = 0; // instanced draws after batching
+    bool* gpuCulling = nullptr; // null when the device has no GPU culling path
+    bool* occlusionCulling = nullptr; // null without GPU culling
+    bool* depthPrepass = nullptr;
+    bool* animateObjects = nullptr; // dynamic renderables orbit the scene, null when there are none
+    uint32_t frustumCulledObjects = 0; // GPU culling counts, a couple of frames old
+    uint32_t occlusionCulledObjects = 0;
+    float overdraw = 0.0f; // fragment shader invocations per pixel, 0 when unavailable
+    bool* commandReplay = nullptr;
+    bool sceneCommandsReplayed = false; // this frame submitted the cached scene commands untouched
+    uint64_t sceneCommandRecords = 0; // how often the cache had to record
+    uint32_t graphPasses = 0; // last frame's render graph
+    uint32_t graphCulledPasses = 0;
+    uint32_t graphRenderPasses = 0;
+    uint32_t graphBarriers = 0;
+    bool* localLights = nullptr; // point and spot lights on or off
+    uint32_t localLightCount = 0;
+    uint32_t clusterLightIndices = 0; // cluster to light references of the last binning
+    uint32_t busiestClusterLights = 0;
+    bool* shadows = nullptr; // directional light shadows on or off
+    uint32_t shadowCascadesDrawn = 0; // cascades redrawn this frame, the rest came from the cache
+    uint32_t shadowBatches = 0; // instanced draws over every redrawn cascade
+    bool* dynamicResolution = nullptr; // the GPU time controller picks the render scale, null without timestamps
+    float* renderScale = nullptr; // set by hand while the controller is off
+    float* targetFrameTime = nullptr; // milliseconds the controller aims for
+    VkExtent2D renderExtent{ 0, 0 };
+    float gpuFrameTime = 0.0f; // milliseconds, smoothed, 0 when the queue has no timestamps
+    VulkanGpuProfiler* gpuProfiler = nullptr; // null when the queue has no timestamps
 };
\ No newline at end of file
@@ -0,0 +1,349 @@
+#include "TransformSystem.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+#include <immintrin.h>
+
+namespace
+{
+	// glm matrices are column major, so a mat4 is four __m128 columns
+	inline void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+	{
+		__m128 a0 = _mm_loadu_ps(&a[0][0]);
+		__m128 a1 = _mm_loadu_ps(&a[1][0]);
+		__m128 a2 = _mm_loadu_ps(&a[2][0]);
+		__m128 a3 = _mm_loadu_ps(&a[3][0]);
+		for (int column = 0; column < 4; column++)
+		{
+			__m128 b0 = _mm_loadu_ps(&b[column][0]);
+			__m128 sum = _mm_mul_ps(a0, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(0, 0, 0, 0)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(1, 1, 1, 1))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(2, 2, 2, 2))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_shuffle_ps(b0, b0, _MM_SHUFFLE(3, 3, 3, 3))));
+			_mm_storeu_ps(&result[column][0], sum);
+		}
+	}
+
+	// a.yzx * b.zxy - a.zxy * b.yzx, w stays 0
+	inline __m128 cross(__m128 a, __m128 b)
+	{
+		__m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 result = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+		return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	// The rows of a 3x3 inverse are the cross products of the other two columns over the determinant,
+	// so the inverse transpose is those cross products as columns
+	inline void normalMatrix(const glm::mat4& world, glm::mat3x4& result)
+	{
+		__m128 c0 = _mm_loadu_ps(&world[0][0]);
+		__m128 c1 = _mm_loadu_ps(&world[1][0]);
+		__m128 c2 = _mm_loadu_ps(&world[2][0]);
+		c0 = _mm_and_ps(c0, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1))); // drop w, projective parts do not belong here
+		c1 = _mm_and_ps(c1, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+		c2 = _mm_and_ps(c2, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1)));
+
+		__m128 n0 = cross(c1, c2);
+		__m128 n1 = cross(c2, c0);
+		__m128 n2 = cross(c0, c1);
+
+		// horizontal sum of c0 * n0
+		__m128 products = _mm_mul_ps(c0, n0);
+		__m128 shuffled = _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 sums = _mm_add_ps(products, shuffled);
+		shuffled = _mm_movehl_ps(shuffled, sums);
+		float determinant = _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+
+		// a degenerate (zero scale) transform keeps the unscaled cross products, the shader normalizes anyway
+		__m128 inverseDeterminant = _mm_set1_ps(std::fabs(determinant) > 1e-20f ? 1.0f / determinant : 1.0f);
+		_mm_storeu_ps(&result[0][0], _mm_mul_ps(n0, inverseDeterminant));
+		_mm_storeu_ps(&result[1][0], _mm_mul_ps(n1, inverseDeterminant));
+		_mm_storeu_ps(&result[2][0], _mm_mul_ps(n2, inverseDeterminant));
+	}
+
+	void decompose(const glm::mat4& matrix, glm::vec3& translation, glm::quat& rotation, glm::vec3& scale)
+	{
+		translation = glm::vec3(matrix[3]);
+		glm::vec3 axisX(matrix[0]);
+		glm::vec3 axisY(matrix[1]);
+		glm::vec3 axisZ(matrix[2]);
+		scale = glm::vec3(glm::length(axisX), glm::length(axisY), glm::length(axisZ));
+		if (glm::dot(glm::cross(axisX, axisY), axisZ) < 0.0f)
+		{
+			scale.x = -scale.x; // mirrored: one negative scale keeps the rotation proper
+		}
+		glm::mat3 rotationMatrix(
+			scale.x != 0.0f ? axisX / scale.x : glm::vec3(1.0f, 0.0f, 0.0f),
+			scale.y != 0.0f ? axisY / scale.y : glm::vec3(0.0f, 1.0f, 0.0f),
+			scale.z != 0.0f ? axisZ / scale.z : glm::vec3(0.0f, 0.0f, 1.0f));
+		rotation = glm::normalize(glm::quat_cast(rotationMatrix));
+	}
+}
+
+uint32_t TransformSystem::addNode(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+	if (parent != INVALID_NODE && parent >= nodeCount)
+	{
+		throw std::runtime_error("Transform system add node: parent does not exist!");
+	}
+
+	uint32_t node = nodeCount;
+	resize(nodeCount + 1);
+	parents[node] = parent;
+	roots[node] = parent == INVALID_NODE ? node : roots[parent];
+	orderDirty = true;
+	setLocal(node, translation, rotation, scale);
+	return node;
+}
+
+uint32_t TransformSystem::addNode(uint32_t parent, const glm::mat4& localMatrix)
+{
+	glm::vec3 translation, scale;
+	glm::quat rotation;
+	decompose(localMatrix, translation, rotation, scale);
+	return addNode(parent, translation, rotation, scale);
+}
+
+void TransformSystem::setLocal(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+	if (node >= nodeCount)
+	{
+		throw std::runtime_error("Transform system set local: invalid node");
+	}
+
+	translationX[node] = translation.x;
+	translationY[node] = translation.y;
+	translationZ[node] = translation.z;
+	rotationX[node] = rotation.x;
+	rotationY[node] = rotation.y;
+	rotationZ[node] = rotation.z;
+	rotationW[node] = rotation.w;
+	scaleX[node] = scale.x;
+	scaleY[node] = scale.y;
+	scaleZ[node] = scale.z;
+	localDirty[node] = 1;
+	anyDirty = true;
+}
+
+void TransformSystem::setLocalMatrix(uint32_t node, const glm::mat4& localMatrix)
+{
+	glm::vec3 translation, scale;
+	glm::quat rotation;
+	decompose(localMatrix, translation, rotation, scale);
+	setLocal(node, translation, rotation, scale);
+}
+
+void TransformSystem::clear()
+{
+	resize(0);
+	order.clear();
+	partitions.clear();
+	anyDirty = false;
+	orderDirty = false;
+}
+
+void TransformSystem::update(std::vector<uint32_t>* changedNodes)
+{
+	CPU_PROFILE_ZONE("Transforms");
+	if (changedNodes)
+	{
+		changedNodes->clear();
+	}
+	if (!anyDirty)
+	{
+		return;
+	}
+	if (orderDirty)
+	{
+		rebuildOrder();
+	}
+
+	composeLocalMatrices();
+
+	uint32_t rangeCount = static_cast<uint32_t>(partitions.size()) - 1;
+	if (rangeCount == 1)
+	{
+		propagateRange(0, nodeCount);
+	}
+	else
+	{
+		std::vector<std::future<void>> jobs;
+		for (uint32_t range = 1; range < rangeCount; range++)
+		{
+			uint32_t begin = partitions[range];
+			uint32_t end = partitions[range + 1];
+			jobs.push_back(std::async(std::launch::async, [this, begin, end]()
+			{
+				propagateRange(begin, end);
+			}));
+		}
+		propagateRange(partitions[0], partitions[1]); // the calling thread takes the first range
+		for (auto& job : jobs)
+		{
+			job.get();
+		}
+	}
+
+	for (uint32_t node = 0; node < nodeCount; node++)
+	{
+		if (changed[node])
+		{
+			if (changedNodes)
+			{
+				changedNodes->push_back(node);
+			}
+			changed[node] = 0;
+		}
+		localDirty[node] = 0;
+	}
+	anyDirty = false;
+}
+
+void TransformSystem::resize(uint32_t count)
+{
+	nodeCount = count;
+	size_t padded = ((count + LANE_PADDING - 1) / LANE_PADDING) * LANE_PADDING;
+	translationX.resize(padded, 0.0f);
+	translationY.resize(padded, 0.0f);
+	translationZ.resize(padded, 0.0f);
+	rotationX.resize(padded, 0.0f);
+	rotationY.resize(padded, 0.0f);
+	rotationZ.resize(padded, 0.0f);
+	rotationW.resize(padded, 1.0f);
+	scaleX.resize(padded, 1.0f);
+	scaleY.resize(padded, 1.0f);
+	scaleZ.resize(padded, 1.0f);
+	localDirty.resize(padded, 0);
+
+	parents.resize(count, INVALID_NODE);
+	roots.resize(count, 0);
+	changed.resize(count, 0);
+	localMatrices.resize(count, glm::mat4(1.0f));
+	worldMatrices.resize(count, glm::mat4(1.0f));
+	normalMatrices.resize(count, glm::mat3x4(1.0f));
+}
+
+void TransformSystem::rebuildOrder()
+{
+	// ids ascend within every root, so a stable sort by root keeps parents ahead of their children
+	order.resize(nodeCount);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return roots[a] < roots[b]; });
+
+	uint32_t workers = 1;
+	if (nodeCount >= PARALLEL_THRESHOLD)
+	{
+		workers = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_WORKERS);
+	}
+
+	// ranges only end between two subtrees, so no worker ever reads a parent another one writes
+	partitions.clear();
+	partitions.push_back(0);
+	uint32_t target = (nodeCount + workers - 1) / std::max(workers, 1u);
+	for (uint32_t i = 1; i < nodeCount; i++)
+	{
+		if (i - partitions.back() >= target && roots[order[i]] != roots[order[i - 1]])
+		{
+			partitions.push_back(i);
+		}
+	}
+	partitions.push_back(nodeCount);
+	orderDirty = false;
+}
+
+void TransformSystem::composeLocalMatrices()
+{
+	// T * R * S for four nodes at once; lanes are nodes, so the quaternion terms need no shuffles
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (uint32_t i = 0; i < nodeCount; i += LANE_PADDING)
+	{
+		uint32_t dirtyLanes;
+		std::memcpy(&dirtyLanes, &localDirty[i], sizeof(dirtyLanes));
+		if (dirtyLanes == 0)
+		{
+			continue;
+		}
+
+		__m128 x = _mm_loadu_ps(&rotationX[i]);
+		__m128 y = _mm_loadu_ps(&rotationY[i]);
+		__m128 z = _mm_loadu_ps(&rotationZ[i]);
+		__m128 w = _mm_loadu_ps(&rotationW[i]);
+		__m128 sx = _mm_loadu_ps(&scaleX[i]);
+		__m128 sy = _mm_loadu_ps(&scaleY[i]);
+		__m128 sz = _mm_loadu_ps(&scaleZ[i]);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		// same terms as glm::mat3_cast, each column scaled by its axis
+		__m128 columns[4][4];
+		columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+		columns[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+		columns[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+		columns[0][3] = zero;
+		columns[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+		columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+		columns[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+		columns[1][3] = zero;
+		columns[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+		columns[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+		columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+		columns[2][3] = zero;
+		columns[3][0] = _mm_loadu_ps(&translationX[i]);
+		columns[3][1] = _mm_loadu_ps(&translationY[i]);
+		columns[3][2] = _mm_loadu_ps(&translationZ[i]);
+		columns[3][3] = one;
+
+		// back to one matrix per node: after the transpose, element n of a column set is node i + n
+		uint32_t lanes = std::min(LANE_PADDING, nodeCount - i);
+		for (int column = 0; column < 4; column++)
+		{
+			_MM_TRANSPOSE4_PS(columns[column][0], columns[column][1], columns[column][2], columns[column][3]);
+			for (uint32_t lane = 0; lane < lanes; lane++)
+			{
+				if (localDirty[i + lane])
+				{
+					_mm_storeu_ps(&localMatrices[i + lane][column][0], columns[column][lane]);
+				}
+			}
+		}
+	}
+}
+
+void TransformSystem::propagateRange(uint32_t begin, uint32_t end)
+{
+	CPU_PROFILE_ZONE("Propagate Range");
+	for (uint32_t i = begin; i < end; i++)
+	{
+		uint32_t node = order[i];
+		uint32_t parent = parents[node];
+		bool parentChanged = parent != INVALID_NODE && changed[parent];
+		if (!localDirty[node] && !parentChanged)
+		{
+			continue;
+		}
+
+		if (parent == INVALID_NODE)
+		{
+			worldMatrices[node] = localMatrices[node];
+		}
+		else
+		{
+			multiply(worldMatrices[parent], localMatrices[node], worldMatrices[node]);
+		}
+		normalMatrix(worldMatrices[node], normalMatrices[node]);
+		changed[node] = 1;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+// TransformSystem.h
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Transform hierarchy with local translation / rotation / scale kept in structure-of-arrays form.
+// update() builds the local matrices of dirty nodes 4 at a time (one SSE lane per node), then walks
+// the hierarchy parents first: every dirty node and everything below it gets its world matrix
+// (SSE 4x4 multiply) and its normal matrix, the inverse transpose of the world matrix's upper 3x3,
+// so shaders never invert per vertex. Large graphs split their root subtrees across worker threads.
+// A parent always has to exist before its children, so node ids are already a topological order.
+class TransformSystem
+{
+public:
+	static constexpr uint32_t INVALID_NODE = 0xFFFFFFFFu;
+	static constexpr uint32_t PARALLEL_THRESHOLD = 4096; // below this a single thread is faster
+	static constexpr uint32_t MAX_WORKERS = 8;
+
+	uint32_t addNode(uint32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+	// the matrix is split into translation, rotation and scale, so it must not shear
+	uint32_t addNode(uint32_t parent, const glm::mat4& localMatrix);
+	void setLocal(uint32_t node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+	void setLocalMatrix(uint32_t node, const glm::mat4& localMatrix);
+	void clear();
+
+	// recomputes what changed since the last call; changedNodes, if given, receives those node ids in ascending order
+	void update(std::vector<uint32_t>* changedNodes = nullptr);
+
+	uint32_t getNodeCount() const { return nodeCount; }
+	uint32_t getParent(uint32_t node) const { return parents.at(node); }
+	const glm::mat4& getWorldMatrix(uint32_t node) const { return worldMatrices.at(node); }
+	// std430 mat3 layout: three columns, each padded to a vec4
+	const glm::mat3x4& getNormalMatrix(uint32_t node) const { return normalMatrices.at(node); }
+
+private:
+	static constexpr uint32_t LANE_PADDING = 4; // SoA arrays are padded so the last SIMD load stays in bounds
+
+	uint32_t nodeCount = 0;
+	bool anyDirty = false;
+	bool orderDirty = false;
+
+	// local transforms, one lane per node
+	std::vector<float> translationX, translationY, translationZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<uint8_t> localDirty;
+
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> roots;       // root of each node's subtree
+	std::vector<uint8_t> changed;      // set by the hierarchy walk, children test their parent's
+	std::vector<glm::mat4> localMatrices;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<glm::mat3x4> normalMatrices;
+
+	// node ids grouped by root subtree, parents still first; partitions are the worker ranges into it
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> partitions;
+
+	void resize(uint32_t count);
+	void rebuildOrder();
+	void composeLocalMatrices();
+	void propagateRange(uint32_t begin, uint32_t end);
+};
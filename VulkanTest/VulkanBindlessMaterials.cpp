@@ -0,0 +1,329 @@
+#include "VulkanBindlessMaterials.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+
+#include "VulkanMemoryAllocator.h"
+#include "VulkanUniformBuffers.h"
+#include "VulkanTexture.h"
+
+VulkanBindlessMaterials::VulkanBindlessMaterials()
+	: descriptorPool(VK_NULL_HANDLE), materialBuffer(VK_NULL_HANDLE), materialCapacity(0), materialCount(0), descriptorGeneration(0),
+	textureCapacity(0), device(VK_NULL_HANDLE), allocator(nullptr)
+{
+}
+
+VulkanBindlessMaterials::~VulkanBindlessMaterials()
+{
+	destroy();
+}
+
+uint32_t VulkanBindlessMaterials::getTextureCapacity(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+	// the IBL maps and the shadow cascades share the per-stage sampler budget with the array
+	uint32_t reserved = 4;
+	uint32_t limit = std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages);
+	limit = std::min(limit, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages);
+	return std::min(PREFERRED_TEXTURE_COUNT, limit > reserved ? limit - reserved : 1u);
+}
+
+void VulkanBindlessMaterials::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames,
+	VkDescriptorSetLayout setLayout, uint32_t textureArraySize,
+	const std::vector<VkBuffer>& frameUniformBuffers,
+	const std::vector<VkBuffer>& lightingUniformBuffers,
+	const IblPacket& iblPacket)
+{
+	device = vkdevice;
+	allocator = &memoryAllocator;
+	textureCapacity = textureArraySize;
+
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = 2 * numFrames;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = numFrames;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[2].descriptorCount = (4 + textureCapacity) * numFrames; // IBL maps, shadow cascades and the texture array
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = numFrames;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create bindless descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(numFrames, setLayout);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = numFrames;
+	allocInfo.pSetLayouts = layouts.data();
+
+	descriptorSets.resize(numFrames);
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate bindless descriptor sets!");
+	}
+
+	createMaterialBuffer(INITIAL_MATERIAL_CAPACITY);
+
+	for (uint32_t i = 0; i < numFrames; i++)
+	{
+		VkDescriptorBufferInfo frameBufferInfo{};
+		frameBufferInfo.buffer = frameUniformBuffers[i];
+		frameBufferInfo.offset = 0;
+		frameBufferInfo.range = sizeof(FrameUniformBufferObject);
+
+		VkDescriptorBufferInfo lightingBufferInfo{};
+		lightingBufferInfo.buffer = lightingUniformBuffers[i];
+		lightingBufferInfo.offset = 0;
+		lightingBufferInfo.range = sizeof(SceneLightingUBO);
+
+		VkDescriptorImageInfo iblImageInfos[3]{};
+		iblImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		iblImageInfos[0].imageView = iblPacket.irradianceImageView;
+		iblImageInfos[0].sampler = iblPacket.irradianceSampler;
+		iblImageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		iblImageInfos[1].imageView = iblPacket.prefilterImageView;
+		iblImageInfos[1].sampler = iblPacket.prefilterSampler;
+		iblImageInfos[2].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		iblImageInfos[2].imageView = iblPacket.brdfLutImageView;
+		iblImageInfos[2].sampler = iblPacket.brdfLutSampler;
+
+		VkDescriptorImageInfo shadowMapImageInfo{};
+		shadowMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		shadowMapImageInfo.imageView = iblPacket.shadowMapImageView;
+		shadowMapImageInfo.sampler = iblPacket.shadowMapSampler;
+
+		std::array<VkWriteDescriptorSet, 6> descriptorWrites{};
+
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = descriptorSets[i];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pBufferInfo = &frameBufferInfo;
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = descriptorSets[i];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pBufferInfo = &lightingBufferInfo;
+
+		descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[2].dstSet = descriptorSets[i];
+		descriptorWrites[2].dstBinding = 3;
+		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[2].descriptorCount = 1;
+		descriptorWrites[2].pImageInfo = &iblImageInfos[0];
+
+		descriptorWrites[3] = descriptorWrites[2];
+		descriptorWrites[3].dstBinding = 4;
+		descriptorWrites[3].pImageInfo = &iblImageInfos[1];
+
+		descriptorWrites[4] = descriptorWrites[2];
+		descriptorWrites[4].dstBinding = 5;
+		descriptorWrites[4].pImageInfo = &iblImageInfos[2];
+
+		descriptorWrites[5] = descriptorWrites[2];
+		descriptorWrites[5].dstBinding = 7;
+		descriptorWrites[5].pImageInfo = &shadowMapImageInfo;
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+	writeMaterialBufferDescriptors();
+
+	std::cout << "Bindless materials: " << textureCapacity << " texture slots per frame" << std::endl;
+}
+
+void VulkanBindlessMaterials::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	VulkanBuffer::destroyBuffer(device, *allocator, materialBuffer, materialAllocation);
+	materialCapacity = 0;
+	materialCount = 0;
+	textureSlots.clear();
+
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		descriptorPool = VK_NULL_HANDLE;
+	}
+	descriptorSets.clear();
+
+	device = VK_NULL_HANDLE;
+}
+
+uint32_t VulkanBindlessMaterials::registerMaterial(Material& material)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Bindless register material called before initialization!");
+	}
+
+	if (material.bindlessIndex == UINT32_MAX)
+	{
+		if (materialCount == materialCapacity)
+		{
+			createMaterialBuffer(materialCapacity * 2);
+			writeMaterialBufferDescriptors();
+		}
+		material.bindlessIndex = materialCount++;
+	}
+
+	const MaterialUBO& ubo = material.uboData;
+	BindlessMaterialData data{};
+	data.baseColorFactor = ubo.baseColorFactor;
+	data.emissiveFactor = ubo.emissiveFactor;
+	data.metallicFactor = ubo.metallicFactor;
+	data.roughnessFactor = ubo.roughnessFactor;
+	data.alphaCutoff = ubo.alphaCutoff;
+	data.alphaMode = ubo.alphaMode;
+	data.albedoTexture = ubo.hasAlbedoMap ? registerTexture(material.albedoMap) : BINDLESS_NO_TEXTURE;
+	data.normalTexture = ubo.hasNormalMap ? registerTexture(material.normalMap) : BINDLESS_NO_TEXTURE;
+	data.metallicRoughnessTexture = ubo.hasMetallicRoughnessMap ? registerTexture(material.metallicRoughnessMap) : BINDLESS_NO_TEXTURE;
+	data.occlusionTexture = ubo.hasOcclusionMap ? registerTexture(material.occlusionMap) : BINDLESS_NO_TEXTURE;
+	data.emissiveTexture = ubo.hasEmissiveMap ? registerTexture(material.emissiveMap) : BINDLESS_NO_TEXTURE;
+
+	// shared by all frames: parameters only change at load time
+	char* mapped = static_cast<char*>(materialAllocation.mappedData);
+	memcpy(mapped + sizeof(BindlessMaterialData) * material.bindlessIndex, &data, sizeof(BindlessMaterialData));
+
+	return material.bindlessIndex;
+}
+
+void VulkanBindlessMaterials::registerMaterials(const std::map<std::string, std::shared_ptr<Material>>& materials)
+{
+	for (const auto& pair : materials)
+	{
+		if (pair.second && pair.second->bindlessIndex == UINT32_MAX)
+		{
+			registerMaterial(*pair.second);
+		}
+	}
+}
+
+VkDescriptorSet VulkanBindlessMaterials::getDescriptorSet(uint32_t frameIndex) const
+{
+	if (frameIndex >= descriptorSets.size())
+	{
+		throw std::runtime_error("Get bindless descriptor set called before initialization!");
+	}
+	return descriptorSets[frameIndex];
+}
+
+uint32_t VulkanBindlessMaterials::registerTexture(const std::shared_ptr<VulkanTexture>& texture)
+{
+	if (!texture)
+	{
+		return BINDLESS_NO_TEXTURE;
+	}
+
+	VkImageView imageView = texture->getImageView();
+	auto it = textureSlots.find(imageView);
+	if (it != textureSlots.end())
+	{
+		return it->second;
+	}
+
+	if (textureSlots.size() >= textureCapacity)
+	{
+		throw std::runtime_error("bindless texture array is full!");
+	}
+	uint32_t slot = static_cast<uint32_t>(textureSlots.size());
+	textureSlots.emplace(imageView, slot);
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = imageView;
+	imageInfo.sampler = texture->getSampler();
+
+	// the slot is new, so no frame still in flight reads it; update-unused-while-pending makes writing
+	// it legal while those frames execute, update-after-bind while the set is bound
+	std::vector<VkWriteDescriptorSet> descriptorWrites(descriptorSets.size());
+	for (size_t i = 0; i < descriptorSets.size(); i++)
+	{
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptorSets[i];
+		descriptorWrites[i].dstBinding = 6;
+		descriptorWrites[i].dstArrayElement = slot;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pImageInfo = &imageInfo;
+	}
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+	return slot;
+}
+
+void VulkanBindlessMaterials::createMaterialBuffer(uint32_t capacity)
+{
+	VkBuffer newBuffer;
+	VulkanAllocation newAllocation;
+	VulkanBuffer::createBuffer(
+		device,
+		*allocator,
+		sizeof(BindlessMaterialData) * capacity,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		allocator->getDirectWriteMemoryProperties(),
+		newBuffer,
+		newAllocation
+	);
+
+	if (materialBuffer != VK_NULL_HANDLE)
+	{
+		std::cout << "Growing bindless material buffer from " << materialCapacity << " to " << capacity << " materials" << std::endl;
+
+		// binding 2 is not update-after-bind, so nothing may still be using the sets
+		vkDeviceWaitIdle(device);
+		memcpy(newAllocation.mappedData, materialAllocation.mappedData, sizeof(BindlessMaterialData) * materialCount);
+		VulkanBuffer::destroyBuffer(device, *allocator, materialBuffer, materialAllocation);
+	}
+
+	materialBuffer = newBuffer;
+	materialAllocation = newAllocation;
+	materialCapacity = capacity;
+}
+
+void VulkanBindlessMaterials::writeMaterialBufferDescriptors()
+{
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = materialBuffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE;
+
+	std::vector<VkWriteDescriptorSet> descriptorWrites(descriptorSets.size());
+	for (size_t i = 0; i < descriptorSets.size(); i++)
+	{
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptorSets[i];
+		descriptorWrites[i].dstBinding = 2;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = &bufferInfo;
+	}
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	descriptorGeneration++;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include "VulkanBuffer.h"
+#include "VulkanDescriptorSets.h"
+#include "MaterialPBR.h"
+#include "Material.h"
+
+// Every material in one descriptor set per frame (VulkanDescriptorSetLayout::createForBindless).
+// Textures are written once into a large partially bound sampler array, material parameters
+// live in a storage buffer, and a draw only pushes its material index. Loading new materials
+// writes new array slots / buffer elements; no descriptor sets are allocated after create().
+class VulkanBindlessMaterials
+{
+public:
+	static constexpr uint32_t PREFERRED_TEXTURE_COUNT = 4096;
+	static constexpr uint32_t INITIAL_MATERIAL_CAPACITY = 256;
+
+	VulkanBindlessMaterials();
+	~VulkanBindlessMaterials();
+
+	VulkanBindlessMaterials(const VulkanBindlessMaterials&) = delete;
+	VulkanBindlessMaterials& operator=(const VulkanBindlessMaterials&) = delete;
+
+	// size of the texture array, clamped to the device's update-after-bind limits
+	static uint32_t getTextureCapacity(VkPhysicalDevice physicalDevice);
+
+	// setLayout is VulkanDescriptorSetLayout::createForBindless(textureArraySize)
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames,
+		VkDescriptorSetLayout setLayout, uint32_t textureArraySize,
+		const std::vector<VkBuffer>& frameUniformBuffers,
+		const std::vector<VkBuffer>& lightingUniformBuffers,
+		const IblPacket& iblPacket);
+	void destroy();
+
+	// assigns material.bindlessIndex on first use, afterwards rewrites its parameters
+	uint32_t registerMaterial(Material& material);
+	void registerMaterials(const std::map<std::string, std::shared_ptr<Material>>& materials);
+
+	VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const;
+
+	uint32_t getTextureCount() const { return static_cast<uint32_t>(textureSlots.size()); }
+	uint32_t getMaterialCount() const { return materialCount; }
+	// moves whenever the material buffer is rebound; commands recorded against the sets are stale then
+	uint32_t getDescriptorGeneration() const { return descriptorGeneration; }
+
+private:
+	std::vector<VkDescriptorSet> descriptorSets;
+	VkDescriptorPool descriptorPool;
+
+	VkBuffer materialBuffer;
+	VulkanAllocation materialAllocation;
+	uint32_t materialCapacity;
+	uint32_t materialCount;
+	uint32_t descriptorGeneration;
+
+	std::unordered_map<VkImageView, uint32_t> textureSlots;
+	uint32_t textureCapacity;
+
+	VkDevice device;
+	VulkanMemoryAllocator* allocator;
+
+	uint32_t registerTexture(const std::shared_ptr<VulkanTexture>& texture);
+	void createMaterialBuffer(uint32_t capacity);
+	void writeMaterialBufferDescriptors();
+};
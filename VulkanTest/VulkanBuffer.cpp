@@ -1,6 +1,6 @@
 #include "VulkanBuffer.h"
 
-void VulkanBuffer::createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+void VulkanBuffer::createBuffer(VkDevice device, VulkanMemoryAllocator& allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VulkanAllocation& bufferAllocation)
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -16,17 +16,22 @@ void VulkanBuffer::createBuffer(VkDevice device, VkPhysicalDevice physicalDevice
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+	bufferAllocation = allocator.allocate(memRequirements, properties, VulkanResourceKind::BUFFER);
 
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+	vkBindBufferMemory(device, buffer, bufferAllocation.memory, bufferAllocation.offset);
+}
+
+void VulkanBuffer::destroyBuffer(VkDevice device, VulkanMemoryAllocator& allocator, VkBuffer& buffer, VulkanAllocation& bufferAllocation)
+{
+	if (buffer != VK_NULL_HANDLE)
 	{
-		throw std::runtime_error("failed to allocate buffer memory!");
+		vkDestroyBuffer(device, buffer, nullptr);
+		buffer = VK_NULL_HANDLE;
+	}
+	if (bufferAllocation.isValid())
+	{
+		allocator.free(bufferAllocation);
 	}
-
-	vkBindBufferMemory(device, buffer, bufferMemory, 0);
 }
 
 void VulkanBuffer::copyBuffer(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
@@ -3,12 +3,15 @@
 #include <stdexcept>
 
 #include "VulkanCommandBuffers.h"
+#include "VulkanMemoryAllocator.h"
 
 class VulkanBuffer
 {	
 public:
-	static void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage,
-		VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+	static void createBuffer(VkDevice device, VulkanMemoryAllocator& allocator, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkMemoryPropertyFlags properties, VkBuffer& buffer, VulkanAllocation& bufferAllocation);
+
+	static void destroyBuffer(VkDevice device, VulkanMemoryAllocator& allocator, VkBuffer& buffer, VulkanAllocation& bufferAllocation);
 
 	static void copyBuffer(VkDevice device, VkCommandPool commandPool,VkQueue graphicsQueue, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 
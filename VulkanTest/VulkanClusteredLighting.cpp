@@ -0,0 +1,347 @@
+#include "VulkanClusteredLighting.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "VulkanMemoryAllocator.h"
+#include "VulkanShaderModuleCache.h"
+
+VulkanClusteredLighting::VulkanClusteredLighting()
+	: staleFramesMask(0), lightIndexCount(0), busiestClusterLightCount(0), setLayout(VK_NULL_HANDLE),
+	pipelineLayout(VK_NULL_HANDLE), pipeline(VK_NULL_HANDLE), descriptorPool(VK_NULL_HANDLE),
+	device(VK_NULL_HANDLE), allocator(nullptr)
+{
+}
+
+VulkanClusteredLighting::~VulkanClusteredLighting()
+{
+	destroy();
+}
+
+void VulkanClusteredLighting::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames)
+{
+	device = vkdevice;
+	allocator = &memoryAllocator;
+	frames.resize(numFrames);
+
+	// cluster data, lights, cluster grid, light indices, stats; the fragment shader skips the stats
+	std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+	for (uint32_t i = 0; i < bindings.size(); i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create clustered lighting descriptor set layout!");
+	}
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = 4 * numFrames;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[1].descriptorCount = numFrames;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = numFrames;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create clustered lighting descriptor pool!");
+	}
+
+	for (FrameResources& frame : frames)
+	{
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &setLayout;
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, &frame.descriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate clustered lighting descriptor sets!");
+		}
+	}
+
+	createFrameBuffers();
+	writeDescriptorSets();
+	createPipeline();
+}
+
+void VulkanClusteredLighting::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	destroyFrameBuffers();
+	frames.clear();
+
+	if (pipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(device, pipeline, nullptr);
+		pipeline = VK_NULL_HANDLE;
+	}
+	if (pipelineLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		pipelineLayout = VK_NULL_HANDLE;
+	}
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		descriptorPool = VK_NULL_HANDLE;
+	}
+	if (setLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+		setLayout = VK_NULL_HANDLE;
+	}
+
+	lights.clear();
+	staleFramesMask = 0;
+	lightIndexCount = 0;
+	busiestClusterLightCount = 0;
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanClusteredLighting::setLights(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Clustered lighting set lights called before initialization!");
+	}
+
+	lights.clear();
+	for (const PointLight& point : pointLights)
+	{
+		if (lights.size() == MAX_LIGHTS) break;
+
+		GpuLight light{};
+		light.position = glm::vec4(point.position, point.range);
+		light.color = point.color;
+		light.type = GPU_LIGHT_POINT;
+		lights.push_back(light);
+	}
+	for (const SpotLight& spot : spotLights)
+	{
+		if (lights.size() == MAX_LIGHTS) break;
+
+		GpuLight light{};
+		light.position = glm::vec4(spot.position, spot.range);
+		light.color = spot.color;
+		light.direction = glm::vec4(glm::normalize(spot.direction), 0.0f);
+		light.spotCosInner = std::cos(std::min(spot.innerAngle, spot.outerAngle * 0.99f)); // smoothstep needs distinct edges
+		light.spotCosOuter = std::cos(spot.outerAngle);
+		light.type = GPU_LIGHT_SPOT;
+		lights.push_back(light);
+	}
+	staleFramesMask = (1u << frames.size()) - 1;
+}
+
+void VulkanClusteredLighting::update(uint32_t frameIndex, const glm::mat4& view, const glm::mat4& projection,
+	float nearPlane, float farPlane, VkExtent2D extent)
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Clustered lighting update: invalid frame index");
+	}
+	const FrameResources& frame = frames[frameIndex];
+
+	const uint32_t frameBit = 1u << frameIndex;
+	if (staleFramesMask & frameBit)
+	{
+		memcpy(frame.lightAllocation.mappedData, lights.data(), lights.size() * sizeof(GpuLight));
+		staleFramesMask &= ~frameBit;
+	}
+
+	// the fence has signalled, so the stats hold this frame slot's last binning
+	const ClusterStats* stats = static_cast<const ClusterStats*>(frame.statsAllocation.mappedData);
+	lightIndexCount = std::min(stats->indexCount, CLUSTER_COUNT * AVERAGE_LIGHTS_PER_CLUSTER);
+	busiestClusterLightCount = stats->busiestCluster;
+
+	float logDepthRange = std::log(farPlane / nearPlane);
+
+	ClusterUniforms* uniforms = static_cast<ClusterUniforms*>(frame.uniformAllocation.mappedData);
+	uniforms->view = view;
+	uniforms->inverseProjection = glm::inverse(projection);
+	uniforms->gridSize = glm::uvec4(CLUSTER_X, CLUSTER_Y, CLUSTER_Z, static_cast<uint32_t>(lights.size()));
+	uniforms->tileSize = glm::vec2(static_cast<float>(extent.width) / CLUSTER_X, static_cast<float>(extent.height) / CLUSTER_Y);
+	uniforms->nearPlane = nearPlane;
+	uniforms->farPlane = farPlane;
+	uniforms->sliceScale = static_cast<float>(CLUSTER_Z) / logDepthRange;
+	uniforms->sliceBias = -static_cast<float>(CLUSTER_Z) * std::log(nearPlane) / logDepthRange;
+	uniforms->indexCapacity = CLUSTER_COUNT * AVERAGE_LIGHTS_PER_CLUSTER;
+}
+
+void VulkanClusteredLighting::recordBinning(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	const FrameResources& frame = frames[frameIndex];
+
+	vkCmdFillBuffer(commandBuffer, frame.statsBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	// the counter must be zero before the shader bumps it, the previous frame's reads of the grid
+	// and index list were already waited on through the frame fence
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	// one invocation per cluster, even without lights: every cluster needs its count cleared
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+	vkCmdDispatch(commandBuffer, (CLUSTER_COUNT + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	// the stats are read back on the host once the fence signals
+	VkMemoryBarrier statsBarrier{};
+	statsBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	statsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	statsBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &statsBarrier, 0, nullptr, 0, nullptr);
+}
+
+VkDescriptorSetLayout VulkanClusteredLighting::getDescriptorSetLayout() const
+{
+	if (setLayout == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Clustered lighting get descriptor set layout called before initialization!");
+	}
+	return setLayout;
+}
+
+VkDescriptorSet VulkanClusteredLighting::getDescriptorSet(uint32_t frameIndex) const
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Clustered lighting get descriptor set called before initialization!");
+	}
+	return frames[frameIndex].descriptorSet;
+}
+
+VkBuffer VulkanClusteredLighting::getClusterBuffer(uint32_t frameIndex) const
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Clustered lighting get cluster buffer called before initialization!");
+	}
+	return frames[frameIndex].clusterBuffer;
+}
+
+VkBuffer VulkanClusteredLighting::getIndexBuffer(uint32_t frameIndex) const
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Clustered lighting get index buffer called before initialization!");
+	}
+	return frames[frameIndex].indexBuffer;
+}
+
+void VulkanClusteredLighting::createPipeline()
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create clustered lighting pipeline layout!");
+	}
+
+	VkShaderModule shaderModule = VulkanShaderModuleCache::createShaderModule(device,
+		VulkanShaderModuleCache::readFile("shaders/cluster.comp.spv"));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create clustered lighting pipeline!");
+	}
+}
+
+void VulkanClusteredLighting::createFrameBuffers()
+{
+	VkMemoryPropertyFlags directWrite = allocator->getDirectWriteMemoryProperties();
+
+	for (FrameResources& frame : frames)
+	{
+		VulkanBuffer::createBuffer(device, *allocator, MAX_LIGHTS * sizeof(GpuLight),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, directWrite, frame.lightBuffer, frame.lightAllocation);
+		VulkanBuffer::createBuffer(device, *allocator, sizeof(ClusterUniforms),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, directWrite, frame.uniformBuffer, frame.uniformAllocation);
+		VulkanBuffer::createBuffer(device, *allocator, CLUSTER_COUNT * 2 * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.clusterBuffer, frame.clusterAllocation);
+		VulkanBuffer::createBuffer(device, *allocator, CLUSTER_COUNT * AVERAGE_LIGHTS_PER_CLUSTER * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.indexBuffer, frame.indexAllocation);
+		VulkanBuffer::createBuffer(device, *allocator, sizeof(ClusterStats),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.statsBuffer, frame.statsAllocation);
+		memset(frame.statsAllocation.mappedData, 0, sizeof(ClusterStats));
+	}
+}
+
+void VulkanClusteredLighting::destroyFrameBuffers()
+{
+	for (FrameResources& frame : frames)
+	{
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.lightBuffer, frame.lightAllocation);
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.uniformBuffer, frame.uniformAllocation);
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.clusterBuffer, frame.clusterAllocation);
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.indexBuffer, frame.indexAllocation);
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.statsBuffer, frame.statsAllocation);
+	}
+}
+
+void VulkanClusteredLighting::writeDescriptorSets()
+{
+	for (FrameResources& frame : frames)
+	{
+		std::array<VkDescriptorBufferInfo, 5> bufferInfos{};
+		bufferInfos[0] = { frame.uniformBuffer, 0, sizeof(ClusterUniforms) };
+		bufferInfos[1] = { frame.lightBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { frame.clusterBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[3] = { frame.indexBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[4] = { frame.statsBuffer, 0, VK_WHOLE_SIZE };
+
+		std::array<VkWriteDescriptorSet, 5> writes{};
+		for (uint32_t i = 0; i < writes.size(); i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
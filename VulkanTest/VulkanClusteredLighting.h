@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "VulkanBuffer.h"
+#include "Lights.h"
+
+// Clustered forward lighting: the view frustum is split into a grid of CLUSTER_X * CLUSTER_Y screen
+// tiles by CLUSTER_Z depth slices (exponential, so near slices stay thin). Every frame a compute pass
+// tests each cluster's view space box against every light's range and writes the lights touching it
+// into one compact index list, each cluster keeping an offset and count into it. shader.frag finds its
+// cluster from gl_FragCoord and only loops over those lights, so shading cost follows the lights
+// overlapping a pixel instead of the scene's light count.
+// The lights, the cluster grid and the index list are bound as set 3 of the pbr layout.
+class VulkanClusteredLighting
+{
+public:
+	static constexpr uint32_t CLUSTER_X = 16;
+	static constexpr uint32_t CLUSTER_Y = 9;
+	static constexpr uint32_t CLUSTER_Z = 24;
+	static constexpr uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+	static constexpr uint32_t MAX_LIGHTS = 1024;
+	static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128; // MAX_CLUSTER_LIGHTS in cluster.comp
+	static constexpr uint32_t AVERAGE_LIGHTS_PER_CLUSTER = 32; // sizes the index list, clusters past it lose their lights
+	static constexpr uint32_t WORKGROUP_SIZE = 64; // local_size_x in cluster.comp
+
+	VulkanClusteredLighting();
+	~VulkanClusteredLighting();
+
+	VulkanClusteredLighting(const VulkanClusteredLighting&) = delete;
+	VulkanClusteredLighting& operator=(const VulkanClusteredLighting&) = delete;
+
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames);
+	void destroy();
+
+	// anything past MAX_LIGHTS is dropped; every frame copy is refreshed as it comes up in update()
+	void setLights(const std::vector<PointLight>& pointLights, const std::vector<SpotLight>& spotLights);
+
+	// call once the frame's fence has signalled, every frame. projection is the one the frame renders
+	// with (y flipped), nearPlane and farPlane the planes it was built from
+	void update(uint32_t frameIndex, const glm::mat4& view, const glm::mat4& projection,
+		float nearPlane, float farPlane, VkExtent2D extent);
+	// outside a render pass. Writes the cluster grid and index list; the barrier to the fragment
+	// shaders reading them is left to the caller (the frame graph)
+	void recordBinning(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	VkDescriptorSetLayout getDescriptorSetLayout() const;
+	VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const;
+	VkBuffer getClusterBuffer(uint32_t frameIndex) const;
+	VkBuffer getIndexBuffer(uint32_t frameIndex) const;
+
+	uint32_t getLightCount() const { return static_cast<uint32_t>(lights.size()); }
+	// from the last completed binning of the frame passed to update()
+	uint32_t getLightIndexCount() const { return lightIndexCount; }
+	uint32_t getBusiestClusterLightCount() const { return busiestClusterLightCount; }
+
+private:
+	// std140 mirror of ClusterData in cluster.comp and shader.frag
+	struct ClusterUniforms
+	{
+		glm::mat4 view;
+		glm::mat4 inverseProjection;
+		glm::uvec4 gridSize; // xyz clusters, w light count
+		glm::vec2 tileSize;  // pixels per cluster column and row
+		float nearPlane;
+		float farPlane;
+		float sliceScale;    // slice = log(viewDepth) * sliceScale + sliceBias
+		float sliceBias;
+		uint32_t indexCapacity;
+		uint32_t padding;
+	};
+
+	// read back on the host
+	struct ClusterStats
+	{
+		uint32_t indexCount;
+		uint32_t busiestCluster;
+	};
+
+	struct FrameResources
+	{
+		VkBuffer lightBuffer = VK_NULL_HANDLE;   // host visible copy of lights
+		VulkanAllocation lightAllocation;
+		VkBuffer uniformBuffer = VK_NULL_HANDLE; // host visible, written while recording
+		VulkanAllocation uniformAllocation;
+		VkBuffer clusterBuffer = VK_NULL_HANDLE; // offset and count per cluster
+		VulkanAllocation clusterAllocation;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		VulkanAllocation indexAllocation;
+		VkBuffer statsBuffer = VK_NULL_HANDLE;   // host visible, the index list's fill counter
+		VulkanAllocation statsAllocation;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+
+	std::vector<GpuLight> lights;
+	uint32_t staleFramesMask; // bit n set: frame n still holds an old copy of lights
+	uint32_t lightIndexCount;
+	uint32_t busiestClusterLightCount;
+
+	std::vector<FrameResources> frames;
+
+	VkDescriptorSetLayout setLayout;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+	VkDescriptorPool descriptorPool;
+
+	VkDevice device;
+	VulkanMemoryAllocator* allocator;
+
+	void createPipeline();
+	void createFrameBuffers();
+	void destroyFrameBuffers();
+	void writeDescriptorSets();
+};
@@ -25,6 +25,21 @@ void VulkanCommandPool::create(VkDevice vkdevice, VkPhysicalDevice vkphysicaldev
 	}
 }
 
+void VulkanCommandPool::create(VkDevice vkdevice, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags)
+{
+	device = vkdevice;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = flags;
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create command pool!");
+	}
+}
+
 void VulkanCommandPool::destroy()
 {
 	if (commandPool != VK_NULL_HANDLE)
@@ -34,6 +49,15 @@ void VulkanCommandPool::destroy()
 	}
 }
 
+void VulkanCommandPool::reset()
+{
+	if (commandPool == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Reset command pool called before initialization!");
+	}
+	vkResetCommandPool(device, commandPool, 0);
+}
+
 VkCommandPool VulkanCommandPool::getVkCommandPool() const
 {
 	if (commandPool == VK_NULL_HANDLE)
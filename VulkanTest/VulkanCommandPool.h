@@ -10,8 +10,12 @@ public:
 	~VulkanCommandPool();
 
 	void create(VkDevice vkdevice, VkPhysicalDevice vkPhysicalDevice, VkSurfaceKHR vksurface);
+	void create(VkDevice vkdevice, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags);
 	void destroy();
 
+	// recycles every buffer allocated from the pool, none of them may still be executing
+	void reset();
+
 	VkCommandPool getVkCommandPool() const;
 
 private:
@@ -1,6 +1,6 @@
 #include "VulkanDepthResources.h"
 
-VulkanDepthResources::VulkanDepthResources() : device(VK_NULL_HANDLE), depthImage(VK_NULL_HANDLE), depthImageMemory(VK_NULL_HANDLE), depthImageView(VK_NULL_HANDLE)
+VulkanDepthResources::VulkanDepthResources() : device(VK_NULL_HANDLE), allocator(nullptr), depthImage(VK_NULL_HANDLE), depthImageView(VK_NULL_HANDLE)
 {
 }
 
@@ -9,20 +9,21 @@ VulkanDepthResources::~VulkanDepthResources()
 	destroy();
 }
 
-void VulkanDepthResources::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, VkExtent2D swapChainExtent)
+void VulkanDepthResources::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, VkExtent2D swapChainExtent)
 {
 	device = vkdevice;
+	allocator = &memoryAllocator;
 	VkFormat depthFormat = findDepthFormat(vkphysdevice);
 	VulkanImage::createImage(
 		device, 
-		vkphysdevice, 
+		*allocator, 
 		swapChainExtent.width, 
 		swapChainExtent.height,
 		1, 1,
 		depthFormat,
-		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // sampled by VulkanHiZPyramid
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-		depthImage, depthImageMemory
+		depthImage, depthImageAllocation
 	);
 	depthImageView = VulkanImage::createImageView(device, depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
@@ -31,23 +32,26 @@ void VulkanDepthResources::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevi
 
 void VulkanDepthResources::destroy()
 {
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
 	if (depthImageView != VK_NULL_HANDLE)
 	{
 		vkDestroyImageView(device, depthImageView, nullptr);
 		depthImageView = VK_NULL_HANDLE;
 	}
 
-	if (depthImage != VK_NULL_HANDLE)
-	{
-		vkDestroyImage(device, depthImage, nullptr);
-		depthImage = VK_NULL_HANDLE;
-	}
+	VulkanImage::destroyImage(device, *allocator, depthImage, depthImageAllocation);
+}
 
-	if (depthImageMemory != VK_NULL_HANDLE)
+VkImage VulkanDepthResources::getDepthImage() const
+{
+	if (depthImage == VK_NULL_HANDLE)
 	{
-		vkFreeMemory(device, depthImageMemory, nullptr);
-		depthImageMemory = VK_NULL_HANDLE;
+		throw std::runtime_error("Get depth image called before initalization!");
 	}
+	return depthImage;
 }
 
 VkImageView VulkanDepthResources::getDepthImageView() const
@@ -11,17 +11,19 @@ public:
 	VulkanDepthResources();
 	~VulkanDepthResources();
 
-	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, VkExtent2D swapChainExtent);
+	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, VkExtent2D swapChainExtent);
 	void destroy();
 
+	VkImage getDepthImage() const;
 	VkImageView getDepthImageView() const;
 
 	static VkFormat findDepthFormat(VkPhysicalDevice physicalDevice);
 private:
 	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
+	VulkanAllocation depthImageAllocation;
 	VkImageView depthImageView;
 
 	VkDevice device;
+	VulkanMemoryAllocator* allocator;
 };
 
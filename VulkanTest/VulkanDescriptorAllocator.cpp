@@ -0,0 +1,142 @@
+#include "VulkanDescriptorAllocator.h"
+
+#include <algorithm>
+#include <iostream>
+
+VulkanDescriptorAllocator::VulkanDescriptorAllocator() : setsPerPool(0), device(VK_NULL_HANDLE)
+{
+}
+
+VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+{
+	destroy();
+}
+
+void VulkanDescriptorAllocator::create(VkDevice vkdevice, uint32_t initialSetsPerPool, const std::vector<DescriptorPoolSizeRatio>& poolRatios)
+{
+	device = vkdevice;
+	ratios = poolRatios;
+	setsPerPool = std::max(initialSetsPerPool, 1u);
+
+	// first pool up front, later ones only when it runs out
+	readyPools.push_back(createPool(setsPerPool));
+}
+
+void VulkanDescriptorAllocator::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	// sets are freed together with their pools
+	for (VkDescriptorPool pool : fullPools)
+	{
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	for (VkDescriptorPool pool : readyPools)
+	{
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	fullPools.clear();
+	readyPools.clear();
+
+	device = VK_NULL_HANDLE;
+}
+
+VkDescriptorSet VulkanDescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+	VkDescriptorSet descriptorSet;
+	allocate(layout, 1, &descriptorSet);
+	return descriptorSet;
+}
+
+void VulkanDescriptorAllocator::allocate(VkDescriptorSetLayout layout, uint32_t count, VkDescriptorSet* outSets)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Descriptor allocator allocate called before initialization!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(count, layout);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = getPool();
+	allocInfo.descriptorSetCount = count;
+	allocInfo.pSetLayouts = layouts.data();
+
+	VkResult result = vkAllocateDescriptorSets(device, &allocInfo, outSets);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		// retire the exhausted pool and retry once on a fresh one
+		fullPools.push_back(readyPools.back());
+		readyPools.pop_back();
+
+		setsPerPool = std::max(setsPerPool, count);
+		allocInfo.descriptorPool = getPool();
+		result = vkAllocateDescriptorSets(device, &allocInfo, outSets);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate descriptor sets!");
+	}
+}
+
+void VulkanDescriptorAllocator::reset()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (VkDescriptorPool pool : readyPools)
+	{
+		vkResetDescriptorPool(device, pool, 0);
+	}
+	for (VkDescriptorPool pool : fullPools)
+	{
+		vkResetDescriptorPool(device, pool, 0);
+		readyPools.push_back(pool);
+	}
+	fullPools.clear();
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::getPool()
+{
+	if (readyPools.empty())
+	{
+		uint32_t setCount = setsPerPool;
+		readyPools.push_back(createPool(setCount));
+		std::cout << "Descriptor allocator: chained pool " << getPoolCount() << " (" << setCount << " sets)" << std::endl;
+	}
+	return readyPools.back();
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::createPool(uint32_t setCount)
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	poolSizes.reserve(ratios.size());
+	for (const DescriptorPoolSizeRatio& ratio : ratios)
+	{
+		uint32_t descriptorCount = std::max(static_cast<uint32_t>(ratio.ratio * setCount), 1u);
+		poolSizes.push_back({ ratio.type, descriptorCount });
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = 0; // sets are only ever released in bulk through reset()
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = setCount;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+
+	// each chained pool is larger, so a long stream of loads settles on few pools
+	setsPerPool = std::min(setsPerPool + setsPerPool / 2, MAX_SETS_PER_POOL);
+	return pool;
+}
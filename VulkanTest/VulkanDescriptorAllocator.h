@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+// Descriptors per set of each type, pools are sized as ratio * setsPerPool
+struct DescriptorPoolSizeRatio
+{
+	VkDescriptorType type;
+	float ratio;
+};
+
+// Growable descriptor set allocator. Sets come from the current pool; when it runs out
+// (VK_ERROR_OUT_OF_POOL_MEMORY / VK_ERROR_FRAGMENTED_POOL) a recycled or new, larger pool is
+// chained on, so allocation never fails on exhaustion. reset() resets every pool and keeps
+// them for reuse, which is how a per-frame allocator recycles its sets once the frame's
+// fence has signalled.
+class VulkanDescriptorAllocator
+{
+public:
+	static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+	VulkanDescriptorAllocator();
+	~VulkanDescriptorAllocator();
+
+	VulkanDescriptorAllocator(const VulkanDescriptorAllocator&) = delete;
+	VulkanDescriptorAllocator& operator=(const VulkanDescriptorAllocator&) = delete;
+
+	void create(VkDevice vkdevice, uint32_t initialSetsPerPool, const std::vector<DescriptorPoolSizeRatio>& poolRatios);
+	void destroy();
+
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+	void allocate(VkDescriptorSetLayout layout, uint32_t count, VkDescriptorSet* outSets);
+
+	// every set allocated so far becomes invalid
+	void reset();
+
+	uint32_t getPoolCount() const { return static_cast<uint32_t>(fullPools.size() + readyPools.size()); }
+
+private:
+	std::vector<DescriptorPoolSizeRatio> ratios;
+	std::vector<VkDescriptorPool> fullPools;  // allocated from since the last reset
+	std::vector<VkDescriptorPool> readyPools; // back() is the pool currently allocated from
+	uint32_t setsPerPool;
+
+	VkDevice device;
+
+	VkDescriptorPool getPool();
+	VkDescriptorPool createPool(uint32_t setCount);
+};
@@ -20,13 +20,6 @@ void VulkanDescriptorSetLayout::create(VkDevice vkdevice)
 	frameUboLayoutBinding.pImmutableSamplers = nullptr;
 	frameUboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT/* | VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT*/;
 
-	VkDescriptorSetLayoutBinding objectUboLayoutBinding{};
-	objectUboLayoutBinding.binding = 1;
-	objectUboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-	objectUboLayoutBinding.descriptorCount = 1;
-	objectUboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT/* | VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT*/;
-	objectUboLayoutBinding.pImmutableSamplers = nullptr;
-
 	VkDescriptorSetLayoutBinding lightingUboLayoutBinding{};
 	lightingUboLayoutBinding.binding = 2;
 	lightingUboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -97,9 +90,16 @@ void VulkanDescriptorSetLayout::create(VkDevice vkdevice)
 	brdfLutSamplerLayoutBinding.pImmutableSamplers = nullptr;
 	brdfLutSamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+	VkDescriptorSetLayoutBinding shadowMapSamplerLayoutBinding{};
+	shadowMapSamplerLayoutBinding.binding = 12; // every cascade of the directional light, compare sampler
+	shadowMapSamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	shadowMapSamplerLayoutBinding.descriptorCount = 1;
+	shadowMapSamplerLayoutBinding.pImmutableSamplers = nullptr;
+	shadowMapSamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	// binding 1 (per-object data) moved to set 1, see createForObjectData
 	std::array<VkDescriptorSetLayoutBinding, 12> bindings = { 
 		frameUboLayoutBinding, 
-		objectUboLayoutBinding,
 		lightingUboLayoutBinding,
 		materialUboLayoutBinding,
 		albedoSamplerLayoutBinding,
@@ -109,7 +109,8 @@ void VulkanDescriptorSetLayout::create(VkDevice vkdevice)
 		emissiveSamplerLayoutBinding,
 		irradianceSamplerLayoutBinding,
 		prefilterSamplerLayoutBinding,
-		brdfLutSamplerLayoutBinding
+		brdfLutSamplerLayoutBinding,
+		shadowMapSamplerLayoutBinding
 	};
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
@@ -184,6 +185,149 @@ void VulkanDescriptorSetLayout::createForCubmapConversion(VkDevice device)
 }
 
 
+void VulkanDescriptorSetLayout::createForTransientData(VkDevice vkdevice)
+{
+	device = vkdevice;
+
+	// a whole frame allocator block as one storage buffer
+	VkDescriptorSetLayoutBinding objectDataLayoutBinding{};
+	objectDataLayoutBinding.binding = 0;
+	objectDataLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	objectDataLayoutBinding.descriptorCount = 1;
+	objectDataLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	objectDataLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &objectDataLayoutBinding;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create transient data descriptor set layout!");
+	}
+}
+
+void VulkanDescriptorSetLayout::createForObjectData(VkDevice vkdevice)
+{
+	device = vkdevice;
+
+	// set 1 of the pbr layout, see VulkanObjectDataBuffer
+	VkDescriptorSetLayoutBinding staticObjectsLayoutBinding{};
+	staticObjectsLayoutBinding.binding = 0;
+	staticObjectsLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	staticObjectsLayoutBinding.descriptorCount = 1;
+	staticObjectsLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	staticObjectsLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding dynamicObjectsLayoutBinding{};
+	dynamicObjectsLayoutBinding.binding = 1;
+	dynamicObjectsLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	dynamicObjectsLayoutBinding.descriptorCount = 1;
+	dynamicObjectsLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	dynamicObjectsLayoutBinding.pImmutableSamplers = nullptr;
+
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings = { staticObjectsLayoutBinding, dynamicObjectsLayoutBinding };
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create object data descriptor set layout!");
+	}
+}
+
+void VulkanDescriptorSetLayout::createForBindless(VkDevice vkdevice, uint32_t textureCount)
+{
+	device = vkdevice;
+
+	// set 0 of the bindless pbr layout, one per frame for every material (see VulkanBindlessMaterials)
+	VkDescriptorSetLayoutBinding frameUboLayoutBinding{};
+	frameUboLayoutBinding.binding = 0; // must stay 0, shared with shader.vert
+	frameUboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	frameUboLayoutBinding.descriptorCount = 1;
+	frameUboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutBinding lightingUboLayoutBinding{};
+	lightingUboLayoutBinding.binding = 1;
+	lightingUboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	lightingUboLayoutBinding.descriptorCount = 1;
+	lightingUboLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutBinding materialBufferLayoutBinding{};
+	materialBufferLayoutBinding.binding = 2;
+	materialBufferLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	materialBufferLayoutBinding.descriptorCount = 1;
+	materialBufferLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutBinding irradianceSamplerLayoutBinding{};
+	irradianceSamplerLayoutBinding.binding = 3;
+	irradianceSamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	irradianceSamplerLayoutBinding.descriptorCount = 1;
+	irradianceSamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutBinding prefilterSamplerLayoutBinding{};
+	prefilterSamplerLayoutBinding.binding = 4;
+	prefilterSamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	prefilterSamplerLayoutBinding.descriptorCount = 1;
+	prefilterSamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutBinding brdfLutSamplerLayoutBinding{};
+	brdfLutSamplerLayoutBinding.binding = 5;
+	brdfLutSamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	brdfLutSamplerLayoutBinding.descriptorCount = 1;
+	brdfLutSamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutBinding textureArrayLayoutBinding{};
+	textureArrayLayoutBinding.binding = 6;
+	textureArrayLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	textureArrayLayoutBinding.descriptorCount = textureCount;
+	textureArrayLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutBinding shadowMapSamplerLayoutBinding{};
+	shadowMapSamplerLayoutBinding.binding = 7;
+	shadowMapSamplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	shadowMapSamplerLayoutBinding.descriptorCount = 1;
+	shadowMapSamplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	std::array<VkDescriptorSetLayoutBinding, 8> bindings = {
+		frameUboLayoutBinding,
+		lightingUboLayoutBinding,
+		materialBufferLayoutBinding,
+		irradianceSamplerLayoutBinding,
+		prefilterSamplerLayoutBinding,
+		brdfLutSamplerLayoutBinding,
+		textureArrayLayoutBinding,
+		shadowMapSamplerLayoutBinding
+	};
+
+	// the texture array is filled in as textures load, slots nobody samples may stay empty, and new slots
+	// are written while frames that only read the older ones are still pending
+	std::array<VkDescriptorBindingFlagsEXT, 8> bindingFlags{};
+	bindingFlags[6] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+		| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create bindless descriptor set layout!");
+	}
+}
+
 void VulkanDescriptorSetLayout::destroy()
 {
 	if (descriptorSetLayout != VK_NULL_HANDLE)
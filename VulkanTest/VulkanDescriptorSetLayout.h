@@ -13,6 +13,9 @@ public:
 	void create(VkDevice vkdevice);
 	void createForSkybox(VkDevice device);
 	void createForCubmapConversion(VkDevice device);
+	void createForTransientData(VkDevice device);
+	void createForObjectData(VkDevice device);
+	void createForBindless(VkDevice device, uint32_t textureCount);
 	void destroy();
 
 	VkDescriptorSetLayout getVkDescriptorSetLayout() const;
@@ -1,5 +1,8 @@
 #include "VulkanDescriptorSets.h"
 #include "iostream"
+#include <cstddef>
+
+#include "VulkanDescriptorUpdateTemplate.h"
 
 VulkanDescriptorSets::VulkanDescriptorSets() : descriptorSets({}), device(VK_NULL_HANDLE)
 {
@@ -79,16 +82,38 @@ void VulkanDescriptorSets::create(VkDevice vkdevice, VkDescriptorPool descriptor
 	}
 }
 
+// binding layout of VulkanDescriptorSetLayout::create, filled through one update template
+struct MaterialDescriptorData
+{
+	VkDescriptorBufferInfo frameUbo;    // binding 0
+	VkDescriptorBufferInfo lightingUbo; // binding 2
+	VkDescriptorBufferInfo materialUbo; // binding 3
+	VkDescriptorImageInfo maps[9];      // bindings 4-8 material maps, 9-11 IBL, 12 shadow cascades
+};
+
 void VulkanDescriptorSets::createForMaterials(
-	VkDevice device, VkDescriptorPool descriptorPool, 
+	VkDevice device, VulkanDescriptorAllocator& descriptorAllocator,
 	VkDescriptorSetLayout descriptorSetLayout, uint32_t numFrames, 
-	const std::vector<VkBuffer> frameUboBuffers, const std::vector<VkBuffer> objectDUBuffers, 
+	const std::vector<VkBuffer> frameUboBuffers,
 	const std::vector<VkBuffer> lightingUboBuffers, const std::vector<VkBuffer> materialDataUboBuffers,
 	std::map<std::string, std::shared_ptr<Material>>& materials,
 	IblPacket iblPacket,
 	size_t materialUboAlignedStride)
 {
-	//this->device = device;
+	std::vector<VkDescriptorUpdateTemplateEntry> entries = {
+		VulkanDescriptorUpdateTemplate::entry(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, offsetof(MaterialDescriptorData, frameUbo)),
+		VulkanDescriptorUpdateTemplate::entry(2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, offsetof(MaterialDescriptorData, lightingUbo)),
+		VulkanDescriptorUpdateTemplate::entry(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, offsetof(MaterialDescriptorData, materialUbo))
+	};
+	for (uint32_t map = 0; map < 9; map++)
+	{
+		entries.push_back(VulkanDescriptorUpdateTemplate::entry(4 + map, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			offsetof(MaterialDescriptorData, maps) + map * sizeof(VkDescriptorImageInfo)));
+	}
+
+	VulkanDescriptorUpdateTemplate updateTemplate;
+	updateTemplate.create(device, descriptorSetLayout, entries);
+
 	int materialIndex = 0;
 	for (auto& pair : materials)
 	{
@@ -96,218 +121,48 @@ void VulkanDescriptorSets::createForMaterials(
 		
 		material->frameSpecificDescriptorSets.resize(numFrames);
 
-		std::vector<VkDescriptorSetLayout> layouts(numFrames, descriptorSetLayout);
-		VkDescriptorSetAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocInfo.descriptorPool = descriptorPool;
-		allocInfo.descriptorSetCount = static_cast<uint32_t>(numFrames);
-		allocInfo.pSetLayouts = layouts.data();
-
 		std::cout << "Allocating Descriptor Sets for " << material->name << std::endl;
-		if (vkAllocateDescriptorSets(device, &allocInfo, material->frameSpecificDescriptorSets.data()) != VK_SUCCESS)
+		descriptorAllocator.allocate(descriptorSetLayout, numFrames, material->frameSpecificDescriptorSets.data());
+
+		MaterialDescriptorData data{};
+		const VulkanTexture* textures[5] = {
+			material->albedoMap.get(),
+			material->normalMap.get(),
+			material->metallicRoughnessMap.get(),
+			material->occlusionMap.get(),
+			material->emissiveMap.get()
+		};
+		for (uint32_t map = 0; map < 5; map++)
 		{
-			throw std::runtime_error("failed to allocate descriptor sets for a material: " + material->name);
+			data.maps[map].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			data.maps[map].imageView = textures[map]->getImageView();
+			data.maps[map].sampler = textures[map]->getSampler();
 		}
-
-		// --- ADD THIS LINE FOR DEBUGGING ---
-		//std::cout << "  > Allocated handle for frame 0: " << material->frameSpecificDescriptorSets[0] << std::endl;
-		// ------------------------------------
+		data.maps[5] = { iblPacket.irradianceSampler, iblPacket.irradianceImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		data.maps[6] = { iblPacket.prefilterSampler, iblPacket.prefilterImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		data.maps[7] = { iblPacket.brdfLutSampler, iblPacket.brdfLutImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		data.maps[8] = { iblPacket.shadowMapSampler, iblPacket.shadowMapImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
 
 		for (size_t i = 0; i < numFrames; i++)
 		{
-			VkDescriptorBufferInfo frameBufferInfo{};
-			frameBufferInfo.buffer = frameUboBuffers[i];
-			frameBufferInfo.offset = 0;
-			frameBufferInfo.range = sizeof(FrameUniformBufferObject);
-
-			// dynamic
-			VkDescriptorBufferInfo objectBufferInfo{};
-			objectBufferInfo.buffer = objectDUBuffers[i];
-			objectBufferInfo.offset = 0;
-			objectBufferInfo.range = sizeof(ObjectUniformBufferObject);
-
-			VkDescriptorBufferInfo lightingBufferInfo{};
-			lightingBufferInfo.buffer = lightingUboBuffers[i];
-			lightingBufferInfo.offset = 0;
-			lightingBufferInfo.range = sizeof(SceneLightingUBO);
-
-			VkDescriptorBufferInfo materialDataBufferInfo{};
-			materialDataBufferInfo.buffer = materialDataUboBuffers[i];
-			materialDataBufferInfo.offset = static_cast<VkDeviceSize>(materialIndex * materialUboAlignedStride);
-			materialDataBufferInfo.range = sizeof(MaterialUBO);
-
-			VkDescriptorImageInfo albedoMapImageInfo{};
-			albedoMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			albedoMapImageInfo.imageView = material->albedoMap->getImageView();
-			albedoMapImageInfo.sampler = material->albedoMap->getSampler();
-
-			VkDescriptorImageInfo normalMapImageInfo{};
-			normalMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			normalMapImageInfo.imageView = material->normalMap->getImageView();
-			normalMapImageInfo.sampler = material->normalMap->getSampler();
-
-			VkDescriptorImageInfo metallicRoughnessMapImageInfo{};
-			metallicRoughnessMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			metallicRoughnessMapImageInfo.imageView = material->metallicRoughnessMap->getImageView();
-			metallicRoughnessMapImageInfo.sampler = material->metallicRoughnessMap->getSampler();
-
-			VkDescriptorImageInfo occlusionMapImageInfo{};
-			occlusionMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			occlusionMapImageInfo.imageView = material->occlusionMap->getImageView();
-			occlusionMapImageInfo.sampler = material->occlusionMap->getSampler();
-
-			VkDescriptorImageInfo emissionMapImageInfo{};
-			emissionMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			emissionMapImageInfo.imageView = material->emissiveMap->getImageView();
-			emissionMapImageInfo.sampler = material->emissiveMap->getSampler();
-
-			VkDescriptorImageInfo irradianceMapImageInfo{};
-			irradianceMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			irradianceMapImageInfo.imageView = iblPacket.irradianceImageView;
-			irradianceMapImageInfo.sampler = iblPacket.irradianceSampler;
-
-			VkDescriptorImageInfo prefilterMapImageInfo{};
-			prefilterMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			prefilterMapImageInfo.imageView = iblPacket.prefilterImageView;
-			prefilterMapImageInfo.sampler = iblPacket.prefilterSampler;
-
-			VkDescriptorImageInfo brdfLutMapImageInfo{};
-			brdfLutMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			brdfLutMapImageInfo.imageView = iblPacket.brdfLutImageView;
-			brdfLutMapImageInfo.sampler = iblPacket.brdfLutSampler;
-
-			std::array<VkWriteDescriptorSet, 12> descriptorWrites{};
-
-			// Frame UBO
-			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[0].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[0].dstBinding = 0;
-			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[0].descriptorCount = 1;
-			descriptorWrites[0].pBufferInfo = &frameBufferInfo;
-
-			// Object UBO
-			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[1].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[1].dstBinding = 1;
-			descriptorWrites[1].dstArrayElement = 0;
-			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-			descriptorWrites[1].descriptorCount = 1;
-			descriptorWrites[1].pBufferInfo = &objectBufferInfo;
-
-			// Lighting UBO
-			descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[2].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[2].dstBinding = 2;
-			descriptorWrites[2].dstArrayElement = 0;
-			descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[2].descriptorCount = 1;
-			descriptorWrites[2].pBufferInfo = &lightingBufferInfo;
-
-			// Material UBO
-			descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[3].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[3].dstBinding = 3;
-			descriptorWrites[3].dstArrayElement = 0;
-			descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[3].descriptorCount = 1;
-			descriptorWrites[3].pBufferInfo = &materialDataBufferInfo;
-
-			// Albedo Map UBO
-			descriptorWrites[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[4].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[4].dstBinding = 4;
-			descriptorWrites[4].dstArrayElement = 0;
-			descriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[4].descriptorCount = 1;
-			descriptorWrites[4].pImageInfo = &albedoMapImageInfo;
-
-			// Normal Map UBO
-			descriptorWrites[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[5].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[5].dstBinding = 5;
-			descriptorWrites[5].dstArrayElement = 0;
-			descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[5].descriptorCount = 1;
-			descriptorWrites[5].pImageInfo = &normalMapImageInfo;
-
-			// metallicRoughness Map UBO
-			descriptorWrites[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[6].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[6].dstBinding = 6;
-			descriptorWrites[6].dstArrayElement = 0;
-			descriptorWrites[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[6].descriptorCount = 1;
-			descriptorWrites[6].pImageInfo = &metallicRoughnessMapImageInfo;
-
-			// occlusion Map UBO
-			descriptorWrites[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[7].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[7].dstBinding = 7;
-			descriptorWrites[7].dstArrayElement = 0;
-			descriptorWrites[7].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[7].descriptorCount = 1;
-			descriptorWrites[7].pImageInfo = &occlusionMapImageInfo;
-
-			// emission Map UBO
-			descriptorWrites[8].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[8].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[8].dstBinding = 8;
-			descriptorWrites[8].dstArrayElement = 0;
-			descriptorWrites[8].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[8].descriptorCount = 1;
-			descriptorWrites[8].pImageInfo = &emissionMapImageInfo;
-
-			// Irradiance Map UBO
-			descriptorWrites[9].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[9].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[9].dstBinding = 9;
-			descriptorWrites[9].dstArrayElement = 0;
-			descriptorWrites[9].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[9].descriptorCount = 1;
-			descriptorWrites[9].pImageInfo = &irradianceMapImageInfo;
-
-			// Prefilter Map UBO
-			descriptorWrites[10].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[10].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[10].dstBinding = 10;
-			descriptorWrites[10].dstArrayElement = 0;
-			descriptorWrites[10].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[10].descriptorCount = 1;
-			descriptorWrites[10].pImageInfo = &prefilterMapImageInfo;
-
-			// BrdfLut Map UBO
-			descriptorWrites[11].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[11].dstSet = material->frameSpecificDescriptorSets[i];
-			descriptorWrites[11].dstBinding = 11;
-			descriptorWrites[11].dstArrayElement = 0;
-			descriptorWrites[11].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[11].descriptorCount = 1;
-			descriptorWrites[11].pImageInfo = &brdfLutMapImageInfo;
-
-			vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+			data.frameUbo = { frameUboBuffers[i], 0, sizeof(FrameUniformBufferObject) };
+			data.lightingUbo = { lightingUboBuffers[i], 0, sizeof(SceneLightingUBO) };
+			data.materialUbo = { materialDataUboBuffers[i], static_cast<VkDeviceSize>(materialIndex * materialUboAlignedStride), sizeof(MaterialUBO) };
+
+			// per-object data lives in set 1, see VulkanObjectDataBuffer
+			updateTemplate.update(material->frameSpecificDescriptorSets[i], &data);
 		}
 
 		materialIndex++;
 	}
+
+	updateTemplate.destroy();
 }
 
-void VulkanDescriptorSets::createForSkybox(VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, uint32_t numFrames, const std::vector<VkBuffer> frameUboBuffers, VulkanTexture& textureObj)
+void VulkanDescriptorSets::createForSkybox(VkDevice device, VulkanDescriptorAllocator& descriptorAllocator, VkDescriptorSetLayout descriptorSetLayout, uint32_t numFrames, const std::vector<VkBuffer> frameUboBuffers, VulkanTexture& textureObj)
 {
-	std::vector<VkDescriptorSetLayout> layouts(numFrames, descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(numFrames);
-	allocInfo.pSetLayouts = layouts.data();
-
 	descriptorSets.resize(numFrames);
-
-	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to allocate descriptor sets for skybox.");
-	}
+	descriptorAllocator.allocate(descriptorSetLayout, numFrames, descriptorSets.data());
 
 	for (size_t i = 0; i < numFrames; i++)
 	{
@@ -345,22 +200,11 @@ void VulkanDescriptorSets::createForSkybox(VkDevice device, VkDescriptorPool des
 	}
 }
 
-void VulkanDescriptorSets::createForCubeMapConversion(VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorSetLayout descriptorSetLayout, VulkanTexture& textureObj)
+void VulkanDescriptorSets::createForCubeMapConversion(VkDevice device, VulkanDescriptorAllocator& descriptorAllocator, VkDescriptorSetLayout descriptorSetLayout, VulkanTexture& textureObj)
 {
 	this->device = device;
-	std::vector<VkDescriptorSetLayout> layouts(1, descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = 1;
-	allocInfo.pSetLayouts = layouts.data();
-
 	descriptorSets.resize(1);
-
-	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to allocate descriptor sets for cubemap conversion.");
-	}
+	descriptorSets[0] = descriptorAllocator.allocate(descriptorSetLayout);
 
 	VkDescriptorImageInfo cubemapImageInfo{};
 	cubemapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -8,6 +8,7 @@
 #include "VulkanUniformBuffers.h"
 #include "Renderable.h"
 #include "Lights.h"
+#include "VulkanDescriptorAllocator.h"
 
 struct IblPacket
 {
@@ -17,6 +18,8 @@ struct IblPacket
 	VkSampler prefilterSampler;
 	VkImageView brdfLutImageView;
 	VkSampler brdfLutSampler;
+	VkImageView shadowMapImageView; // every shadow cascade as one array, in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+	VkSampler shadowMapSampler;     // depth compare
 };
 
 class VulkanDescriptorSets
@@ -33,11 +36,10 @@ public:
 
 	static void createForMaterials(
 		VkDevice device,
-		VkDescriptorPool descriptorPool,
+		VulkanDescriptorAllocator& descriptorAllocator,
 		VkDescriptorSetLayout descriptorSetLayout,
 		uint32_t numFrames,
 		const std::vector<VkBuffer> frameUboBuffers,
-		const std::vector<VkBuffer> objectDUBuffers,
 		const std::vector<VkBuffer> lightingUboBuffers,
 		//const std::vector<VkBuffer> tessUboBuffers,
 		const std::vector<VkBuffer> materialDataUboBuffers,
@@ -48,7 +50,7 @@ public:
 
 	void createForSkybox(
 		VkDevice device,
-		VkDescriptorPool descriptorPool,
+		VulkanDescriptorAllocator& descriptorAllocator,
 		VkDescriptorSetLayout descriptorSetLayout,
 		uint32_t numFrames,
 		const std::vector<VkBuffer> frameUboBuffers,
@@ -57,7 +59,7 @@ public:
 
 	void createForCubeMapConversion(
 		VkDevice device,
-		VkDescriptorPool descriptorPool,
+		VulkanDescriptorAllocator& descriptorAllocator,
 		VkDescriptorSetLayout descriptorSetLayout,
 		VulkanTexture& textureObj
 	);
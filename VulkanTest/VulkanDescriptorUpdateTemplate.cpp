@@ -0,0 +1,57 @@
+#include "VulkanDescriptorUpdateTemplate.h"
+
+VulkanDescriptorUpdateTemplate::VulkanDescriptorUpdateTemplate() : updateTemplate(VK_NULL_HANDLE), device(VK_NULL_HANDLE)
+{
+}
+
+VulkanDescriptorUpdateTemplate::~VulkanDescriptorUpdateTemplate()
+{
+	destroy();
+}
+
+void VulkanDescriptorUpdateTemplate::create(VkDevice vkdevice, VkDescriptorSetLayout setLayout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries)
+{
+	device = vkdevice;
+
+	VkDescriptorUpdateTemplateCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	createInfo.pDescriptorUpdateEntries = entries.data();
+	createInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	createInfo.descriptorSetLayout = setLayout;
+
+	if (vkCreateDescriptorUpdateTemplate(device, &createInfo, nullptr, &updateTemplate) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor update template!");
+	}
+}
+
+void VulkanDescriptorUpdateTemplate::destroy()
+{
+	if (updateTemplate != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorUpdateTemplate(device, updateTemplate, nullptr);
+		updateTemplate = VK_NULL_HANDLE;
+	}
+}
+
+void VulkanDescriptorUpdateTemplate::update(VkDescriptorSet descriptorSet, const void* pData) const
+{
+	if (updateTemplate == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Descriptor update template update called before initialization!");
+	}
+	vkUpdateDescriptorSetWithTemplate(device, descriptorSet, updateTemplate, pData);
+}
+
+VkDescriptorUpdateTemplateEntry VulkanDescriptorUpdateTemplate::entry(uint32_t binding, VkDescriptorType type, size_t offset)
+{
+	VkDescriptorUpdateTemplateEntry templateEntry{};
+	templateEntry.dstBinding = binding;
+	templateEntry.dstArrayElement = 0;
+	templateEntry.descriptorCount = 1;
+	templateEntry.descriptorType = type;
+	templateEntry.offset = offset;
+	templateEntry.stride = 0; // single descriptor, stride unused
+	return templateEntry;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+// Wraps a VkDescriptorUpdateTemplate: the driver reads a set's buffer / image infos straight
+// out of a caller defined struct, instead of walking a VkWriteDescriptorSet array per update.
+class VulkanDescriptorUpdateTemplate
+{
+public:
+	VulkanDescriptorUpdateTemplate();
+	~VulkanDescriptorUpdateTemplate();
+
+	VulkanDescriptorUpdateTemplate(const VulkanDescriptorUpdateTemplate&) = delete;
+	VulkanDescriptorUpdateTemplate& operator=(const VulkanDescriptorUpdateTemplate&) = delete;
+
+	void create(VkDevice vkdevice, VkDescriptorSetLayout setLayout, const std::vector<VkDescriptorUpdateTemplateEntry>& entries);
+	void destroy();
+
+	// pData is laid out as described by the entries' offsets
+	void update(VkDescriptorSet descriptorSet, const void* pData) const;
+
+	// one descriptor at byte offset `offset` of the data struct
+	static VkDescriptorUpdateTemplateEntry entry(uint32_t binding, VkDescriptorType type, size_t offset);
+
+private:
+	VkDescriptorUpdateTemplate updateTemplate;
+
+	VkDevice device;
+};
@@ -1,5 +1,7 @@
 #include "VulkanDevice.h"
 
+#include <cstring>
+
 VulkanDevice::VulkanDevice() : device(VK_NULL_HANDLE), physicalDevice(VK_NULL_HANDLE), instance(VK_NULL_HANDLE), surface(VK_NULL_HANDLE), graphicsQueue(VK_NULL_HANDLE), presentQueue(VK_NULL_HANDLE)
 {
 
@@ -119,13 +121,102 @@ void VulkanDevice::createLogicalDevice()
 	deviceFeatures.tessellationShader = VK_TRUE;
 	deviceFeatures.fillModeNonSolid = VK_TRUE;
 
+	std::vector<const char*> enabledExtensions = deviceExtensionsTmp;
+
+	// GPU driven culling writes many draws with their own firstInstance, optional
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	indirectDrawEnabled = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+	if (indirectDrawEnabled)
+	{
+		deviceFeatures.multiDrawIndirect = VK_TRUE;
+		deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+	}
+
+	// fragment shader invocation counts for the overdraw readout, optional
+	pipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+	deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+	// lets secondaries run while that query is active, without it the scene is recorded inline then
+	inheritedQueriesEnabled = pipelineStatisticsEnabled && supportedFeatures.inheritedQueries == VK_TRUE;
+	deviceFeatures.inheritedQueries = inheritedQueriesEnabled ? VK_TRUE : VK_FALSE;
+
+	// the draw count can then come from a buffer the cull shader fills
+	drawIndirectCountEnabled = false;
+	if (indirectDrawEnabled && isExtensionAvailable(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+	{
+		enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		drawIndirectCountEnabled = true;
+	}
+
+	// 8-bit indices for tiny meshes, optional
+	VkPhysicalDeviceIndexTypeUint8FeaturesEXT indexTypeUint8Features{};
+	indexTypeUint8Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT;
+	indexTypeUint8Enabled = false;
+	if (isExtensionAvailable(physicalDevice, VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &indexTypeUint8Features;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+		if (indexTypeUint8Features.indexTypeUint8 == VK_TRUE)
+		{
+			enabledExtensions.push_back(VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME);
+			indexTypeUint8Enabled = true;
+		}
+	}
+
+	// descriptor indexing for the bindless material path, optional
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+	descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	descriptorIndexingEnabled = false;
+	if (isExtensionAvailable(physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+		isExtensionAvailable(physicalDevice, VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported{};
+		supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &supported;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+		if (supported.runtimeDescriptorArray && supported.descriptorBindingPartiallyBound &&
+			supported.descriptorBindingSampledImageUpdateAfterBind && supported.descriptorBindingUpdateUnusedWhilePending &&
+			supported.shaderSampledImageArrayNonUniformIndexing)
+		{
+			// only what the bindless set uses
+			descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+			descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+			descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+			descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+			enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+			descriptorIndexingEnabled = true;
+		}
+	}
+
+	// chain whichever optional feature structs ended up enabled
+	void* featureChain = nullptr;
+	if (indexTypeUint8Enabled)
+	{
+		indexTypeUint8Features.pNext = featureChain;
+		featureChain = &indexTypeUint8Features;
+	}
+	if (descriptorIndexingEnabled)
+	{
+		descriptorIndexingFeatures.pNext = featureChain;
+		featureChain = &descriptorIndexingFeatures;
+	}
+
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = featureChain;
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensionsTmp.size());
-	createInfo.ppEnabledExtensionNames = deviceExtensionsTmp.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+	createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 	if (enableValidationLayers)
 	{
@@ -162,6 +253,24 @@ bool VulkanDevice::isDeviceSuitable(VkPhysicalDevice physdevice)
 	return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy && supportedFeatures.fillModeNonSolid;
 }
 
+bool VulkanDevice::isExtensionAvailable(VkPhysicalDevice physdevice, const char* extensionName)
+{
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(physdevice, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physdevice, nullptr, &extensionCount, availableExtensions.data());
+
+	for (const auto& extension : availableExtensions)
+	{
+		if (strcmp(extension.extensionName, extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 bool VulkanDevice::checkDeviceExtensionSupport(VkPhysicalDevice physdevice)
 {
 	uint32_t extensionCount;
@@ -37,6 +37,14 @@ public:
 	VkQueue getGraphicsQueue() const;
 	VkQueue getPresentQueue() const;
 
+	// optional features, enabled when the device exposes them
+	bool isIndexTypeUint8Enabled() const { return indexTypeUint8Enabled; }
+	bool isDescriptorIndexingEnabled() const { return descriptorIndexingEnabled; }
+	bool isIndirectDrawEnabled() const { return indirectDrawEnabled; } // multiDrawIndirect + drawIndirectFirstInstance
+	bool isDrawIndirectCountEnabled() const { return drawIndirectCountEnabled; }
+	bool isPipelineStatisticsEnabled() const { return pipelineStatisticsEnabled; }
+	bool isInheritedQueriesEnabled() const { return inheritedQueriesEnabled; }
+
 
 private:
 	VkDevice device;
@@ -49,10 +57,18 @@ private:
 	std::vector<const char*> deviceExtensionsTmp;
 	std::vector<const char*> validationLayersTmp;
 
+	bool indexTypeUint8Enabled = false;
+	bool descriptorIndexingEnabled = false;
+	bool indirectDrawEnabled = false;
+	bool drawIndirectCountEnabled = false;
+	bool pipelineStatisticsEnabled = false;
+	bool inheritedQueriesEnabled = false;
+
 	void createLogicalDevice();
 	void pickPhysicalDevice(VkInstance instance);
 	bool isDeviceSuitable(VkPhysicalDevice physdevice);
 	bool checkDeviceExtensionSupport(VkPhysicalDevice physdevice);
+	bool isExtensionAvailable(VkPhysicalDevice physdevice, const char* extensionName);
 
 
 };
@@ -0,0 +1,170 @@
+#include "VulkanDynamicResolution.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+VulkanDynamicResolution::VulkanDynamicResolution()
+	: queryPool(VK_NULL_HANDLE), frameCount(0), recordedFrameMask(0), timingSupported(false), timestampPeriod(1.0f),
+	timestampMask(~0ull), enabled(true), targetFrameTime(DEFAULT_TARGET_MS), smoothedGpuTime(0.0f), scale(MAX_SCALE),
+	requestedScale(-1.0f), samplesSinceChange(0), device(VK_NULL_HANDLE)
+{
+}
+
+VulkanDynamicResolution::~VulkanDynamicResolution()
+{
+	destroy();
+}
+
+void VulkanDynamicResolution::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, uint32_t queueFamilyIndex, uint32_t numFrames)
+{
+	device = vkdevice;
+	frameCount = numFrames;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(vkphysdevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(vkphysdevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(vkphysdevice, &familyCount, families.data());
+	uint32_t validBits = queueFamilyIndex < familyCount ? families[queueFamilyIndex].timestampValidBits : 0;
+
+	timingSupported = validBits > 0 && timestampPeriod > 0.0f;
+	if (!timingSupported)
+	{
+		return; // the scale stays wherever setScale puts it
+	}
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = numFrames * 2;
+
+	if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create dynamic resolution query pool!");
+	}
+}
+
+void VulkanDynamicResolution::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+	recordedFrameMask = 0;
+	timingSupported = false;
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanDynamicResolution::recordBegin(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Dynamic resolution record begin called before initialization!");
+	}
+	if (!timingSupported)
+	{
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, queryPool, frameIndex * 2, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, frameIndex * 2);
+}
+
+void VulkanDynamicResolution::recordEnd(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (!timingSupported)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, frameIndex * 2 + 1);
+	recordedFrameMask |= 1u << frameIndex;
+}
+
+void VulkanDynamicResolution::fetchResults(uint32_t frameIndex)
+{
+	if (!timingSupported || frameIndex >= frameCount || (recordedFrameMask & (1u << frameIndex)) == 0)
+	{
+		return;
+	}
+
+	// no wait flag: after the fence the results are there, VK_NOT_READY just keeps the old value
+	std::array<uint64_t, 2> timestamps{};
+	if (vkGetQueryPoolResults(device, queryPool, frameIndex * 2, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return;
+	}
+	recordedFrameMask &= ~(1u << frameIndex); // each pair is one sample
+
+	uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+	float milliseconds = static_cast<float>(static_cast<double>(ticks) * timestampPeriod * 1e-6);
+	smoothedGpuTime = smoothedGpuTime > 0.0f
+		? smoothedGpuTime + (milliseconds - smoothedGpuTime) * SMOOTHING
+		: milliseconds;
+	samplesSinceChange++;
+}
+
+bool VulkanDynamicResolution::update()
+{
+	float wanted = scale;
+	if (requestedScale >= 0.0f)
+	{
+		wanted = requestedScale;
+		requestedScale = -1.0f;
+	}
+	else if (enabled && timingSupported && smoothedGpuTime > 0.0f && samplesSinceChange >= SETTLE_FRAMES)
+	{
+		if (smoothedGpuTime > targetFrameTime)
+		{
+			// at least one step down, more when the overshoot is large
+			float fitting = quantize(scale * std::sqrt(targetFrameTime / smoothedGpuTime));
+			wanted = std::min(fitting, scale - SCALE_STEP);
+		}
+		else if (smoothedGpuTime < targetFrameTime * RAISE_THRESHOLD)
+		{
+			wanted = scale + SCALE_STEP; // climbing is cautious, a jump back up could overshoot again
+		}
+	}
+
+	wanted = quantize(std::clamp(wanted, MIN_SCALE, MAX_SCALE));
+	if (std::abs(wanted - scale) < SCALE_STEP * 0.5f)
+	{
+		return false;
+	}
+
+	scale = wanted;
+	samplesSinceChange = 0;
+	return true;
+}
+
+void VulkanDynamicResolution::setScale(float renderScale)
+{
+	requestedScale = quantize(std::clamp(renderScale, MIN_SCALE, MAX_SCALE));
+}
+
+VkExtent2D VulkanDynamicResolution::scaleExtent(VkExtent2D full) const
+{
+	return {
+		std::max(static_cast<uint32_t>(std::lround(full.width * scale)), 1u),
+		std::max(static_cast<uint32_t>(std::lround(full.height * scale)), 1u)
+	};
+}
+
+float VulkanDynamicResolution::quantize(float renderScale)
+{
+	// the small bias keeps exact multiples from rounding down a step
+	return std::floor(renderScale / SCALE_STEP + 0.001f) * SCALE_STEP;
+}
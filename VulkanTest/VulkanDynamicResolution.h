@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <cstdint>
+
+// Picks the scene's render scale from measured GPU time. Two timestamps per frame in flight bracket
+// the frame's commands; their moving average is held against the target frame time. Over the target
+// the scale drops straight to where the pixel count should fit (GPU time is taken to follow the
+// square of the scale), well under it the scale climbs back one step at a time. Scales are multiples
+// of SCALE_STEP and a change waits SETTLE_FRAMES samples after the last one, because every change
+// recreates the scene's render targets.
+// With the controller off, or on a queue without timestamps, the scale only changes through setScale.
+class VulkanDynamicResolution
+{
+public:
+	static constexpr float MIN_SCALE = 0.5f;
+	static constexpr float MAX_SCALE = 1.0f;
+	static constexpr float SCALE_STEP = 0.05f;
+	static constexpr float SMOOTHING = 0.1f;         // weight of a new sample in the moving average
+	static constexpr float RAISE_THRESHOLD = 0.8f;   // the scale only climbs under this fraction of the target
+	static constexpr uint32_t SETTLE_FRAMES = 30;
+	static constexpr float DEFAULT_TARGET_MS = 16.6f;
+
+	VulkanDynamicResolution();
+	~VulkanDynamicResolution();
+
+	VulkanDynamicResolution(const VulkanDynamicResolution&) = delete;
+	VulkanDynamicResolution& operator=(const VulkanDynamicResolution&) = delete;
+
+	// queueFamilyIndex: the family the frame is submitted to, its timestamp bits decide whether timing works
+	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, uint32_t queueFamilyIndex, uint32_t numFrames);
+	void destroy();
+
+	// first and last thing in the frame's command buffer, outside any render pass
+	void recordBegin(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	void recordEnd(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// call once the frame's fence has signalled; keeps the last value if the result is not there
+	void fetchResults(uint32_t frameIndex);
+	// once per frame after fetchResults; true when the scale changed and the render targets need resizing
+	bool update();
+
+	void setEnabled(bool enable) { enabled = enable; }
+	void setTargetFrameTime(float milliseconds) { targetFrameTime = milliseconds; }
+	// applied by the next update(), rounded to a step and clamped; the controller may move on from it
+	void setScale(float renderScale);
+
+	bool isEnabled() const { return enabled; }
+	bool isTimingSupported() const { return timingSupported; }
+	float getScale() const { return scale; }
+	float getGpuTime() const { return smoothedGpuTime; } // milliseconds, 0 until the first result
+	float getTargetFrameTime() const { return targetFrameTime; }
+	// full scaled by the current scale, never below one texel
+	VkExtent2D scaleExtent(VkExtent2D full) const;
+
+private:
+	VkQueryPool queryPool;
+	uint32_t frameCount;
+	uint32_t recordedFrameMask; // bit n set: frame n holds a pair of timestamps that was written
+	bool timingSupported;
+	float timestampPeriod;      // nanoseconds per tick
+	uint64_t timestampMask;     // valid bits of the graphics queue's timestamps
+
+	bool enabled;
+	float targetFrameTime;
+	float smoothedGpuTime;
+	float scale;
+	float requestedScale;       // below 0 when nothing was requested
+	uint32_t samplesSinceChange;
+
+	VkDevice device;
+
+	static float quantize(float renderScale);
+};
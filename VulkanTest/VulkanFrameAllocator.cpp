@@ -0,0 +1,168 @@
+#include "VulkanFrameAllocator.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "VulkanMemoryAllocator.h"
+
+VulkanFrameAllocator::VulkanFrameAllocator()
+	: currentFrame(0), blockSize(DEFAULT_BLOCK_SIZE), alignment(1), maxBlockSize(0),
+	setLayout(VK_NULL_HANDLE), device(VK_NULL_HANDLE), allocator(nullptr)
+{
+}
+
+VulkanFrameAllocator::~VulkanFrameAllocator()
+{
+	destroy();
+}
+
+void VulkanFrameAllocator::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames,
+	VkDescriptorSetLayout transientSetLayout, VkDeviceSize preferredBlockSize)
+{
+	device = vkdevice;
+	allocator = &memoryAllocator;
+	setLayout = transientSetLayout;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(vkphysdevice, &properties);
+	alignment = std::max(properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment);
+	maxBlockSize = properties.limits.maxStorageBufferRange;
+	blockSize = std::min(preferredBlockSize, maxBlockSize);
+
+	blockSets.create(device, SETS_PER_DESCRIPTOR_POOL, { { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f } });
+
+	frames.resize(numFrames);
+	currentFrame = 0;
+
+	// one block per frame up front, the chains only grow when a frame outgrows it
+	for (FrameChain& chain : frames)
+	{
+		chain.blocks.push_back(createBlock(blockSize));
+	}
+}
+
+void VulkanFrameAllocator::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (FrameChain& chain : frames)
+	{
+		for (Block& block : chain.blocks)
+		{
+			VulkanBuffer::destroyBuffer(device, *allocator, block.buffer, block.allocation);
+		}
+	}
+	frames.clear();
+	blockSets.destroy();
+
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanFrameAllocator::beginFrame(uint32_t frameIndex)
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Frame allocator begin frame: invalid frame index");
+	}
+	currentFrame = frameIndex;
+	frames[currentFrame].currentBlock = 0;
+	frames[currentFrame].head = 0;
+}
+
+FrameAllocation VulkanFrameAllocator::allocate(VkDeviceSize size, VkDeviceSize requestedAlignment)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Frame allocator allocate called before initialization!");
+	}
+
+	VkDeviceSize reserved = std::max<VkDeviceSize>(size, 1);
+	if (reserved > maxBlockSize)
+	{
+		throw std::runtime_error("Frame allocation exceeds maxStorageBufferRange!");
+	}
+	VkDeviceSize sliceAlignment = requestedAlignment != 0 ? requestedAlignment : alignment;
+	FrameChain& chain = frames[currentFrame];
+
+	while (true)
+	{
+		if (chain.currentBlock == chain.blocks.size())
+		{
+			chain.blocks.push_back(createBlock(std::max(blockSize, reserved)));
+			std::cout << "Frame allocator: frame " << currentFrame << " chained block " << chain.blocks.size()
+				<< " (" << chain.blocks.back().size / 1024 << " KB)" << std::endl;
+		}
+
+		Block& block = chain.blocks[chain.currentBlock];
+		VkDeviceSize offset = (chain.head + sliceAlignment - 1) / sliceAlignment * sliceAlignment;
+		if (offset + reserved <= block.size)
+		{
+			chain.head = offset + reserved;
+
+			FrameAllocation allocation{};
+			allocation.buffer = block.buffer;
+			allocation.offset = static_cast<uint32_t>(offset);
+			allocation.mappedData = static_cast<char*>(block.allocation.mappedData) + offset;
+			allocation.descriptorSet = block.descriptorSet;
+			return allocation;
+		}
+
+		chain.currentBlock++;
+		chain.head = 0;
+	}
+}
+
+uint32_t VulkanFrameAllocator::getBlockCount() const
+{
+	uint32_t count = 0;
+	for (const FrameChain& chain : frames)
+	{
+		count += static_cast<uint32_t>(chain.blocks.size());
+	}
+	return count;
+}
+
+VulkanFrameAllocator::Block VulkanFrameAllocator::createBlock(VkDeviceSize size)
+{
+	Block block{};
+	block.size = size;
+
+	// written by the CPU every frame: lands directly in VRAM when resizable BAR is exposed
+	VulkanBuffer::createBuffer(
+		device,
+		*allocator,
+		size,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		allocator->getDirectWriteMemoryProperties(),
+		block.buffer,
+		block.allocation
+	);
+
+	block.descriptorSet = allocateDescriptorSet(block.buffer);
+	return block;
+}
+
+VkDescriptorSet VulkanFrameAllocator::allocateDescriptorSet(VkBuffer buffer)
+{
+	VkDescriptorSet descriptorSet = blockSets.allocate(setLayout);
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE; // blocks never exceed maxStorageBufferRange
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+	return descriptorSet;
+}
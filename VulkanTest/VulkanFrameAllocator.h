@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "VulkanBuffer.h"
+#include "VulkanDescriptorAllocator.h"
+
+// An aligned slice of one frame's transient memory. descriptorSet exposes the whole block
+// the slice came from as a storage buffer, so shaders address the slice by offset / index.
+struct FrameAllocation
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	uint32_t offset = 0;
+	void* mappedData = nullptr;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+	bool isValid() const { return mappedData != nullptr; }
+};
+
+// Bump allocator for data that is rewritten every frame (object transforms, lights,
+// per-pass constants). Every frame in flight owns a chain of persistently mapped uniform /
+// storage blocks: allocations bump an offset, a full block chains on to the next one
+// (creating it if needed) and beginFrame() rewinds the chain once that frame's fence has
+// signalled.
+// Blocks are kept between frames, so after warm-up nothing is allocated per frame.
+class VulkanFrameAllocator
+{
+public:
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+	VulkanFrameAllocator();
+	~VulkanFrameAllocator();
+
+	VulkanFrameAllocator(const VulkanFrameAllocator&) = delete;
+	VulkanFrameAllocator& operator=(const VulkanFrameAllocator&) = delete;
+
+	// transientSetLayout holds a single STORAGE_BUFFER binding, one set of it is written per block
+	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames,
+		VkDescriptorSetLayout transientSetLayout, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+	void destroy();
+
+	// only call after the fence of frameIndex has been waited on
+	void beginFrame(uint32_t frameIndex);
+
+	// a single allocation never straddles two blocks; alignment 0 uses the device's
+	// uniform / storage offset alignment, any other value need not be a power of two
+	FrameAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+	template<typename T>
+	FrameAllocation push(const T& data)
+	{
+		FrameAllocation allocation = allocate(sizeof(T));
+		memcpy(allocation.mappedData, &data, sizeof(T));
+		return allocation;
+	}
+
+	VkDeviceSize getAlignment() const { return alignment; }
+	uint32_t getBlockCount() const;
+
+private:
+	static constexpr uint32_t SETS_PER_DESCRIPTOR_POOL = 16; // initial size, the allocator grows
+
+	struct Block
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VulkanAllocation allocation;
+		VkDeviceSize size = 0;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+
+	struct FrameChain
+	{
+		std::vector<Block> blocks;
+		uint32_t currentBlock = 0;
+		VkDeviceSize head = 0;
+	};
+
+	std::vector<FrameChain> frames;
+	uint32_t currentFrame;
+
+	VkDeviceSize blockSize;
+	VkDeviceSize alignment;
+	VkDeviceSize maxBlockSize; // maxStorageBufferRange, the whole block is one descriptor
+
+	VkDescriptorSetLayout setLayout;
+	VulkanDescriptorAllocator blockSets; // one persistent set per block
+
+	VkDevice device;
+	VulkanMemoryAllocator* allocator;
+
+	Block createBlock(VkDeviceSize size);
+	VkDescriptorSet allocateDescriptorSet(VkBuffer buffer);
+};
@@ -0,0 +1,318 @@
+#include "VulkanGeometryBuffer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <iostream>
+
+VulkanGeometryBuffer::VulkanGeometryBuffer()
+	: vertexBuffer(VK_NULL_HANDLE), vertexCapacity(0), positionBuffer(VK_NULL_HANDLE), indexBuffer(VK_NULL_HANDLE), indexByteCapacity(0), uint8Indices(false),
+	device(VK_NULL_HANDLE), allocator(nullptr), queue(VK_NULL_HANDLE), pool(VK_NULL_HANDLE)
+{
+}
+
+VulkanGeometryBuffer::~VulkanGeometryBuffer()
+{
+	destroy();
+}
+
+void VulkanGeometryBuffer::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+	uint32_t initialVertexCapacity, uint32_t initialIndexBytes, bool uint8IndicesSupported)
+{
+	device = vkdevice;
+	allocator = &memoryAllocator;
+	queue = graphicsQueue;
+	pool = commandPool;
+	uint8Indices = uint8IndicesSupported;
+
+	growVertexBuffers(initialVertexCapacity);
+	growBuffer(indexBuffer, indexBufferAllocation, indexByteCapacity, freeIndexBytes,
+		initialIndexBytes, 1, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
+
+void VulkanGeometryBuffer::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+	VulkanBuffer::destroyBuffer(device, *allocator, vertexBuffer, vertexBufferAllocation);
+	VulkanBuffer::destroyBuffer(device, *allocator, positionBuffer, positionBufferAllocation);
+	VulkanBuffer::destroyBuffer(device, *allocator, indexBuffer, indexBufferAllocation);
+	vertexCapacity = 0;
+	indexByteCapacity = 0;
+	freeVertices.clear();
+	freeIndexBytes.clear();
+	device = VK_NULL_HANDLE;
+}
+
+GeometryRange VulkanGeometryBuffer::upload(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Geometry buffer upload called before initialization!");
+	}
+	if (vertices.empty() || indices.empty())
+	{
+		return GeometryRange{};
+	}
+
+	GeometryRange range{};
+	range.vertexCount = static_cast<uint32_t>(vertices.size());
+	range.indexCount = static_cast<uint32_t>(indices.size());
+	range.indexType = chooseIndexType(vertices.size(), uint8Indices);
+	uint32_t indexSize = indexTypeSize(range.indexType);
+	uint32_t indexBytesRequired = range.indexCount * indexSize;
+
+	if (!allocateRange(freeVertices, range.vertexCount, 1, range.vertexOffset))
+	{
+		growVertexBuffers(vertexCapacity + range.vertexCount);
+		allocateRange(freeVertices, range.vertexCount, 1, range.vertexOffset);
+	}
+	if (!allocateRange(freeIndexBytes, indexBytesRequired, indexSize, range.indexByteOffset))
+	{
+		growBuffer(indexBuffer, indexBufferAllocation, indexByteCapacity, freeIndexBytes,
+			indexByteCapacity + indexBytesRequired + indexSize, 1, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+		allocateRange(freeIndexBytes, indexBytesRequired, indexSize, range.indexByteOffset);
+	}
+	// the index buffer is bound at offset 0, so the range start is expressed in units of its own type
+	range.firstIndex = range.indexByteOffset / indexSize;
+
+	VkDeviceSize vertexBytes = sizeof(Vertex) * vertices.size();
+	VkDeviceSize positionBytes = sizeof(glm::vec3) * vertices.size();
+	VkDeviceSize indexBytes = indexBytesRequired;
+
+	// one staging buffer and one submit for the vertices, their positions and the indices
+	VkBuffer stagingBuffer;
+	VulkanAllocation stagingBufferAllocation;
+	VulkanBuffer::createBuffer(
+		device,
+		*allocator,
+		vertexBytes + positionBytes + indexBytes,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer, stagingBufferAllocation
+	);
+
+	char* data = static_cast<char*>(stagingBufferAllocation.mappedData);
+	memcpy(data, vertices.data(), static_cast<size_t>(vertexBytes));
+
+	char* positionData = data + vertexBytes;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		memcpy(positionData + i * sizeof(glm::vec3), &vertices[i].pos, sizeof(glm::vec3));
+	}
+
+	// narrow the indices while writing them into the staging memory
+	char* indexData = positionData + positionBytes;
+	switch (range.indexType)
+	{
+	case VK_INDEX_TYPE_UINT8_EXT:
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			reinterpret_cast<uint8_t*>(indexData)[i] = static_cast<uint8_t>(indices[i]);
+		}
+		break;
+	case VK_INDEX_TYPE_UINT16:
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			uint16_t index = static_cast<uint16_t>(indices[i]);
+			memcpy(indexData + i * sizeof(uint16_t), &index, sizeof(uint16_t));
+		}
+		break;
+	default:
+		memcpy(indexData, indices.data(), static_cast<size_t>(indexBytes));
+		break;
+	}
+
+	VkCommandBuffer commandBuffer = VulkanCommandBuffers::beginSingleTimeCommands(device, pool);
+
+	VkBufferCopy vertexCopy{};
+	vertexCopy.srcOffset = 0;
+	vertexCopy.dstOffset = static_cast<VkDeviceSize>(range.vertexOffset) * sizeof(Vertex);
+	vertexCopy.size = vertexBytes;
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, vertexBuffer, 1, &vertexCopy);
+
+	VkBufferCopy positionCopy{};
+	positionCopy.srcOffset = vertexBytes;
+	positionCopy.dstOffset = static_cast<VkDeviceSize>(range.vertexOffset) * sizeof(glm::vec3);
+	positionCopy.size = positionBytes;
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, positionBuffer, 1, &positionCopy);
+
+	VkBufferCopy indexCopy{};
+	indexCopy.srcOffset = vertexBytes + positionBytes;
+	indexCopy.dstOffset = range.indexByteOffset;
+	indexCopy.size = indexBytes;
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, indexBuffer, 1, &indexCopy);
+
+	VulkanCommandBuffers::endSingleTimeCommands(commandBuffer, device, queue, pool);
+
+	VulkanBuffer::destroyBuffer(device, *allocator, stagingBuffer, stagingBufferAllocation);
+
+	return range;
+}
+
+void VulkanGeometryBuffer::release(const GeometryRange& range)
+{
+	if (!range.isValid() || device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+	freeRange(freeVertices, range.vertexOffset, range.vertexCount);
+	freeRange(freeIndexBytes, range.indexByteOffset, range.indexCount * indexTypeSize(range.indexType));
+}
+
+VkIndexType VulkanGeometryBuffer::chooseIndexType(size_t vertexCount, bool uint8IndicesSupported)
+{
+	if (uint8IndicesSupported && vertexCount <= 256)
+	{
+		return VK_INDEX_TYPE_UINT8_EXT;
+	}
+	if (vertexCount <= 65536)
+	{
+		return VK_INDEX_TYPE_UINT16;
+	}
+	return VK_INDEX_TYPE_UINT32;
+}
+
+uint32_t VulkanGeometryBuffer::indexTypeSize(VkIndexType indexType)
+{
+	switch (indexType)
+	{
+	case VK_INDEX_TYPE_UINT8_EXT: return 1;
+	case VK_INDEX_TYPE_UINT16: return 2;
+	default: return 4;
+	}
+}
+
+VkBuffer VulkanGeometryBuffer::getVertexBuffer() const
+{
+	if (vertexBuffer == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Get geometry vertex buffer called before initialization!");
+	}
+	return vertexBuffer;
+}
+
+VkBuffer VulkanGeometryBuffer::getPositionBuffer() const
+{
+	if (positionBuffer == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Get geometry position buffer called before initialization!");
+	}
+	return positionBuffer;
+}
+
+VkBuffer VulkanGeometryBuffer::getIndexBuffer() const
+{
+	if (indexBuffer == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Get geometry index buffer called before initialization!");
+	}
+	return indexBuffer;
+}
+
+void VulkanGeometryBuffer::growBuffer(VkBuffer& buffer, VulkanAllocation& allocation, uint32_t& capacity, FreeList& freeList,
+	uint32_t required, VkDeviceSize elementSize, VkBufferUsageFlags usage)
+{
+	uint32_t newCapacity = std::max(required, capacity * 2);
+	reallocateBuffer(buffer, allocation, capacity, newCapacity, elementSize, usage);
+
+	freeRange(freeList, capacity, newCapacity - capacity);
+	capacity = newCapacity;
+}
+
+void VulkanGeometryBuffer::growVertexBuffers(uint32_t required)
+{
+	uint32_t newCapacity = std::max(required, vertexCapacity * 2);
+	reallocateBuffer(vertexBuffer, vertexBufferAllocation, vertexCapacity, newCapacity, sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	reallocateBuffer(positionBuffer, positionBufferAllocation, vertexCapacity, newCapacity, sizeof(glm::vec3), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+	freeRange(freeVertices, vertexCapacity, newCapacity - vertexCapacity);
+	vertexCapacity = newCapacity;
+}
+
+void VulkanGeometryBuffer::reallocateBuffer(VkBuffer& buffer, VulkanAllocation& allocation, uint32_t capacity, uint32_t newCapacity,
+	VkDeviceSize elementSize, VkBufferUsageFlags usage)
+{
+	VkBuffer newBuffer;
+	VulkanAllocation newAllocation;
+	VulkanBuffer::createBuffer(
+		device,
+		*allocator,
+		elementSize * newCapacity,
+		usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		newBuffer, newAllocation
+	);
+
+	if (buffer != VK_NULL_HANDLE)
+	{
+		std::cout << "Growing geometry buffer from " << capacity << " to " << newCapacity << " elements" << std::endl;
+
+		// endSingleTimeCommands waits for the queue, so no in-flight frame still reads the old buffer
+		VkCommandBuffer commandBuffer = VulkanCommandBuffers::beginSingleTimeCommands(device, pool);
+		VkBufferCopy copyRegion{};
+		copyRegion.size = elementSize * capacity;
+		vkCmdCopyBuffer(commandBuffer, buffer, newBuffer, 1, &copyRegion);
+		VulkanCommandBuffers::endSingleTimeCommands(commandBuffer, device, queue, pool);
+
+		VulkanBuffer::destroyBuffer(device, *allocator, buffer, allocation);
+	}
+
+	buffer = newBuffer;
+	allocation = newAllocation;
+}
+
+bool VulkanGeometryBuffer::allocateRange(FreeList& freeList, uint32_t count, uint32_t alignment, uint32_t& outOffset)
+{
+	for (auto it = freeList.begin(); it != freeList.end(); ++it)
+	{
+		uint32_t rangeOffset = it->first;
+		uint32_t rangeCount = it->second;
+		uint32_t alignedOffset = (rangeOffset + alignment - 1) / alignment * alignment;
+		uint32_t padding = alignedOffset - rangeOffset;
+		if (padding + count > rangeCount) continue;
+
+		freeList.erase(it);
+		if (padding > 0)
+		{
+			freeList.emplace(rangeOffset, padding);
+		}
+		uint32_t remaining = rangeCount - padding - count;
+		if (remaining > 0)
+		{
+			freeList.emplace(alignedOffset + count, remaining);
+		}
+		outOffset = alignedOffset;
+		return true;
+	}
+	return false;
+}
+
+void VulkanGeometryBuffer::freeRange(FreeList& freeList, uint32_t offset, uint32_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	auto inserted = freeList.emplace(offset, count).first;
+
+	auto next = std::next(inserted);
+	if (next != freeList.end() && inserted->first + inserted->second == next->first)
+	{
+		inserted->second += next->second;
+		freeList.erase(next);
+	}
+
+	if (inserted != freeList.begin())
+	{
+		auto prev = std::prev(inserted);
+		if (prev->first + prev->second == inserted->first)
+		{
+			prev->second += inserted->second;
+			freeList.erase(inserted);
+		}
+	}
+}
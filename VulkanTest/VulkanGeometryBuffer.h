@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "VulkanBuffer.h"
+#include "ModelLoader.h"
+
+// Where one mesh lives inside the shared vertex / index buffers.
+struct GeometryRange
+{
+	uint32_t vertexOffset = 0; // in vertices, passed as vertexOffset to vkCmdDrawIndexed
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0;   // in indices of indexType
+	uint32_t indexCount = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	uint32_t indexByteOffset = 0;
+
+	bool isValid() const { return indexCount > 0; }
+};
+
+// One device local vertex buffer and one index buffer shared by every static mesh,
+// so the scene binds geometry once and draws with firstIndex / vertexOffset.
+// A second vertex buffer holds just the positions at the same vertex offsets, for depth only
+// passes that would otherwise fetch whole vertices to read 12 bytes of each.
+// Ranges are handed out first fit from a free list; released ranges are reused, and
+// the buffers grow (copying the old contents) when nothing fits.
+// Each mesh stores its indices in the narrowest type its vertex count allows, so the
+// index buffer is addressed in bytes and every range is aligned to its index size.
+class VulkanGeometryBuffer
+{
+public:
+	VulkanGeometryBuffer();
+	~VulkanGeometryBuffer();
+
+	VulkanGeometryBuffer(const VulkanGeometryBuffer&) = delete;
+	VulkanGeometryBuffer& operator=(const VulkanGeometryBuffer&) = delete;
+
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+		uint32_t initialVertexCapacity, uint32_t initialIndexBytes, bool uint8IndicesSupported = false);
+	void destroy();
+
+	GeometryRange upload(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+	void release(const GeometryRange& range);
+
+	VkBuffer getVertexBuffer() const;
+	VkBuffer getPositionBuffer() const; // glm::vec3 per vertex, addressed like the vertex buffer
+	VkBuffer getIndexBuffer() const;
+
+	uint32_t getVertexCapacity() const { return vertexCapacity; }
+	uint32_t getIndexByteCapacity() const { return indexByteCapacity; }
+
+	static VkIndexType chooseIndexType(size_t vertexCount, bool uint8IndicesSupported);
+	static uint32_t indexTypeSize(VkIndexType indexType);
+
+private:
+	// offset -> count of free elements, kept coalesced
+	using FreeList = std::map<uint32_t, uint32_t>;
+
+	VkBuffer vertexBuffer;
+	VulkanAllocation vertexBufferAllocation;
+	uint32_t vertexCapacity;
+	FreeList freeVertices;
+	VkBuffer positionBuffer;
+	VulkanAllocation positionBufferAllocation;
+
+	VkBuffer indexBuffer;
+	VulkanAllocation indexBufferAllocation;
+	uint32_t indexByteCapacity;
+	FreeList freeIndexBytes;
+	bool uint8Indices;
+
+	VkDevice device;
+	VulkanMemoryAllocator* allocator;
+	VkQueue queue;
+	VkCommandPool pool;
+
+	void growBuffer(VkBuffer& buffer, VulkanAllocation& allocation, uint32_t& capacity, FreeList& freeList,
+		uint32_t required, VkDeviceSize elementSize, VkBufferUsageFlags usage);
+	// the vertex and position buffers always grow together, they share one free list
+	void growVertexBuffers(uint32_t required);
+	void reallocateBuffer(VkBuffer& buffer, VulkanAllocation& allocation, uint32_t capacity, uint32_t newCapacity,
+		VkDeviceSize elementSize, VkBufferUsageFlags usage);
+
+	static bool allocateRange(FreeList& freeList, uint32_t count, uint32_t alignment, uint32_t& outOffset);
+	static void freeRange(FreeList& freeList, uint32_t offset, uint32_t count);
+};
@@ -8,7 +8,10 @@
 namespace VulkanGlobals
 {
 	constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
-	constexpr size_t MAX_EXPECTED_OBJECTS = 1000;
+	constexpr uint32_t INITIAL_DYNAMIC_OBJECT_CAPACITY = 1024; // grows on demand
+	constexpr uint32_t SCENE_POINT_LIGHTS = 256; // scattered over the scene by createSceneLights
+	constexpr uint32_t SCENE_SPOT_LIGHTS = 64;
+	constexpr float SHADOW_DISTANCE = 150.0f; // sun shadows end here, or at the far plane if that is closer
 }
 
 #endif // !VULKAN_GLOBALS_H
@@ -0,0 +1,515 @@
+#include "VulkanGpuCulling.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+#include "VulkanMemoryAllocator.h"
+#include "VulkanShaderModuleCache.h"
+
+VulkanGpuCulling::VulkanGpuCulling()
+	: allFramesMask(0), previousViewProjection(1.0f), hiZExtent{ 0, 0 }, hiZLevels(0), frustumCulledCount(0),
+	occlusionCulledCount(0), generation(0), cullSetLayout(VK_NULL_HANDLE), pipelineLayout(VK_NULL_HANDLE), pipeline(VK_NULL_HANDLE),
+	descriptorPool(VK_NULL_HANDLE), drawIndirectCount(false), cmdDrawIndexedIndirectCount(nullptr),
+	device(VK_NULL_HANDLE), allocator(nullptr)
+{
+}
+
+VulkanGpuCulling::~VulkanGpuCulling()
+{
+	destroy();
+}
+
+void VulkanGpuCulling::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames,
+	VkDescriptorSetLayout instanceSetLayout, bool useDrawIndirectCount)
+{
+	device = vkdevice;
+	allocator = &memoryAllocator;
+	frames.resize(numFrames);
+	allFramesMask = (1u << numFrames) - 1;
+
+	if (useDrawIndirectCount)
+	{
+		cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+			vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+	}
+	drawIndirectCount = cmdDrawIndexedIndirectCount != nullptr;
+
+	// objects, commands, counts, instance ids, cull data, hi-z pyramid, stats
+	std::array<VkDescriptorSetLayoutBinding, 7> bindings{};
+	for (uint32_t i = 0; i < bindings.size(); i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create gpu culling descriptor set layout!");
+	}
+
+	// five storage buffers in the cull set plus the instance ids in the instance set
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = 6 * numFrames;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[1].descriptorCount = numFrames;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[2].descriptorCount = numFrames;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = 2 * numFrames;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create gpu culling descriptor pool!");
+	}
+
+	for (FrameResources& frame : frames)
+	{
+		std::array<VkDescriptorSetLayout, 2> layouts = { cullSetLayout, instanceSetLayout };
+		std::array<VkDescriptorSet, 2> sets{};
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = descriptorPool;
+		allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+		allocInfo.pSetLayouts = layouts.data();
+
+		if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate gpu culling descriptor sets!");
+		}
+		frame.cullSet = sets[0];
+		frame.instanceSet = sets[1];
+	}
+
+	createPipeline();
+}
+
+void VulkanGpuCulling::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	destroyFrameBuffers();
+	frames.clear();
+
+	if (pipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(device, pipeline, nullptr);
+		pipeline = VK_NULL_HANDLE;
+	}
+	if (pipelineLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		pipelineLayout = VK_NULL_HANDLE;
+	}
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		descriptorPool = VK_NULL_HANDLE;
+	}
+	if (cullSetLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(device, cullSetLayout, nullptr);
+		cullSetLayout = VK_NULL_HANDLE;
+	}
+
+	objects.clear();
+	groups.clear();
+	objectOfRenderable.clear();
+	staleFrameMasks.clear();
+	dirtyObjects.clear();
+	cmdDrawIndexedIndirectCount = nullptr;
+	hiZExtent = { 0, 0 };
+	hiZLevels = 0;
+	device = VK_NULL_HANDLE;
+}
+
+bool VulkanGpuCulling::isCandidate(const RenderableObject& renderable)
+{
+	return renderable.indexCount > 0 && renderable.material
+		&& renderable.material->alphaMode != Material::AlphaMode::BLEND_MODE;
+}
+
+void VulkanGpuCulling::setObjects(const std::vector<RenderableObject>& renderables)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Gpu culling set objects called before initialization!");
+	}
+
+	// group by material and index width
+	std::map<std::pair<const Material*, VkIndexType>, std::vector<uint32_t>> members;
+	for (uint32_t i = 0; i < renderables.size(); i++)
+	{
+		if (isCandidate(renderables[i]))
+		{
+			members[{ renderables[i].material.get(), renderables[i].indexType }].push_back(i);
+		}
+	}
+
+	objects.clear();
+	groups.clear();
+	objectOfRenderable.assign(renderables.size(), UINT32_MAX);
+	for (const auto& [key, renderableIndices] : members)
+	{
+		GpuDrawGroup group{};
+		group.material = renderables[renderableIndices[0]].material.get();
+		group.indexType = key.second;
+		group.firstCommand = static_cast<uint32_t>(objects.size());
+		group.capacity = static_cast<uint32_t>(renderableIndices.size());
+
+		for (uint32_t slot = 0; slot < renderableIndices.size(); slot++)
+		{
+			const RenderableObject& renderable = renderables[renderableIndices[slot]];
+			BoundingVolume worldBounds = renderable.localBounds.transformed(renderable.modelMatrix);
+
+			GpuCullObject object{};
+			object.center = glm::vec4(worldBounds.center, 0.0f);
+			object.extents = glm::vec4(worldBounds.extents, 0.0f);
+			object.firstIndex = renderable.firstIndex;
+			object.indexCount = renderable.indexCount;
+			object.vertexOffset = renderable.vertexOffset;
+			object.objectId = renderable.objectIndex;
+			object.groupIndex = static_cast<uint32_t>(groups.size());
+			object.groupFirstCommand = group.firstCommand;
+			object.fixedSlot = group.firstCommand + slot;
+
+			objectOfRenderable[renderableIndices[slot]] = static_cast<uint32_t>(objects.size());
+			objects.push_back(object);
+		}
+		groups.push_back(group);
+	}
+
+	destroyFrameBuffers();
+	createFrameBuffers();
+	writeDescriptorSets();
+
+	// every frame copy starts out complete
+	for (FrameResources& frame : frames)
+	{
+		memcpy(frame.objectAllocation.mappedData, objects.data(), objects.size() * sizeof(GpuCullObject));
+	}
+	staleFrameMasks.assign(objects.size(), 0);
+	dirtyObjects.clear();
+
+	std::cout << "Gpu culling: " << objects.size() << " objects in " << groups.size() << " groups ("
+		<< (drawIndirectCount ? "indirect count" : "indirect") << ")" << std::endl;
+}
+
+void VulkanGpuCulling::setBounds(uint32_t renderableIndex, const BoundingVolume& worldBounds)
+{
+	if (renderableIndex >= objectOfRenderable.size() || objectOfRenderable[renderableIndex] == UINT32_MAX)
+	{
+		return; // drawn on the CPU path
+	}
+
+	uint32_t index = objectOfRenderable[renderableIndex];
+	objects[index].center = glm::vec4(worldBounds.center, 0.0f);
+	objects[index].extents = glm::vec4(worldBounds.extents, 0.0f);
+	if (staleFrameMasks[index] == 0)
+	{
+		dirtyObjects.push_back(index);
+	}
+	staleFrameMasks[index] = allFramesMask;
+}
+
+void VulkanGpuCulling::update(uint32_t frameIndex)
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Gpu culling update: invalid frame index");
+	}
+
+	const uint32_t frameBit = 1u << frameIndex;
+	GpuCullObject* mapped = static_cast<GpuCullObject*>(frames[frameIndex].objectAllocation.mappedData);
+	size_t keep = 0;
+	for (uint32_t index : dirtyObjects)
+	{
+		if (staleFrameMasks[index] & frameBit)
+		{
+			mapped[index] = objects[index];
+			staleFrameMasks[index] &= ~frameBit;
+		}
+		if (staleFrameMasks[index] != 0)
+		{
+			dirtyObjects[keep++] = index;
+		}
+	}
+	dirtyObjects.resize(keep);
+
+	// the fence has signalled, so the stats hold this frame slot's last cull
+	const CullStats* stats = static_cast<const CullStats*>(frames[frameIndex].statsAllocation.mappedData);
+	if (stats)
+	{
+		frustumCulledCount = stats->frustumCulled;
+		occlusionCulledCount = stats->occlusionCulled;
+	}
+}
+
+void VulkanGpuCulling::setHiZPyramid(VkImageView pyramidView, VkSampler pyramidSampler, VkExtent2D pyramidExtent, uint32_t pyramidLevels)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Gpu culling set hi-z pyramid called before initialization!");
+	}
+
+	hiZExtent = pyramidExtent;
+	hiZLevels = pyramidLevels;
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	imageInfo.imageView = pyramidView;
+	imageInfo.sampler = pyramidSampler;
+
+	for (FrameResources& frame : frames)
+	{
+		VkWriteDescriptorSet write{};
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = frame.cullSet;
+		write.dstBinding = 5;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		write.descriptorCount = 1;
+		write.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	}
+	generation++;
+}
+
+void VulkanGpuCulling::setCullData(uint32_t frameIndex, const Frustum& frustum, const glm::mat4& viewProjection, bool occlusion)
+{
+	if (objects.empty())
+	{
+		return;
+	}
+	const FrameResources& frame = frames[frameIndex];
+
+	CullUniforms* uniforms = static_cast<CullUniforms*>(frame.uniformAllocation.mappedData);
+	for (int i = 0; i < 6; i++)
+	{
+		uniforms->planes[i] = frustum.planes[i];
+	}
+	uniforms->previousViewProjection = previousViewProjection;
+	uniforms->pyramidSize = glm::vec2(static_cast<float>(hiZExtent.width), static_cast<float>(hiZExtent.height));
+	uniforms->pyramidLevels = hiZLevels;
+	uniforms->objectCount = static_cast<uint32_t>(objects.size());
+	uniforms->flags = (drawIndirectCount ? CULL_FLAG_COMPACT : 0u) | (occlusion ? CULL_FLAG_OCCLUSION : 0u);
+	previousViewProjection = viewProjection;
+}
+
+void VulkanGpuCulling::recordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (objects.empty())
+	{
+		return;
+	}
+	if (hiZLevels == 0)
+	{
+		throw std::runtime_error("Gpu culling record cull called before the hi-z pyramid was set!");
+	}
+	const FrameResources& frame = frames[frameIndex];
+
+	vkCmdFillBuffer(commandBuffer, frame.countBuffer, 0, VK_WHOLE_SIZE, 0);
+	vkCmdFillBuffer(commandBuffer, frame.statsBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	// the counters must be zero before the shader bumps them; the pyramid read is synced by the frame graph,
+	// the previous frame's draws using these buffers were already waited on through the frame fence
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	uint32_t objectCount = static_cast<uint32_t>(objects.size());
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.cullSet, 0, nullptr);
+	vkCmdDispatch(commandBuffer, (objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+	// the stats are read back on the host once the fence signals
+	VkMemoryBarrier statsBarrier{};
+	statsBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	statsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	statsBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &statsBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanGpuCulling::recordDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t groupIndex)
+{
+	const FrameResources& frame = frames[frameIndex];
+	const GpuDrawGroup& group = groups[groupIndex];
+	VkDeviceSize commandOffset = static_cast<VkDeviceSize>(group.firstCommand) * sizeof(VkDrawIndexedIndirectCommand);
+
+	if (drawIndirectCount)
+	{
+		cmdDrawIndexedIndirectCount(commandBuffer, frame.commandBuffer, commandOffset,
+			frame.countBuffer, groupIndex * sizeof(uint32_t), group.capacity, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else
+	{
+		vkCmdDrawIndexedIndirect(commandBuffer, frame.commandBuffer, commandOffset,
+			group.capacity, sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
+
+VkDescriptorSet VulkanGpuCulling::getInstanceDescriptorSet(uint32_t frameIndex) const
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Gpu culling get instance descriptor set called before initialization!");
+	}
+	return frames[frameIndex].instanceSet;
+}
+
+VkBuffer VulkanGpuCulling::getIndirectBuffer(uint32_t frameIndex) const
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Gpu culling get indirect buffer called before initialization!");
+	}
+	return frames[frameIndex].commandBuffer;
+}
+
+VkBuffer VulkanGpuCulling::getCountBuffer(uint32_t frameIndex) const
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Gpu culling get count buffer called before initialization!");
+	}
+	return frames[frameIndex].countBuffer;
+}
+
+VkBuffer VulkanGpuCulling::getInstanceBuffer(uint32_t frameIndex) const
+{
+	if (frameIndex >= frames.size())
+	{
+		throw std::runtime_error("Gpu culling get instance buffer called before initialization!");
+	}
+	return frames[frameIndex].instanceBuffer;
+}
+
+void VulkanGpuCulling::createPipeline()
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &cullSetLayout;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create gpu culling pipeline layout!");
+	}
+
+	VkShaderModule shaderModule = VulkanShaderModuleCache::createShaderModule(device,
+		VulkanShaderModuleCache::readFile("shaders/cull.comp.spv"));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create gpu culling pipeline!");
+	}
+}
+
+void VulkanGpuCulling::createFrameBuffers()
+{
+	// buffers can not be empty, an empty scene still gets one slot of each
+	VkDeviceSize objectCount = std::max<VkDeviceSize>(objects.size(), 1);
+	VkDeviceSize groupCount = std::max<VkDeviceSize>(groups.size(), 1);
+	VkMemoryPropertyFlags directWrite = allocator->getDirectWriteMemoryProperties();
+
+	for (FrameResources& frame : frames)
+	{
+		VulkanBuffer::createBuffer(device, *allocator, objectCount * sizeof(GpuCullObject),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, directWrite, frame.objectBuffer, frame.objectAllocation);
+		VulkanBuffer::createBuffer(device, *allocator, objectCount * sizeof(VkDrawIndexedIndirectCommand),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.commandBuffer, frame.commandAllocation);
+		VulkanBuffer::createBuffer(device, *allocator, groupCount * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.countBuffer, frame.countAllocation);
+		VulkanBuffer::createBuffer(device, *allocator, objectCount * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.instanceBuffer, frame.instanceAllocation);
+		VulkanBuffer::createBuffer(device, *allocator, sizeof(CullUniforms),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, directWrite, frame.uniformBuffer, frame.uniformAllocation);
+		VulkanBuffer::createBuffer(device, *allocator, sizeof(CullStats),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.statsBuffer, frame.statsAllocation);
+		memset(frame.statsAllocation.mappedData, 0, sizeof(CullStats));
+	}
+}
+
+void VulkanGpuCulling::destroyFrameBuffers()
+{
+	for (FrameResources& frame : frames)
+	{
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.objectBuffer, frame.objectAllocation);
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.commandBuffer, frame.commandAllocation);
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.countBuffer, frame.countAllocation);
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.instanceBuffer, frame.instanceAllocation);
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.uniformBuffer, frame.uniformAllocation);
+		VulkanBuffer::destroyBuffer(device, *allocator, frame.statsBuffer, frame.statsAllocation);
+	}
+}
+
+void VulkanGpuCulling::writeDescriptorSets()
+{
+	for (FrameResources& frame : frames)
+	{
+		// binding 5, the pyramid, is written by setHiZPyramid
+		std::array<VkDescriptorBufferInfo, 6> bufferInfos{};
+		bufferInfos[0] = { frame.objectBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { frame.commandBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { frame.countBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[3] = { frame.instanceBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[4] = { frame.uniformBuffer, 0, sizeof(CullUniforms) };
+		bufferInfos[5] = { frame.statsBuffer, 0, VK_WHOLE_SIZE };
+		const std::array<uint32_t, 6> bindings = { 0, 1, 2, 3, 4, 6 };
+
+		std::array<VkWriteDescriptorSet, 7> writes{};
+		for (uint32_t i = 0; i < bufferInfos.size(); i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.cullSet;
+			writes[i].dstBinding = bindings[i];
+			writes[i].descriptorType = bindings[i] == 4 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+		// the vertex shader reads the same instance ids through set 2
+		writes[6] = writes[3];
+		writes[6].dstSet = frame.instanceSet;
+		writes[6].dstBinding = 0;
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+	generation++;
+}
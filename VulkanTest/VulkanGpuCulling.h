@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "VulkanBuffer.h"
+#include "FrustumCuller.h"
+#include "Renderable.h"
+
+// Mirrors CullObject in cull.comp (std430)
+struct GpuCullObject
+{
+	glm::vec4 center;   // xyz world bounds center
+	glm::vec4 extents;  // xyz world bounds half extents
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+	uint32_t objectId;  // VulkanObjectDataBuffer id
+	uint32_t groupIndex;
+	uint32_t groupFirstCommand;
+	uint32_t fixedSlot; // command slot when the draws are not compacted
+	uint32_t padding;
+};
+
+// Renderables sharing a material and index type, drawn with one indirect call
+struct GpuDrawGroup
+{
+	Material* material = nullptr;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	uint32_t firstCommand = 0;
+	uint32_t capacity = 0; // renderables in the group, the most draws it can produce
+};
+
+// GPU driven culling: object bounds and draw arguments live in storage buffers, a compute pass
+// frustum culls every object, optionally occlusion tests it against a VulkanHiZPyramid of last
+// frame's depth, and writes a VkDrawIndexedIndirectCommand per survivor, and each
+// group is then drawn with a single vkCmdDrawIndexedIndirectCount. Without VK_KHR_draw_indirect_count
+// every object keeps its own command slot and culled ones get instanceCount 0, drawn with
+// vkCmdDrawIndexedIndirect. Either way the CPU cost per frame only depends on the group count.
+// Instance ids are written next to the commands and bound as set 2 of the pbr layout, so
+// shader.vert is shared with the CPU path. Blended renderables are left out, they need sorting.
+class VulkanGpuCulling
+{
+public:
+	static constexpr uint32_t WORKGROUP_SIZE = 64; // local_size_x in cull.comp
+
+	VulkanGpuCulling();
+	~VulkanGpuCulling();
+
+	VulkanGpuCulling(const VulkanGpuCulling&) = delete;
+	VulkanGpuCulling& operator=(const VulkanGpuCulling&) = delete;
+
+	// instanceSetLayout is VulkanDescriptorSetLayout::createForTransientData
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames,
+		VkDescriptorSetLayout instanceSetLayout, bool useDrawIndirectCount);
+	void destroy();
+
+	static bool isCandidate(const RenderableObject& renderable);
+
+	// builds groups from every candidate renderable; recreates the buffers, so only call while the GPU is idle
+	void setObjects(const std::vector<RenderableObject>& renderables);
+	void setBounds(uint32_t renderableIndex, const BoundingVolume& worldBounds);
+
+	// call once the frame's fence has signalled, before recording it
+	void update(uint32_t frameIndex);
+
+	// must be called before the first recordCull and again whenever the pyramid is recreated
+	void setHiZPyramid(VkImageView pyramidView, VkSampler pyramidSampler, VkExtent2D pyramidExtent, uint32_t pyramidLevels);
+
+	// writes the frame's cull parameters, every frame, recorded or replayed. viewProjection is the matrix
+	// the frame renders with (y flipped); occlusion is only tested when the pyramid was built last frame
+	void setCullData(uint32_t frameIndex, const Frustum& frustum, const glm::mat4& viewProjection, bool occlusion);
+	// outside a render pass, before any recordDraw of the same frame. Writes the indirect, count and
+	// instance buffers; the barrier to the draws reading them is left to the caller (the frame graph)
+	void recordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	// expects the group's pipeline, material and index buffer to be bound
+	void recordDraw(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t groupIndex);
+
+	const std::vector<GpuDrawGroup>& getGroups() const { return groups; }
+	VkDescriptorSet getInstanceDescriptorSet(uint32_t frameIndex) const;
+	VkBuffer getIndirectBuffer(uint32_t frameIndex) const;
+	VkBuffer getCountBuffer(uint32_t frameIndex) const;
+	VkBuffer getInstanceBuffer(uint32_t frameIndex) const;
+	uint32_t getObjectCount() const { return static_cast<uint32_t>(objects.size()); }
+	bool isCompacting() const { return drawIndirectCount; }
+	// bumped whenever buffers or descriptor sets are replaced, command buffers recorded before are invalid
+	uint32_t getGeneration() const { return generation; }
+
+	// counts from the last completed cull of the frame passed to update()
+	uint32_t getFrustumCulledCount() const { return frustumCulledCount; }
+	uint32_t getOcclusionCulledCount() const { return occlusionCulledCount; }
+
+private:
+	static constexpr uint32_t CULL_FLAG_COMPACT = 1;
+	static constexpr uint32_t CULL_FLAG_OCCLUSION = 2;
+
+	// std140 mirror of CullData in cull.comp
+	struct CullUniforms
+	{
+		glm::vec4 planes[6];
+		glm::mat4 previousViewProjection;
+		glm::vec2 pyramidSize;
+		uint32_t pyramidLevels;
+		uint32_t objectCount;
+		uint32_t flags;
+		uint32_t padding[3];
+	};
+
+	struct CullStats
+	{
+		uint32_t frustumCulled;
+		uint32_t occlusionCulled;
+	};
+
+	struct FrameResources
+	{
+		VkBuffer objectBuffer = VK_NULL_HANDLE; // host visible copy of objects
+		VulkanAllocation objectAllocation;
+		VkBuffer commandBuffer = VK_NULL_HANDLE;
+		VulkanAllocation commandAllocation;
+		VkBuffer countBuffer = VK_NULL_HANDLE;
+		VulkanAllocation countAllocation;
+		VkBuffer instanceBuffer = VK_NULL_HANDLE;
+		VulkanAllocation instanceAllocation;
+		VkBuffer uniformBuffer = VK_NULL_HANDLE; // host visible, written while recording
+		VulkanAllocation uniformAllocation;
+		VkBuffer statsBuffer = VK_NULL_HANDLE;   // host visible, read back once the frame's fence signals
+		VulkanAllocation statsAllocation;
+		VkDescriptorSet cullSet = VK_NULL_HANDLE;
+		VkDescriptorSet instanceSet = VK_NULL_HANDLE;
+	};
+
+	std::vector<GpuCullObject> objects;
+	std::vector<GpuDrawGroup> groups;
+	std::vector<uint32_t> objectOfRenderable; // UINT32_MAX for renderables drawn on the CPU path
+	std::vector<uint32_t> staleFrameMasks;    // bit n set: frame n still holds an old copy
+	std::vector<uint32_t> dirtyObjects;
+	uint32_t allFramesMask;
+
+	glm::mat4 previousViewProjection;
+	VkExtent2D hiZExtent;
+	uint32_t hiZLevels;
+	uint32_t frustumCulledCount;
+	uint32_t occlusionCulledCount;
+	uint32_t generation;
+
+	std::vector<FrameResources> frames;
+
+	VkDescriptorSetLayout cullSetLayout;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+	VkDescriptorPool descriptorPool;
+
+	bool drawIndirectCount;
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount;
+
+	VkDevice device;
+	VulkanMemoryAllocator* allocator;
+
+	void createPipeline();
+	void createFrameBuffers();
+	void destroyFrameBuffers();
+	void writeDescriptorSets();
+};
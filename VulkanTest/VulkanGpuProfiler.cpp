@@ -0,0 +1,254 @@
+#include "VulkanGpuProfiler.h"
+
+#include <cstring>
+
+VulkanGpuProfiler::VulkanGpuProfiler()
+	: queryPool(VK_NULL_HANDLE), frameCount(0), recordedFrameMask(0), currentFrame(0), frameZone(INVALID_ZONE),
+	timestampPeriod(1.0f), timestampMask(~0ull), enabled(true), frameActive(false), historyOffset(0), fetchedFrames(0),
+	resolvedBakeZones(0), device(VK_NULL_HANDLE)
+{
+}
+
+VulkanGpuProfiler::~VulkanGpuProfiler()
+{
+	destroy();
+}
+
+void VulkanGpuProfiler::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, uint32_t queueFamilyIndex, uint32_t numFrames)
+{
+	device = vkdevice;
+	frameCount = numFrames;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(vkphysdevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(vkphysdevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(vkphysdevice, &familyCount, families.data());
+	uint32_t validBits = queueFamilyIndex < familyCount ? families[queueFamilyIndex].timestampValidBits : 0;
+	if (validBits == 0 || timestampPeriod <= 0.0f)
+	{
+		return; // isSupported() stays false and every call is a no-op
+	}
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	// a begin / end pair per zone and frame, then the bake zones
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = (numFrames * MAX_ZONES + MAX_BAKE_ZONES) * 2;
+
+	if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create gpu profiler query pool!");
+	}
+}
+
+void VulkanGpuProfiler::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	stopCsvCapture();
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+	recordedFrameMask = 0;
+	frameActive = false;
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (!isSupported() || frameIndex >= frameCount)
+	{
+		return;
+	}
+
+	currentFrame = frameIndex;
+	frameActive = enabled;
+	if (!frameActive)
+	{
+		recordedFrameMask &= ~(1u << frameIndex); // nothing of this frame to read back
+		return;
+	}
+
+	vkCmdResetQueryPool(commandBuffer, queryPool, frameQuery(frameIndex, 0), MAX_ZONES * 2);
+	recordedFrameMask |= 1u << frameIndex;
+	frameZone = beginZone(commandBuffer, "Frame");
+}
+
+void VulkanGpuProfiler::endFrame(VkCommandBuffer commandBuffer)
+{
+	endZone(commandBuffer, frameZone);
+	frameActive = false;
+}
+
+uint32_t VulkanGpuProfiler::beginZone(VkCommandBuffer commandBuffer, const char* name)
+{
+	uint32_t zone = prepareZone(name);
+	beginPreparedZone(commandBuffer, zone);
+	return zone;
+}
+
+void VulkanGpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t zone)
+{
+	if (!frameActive || zone == INVALID_ZONE)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, frameQuery(currentFrame, zone) + 1);
+}
+
+uint32_t VulkanGpuProfiler::prepareZone(const char* name)
+{
+	if (!frameActive)
+	{
+		return INVALID_ZONE;
+	}
+	return findZone(name);
+}
+
+void VulkanGpuProfiler::beginPreparedZone(VkCommandBuffer commandBuffer, uint32_t zone)
+{
+	if (!frameActive || zone == INVALID_ZONE)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, frameQuery(currentFrame, zone));
+}
+
+void VulkanGpuProfiler::fetchResults(uint32_t frameIndex)
+{
+	if (!isSupported() || frameIndex >= frameCount || (recordedFrameMask & (1u << frameIndex)) == 0)
+	{
+		return;
+	}
+
+	// no wait flag: zones the frame did not write come back unavailable, VK_NOT_READY is expected then
+	uint32_t zoneCount = static_cast<uint32_t>(zones.size());
+	results.resize(zoneCount * 4);
+	VkResult result = vkGetQueryPoolResults(device, queryPool, frameQuery(frameIndex, 0), zoneCount * 2,
+		results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+	{
+		return;
+	}
+	recordedFrameMask &= ~(1u << frameIndex);
+
+	for (uint32_t index = 0; index < zoneCount; index++)
+	{
+		const uint64_t* pair = &results[index * 4]; // begin, available, end, available
+		float milliseconds = pair[1] != 0 && pair[3] != 0 ? toMilliseconds(pair[0], pair[2]) : 0.0f;
+
+		Zone& zone = zones[index];
+		zone.average += (milliseconds - zone.history[historyOffset]) / HISTORY_LENGTH;
+		zone.history[historyOffset] = milliseconds;
+
+		if (csvFile.is_open() && milliseconds > 0.0f)
+		{
+			csvFile << fetchedFrames << ',' << zone.name << ',' << milliseconds << '\n';
+		}
+	}
+	historyOffset = (historyOffset + 1) % HISTORY_LENGTH;
+	fetchedFrames++;
+}
+
+uint32_t VulkanGpuProfiler::beginBakeZone(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!isSupported() || bakeZones.size() >= MAX_BAKE_ZONES)
+	{
+		return INVALID_ZONE;
+	}
+
+	uint32_t zone = static_cast<uint32_t>(bakeZones.size());
+	bakeZones.push_back({ name, 0.0f });
+	vkCmdResetQueryPool(commandBuffer, queryPool, bakeQuery(zone), 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, bakeQuery(zone));
+	return zone;
+}
+
+void VulkanGpuProfiler::endBakeZone(VkCommandBuffer commandBuffer, uint32_t zone)
+{
+	if (zone == INVALID_ZONE)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, bakeQuery(zone) + 1);
+}
+
+void VulkanGpuProfiler::resolveBakeZones()
+{
+	// the bake already waited for the queue, so the wait flag does not stall
+	for (; resolvedBakeZones < bakeZones.size(); resolvedBakeZones++)
+	{
+		uint64_t timestamps[2] = {};
+		if (vkGetQueryPoolResults(device, queryPool, bakeQuery(resolvedBakeZones), 2, sizeof(timestamps), timestamps,
+			sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS)
+		{
+			bakeZones[resolvedBakeZones].milliseconds = toMilliseconds(timestamps[0], timestamps[1]);
+		}
+	}
+}
+
+bool VulkanGpuProfiler::startCsvCapture(const std::string& path)
+{
+	stopCsvCapture();
+	csvFile.open(path, std::ios::out | std::ios::trunc);
+	if (!csvFile.is_open())
+	{
+		return false;
+	}
+
+	csvFile << "frame,zone,milliseconds\n";
+	for (const BakeZone& zone : bakeZones)
+	{
+		csvFile << "bake," << zone.name << ',' << zone.milliseconds << '\n';
+	}
+	return true;
+}
+
+void VulkanGpuProfiler::stopCsvCapture()
+{
+	if (csvFile.is_open())
+	{
+		csvFile.close();
+	}
+}
+
+uint32_t VulkanGpuProfiler::findZone(const char* name)
+{
+	for (uint32_t zone = 0; zone < zones.size(); zone++)
+	{
+		if (std::strcmp(zones[zone].name.c_str(), name) == 0)
+		{
+			return zone;
+		}
+	}
+	if (zones.size() >= MAX_ZONES)
+	{
+		return INVALID_ZONE;
+	}
+
+	Zone zone;
+	zone.name = name;
+	zone.history.assign(HISTORY_LENGTH, 0.0f);
+	zones.push_back(std::move(zone));
+	return static_cast<uint32_t>(zones.size() - 1);
+}
+
+float VulkanGpuProfiler::toMilliseconds(uint64_t begin, uint64_t end) const
+{
+	uint64_t ticks = (end - begin) & timestampMask;
+	return static_cast<float>(static_cast<double>(ticks) * timestampPeriod * 1e-6);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+// GPU timestamps around named zones of the frame (skybox, pbr draws, UI, compute passes, ...), one
+// range of queries per frame in flight. A zone keeps its slot once its name was first seen, so the
+// query indices a cached secondary command buffer recorded stay right when it is replayed. Results are
+// read once the frame's fence has signalled, MAX_FRAMES_IN_FLIGHT frames later, without the wait flag,
+// and go into a rolling history per zone plus, while a capture runs, a CSV file.
+// Zones may be written in primaries or secondaries, inside or outside render passes, but not in a
+// subpass whose contents are secondaries; each zone at most once per frame. A zone can begin and end
+// in different secondaries recorded on worker threads: prepareZone picks its slot on the recording
+// thread first, beginPreparedZone / endZone then only write commands.
+// One-off work that is waited on right away (the IBL bake) has its own bake zones, read back as soon
+// as the queue is idle.
+class VulkanGpuProfiler
+{
+public:
+	static constexpr uint32_t MAX_ZONES = 32;       // per frame, "Frame" included
+	static constexpr uint32_t MAX_BAKE_ZONES = 16;
+	static constexpr uint32_t HISTORY_LENGTH = 240; // frames in the rolling graph
+	static constexpr uint32_t INVALID_ZONE = 0xFFFFFFFFu;
+
+	struct Zone
+	{
+		std::string name;
+		std::vector<float> history; // milliseconds, ring buffer of HISTORY_LENGTH, 0 when not written
+		float average = 0.0f;       // over the history
+	};
+
+	struct BakeZone
+	{
+		std::string name;
+		float milliseconds = 0.0f;
+	};
+
+	VulkanGpuProfiler();
+	~VulkanGpuProfiler();
+
+	VulkanGpuProfiler(const VulkanGpuProfiler&) = delete;
+	VulkanGpuProfiler& operator=(const VulkanGpuProfiler&) = delete;
+
+	// queueFamilyIndex: the family everything is submitted to, without timestamp bits nothing is recorded
+	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, uint32_t queueFamilyIndex, uint32_t numFrames);
+	void destroy();
+
+	// first and last thing in the frame's command buffer, outside any render pass; the pair is the "Frame" zone
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	void endFrame(VkCommandBuffer commandBuffer);
+
+	// between beginFrame and endFrame; INVALID_ZONE when disabled or out of slots, endZone ignores that
+	uint32_t beginZone(VkCommandBuffer commandBuffer, const char* name);
+	void endZone(VkCommandBuffer commandBuffer, uint32_t zone);
+	uint32_t prepareZone(const char* name);
+	void beginPreparedZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+	// call once the frame's fence has signalled
+	void fetchResults(uint32_t frameIndex);
+
+	// on a command buffer the caller waits for before resolveBakeZones; begin resets the pair, so outside a render pass
+	uint32_t beginBakeZone(VkCommandBuffer commandBuffer, const char* name);
+	void endBakeZone(VkCommandBuffer commandBuffer, uint32_t zone);
+	void resolveBakeZones();
+
+	// one "frame,zone,milliseconds" row per zone written in each fetched frame
+	bool startCsvCapture(const std::string& path);
+	void stopCsvCapture();
+	bool isCapturingCsv() const { return csvFile.is_open(); }
+
+	void setEnabled(bool enable) { enabled = enable; }
+	bool isEnabled() const { return enabled; }
+	bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+	const std::vector<Zone>& getZones() const { return zones; }
+	uint32_t getHistoryOffset() const { return historyOffset; } // oldest entry of every history
+	const std::vector<BakeZone>& getBakeZones() const { return bakeZones; }
+
+private:
+	VkQueryPool queryPool;
+	uint32_t frameCount;
+	uint32_t recordedFrameMask; // bit n set: frame n's queries were reset and written
+	uint32_t currentFrame;      // of the frame being recorded
+	uint32_t frameZone;
+	float timestampPeriod;      // nanoseconds per tick
+	uint64_t timestampMask;
+	bool enabled;
+	bool frameActive;           // between a beginFrame that found the profiler enabled and endFrame
+
+	std::vector<Zone> zones;
+	uint32_t historyOffset;
+	uint64_t fetchedFrames;
+	std::vector<BakeZone> bakeZones;
+	uint32_t resolvedBakeZones;
+	std::vector<uint64_t> results; // value / availability pairs, reused by every fetch
+	std::ofstream csvFile;
+
+	VkDevice device;
+
+	uint32_t findZone(const char* name);
+	uint32_t frameQuery(uint32_t frameIndex, uint32_t zone) const { return (frameIndex * MAX_ZONES + zone) * 2; }
+	uint32_t bakeQuery(uint32_t zone) const { return (frameCount * MAX_ZONES + zone) * 2; }
+	float toMilliseconds(uint64_t begin, uint64_t end) const;
+};
@@ -20,18 +20,38 @@ void VulkanGraphicsPipeline::create(
 	//const std::string& teseShaderPath,
 	VkPolygonMode polygonMode,
 	VkCullModeFlagBits cullMode,
-	VkFrontFace frontFace
+	VkFrontFace frontFace,
+	VulkanShaderModuleCache* shaderModuleCache,
+	VkPipelineCache pipelineCache
+)
+{
+	GraphicsPipelineState state{};
+	state.pipelineLayout = pipelineLayout;
+	state.renderPass = renderPass;
+	state.vertShaderPath = vertShaderPath;
+	state.fragShaderPath = fragShaderPath;
+	state.polygonMode = polygonMode;
+	state.cullMode = cullMode;
+	state.frontFace = frontFace;
+
+	createFromState(vkDevice, state, shaderModuleCache, pipelineCache);
+}
+
+void VulkanGraphicsPipeline::createFromState(
+	VkDevice vkDevice,
+	const GraphicsPipelineState& state,
+	VulkanShaderModuleCache* shaderModuleCache,
+	VkPipelineCache pipelineCache
 )
 {
 	device = vkDevice;
 
-	auto vertShaderCode = readFile(vertShaderPath);
-	auto fragShaderCode = readFile(fragShaderPath);
+	VkShaderModule vertShaderModule = acquireShaderModule(state.vertShaderPath, shaderModuleCache);
+	// depth only pipelines run without a fragment stage
+	bool hasFragmentStage = !state.fragShaderPath.empty();
+	VkShaderModule fragShaderModule = hasFragmentStage ? acquireShaderModule(state.fragShaderPath, shaderModuleCache) : VK_NULL_HANDLE;
 	//auto tescShaderCode = readFile(tescShaderPath);
 	//auto teseShaderCode = readFile(teseShaderPath);
-
-	VkShaderModule vertShaderModule = createShaderModule(device, vertShaderCode);
-	VkShaderModule fragShaderModule = createShaderModule(device, fragShaderCode);
 	//VkShaderModule tescShaderModule = createShaderModule(device, tescShaderCode);
 	//VkShaderModule teseShaderModule = createShaderModule(device, teseShaderCode);
 
@@ -47,6 +67,23 @@ void VulkanGraphicsPipeline::create(
 	fragShaderStageInfo.module = fragShaderModule;
 	fragShaderStageInfo.pName = "main";
 
+	// shader.frag variants; fragment shaders without these constant ids ignore the entries
+	struct FragmentSpecialization
+	{
+		uint32_t materialFeatures;
+		int32_t alphaMode;
+	} specializationData{ state.materialFeatures, static_cast<int32_t>(state.blendMode) };
+	VkSpecializationMapEntry specializationEntries[] = {
+		{ 0, offsetof(FragmentSpecialization, materialFeatures), sizeof(uint32_t) },
+		{ 1, offsetof(FragmentSpecialization, alphaMode), sizeof(int32_t) }
+	};
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = 2;
+	specializationInfo.pMapEntries = specializationEntries;
+	specializationInfo.dataSize = sizeof(specializationData);
+	specializationInfo.pData = &specializationData;
+	fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
 	/*VkPipelineShaderStageCreateInfo tescShaderStageInfo{};
 	tescShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	tescShaderStageInfo.stage = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
@@ -71,10 +108,20 @@ void VulkanGraphicsPipeline::create(
 
 	auto bindingDescription = Vertex::getBindingDescription();
 	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	// position only layouts still read from the full Vertex stride, just skip the other attributes
+	uint32_t attributeCount = state.vertexLayout == PipelineVertexLayout::PBR_FULL
+		? static_cast<uint32_t>(attributeDescriptions.size())
+		: 1u;
+	// the position stream holds nothing else, the stride shrinks to one position
+	if (state.vertexLayout == PipelineVertexLayout::POSITION_STREAM)
+	{
+		bindingDescription.stride = sizeof(glm::vec3);
+		attributeDescriptions[0].offset = 0;
+	}
 
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.vertexAttributeDescriptionCount = attributeCount;
 	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -92,14 +139,14 @@ void VulkanGraphicsPipeline::create(
 	VkPipelineRasterizationStateCreateInfo rasterizer{};
 	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.polygonMode = polygonMode;
+	rasterizer.polygonMode = state.polygonMode;
 	rasterizer.lineWidth = 1.0f;
-	rasterizer.cullMode = cullMode;
-	rasterizer.frontFace = frontFace; // to counter the Y-Flip from GLM, after the Y-Flip, it would practically be counter clockwise.
-	rasterizer.depthBiasEnable = VK_FALSE;
-	rasterizer.depthBiasConstantFactor = 0.0f;
+	rasterizer.cullMode = state.cullMode;
+	rasterizer.frontFace = state.frontFace; // to counter the Y-Flip from GLM, after the Y-Flip, it would practically be counter clockwise.
+	rasterizer.depthBiasEnable = state.depthBias ? VK_TRUE : VK_FALSE;
+	rasterizer.depthBiasConstantFactor = state.depthBias ? 1.25f : 0.0f;
 	rasterizer.depthBiasClamp = 0.0f;
-	rasterizer.depthBiasSlopeFactor = 0.0f;
+	rasterizer.depthBiasSlopeFactor = state.depthBias ? 1.75f : 0.0f;
 
 	VkPipelineMultisampleStateCreateInfo multisampling{};
 	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
@@ -111,20 +158,35 @@ void VulkanGraphicsPipeline::create(
 	multisampling.alphaToOneEnable = VK_FALSE;
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
+	colorBlendAttachment.colorWriteMask = state.colorWrite
+		? VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+		: 0;
+	if (state.blendMode == PipelineBlendMode::BLEND_MODE)
+	{
+		colorBlendAttachment.blendEnable = VK_TRUE;
+		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	}
+	else
+	{
+		colorBlendAttachment.blendEnable = VK_FALSE;
+		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
+		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
+		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD; // Optional
+		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
+		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
+		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD; // Optional
+	}
 
 	VkPipelineColorBlendStateCreateInfo colorBlending{};
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlending.logicOpEnable = VK_FALSE;
 	colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional;
-	colorBlending.attachmentCount = 1;
+	colorBlending.attachmentCount = state.colorAttachment ? 1 : 0;
 	colorBlending.pAttachments = &colorBlendAttachment;
 	colorBlending.blendConstants[0] = 0.0f; // Optional
 	colorBlending.blendConstants[1] = 0.0f; // Optional
@@ -134,8 +196,9 @@ void VulkanGraphicsPipeline::create(
 	VkPipelineDepthStencilStateCreateInfo depthStencil{};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthStencil.depthTestEnable = VK_TRUE;
-	depthStencil.depthWriteEnable = VK_TRUE;
-	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	// blended surfaces are tested against depth but must not occlude what is drawn behind them
+	depthStencil.depthWriteEnable = (state.depthWrite && state.blendMode != PipelineBlendMode::BLEND_MODE) ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = state.depthCompareOp;
 
 	depthStencil.depthBoundsTestEnable = VK_FALSE;
 	depthStencil.minDepthBounds = 0.0f; // Optional
@@ -160,7 +223,7 @@ void VulkanGraphicsPipeline::create(
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
+	pipelineInfo.stageCount = hasFragmentStage ? 2 : 1;
 	pipelineInfo.pStages = shaderStages;
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &inputAssembly;
@@ -171,31 +234,32 @@ void VulkanGraphicsPipeline::create(
 	pipelineInfo.pColorBlendState = &colorBlending;
 	pipelineInfo.pTessellationState = &tessellationState;
 	pipelineInfo.pDynamicState = &dynamicState;
-	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.renderPass = renderPass;
+	pipelineInfo.layout = state.pipelineLayout;
+	pipelineInfo.renderPass = state.renderPass;
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 	pipelineInfo.basePipelineIndex = -1; // Optional
 
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create graphics pipeline!");
 	}
 
-	vkDestroyShaderModule(device, vertShaderModule, nullptr);
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
+	releaseShaderModule(vertShaderModule, shaderModuleCache);
+	if (hasFragmentStage)
+	{
+		releaseShaderModule(fragShaderModule, shaderModuleCache);
+	}
 	//vkDestroyShaderModule(device, tescShaderModule, nullptr);
 	//vkDestroyShaderModule(device, teseShaderModule, nullptr);
 }
 
-void VulkanGraphicsPipeline::createSkybox(VkDevice vkDevice, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertShaderPath, const std::string& fragShaderPath)
+void VulkanGraphicsPipeline::createSkybox(VkDevice vkDevice, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertShaderPath, const std::string& fragShaderPath, VulkanShaderModuleCache* shaderModuleCache, VkPipelineCache pipelineCache)
 {
 	device = vkDevice;
 
-	auto vertShaderCode = readFile(vertShaderPath);
-	auto fragShaderCode = readFile(fragShaderPath);
-	VkShaderModule vertShaderModule = createShaderModule(device, vertShaderCode);
-	VkShaderModule fragShaderModule = createShaderModule(device, fragShaderCode);
+	VkShaderModule vertShaderModule = acquireShaderModule(vertShaderPath, shaderModuleCache);
+	VkShaderModule fragShaderModule = acquireShaderModule(fragShaderPath, shaderModuleCache);
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -308,23 +372,21 @@ void VulkanGraphicsPipeline::createSkybox(VkDevice vkDevice, VkPipelineLayout pi
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create skybox graphics pipeline!");
 	}
 
-	vkDestroyShaderModule(device, vertShaderModule, nullptr);
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
+	releaseShaderModule(vertShaderModule, shaderModuleCache);
+	releaseShaderModule(fragShaderModule, shaderModuleCache);
 }
 
-void VulkanGraphicsPipeline::createForConversion(VkDevice device, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertShaderPath, const std::string& fragShaderPath)
+void VulkanGraphicsPipeline::createForConversion(VkDevice device, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertShaderPath, const std::string& fragShaderPath, VulkanShaderModuleCache* shaderModuleCache, VkPipelineCache pipelineCache)
 {
 	this->device = device;
 
-	auto vertShaderCode = readFile(vertShaderPath);
-	auto fragShaderCode = readFile(fragShaderPath);
-	VkShaderModule vertShaderModule = createShaderModule(device, vertShaderCode);
-	VkShaderModule fragShaderModule = createShaderModule(device, fragShaderCode);
+	VkShaderModule vertShaderModule = acquireShaderModule(vertShaderPath, shaderModuleCache);
+	VkShaderModule fragShaderModule = acquireShaderModule(fragShaderPath, shaderModuleCache);
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -436,23 +498,28 @@ void VulkanGraphicsPipeline::createForConversion(VkDevice device, VkPipelineLayo
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create skybox graphics pipeline!");
 	}
 
-	vkDestroyShaderModule(device, vertShaderModule, nullptr);
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
+	releaseShaderModule(vertShaderModule, shaderModuleCache);
+	releaseShaderModule(fragShaderModule, shaderModuleCache);
+}
+
+void VulkanGraphicsPipeline::createForLutGeneration(VkDevice device, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertShaderPath, const std::string& fragShaderPath, VulkanShaderModuleCache* shaderModuleCache, VkPipelineCache pipelineCache)
+{
+	// the LUT is two channels
+	createFullscreen(device, pipelineLayout, renderPass, 0, vertShaderPath, fragShaderPath,
+		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT, shaderModuleCache, pipelineCache);
 }
 
-void VulkanGraphicsPipeline::createForLutGeneration(VkDevice device, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, const std::string& vertShaderPath, const std::string& fragShaderPath)
+void VulkanGraphicsPipeline::createFullscreen(VkDevice device, VkPipelineLayout pipelineLayout, VkRenderPass renderPass, uint32_t subpass, const std::string& vertShaderPath, const std::string& fragShaderPath, VkColorComponentFlags colorWriteMask, VulkanShaderModuleCache* shaderModuleCache, VkPipelineCache pipelineCache)
 {
 	this->device = device;
 
-	auto vertShaderCode = readFile(vertShaderPath);
-	auto fragShaderCode = readFile(fragShaderPath);
-	VkShaderModule vertShaderModule = createShaderModule(device, vertShaderCode);
-	VkShaderModule fragShaderModule = createShaderModule(device, fragShaderCode);
+	VkShaderModule vertShaderModule = acquireShaderModule(vertShaderPath, shaderModuleCache);
+	VkShaderModule fragShaderModule = acquireShaderModule(fragShaderPath, shaderModuleCache);
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -514,7 +581,7 @@ void VulkanGraphicsPipeline::createForLutGeneration(VkDevice device, VkPipelineL
 	depthStencil.stencilTestEnable = VK_FALSE;
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT;
+	colorBlendAttachment.colorWriteMask = colorWriteMask;
 	colorBlendAttachment.blendEnable = VK_FALSE;
 
 	VkPipelineColorBlendStateCreateInfo colorBlending{};
@@ -543,15 +610,15 @@ void VulkanGraphicsPipeline::createForLutGeneration(VkDevice device, VkPipelineL
 	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = pipelineLayout;
 	pipelineInfo.renderPass = renderPass;
-	pipelineInfo.subpass = 0;
+	pipelineInfo.subpass = subpass;
 
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
 	{
-		throw std::runtime_error("failed to create LUT generation graphics pipeline!");
+		throw std::runtime_error("failed to create fullscreen graphics pipeline!");
 	}
 
-	vkDestroyShaderModule(device, vertShaderModule, nullptr);
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
+	releaseShaderModule(vertShaderModule, shaderModuleCache);
+	releaseShaderModule(fragShaderModule, shaderModuleCache);
 }
 
 
@@ -575,37 +642,20 @@ VkPipeline VulkanGraphicsPipeline::getVkPipeline() const
 	return graphicsPipeline;
 }
 
-std::vector<char> VulkanGraphicsPipeline::readFile(const std::string& filename)
+VkShaderModule VulkanGraphicsPipeline::acquireShaderModule(const std::string& path, VulkanShaderModuleCache* shaderModuleCache) const
 {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open())
+	if (shaderModuleCache)
 	{
-		throw std::runtime_error("failed to open file!");
+		return shaderModuleCache->getShaderModule(path);
 	}
-
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
-
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-	file.close();
-
-	return buffer;
+	return VulkanShaderModuleCache::createShaderModule(device, VulkanShaderModuleCache::readFile(path));
 }
 
-VkShaderModule VulkanGraphicsPipeline::createShaderModule(VkDevice vkdevice, const std::vector<char>& code)
+void VulkanGraphicsPipeline::releaseShaderModule(VkShaderModule shaderModule, VulkanShaderModuleCache* shaderModuleCache) const
 {
-	VkShaderModuleCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-	VkShaderModule shaderModule;
-	if (vkCreateShaderModule(vkdevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	// modules owned by the cache outlive the pipeline, only destroy the ones we created ourselves
+	if (!shaderModuleCache)
 	{
-		throw std::runtime_error("failed to create shader module!");
+		vkDestroyShaderModule(device, shaderModule, nullptr);
 	}
-
-	return shaderModule;
-}
\ No newline at end of file
+}
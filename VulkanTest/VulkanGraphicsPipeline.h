@@ -5,8 +5,101 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
 
 #include "ModelLoader.h"
+#include "VulkanShaderModuleCache.h"
+
+enum class PipelineBlendMode : uint8_t
+{
+	OPAQUE_MODE,
+	MASK_MODE, // opaque blending, alpha test happens in the shader
+	BLEND_MODE
+};
+
+enum class PipelineVertexLayout : uint8_t
+{
+	PBR_FULL, // pos, color, texCoord, normal
+	POSITION_ONLY,  // pos out of the full Vertex stride
+	POSITION_STREAM // tightly packed positions, VulkanGeometryBuffer::getPositionBuffer
+};
+
+// Specialization constant 0 of shader.frag: the texture maps a material variant samples.
+// Constant 1 is the alpha mode, taken from the state's blendMode
+enum MaterialFeatureBits : uint32_t
+{
+	MATERIAL_FEATURE_ALBEDO_MAP = 1u << 0,
+	MATERIAL_FEATURE_METALLIC_ROUGHNESS_MAP = 1u << 1,
+	MATERIAL_FEATURE_OCCLUSION_MAP = 1u << 2,
+	MATERIAL_FEATURE_EMISSIVE_MAP = 1u << 3,
+	MATERIAL_FEATURE_ALL = 0xFu
+};
+
+// Describes everything that makes one graphics pipeline differ from another.
+// Used as the key of VulkanPipelineLibrary so identical states share a pipeline.
+struct GraphicsPipelineState
+{
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	std::string vertShaderPath;
+	std::string fragShaderPath; // empty for depth only pipelines
+
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	PipelineBlendMode blendMode = PipelineBlendMode::OPAQUE_MODE;
+	PipelineVertexLayout vertexLayout = PipelineVertexLayout::PBR_FULL;
+
+	bool depthWrite = true;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+	bool depthBias = false; // slope scaled bias for shadow map casters
+	bool colorWrite = true;
+	bool colorAttachment = true; // false for render passes with only a depth attachment
+	uint32_t materialFeatures = MATERIAL_FEATURE_ALL; // MaterialFeatureBits, leave at ALL for shaders other than shader.frag
+
+	bool operator==(const GraphicsPipelineState& other) const
+	{
+		return pipelineLayout == other.pipelineLayout && renderPass == other.renderPass &&
+			vertShaderPath == other.vertShaderPath && fragShaderPath == other.fragShaderPath &&
+			polygonMode == other.polygonMode && cullMode == other.cullMode && frontFace == other.frontFace &&
+			blendMode == other.blendMode && vertexLayout == other.vertexLayout &&
+			depthWrite == other.depthWrite && depthCompareOp == other.depthCompareOp &&
+			depthBias == other.depthBias && colorWrite == other.colorWrite && colorAttachment == other.colorAttachment &&
+			materialFeatures == other.materialFeatures;
+	}
+};
+
+namespace std {
+	template<> struct hash<GraphicsPipelineState>
+	{
+		size_t operator()(GraphicsPipelineState const& state) const
+		{
+			size_t seed = 0;
+			auto combine = [&seed](size_t value)
+				{
+					seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+				};
+			combine(hash<uint64_t>()(reinterpret_cast<uint64_t>(state.pipelineLayout)));
+			combine(hash<uint64_t>()(reinterpret_cast<uint64_t>(state.renderPass)));
+			combine(hash<string>()(state.vertShaderPath));
+			combine(hash<string>()(state.fragShaderPath));
+			combine(static_cast<size_t>(state.polygonMode));
+			combine(static_cast<size_t>(state.cullMode));
+			combine(static_cast<size_t>(state.frontFace));
+			combine(static_cast<size_t>(state.blendMode));
+			combine(static_cast<size_t>(state.vertexLayout));
+			combine(static_cast<size_t>(state.depthWrite));
+			combine(static_cast<size_t>(state.depthCompareOp));
+			combine(static_cast<size_t>(state.depthBias));
+			combine(static_cast<size_t>(state.colorWrite));
+			combine(static_cast<size_t>(state.colorAttachment));
+			combine(static_cast<size_t>(state.materialFeatures));
+			return seed;
+		}
+	};
+}
 
 class VulkanGraphicsPipeline
 {
@@ -24,7 +117,16 @@ public:
 		//const std::string& teseShaderPath,
 		VkPolygonMode polygoneMode,
 		VkCullModeFlagBits cullMode,
-		VkFrontFace frontFace
+		VkFrontFace frontFace,
+		VulkanShaderModuleCache* shaderModuleCache = nullptr,
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE
+	);
+
+	void createFromState(
+		VkDevice vkDevice,
+		const GraphicsPipelineState& state,
+		VulkanShaderModuleCache* shaderModuleCache = nullptr,
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE
 	);
 
 	void createSkybox(
@@ -32,7 +134,9 @@ public:
 		VkPipelineLayout pipelineLayout,
 		VkRenderPass renderPass,
 		const std::string& vertShaderPath,
-		const std::string& fragShaderPath
+		const std::string& fragShaderPath,
+		VulkanShaderModuleCache* shaderModuleCache = nullptr,
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE
 	);
 
 	void createForConversion(
@@ -40,7 +144,9 @@ public:
 		VkPipelineLayout pipelineLayout,
 		VkRenderPass renderPass,
 		const std::string& vertShaderPath,
-		const std::string& fragShaderPath
+		const std::string& fragShaderPath,
+		VulkanShaderModuleCache* shaderModuleCache = nullptr,
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE
 	);
 
 	void createForLutGeneration(
@@ -48,7 +154,22 @@ public:
 		VkPipelineLayout pipelineLayout,
 		VkRenderPass renderPass,
 		const std::string& vertShaderPath,
-		const std::string& fragShaderPath
+		const std::string& fragShaderPath,
+		VulkanShaderModuleCache* shaderModuleCache = nullptr,
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE
+	);
+
+	// one triangle covering the target, generated in the vertex shader: no vertex input, depth or blending
+	void createFullscreen(
+		VkDevice device,
+		VkPipelineLayout pipelineLayout,
+		VkRenderPass renderPass,
+		uint32_t subpass,
+		const std::string& vertShaderPath,
+		const std::string& fragShaderPath,
+		VkColorComponentFlags colorWriteMask,
+		VulkanShaderModuleCache* shaderModuleCache = nullptr,
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE
 	);
 
 	void destroy();
@@ -60,8 +181,7 @@ private:
 
 	VkDevice device;
 
-	static std::vector<char> readFile(const std::string& filename);
-
-	static VkShaderModule createShaderModule(VkDevice vkdevice, const std::vector<char>& code);
+	VkShaderModule acquireShaderModule(const std::string& path, VulkanShaderModuleCache* shaderModuleCache) const;
+	void releaseShaderModule(VkShaderModule shaderModule, VulkanShaderModuleCache* shaderModuleCache) const;
 };
 
@@ -0,0 +1,347 @@
+#include "VulkanHiZPyramid.h"
+
+#include <algorithm>
+#include <array>
+
+#include "VulkanImage.h"
+#include "VulkanCommandBuffers.h"
+#include "VulkanShaderModuleCache.h"
+
+namespace
+{
+	uint32_t floorPowerOfTwo(uint32_t value)
+	{
+		uint32_t result = 1;
+		while (result * 2 <= value)
+		{
+			result *= 2;
+		}
+		return result;
+	}
+}
+
+VulkanHiZPyramid::VulkanHiZPyramid()
+	: image(VK_NULL_HANDLE), imageView(VK_NULL_HANDLE), sampler(VK_NULL_HANDLE), extent{ 0, 0 }, sourceExtent{ 0, 0 },
+	setLayout(VK_NULL_HANDLE), descriptorPool(VK_NULL_HANDLE), pipelineLayout(VK_NULL_HANDLE), pipeline(VK_NULL_HANDLE),
+	device(VK_NULL_HANDLE), allocator(nullptr)
+{
+}
+
+VulkanHiZPyramid::~VulkanHiZPyramid()
+{
+	destroy();
+}
+
+void VulkanHiZPyramid::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+	VkImageView depthView, VkExtent2D depthExtent)
+{
+	device = vkdevice;
+	allocator = &memoryAllocator;
+	sourceExtent = depthExtent;
+	extent = { floorPowerOfTwo(std::max(depthExtent.width, 1u)), floorPowerOfTwo(std::max(depthExtent.height, 1u)) };
+
+	uint32_t levelCount = 1;
+	while ((std::max(extent.width, extent.height) >> levelCount) > 0)
+	{
+		levelCount++;
+	}
+
+	VulkanImage::createImage(device, *allocator, extent.width, extent.height, levelCount, 1,
+		VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = levelCount;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create hi-z pyramid image view!");
+	}
+
+	levelViews.resize(levelCount, VK_NULL_HANDLE);
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		viewInfo.subresourceRange.baseMipLevel = level;
+		viewInfo.subresourceRange.levelCount = 1;
+		if (vkCreateImageView(device, &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create hi-z pyramid level view!");
+		}
+	}
+
+	// only read with texelFetch, the sampler just has to exist
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = static_cast<float>(levelCount);
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create hi-z pyramid sampler!");
+	}
+
+	// GENERAL for good, so the culling pass can sample it even before the first build
+	VkCommandBuffer commandBuffer = VulkanCommandBuffers::beginSingleTimeCommands(device, commandPool);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VulkanCommandBuffers::endSingleTimeCommands(commandBuffer, device, graphicsQueue, commandPool);
+
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create hi-z pyramid descriptor set layout!");
+	}
+
+	createDescriptorSets(depthView);
+	createPipeline();
+}
+
+void VulkanHiZPyramid::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	if (pipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(device, pipeline, nullptr);
+		pipeline = VK_NULL_HANDLE;
+	}
+	if (pipelineLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		pipelineLayout = VK_NULL_HANDLE;
+	}
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		descriptorPool = VK_NULL_HANDLE;
+	}
+	levelSets.clear();
+	if (setLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+		setLayout = VK_NULL_HANDLE;
+	}
+	if (sampler != VK_NULL_HANDLE)
+	{
+		vkDestroySampler(device, sampler, nullptr);
+		sampler = VK_NULL_HANDLE;
+	}
+	for (VkImageView view : levelViews)
+	{
+		vkDestroyImageView(device, view, nullptr);
+	}
+	levelViews.clear();
+	if (imageView != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(device, imageView, nullptr);
+		imageView = VK_NULL_HANDLE;
+	}
+
+	VulkanImage::destroyImage(device, *allocator, image, imageAllocation);
+	extent = { 0, 0 };
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanHiZPyramid::recordBuild(VkCommandBuffer commandBuffer)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Hi-z pyramid record build called before initialization!");
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+	VkExtent2D source = sourceExtent;
+	for (uint32_t level = 0; level < levelViews.size(); level++)
+	{
+		VkExtent2D destination = { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u) };
+
+		LevelSizes sizes{};
+		sizes.sourceWidth = static_cast<int32_t>(source.width);
+		sizes.sourceHeight = static_cast<int32_t>(source.height);
+		sizes.destinationWidth = static_cast<int32_t>(destination.width);
+		sizes.destinationHeight = static_cast<int32_t>(destination.height);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &levelSets[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(LevelSizes), &sizes);
+		vkCmdDispatch(commandBuffer, (destination.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(destination.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+		// the next level reads this one; after the last level the frame graph syncs next frame's culling pass
+		if (level + 1 < levelViews.size())
+		{
+			VkMemoryBarrier levelBarrier{};
+			levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		source = destination;
+	}
+}
+
+VkImage VulkanHiZPyramid::getImage() const
+{
+	if (image == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Get hi-z pyramid image called before initialization!");
+	}
+	return image;
+}
+
+VkImageView VulkanHiZPyramid::getImageView() const
+{
+	if (imageView == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Get hi-z pyramid image view called before initialization!");
+	}
+	return imageView;
+}
+
+void VulkanHiZPyramid::createPipeline()
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(LevelSizes);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create hi-z pyramid pipeline layout!");
+	}
+
+	VkShaderModule shaderModule = VulkanShaderModuleCache::createShaderModule(device,
+		VulkanShaderModuleCache::readFile("shaders/hiz.comp.spv"));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create hi-z pyramid pipeline!");
+	}
+}
+
+void VulkanHiZPyramid::createDescriptorSets(VkImageView depthView)
+{
+	uint32_t levelCount = static_cast<uint32_t>(levelViews.size());
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = levelCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = levelCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = levelCount;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create hi-z pyramid descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(levelCount, setLayout);
+	levelSets.resize(levelCount);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = levelCount;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, levelSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate hi-z pyramid descriptor sets!");
+	}
+
+	// level 0 reduces the depth buffer, every other level the one above it
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		VkDescriptorImageInfo sourceInfo{};
+		sourceInfo.sampler = sampler;
+		sourceInfo.imageView = level == 0 ? depthView : levelViews[level - 1];
+		sourceInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo destinationInfo{};
+		destinationInfo.imageView = levelViews[level];
+		destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> writes{};
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].dstSet = levelSets[level];
+		writes[0].dstBinding = 0;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].descriptorCount = 1;
+		writes[0].pImageInfo = &sourceInfo;
+		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[1].dstSet = levelSets[level];
+		writes[1].dstBinding = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		writes[1].descriptorCount = 1;
+		writes[1].pImageInfo = &destinationInfo;
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
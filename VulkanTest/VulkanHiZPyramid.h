@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+#include "VulkanMemoryAllocator.h"
+
+// Hierarchical Z pyramid of the scene depth buffer for occlusion culling. Level 0 is the depth
+// buffer reduced to the next lower power of two, every level after that halves the previous one,
+// and each texel keeps the farthest depth it covers, so a box whose nearest depth is still behind
+// that value is hidden. Built with hiz.comp right after the scene pass and sampled by cull.comp
+// the next frame; the image stays in VK_IMAGE_LAYOUT_GENERAL throughout.
+// Tied to the depth buffer, so it is recreated along with the swap chain.
+class VulkanHiZPyramid
+{
+public:
+	static constexpr uint32_t WORKGROUP_SIZE = 8; // local_size_x / local_size_y in hiz.comp
+
+	VulkanHiZPyramid();
+	~VulkanHiZPyramid();
+
+	VulkanHiZPyramid(const VulkanHiZPyramid&) = delete;
+	VulkanHiZPyramid& operator=(const VulkanHiZPyramid&) = delete;
+
+	// depthView must be in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL when the build runs
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+		VkImageView depthView, VkExtent2D depthExtent);
+	void destroy();
+
+	// outside a render pass; the frame graph puts the barriers on the depth buffer and the pyramid around it
+	void recordBuild(VkCommandBuffer commandBuffer);
+
+	VkImage getImage() const;
+	VkImageView getImageView() const;
+	VkSampler getSampler() const { return sampler; }
+	VkExtent2D getExtent() const { return extent; }
+	uint32_t getLevelCount() const { return static_cast<uint32_t>(levelViews.size()); }
+
+private:
+	struct LevelSizes
+	{
+		int32_t sourceWidth;
+		int32_t sourceHeight;
+		int32_t destinationWidth;
+		int32_t destinationHeight;
+	};
+
+	VkImage image;
+	VulkanAllocation imageAllocation;
+	VkImageView imageView;               // every level, sampled by the culling pass
+	std::vector<VkImageView> levelViews; // one per level, written by the build
+	VkSampler sampler;
+	VkExtent2D extent;
+	VkExtent2D sourceExtent;
+
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool;
+	std::vector<VkDescriptorSet> levelSets;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+
+	VkDevice device;
+	VulkanMemoryAllocator* allocator;
+
+	void createPipeline();
+	void createDescriptorSets(VkImageView depthView);
+};
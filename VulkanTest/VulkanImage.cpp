@@ -2,7 +2,7 @@
 
 void VulkanImage::createImage(
 	VkDevice device, 
-	VkPhysicalDevice physicalDevice, 
+	VulkanMemoryAllocator& allocator, 
 	uint32_t width, uint32_t height, 
 	uint32_t mipLevels,
 	uint32_t arrayLayers,
@@ -11,7 +11,7 @@ void VulkanImage::createImage(
 	VkImageUsageFlags usage,
 	VkMemoryPropertyFlags properties,
 	VkImage& image,
-	VkDeviceMemory& imageMemory,
+	VulkanAllocation& imageAllocation,
 	VkImageCreateFlags flags)
 {
 	VkImageCreateInfo imageInfo{};
@@ -37,16 +37,23 @@ void VulkanImage::createImage(
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+	VulkanResourceKind kind = (tiling == VK_IMAGE_TILING_LINEAR) ? VulkanResourceKind::BUFFER : VulkanResourceKind::IMAGE;
+	imageAllocation = allocator.allocate(memRequirements, properties, kind);
 
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate image memory!");
-	}
+	vkBindImageMemory(device, image, imageAllocation.memory, imageAllocation.offset);
+}
 
-	vkBindImageMemory(device, image, imageMemory, 0);
+void VulkanImage::destroyImage(VkDevice device, VulkanMemoryAllocator& allocator, VkImage& image, VulkanAllocation& imageAllocation)
+{
+	if (image != VK_NULL_HANDLE)
+	{
+		vkDestroyImage(device, image, nullptr);
+		image = VK_NULL_HANDLE;
+	}
+	if (imageAllocation.isValid())
+	{
+		allocator.free(imageAllocation);
+	}
 }
 
 VkImageView VulkanImage::createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
@@ -76,23 +83,23 @@ VkImageView VulkanImage::createImageView(VkDevice device, VkImage image, VkForma
 
 void VulkanImage::createCubeMapImage(
 	VkDevice device, 
-	VkPhysicalDevice physicalDevice, 
+	VulkanMemoryAllocator& allocator, 
 	uint32_t width, 
 	uint32_t height, 
 	uint32_t mipLevels,
 	VkImage& image, 
-	VkDeviceMemory& imageMemory)
+	VulkanAllocation& imageAllocation)
 {
 
 	createImage(
-		device, physicalDevice,
+		device, allocator,
 		width, height,
 		mipLevels, 6,
 		VK_FORMAT_R32G32B32A32_SFLOAT,
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		image, imageMemory,
+		image, imageAllocation,
 		VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT
 	);
 }
@@ -345,21 +352,6 @@ void VulkanImage::copyBufferToImage(VkDevice vkdevice, VkCommandPool commandPool
 	VulkanCommandBuffers::endSingleTimeCommands(commandBuffer, vkdevice, graphicsQueue, commandPool);
 }
 
-uint32_t VulkanImage::findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
-{
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-	{
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-		{
-			return i;
-		}
-	}
-	throw std::runtime_error("failed to find suitable memory type!");
-}
-
 bool VulkanImage::hasStencilComponent(VkFormat format)
 {
 	return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "VulkanCommandBuffers.h"
+#include "VulkanMemoryAllocator.h"
 
 //void createImage(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
 
@@ -16,7 +17,7 @@ class VulkanImage
 public:
 	static void createImage(
 		VkDevice device, 
-		VkPhysicalDevice physicalDevice, 
+		VulkanMemoryAllocator& allocator, 
 		uint32_t width, uint32_t height, 
 		uint32_t mipLevels,
 		uint32_t arrayLayers,
@@ -25,20 +26,22 @@ public:
 		VkImageUsageFlags usage,
 		VkMemoryPropertyFlags properties, 
 		VkImage& image, 
-		VkDeviceMemory& imageMemory,
+		VulkanAllocation& imageAllocation,
 		VkImageCreateFlags flags = 0
 	);
 
+	static void destroyImage(VkDevice device, VulkanMemoryAllocator& allocator, VkImage& image, VulkanAllocation& imageAllocation);
+
 	static VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
 
 	static void createCubeMapImage(
 		VkDevice device,
-		VkPhysicalDevice physicalDevice,
+		VulkanMemoryAllocator& allocator,
 		uint32_t width, 
 		uint32_t height,
 		uint32_t mipLevels,
 		VkImage& image,
-		VkDeviceMemory& imageMemory
+		VulkanAllocation& imageAllocation
 	);
 
 	static VkImageView createCubeMapView(VkDevice device, VkImage image, uint32_t mipLevel);
@@ -72,8 +75,6 @@ public:
 	static void copyBufferToImage(VkDevice vkdevice, VkCommandPool commandPool, VkQueue graphicsQueue, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 
 private:
-	static uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
-
 	static bool hasStencilComponent(VkFormat format);
 };
 
@@ -1,6 +1,6 @@
 #include "VulkanIndexBuffer.h"
 
-VulkanIndexBuffer::VulkanIndexBuffer() : device(VK_NULL_HANDLE), indexBuffer(VK_NULL_HANDLE), indexBufferMemory(VK_NULL_HANDLE)
+VulkanIndexBuffer::VulkanIndexBuffer() : device(VK_NULL_HANDLE), allocator(nullptr), indexBuffer(VK_NULL_HANDLE)
 {
 
 }
@@ -10,37 +10,36 @@ VulkanIndexBuffer::~VulkanIndexBuffer()
 	destroy();
 }
 
-void VulkanIndexBuffer::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, const std::vector<uint32_t>& indices)
+void VulkanIndexBuffer::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, const std::vector<uint32_t>& indices)
 {
 	device = vkdevice;
+	allocator = &memoryAllocator;
 
 	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	VulkanAllocation stagingBufferAllocation;
 
 	VulkanBuffer::createBuffer(
 		device,
-		vkphysdevice,
+		*allocator,
 		bufferSize,
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer, stagingBufferMemory
+		stagingBuffer, stagingBufferAllocation
 	);
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+	void* data = stagingBufferAllocation.mappedData;
 	memcpy(data, indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
 
 	VulkanBuffer::createBuffer(
 		device,
-		vkphysdevice,
+		*allocator,
 		bufferSize,
 		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		indexBuffer,
-		indexBufferMemory
+		indexBufferAllocation
 	);
 
 	VulkanBuffer::copyBuffer(
@@ -52,22 +51,16 @@ void VulkanIndexBuffer::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice,
 		bufferSize
 	);
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	VulkanBuffer::destroyBuffer(device, *allocator, stagingBuffer, stagingBufferAllocation);
 }
 
 void VulkanIndexBuffer::destroy()
 {
-	if (indexBuffer != VK_NULL_HANDLE)
+	if (device == VK_NULL_HANDLE)
 	{
-		vkDestroyBuffer(device, indexBuffer, nullptr);
-		indexBuffer = VK_NULL_HANDLE;
-	}
-	if (indexBufferMemory != VK_NULL_HANDLE)
-	{
-		vkFreeMemory(device, indexBufferMemory, nullptr);
-		indexBufferMemory = VK_NULL_HANDLE;
+		return;
 	}
+	VulkanBuffer::destroyBuffer(device, *allocator, indexBuffer, indexBufferAllocation);
 }
 
 VkBuffer VulkanIndexBuffer::getVkBuffer() const
@@ -11,14 +11,15 @@ public:
 	VulkanIndexBuffer();
 	~VulkanIndexBuffer();
 
-	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, const std::vector<uint32_t>& indices);
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, const std::vector<uint32_t>& indices);
 	void destroy();
 
 	VkBuffer getVkBuffer() const;
 private:
 	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
+	VulkanAllocation indexBufferAllocation;
 
 	VkDevice device;
+	VulkanMemoryAllocator* allocator;
 };
 
@@ -0,0 +1,369 @@
+#include "VulkanMemoryAllocator.h"
+
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+
+
+VulkanMemoryAllocator::VulkanMemoryAllocator()
+	: device(VK_NULL_HANDLE), memoryProperties{}, maxMemoryAllocationCount(0), reBarAvailable(false),
+	dedicatedAllocationCount(0), dedicatedBytes(0)
+{
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+	destroy();
+}
+
+void VulkanMemoryAllocator::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice)
+{
+	device = vkdevice;
+
+	vkGetPhysicalDeviceMemoryProperties(vkphysdevice, &memoryProperties);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(vkphysdevice, &deviceProperties);
+	maxMemoryAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+
+	const VkMemoryPropertyFlags reBarFlags =
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	reBarAvailable = false;
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		const VkMemoryType& type = memoryProperties.memoryTypes[i];
+		if ((type.propertyFlags & reBarFlags) == reBarFlags &&
+			memoryProperties.memoryHeaps[type.heapIndex].size > REBAR_MIN_HEAP_SIZE)
+		{
+			reBarAvailable = true;
+			break;
+		}
+	}
+
+	for (auto& kindPools : pools)
+	{
+		kindPools.clear();
+		kindPools.resize(memoryProperties.memoryTypeCount);
+	}
+
+	std::cout << "Memory allocator: resizable BAR " << (reBarAvailable ? "available" : "not available") << std::endl;
+}
+
+void VulkanMemoryAllocator::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+	for (auto& kindPools : pools)
+	{
+		for (auto& pool : kindPools)
+		{
+			for (auto& block : pool.blocks)
+			{
+				if (block->allocationCount > 0)
+				{
+					std::cerr << "Warning: memory block destroyed with " << block->allocationCount << " live allocation(s)." << std::endl;
+				}
+				freeDeviceMemory(block->memory, block->mappedData != nullptr);
+			}
+			pool.blocks.clear();
+		}
+		kindPools.clear();
+	}
+	if (dedicatedAllocationCount > 0)
+	{
+		std::cerr << "Warning: " << dedicatedAllocationCount << " dedicated allocation(s) still alive at allocator shutdown." << std::endl;
+	}
+
+	device = VK_NULL_HANDLE;
+}
+
+VulkanAllocation VulkanMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, VulkanResourceKind kind)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Allocate called before initialization!");
+	}
+
+	uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+	VkDeviceSize blockSize = preferredBlockSize(memoryTypeIndex);
+
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+
+	VulkanAllocation allocation{};
+	allocation.memoryTypeIndex = memoryTypeIndex;
+	allocation.size = requirements.size;
+
+	// large resources (render targets, cubemaps) get their own VkDeviceMemory
+	if (requirements.size > blockSize / 2)
+	{
+		allocation.memory = allocateDeviceMemory(requirements.size, memoryTypeIndex, &allocation.mappedData);
+		allocation.offset = 0;
+		allocation.block = nullptr;
+		dedicatedAllocationCount++;
+		dedicatedBytes += requirements.size;
+		return allocation;
+	}
+
+	MemoryPool& pool = pools[static_cast<size_t>(kind)][memoryTypeIndex];
+
+	VkDeviceSize offset = 0;
+	for (auto& block : pool.blocks)
+	{
+		if (block->size - block->usedBytes < requirements.size) continue;
+		if (allocateFromBlock(*block, requirements.size, requirements.alignment, offset))
+		{
+			allocation.memory = block->memory;
+			allocation.offset = offset;
+			allocation.block = block.get();
+			allocation.mappedData = block->mappedData ? static_cast<char*>(block->mappedData) + offset : nullptr;
+			return allocation;
+		}
+	}
+
+	// no room in the existing blocks, open a new one
+	auto block = std::make_unique<VulkanMemoryBlock>();
+	block->memory = allocateDeviceMemory(blockSize, memoryTypeIndex, &block->mappedData);
+	block->size = blockSize;
+	block->memoryTypeIndex = memoryTypeIndex;
+	block->kind = kind;
+	block->freeRanges.emplace(0, blockSize);
+
+	if (!allocateFromBlock(*block, requirements.size, requirements.alignment, offset))
+	{
+		freeDeviceMemory(block->memory, block->mappedData != nullptr);
+		throw std::runtime_error("failed to sub-allocate from a new memory block!");
+	}
+
+	allocation.memory = block->memory;
+	allocation.offset = offset;
+	allocation.block = block.get();
+	allocation.mappedData = block->mappedData ? static_cast<char*>(block->mappedData) + offset : nullptr;
+	pool.blocks.push_back(std::move(block));
+	return allocation;
+}
+
+void VulkanMemoryAllocator::free(VulkanAllocation& allocation)
+{
+	if (!allocation.isValid() || device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+
+	if (allocation.block == nullptr)
+	{
+		freeDeviceMemory(allocation.memory, allocation.mappedData != nullptr);
+		dedicatedAllocationCount--;
+		dedicatedBytes -= allocation.size;
+	}
+	else
+	{
+		VulkanMemoryBlock* block = allocation.block;
+		freeToBlock(*block, allocation.offset, allocation.size);
+
+		// keep one empty block around per pool so load / unload cycles don't thrash vkAllocateMemory
+		if (block->allocationCount == 0)
+		{
+			MemoryPool& pool = pools[static_cast<size_t>(block->kind)][block->memoryTypeIndex];
+			size_t emptyBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+				[](const std::unique_ptr<VulkanMemoryBlock>& b) { return b->allocationCount == 0; });
+			if (emptyBlocks > 1)
+			{
+				auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+					[block](const std::unique_ptr<VulkanMemoryBlock>& b) { return b.get() == block; });
+				freeDeviceMemory(block->memory, block->mappedData != nullptr);
+				pool.blocks.erase(it);
+			}
+		}
+	}
+
+	allocation = VulkanAllocation{};
+}
+
+VkMemoryPropertyFlags VulkanMemoryAllocator::getDirectWriteMemoryProperties() const
+{
+	if (reBarAvailable)
+	{
+		return VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	}
+	return VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+VulkanAllocatorStats VulkanMemoryAllocator::getStats() const
+{
+	std::lock_guard<std::mutex> lock(allocatorMutex);
+
+	VulkanAllocatorStats stats{};
+	for (const auto& kindPools : pools)
+	{
+		for (const auto& pool : kindPools)
+		{
+			for (const auto& block : pool.blocks)
+			{
+				stats.blockCount++;
+				stats.blockBytes += block->size;
+				stats.usedBytes += block->usedBytes;
+				stats.allocationCount += block->allocationCount;
+			}
+		}
+	}
+	stats.dedicatedAllocationCount = dedicatedAllocationCount;
+	stats.dedicatedBytes = dedicatedBytes;
+	stats.allocationCount += dedicatedAllocationCount;
+	stats.deviceMemoryObjectCount = stats.blockCount + dedicatedAllocationCount;
+	return stats;
+}
+
+void VulkanMemoryAllocator::printStats() const
+{
+	VulkanAllocatorStats stats = getStats();
+	const double MiB = 1024.0 * 1024.0;
+
+	std::cout << "--- GPU memory ---" << std::endl;
+	std::cout << "  allocations:        " << stats.allocationCount << std::endl;
+	std::cout << "  blocks:             " << stats.blockCount << " (" << stats.blockBytes / MiB << " MiB reserved, "
+		<< stats.usedBytes / MiB << " MiB used)" << std::endl;
+	std::cout << "  dedicated:          " << stats.dedicatedAllocationCount << " (" << stats.dedicatedBytes / MiB << " MiB)" << std::endl;
+	std::cout << "  vkDeviceMemory:     " << stats.deviceMemoryObjectCount << " / " << maxMemoryAllocationCount << std::endl;
+}
+
+uint32_t VulkanMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VkDeviceSize VulkanMemoryAllocator::preferredBlockSize(uint32_t memoryTypeIndex) const
+{
+	// small heaps (integrated GPUs, the 256MB BAR window) get proportionally smaller blocks
+	VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+	if (heapSize <= 1024ull * 1024 * 1024)
+	{
+		return std::max<VkDeviceSize>(heapSize / 8, 4ull * 1024 * 1024);
+	}
+	return DEFAULT_BLOCK_SIZE;
+}
+
+VkDeviceMemory VulkanMemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData)
+{
+	if (maxMemoryAllocationCount != 0 && deviceMemoryObjectCount() >= maxMemoryAllocationCount)
+	{
+		throw std::runtime_error("failed to allocate device memory, maxMemoryAllocationCount reached!");
+	}
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate device memory!");
+	}
+
+	*mappedData = nullptr;
+	if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		// host visible memory stays mapped for its whole lifetime, sub-allocations just offset into it
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mappedData) != VK_SUCCESS)
+		{
+			vkFreeMemory(device, memory, nullptr);
+			throw std::runtime_error("failed to map device memory!");
+		}
+	}
+	return memory;
+}
+
+void VulkanMemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, bool mapped)
+{
+	if (mapped)
+	{
+		vkUnmapMemory(device, memory);
+	}
+	vkFreeMemory(device, memory, nullptr);
+}
+
+uint32_t VulkanMemoryAllocator::deviceMemoryObjectCount() const
+{
+	uint32_t count = dedicatedAllocationCount;
+	for (const auto& kindPools : pools)
+	{
+		for (const auto& pool : kindPools)
+		{
+			count += static_cast<uint32_t>(pool.blocks.size());
+		}
+	}
+	return count;
+}
+
+bool VulkanMemoryAllocator::allocateFromBlock(VulkanMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset)
+{
+	if (alignment == 0) alignment = 1;
+
+	// first fit over the address ordered free list
+	for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it)
+	{
+		VkDeviceSize rangeOffset = it->first;
+		VkDeviceSize rangeSize = it->second;
+
+		VkDeviceSize alignedOffset = (rangeOffset + alignment - 1) / alignment * alignment;
+		VkDeviceSize padding = alignedOffset - rangeOffset;
+		if (padding + size > rangeSize) continue;
+
+		block.freeRanges.erase(it);
+		if (padding > 0)
+		{
+			block.freeRanges.emplace(rangeOffset, padding);
+		}
+		VkDeviceSize tail = rangeSize - padding - size;
+		if (tail > 0)
+		{
+			block.freeRanges.emplace(alignedOffset + size, tail);
+		}
+
+		block.allocationCount++;
+		block.usedBytes += size;
+		outOffset = alignedOffset;
+		return true;
+	}
+	return false;
+}
+
+void VulkanMemoryAllocator::freeToBlock(VulkanMemoryBlock& block, VkDeviceSize offset, VkDeviceSize size)
+{
+	auto inserted = block.freeRanges.emplace(offset, size).first;
+
+	// merge with the following range
+	auto next = std::next(inserted);
+	if (next != block.freeRanges.end() && inserted->first + inserted->second == next->first)
+	{
+		inserted->second += next->second;
+		block.freeRanges.erase(next);
+	}
+
+	// merge with the preceding range
+	if (inserted != block.freeRanges.begin())
+	{
+		auto prev = std::prev(inserted);
+		if (prev->first + prev->second == inserted->first)
+		{
+			prev->second += inserted->second;
+			block.freeRanges.erase(inserted);
+		}
+	}
+
+	block.allocationCount--;
+	block.usedBytes -= size;
+}
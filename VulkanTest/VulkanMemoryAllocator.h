@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+// Buffers (linear) and optimal tiling images are kept in separate blocks so neighbouring
+// sub-allocations never violate bufferImageGranularity.
+enum class VulkanResourceKind : uint8_t
+{
+	BUFFER,
+	IMAGE
+};
+
+struct VulkanMemoryBlock;
+
+// A slice of a larger VkDeviceMemory block (or a dedicated allocation for big resources).
+// Bind with memory + offset; host visible allocations are persistently mapped.
+struct VulkanAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mappedData = nullptr;
+
+	uint32_t memoryTypeIndex = 0;
+	VulkanMemoryBlock* block = nullptr; // nullptr for dedicated allocations
+
+	bool isValid() const { return memory != VK_NULL_HANDLE; }
+};
+
+struct VulkanMemoryBlock
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	void* mappedData = nullptr;
+	uint32_t memoryTypeIndex = 0;
+	VulkanResourceKind kind = VulkanResourceKind::BUFFER;
+
+	std::map<VkDeviceSize, VkDeviceSize> freeRanges; // offset -> size, kept coalesced
+	uint32_t allocationCount = 0;
+	VkDeviceSize usedBytes = 0;
+};
+
+struct VulkanAllocatorStats
+{
+	uint32_t blockCount = 0;
+	uint32_t dedicatedAllocationCount = 0;
+	uint32_t allocationCount = 0;
+	VkDeviceSize blockBytes = 0;      // reserved in blocks
+	VkDeviceSize usedBytes = 0;       // handed out from blocks
+	VkDeviceSize dedicatedBytes = 0;
+	uint32_t deviceMemoryObjectCount = 0; // against maxMemoryAllocationCount
+};
+
+// Sub-allocates resources out of large per memory type blocks instead of one
+// vkAllocateMemory per buffer / image. It is handed to everything that creates buffers or
+// images like the device is, so create() it right after the logical device and destroy() it last.
+class VulkanMemoryAllocator
+{
+public:
+	VulkanMemoryAllocator();
+	~VulkanMemoryAllocator();
+
+	VulkanMemoryAllocator(const VulkanMemoryAllocator&) = delete;
+	VulkanMemoryAllocator& operator=(const VulkanMemoryAllocator&) = delete;
+
+	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice);
+	void destroy();
+
+	VulkanAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, VulkanResourceKind kind);
+	void free(VulkanAllocation& allocation);
+
+	// true when a large DEVICE_LOCAL | HOST_VISIBLE heap exists (resizable BAR / SAM),
+	// so per-frame data can be written straight into VRAM without a staging copy
+	bool isReBarAvailable() const { return reBarAvailable; }
+	VkMemoryPropertyFlags getDirectWriteMemoryProperties() const;
+
+	VulkanAllocatorStats getStats() const;
+	void printStats() const;
+
+private:
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+	static constexpr VkDeviceSize REBAR_MIN_HEAP_SIZE = 256ull * 1024 * 1024; // the legacy BAR window
+
+	struct MemoryPool
+	{
+		std::vector<std::unique_ptr<VulkanMemoryBlock>> blocks;
+	};
+
+	VkDevice device;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	uint32_t maxMemoryAllocationCount;
+	bool reBarAvailable;
+
+	// [kind][memoryTypeIndex]
+	std::vector<MemoryPool> pools[2];
+	uint32_t dedicatedAllocationCount;
+	VkDeviceSize dedicatedBytes;
+
+	mutable std::mutex allocatorMutex;
+
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	VkDeviceSize preferredBlockSize(uint32_t memoryTypeIndex) const;
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData);
+	void freeDeviceMemory(VkDeviceMemory memory, bool mapped);
+	uint32_t deviceMemoryObjectCount() const;
+
+	static bool allocateFromBlock(VulkanMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset);
+	static void freeToBlock(VulkanMemoryBlock& block, VkDeviceSize offset, VkDeviceSize size);
+};
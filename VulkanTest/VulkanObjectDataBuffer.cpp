@@ -0,0 +1,390 @@
+#include "VulkanObjectDataBuffer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+
+VulkanObjectDataBuffer::VulkanObjectDataBuffer()
+	: staticBuffer(VK_NULL_HANDLE), staticCapacity(0), staticDirtyBegin(0), staticDirtyEnd(0),
+	dynamicCapacity(0), allFramesMask(0), descriptorGeneration(0), descriptorPool(VK_NULL_HANDLE), descriptorSetLayout(VK_NULL_HANDLE),
+	device(VK_NULL_HANDLE), allocator(nullptr), queue(VK_NULL_HANDLE), pool(VK_NULL_HANDLE)
+{
+}
+
+VulkanObjectDataBuffer::~VulkanObjectDataBuffer()
+{
+	destroy();
+}
+
+void VulkanObjectDataBuffer::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+	uint32_t numFrames, VkDescriptorSetLayout setLayout,
+	uint32_t initialStaticCapacity, uint32_t initialDynamicCapacity)
+{
+	device = vkdevice;
+	allocator = &memoryAllocator;
+	queue = graphicsQueue;
+	pool = commandPool;
+	descriptorSetLayout = setLayout;
+
+	if (numFrames == 0 || numFrames > 32)
+	{
+		throw std::runtime_error("Object data buffer supports 1 to 32 frames in flight!");
+	}
+	allFramesMask = numFrames == 32 ? ~0u : (1u << numFrames) - 1;
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 2 * numFrames;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = numFrames;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create object data descriptor pool!");
+	}
+
+	frameCopies.resize(numFrames);
+	std::vector<VkDescriptorSetLayout> layouts(numFrames, descriptorSetLayout);
+	std::vector<VkDescriptorSet> sets(numFrames);
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = numFrames;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate object data descriptor sets!");
+	}
+	for (uint32_t i = 0; i < numFrames; i++)
+	{
+		frameCopies[i].descriptorSet = sets[i];
+	}
+
+	createStaticBuffer(std::max(initialStaticCapacity, 1u));
+	createFrameCopies(std::max(initialDynamicCapacity, 1u));
+	writeDescriptorSets();
+}
+
+void VulkanObjectDataBuffer::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	VulkanBuffer::destroyBuffer(device, *allocator, staticBuffer, staticAllocation);
+	for (FrameCopy& copy : frameCopies)
+	{
+		VulkanBuffer::destroyBuffer(device, *allocator, copy.buffer, copy.allocation);
+	}
+	frameCopies.clear();
+
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		descriptorPool = VK_NULL_HANDLE;
+	}
+
+	staticObjects.clear();
+	dynamicObjects.clear();
+	staleFrameMasks.clear();
+	dirtyObjects.clear();
+	staticCapacity = 0;
+	dynamicCapacity = 0;
+	staticDirtyBegin = staticDirtyEnd = 0;
+	device = VK_NULL_HANDLE;
+}
+
+uint32_t VulkanObjectDataBuffer::addObject(const glm::mat4& model, const glm::mat3x4& normalMatrix, bool isStatic)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Object data buffer add object called before initialization!");
+	}
+
+	ObjectUniformBufferObject object{};
+	object.model = model;
+	object.normalMatrix = normalMatrix;
+
+	if (isStatic)
+	{
+		uint32_t index = static_cast<uint32_t>(staticObjects.size());
+		staticObjects.push_back(object);
+		if (staticDirtyBegin == staticDirtyEnd)
+		{
+			staticDirtyBegin = index;
+		}
+		staticDirtyEnd = index + 1; // uploaded with the next update
+		return index;
+	}
+
+	uint32_t index = static_cast<uint32_t>(dynamicObjects.size());
+	if (index >= DYNAMIC_OBJECT_BIT)
+	{
+		throw std::runtime_error("Object data buffer ran out of dynamic object ids!");
+	}
+	dynamicObjects.push_back(object);
+	staleFrameMasks.push_back(0);
+
+	if (dynamicObjects.size() > dynamicCapacity)
+	{
+		// the frame copies are rebuilt from the CPU copy, so nothing is left stale
+		createFrameCopies(std::max(dynamicCapacity * 2, static_cast<uint32_t>(dynamicObjects.size())));
+		writeDescriptorSets();
+	}
+	else
+	{
+		markDynamicDirty(index);
+	}
+	return index | DYNAMIC_OBJECT_BIT;
+}
+
+void VulkanObjectDataBuffer::setTransform(uint32_t objectId, const glm::mat4& model, const glm::mat3x4& normalMatrix)
+{
+	if (isDynamicObject(objectId))
+	{
+		uint32_t index = objectId & ~DYNAMIC_OBJECT_BIT;
+		if (index >= dynamicObjects.size())
+		{
+			throw std::runtime_error("Object data buffer set transform: invalid object id");
+		}
+		dynamicObjects[index].model = model;
+		dynamicObjects[index].normalMatrix = normalMatrix;
+		markDynamicDirty(index);
+		return;
+	}
+
+	if (objectId >= staticObjects.size())
+	{
+		throw std::runtime_error("Object data buffer set transform: invalid object id");
+	}
+	staticObjects[objectId].model = model;
+	staticObjects[objectId].normalMatrix = normalMatrix;
+	if (staticDirtyBegin == staticDirtyEnd)
+	{
+		staticDirtyBegin = objectId;
+		staticDirtyEnd = objectId + 1;
+	}
+	else
+	{
+		staticDirtyBegin = std::min(staticDirtyBegin, objectId);
+		staticDirtyEnd = std::max(staticDirtyEnd, objectId + 1);
+	}
+}
+
+void VulkanObjectDataBuffer::update(uint32_t frameIndex)
+{
+	if (frameIndex >= frameCopies.size())
+	{
+		throw std::runtime_error("Object data buffer update: invalid frame index");
+	}
+
+	if (staticDirtyBegin != staticDirtyEnd)
+	{
+		if (staticObjects.size() > staticCapacity)
+		{
+			// every frame reads the static buffer, so it can only be replaced once all of them are done
+			vkDeviceWaitIdle(device);
+			createStaticBuffer(std::max(staticCapacity * 2, static_cast<uint32_t>(staticObjects.size())));
+			writeDescriptorSets();
+			staticDirtyBegin = 0;
+			staticDirtyEnd = static_cast<uint32_t>(staticObjects.size());
+		}
+		uploadStaticRange(staticDirtyBegin, staticDirtyEnd);
+		staticDirtyBegin = staticDirtyEnd = 0;
+	}
+
+	if (dirtyObjects.empty())
+	{
+		return;
+	}
+
+	// copy the objects this frame has not seen yet, merged into contiguous runs
+	const uint32_t frameBit = 1u << frameIndex;
+	std::vector<uint32_t> pending;
+	pending.reserve(dirtyObjects.size());
+	size_t keep = 0;
+	for (uint32_t index : dirtyObjects)
+	{
+		if (staleFrameMasks[index] & frameBit)
+		{
+			pending.push_back(index);
+			staleFrameMasks[index] &= ~frameBit;
+		}
+		if (staleFrameMasks[index] != 0)
+		{
+			dirtyObjects[keep++] = index;
+		}
+	}
+	dirtyObjects.resize(keep);
+
+	std::sort(pending.begin(), pending.end());
+	char* mapped = static_cast<char*>(frameCopies[frameIndex].allocation.mappedData);
+	const size_t stride = sizeof(ObjectUniformBufferObject);
+	size_t runStart = 0;
+	for (size_t i = 1; i <= pending.size(); i++)
+	{
+		if (i == pending.size() || pending[i] != pending[i - 1] + 1)
+		{
+			uint32_t first = pending[runStart];
+			size_t count = i - runStart;
+			memcpy(mapped + first * stride, &dynamicObjects[first], count * stride);
+			runStart = i;
+		}
+	}
+}
+
+VkDescriptorSet VulkanObjectDataBuffer::getDescriptorSet(uint32_t frameIndex) const
+{
+	if (frameIndex >= frameCopies.size())
+	{
+		throw std::runtime_error("Get object data descriptor set: invalid frame index");
+	}
+	return frameCopies[frameIndex].descriptorSet;
+}
+
+void VulkanObjectDataBuffer::createStaticBuffer(uint32_t capacity)
+{
+	VulkanBuffer::destroyBuffer(device, *allocator, staticBuffer, staticAllocation);
+
+	VulkanBuffer::createBuffer(
+		device,
+		*allocator,
+		sizeof(ObjectUniformBufferObject) * capacity,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		staticBuffer, staticAllocation
+	);
+	staticCapacity = capacity;
+}
+
+void VulkanObjectDataBuffer::createFrameCopies(uint32_t capacity)
+{
+	bool replacing = frameCopies.front().buffer != VK_NULL_HANDLE;
+	if (replacing)
+	{
+		std::cout << "Growing dynamic object buffers from " << dynamicCapacity << " to " << capacity << " objects" << std::endl;
+		vkDeviceWaitIdle(device); // in flight frames still read the old copies
+	}
+
+	// written by the CPU every frame: lands directly in VRAM when resizable BAR is exposed
+	VkMemoryPropertyFlags memoryProperties = allocator->getDirectWriteMemoryProperties();
+	for (FrameCopy& copy : frameCopies)
+	{
+		VulkanBuffer::destroyBuffer(device, *allocator, copy.buffer, copy.allocation);
+		VulkanBuffer::createBuffer(
+			device,
+			*allocator,
+			sizeof(ObjectUniformBufferObject) * capacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			memoryProperties,
+			copy.buffer, copy.allocation
+		);
+		if (!dynamicObjects.empty())
+		{
+			memcpy(copy.allocation.mappedData, dynamicObjects.data(), sizeof(ObjectUniformBufferObject) * dynamicObjects.size());
+		}
+	}
+	dynamicCapacity = capacity;
+
+	std::fill(staleFrameMasks.begin(), staleFrameMasks.end(), 0u);
+	dirtyObjects.clear();
+}
+
+void VulkanObjectDataBuffer::uploadStaticRange(uint32_t begin, uint32_t end)
+{
+	const VkDeviceSize stride = sizeof(ObjectUniformBufferObject);
+	VkDeviceSize size = stride * (end - begin);
+
+	VkBuffer stagingBuffer;
+	VulkanAllocation stagingBufferAllocation;
+	VulkanBuffer::createBuffer(
+		device,
+		*allocator,
+		size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer, stagingBufferAllocation
+	);
+	memcpy(stagingBufferAllocation.mappedData, &staticObjects[begin], static_cast<size_t>(size));
+
+	VkCommandBuffer commandBuffer = VulkanCommandBuffers::beginSingleTimeCommands(device, pool);
+
+	// earlier frames may still be reading the static buffer
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = 0;
+	copyRegion.dstOffset = stride * begin;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, staticBuffer, 1, &copyRegion);
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = staticBuffer;
+	barrier.offset = copyRegion.dstOffset;
+	barrier.size = size;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+	VulkanCommandBuffers::endSingleTimeCommands(commandBuffer, device, queue, pool);
+
+	VulkanBuffer::destroyBuffer(device, *allocator, stagingBuffer, stagingBufferAllocation);
+}
+
+void VulkanObjectDataBuffer::writeDescriptorSets()
+{
+	for (FrameCopy& copy : frameCopies)
+	{
+		VkDescriptorBufferInfo staticInfo{};
+		staticInfo.buffer = staticBuffer;
+		staticInfo.offset = 0;
+		staticInfo.range = VK_WHOLE_SIZE;
+
+		VkDescriptorBufferInfo dynamicInfo{};
+		dynamicInfo.buffer = copy.buffer;
+		dynamicInfo.offset = 0;
+		dynamicInfo.range = VK_WHOLE_SIZE;
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = copy.descriptorSet;
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].dstArrayElement = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pBufferInfo = &staticInfo;
+
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = copy.descriptorSet;
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].dstArrayElement = 0;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pBufferInfo = &dynamicInfo;
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+	descriptorGeneration++;
+}
+
+void VulkanObjectDataBuffer::markDynamicDirty(uint32_t index)
+{
+	if (staleFrameMasks[index] == 0)
+	{
+		dirtyObjects.push_back(index);
+	}
+	staleFrameMasks[index] = allFramesMask; // every frame copy is now out of date
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "VulkanBuffer.h"
+#include "VulkanUniformBuffers.h"
+
+// Per-object data for the whole scene, split by how often it changes.
+// Static objects live in one device local buffer that is uploaded once; dynamic objects keep
+// a CPU copy plus one host visible buffer per frame in flight, and each frame only the
+// objects changed since that frame's copy was last written are copied (in contiguous runs).
+// Object ids are drawn as firstInstance; dynamic ids carry DYNAMIC_OBJECT_BIT.
+class VulkanObjectDataBuffer
+{
+public:
+	static constexpr uint32_t DYNAMIC_OBJECT_BIT = 0x80000000u;
+
+	VulkanObjectDataBuffer();
+	~VulkanObjectDataBuffer();
+
+	VulkanObjectDataBuffer(const VulkanObjectDataBuffer&) = delete;
+	VulkanObjectDataBuffer& operator=(const VulkanObjectDataBuffer&) = delete;
+
+	// setLayout is VulkanDescriptorSetLayout::createForObjectData
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool,
+		uint32_t numFrames, VkDescriptorSetLayout setLayout,
+		uint32_t initialStaticCapacity, uint32_t initialDynamicCapacity);
+	void destroy();
+
+	// normalMatrix comes precomputed from the TransformSystem, shaders do not invert per vertex
+	uint32_t addObject(const glm::mat4& model, const glm::mat3x4& normalMatrix, bool isStatic);
+	// cheap for dynamic objects; static ones are re-uploaded (with a queue wait) on the next update
+	void setTransform(uint32_t objectId, const glm::mat4& model, const glm::mat3x4& normalMatrix);
+
+	// call once the frame's fence has signalled, before recording it
+	void update(uint32_t frameIndex);
+
+	VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const;
+
+	uint32_t getStaticObjectCount() const { return static_cast<uint32_t>(staticObjects.size()); }
+	uint32_t getDynamicObjectCount() const { return static_cast<uint32_t>(dynamicObjects.size()); }
+	static bool isDynamicObject(uint32_t objectId) { return (objectId & DYNAMIC_OBJECT_BIT) != 0; }
+
+	// bumped whenever the sets are rewritten, command buffers recorded with the old ones are invalid
+	uint32_t getDescriptorGeneration() const { return descriptorGeneration; }
+
+private:
+	struct FrameCopy
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VulkanAllocation allocation;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+
+	// static objects
+	std::vector<ObjectUniformBufferObject> staticObjects;
+	VkBuffer staticBuffer;
+	VulkanAllocation staticAllocation;
+	uint32_t staticCapacity;
+	uint32_t staticDirtyBegin; // pending upload range, begin == end when clean
+	uint32_t staticDirtyEnd;
+
+	// dynamic objects
+	std::vector<ObjectUniformBufferObject> dynamicObjects;
+	std::vector<uint32_t> staleFrameMasks; // bit n set: frame n still holds an old copy
+	std::vector<uint32_t> dirtyObjects;    // every dynamic object with a non zero mask
+	std::vector<FrameCopy> frameCopies;
+	uint32_t dynamicCapacity;
+	uint32_t allFramesMask;
+	uint32_t descriptorGeneration;
+
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSetLayout descriptorSetLayout;
+
+	VkDevice device;
+	VulkanMemoryAllocator* allocator;
+	VkQueue queue;
+	VkCommandPool pool;
+
+	void createStaticBuffer(uint32_t capacity);
+	void createFrameCopies(uint32_t capacity);
+	void uploadStaticRange(uint32_t begin, uint32_t end);
+	void writeDescriptorSets();
+	void markDynamicDirty(uint32_t index);
+};
@@ -0,0 +1,227 @@
+#include "VulkanParallelCommandRecorder.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <string>
+
+VulkanParallelCommandRecorder::VulkanParallelCommandRecorder()
+	: workerCount(0), lastChunkCount(0), job(nullptr), jobChunkCount(0), jobGeneration(0), pendingChunks(0),
+	stopping(false), device(VK_NULL_HANDLE)
+{
+}
+
+VulkanParallelCommandRecorder::~VulkanParallelCommandRecorder()
+{
+	destroy();
+}
+
+void VulkanParallelCommandRecorder::create(VkDevice vkdevice, uint32_t queueFamilyIndex, uint32_t numFrames)
+{
+	device = vkdevice;
+	workerCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_WORKERS);
+
+	frames.resize(numFrames);
+	for (auto& workers : frames)
+	{
+		workers.resize(workerCount);
+		for (WorkerFrame& worker : workers)
+		{
+			// transient: the buffers are rerecorded every frame, the pool is reset as a whole
+			worker.pool = std::make_unique<VulkanCommandPool>();
+			worker.pool->create(device, queueFamilyIndex, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = worker.pool->getVkCommandPool();
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = MAX_PASSES;
+
+			if (vkAllocateCommandBuffers(device, &allocInfo, worker.secondaries) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate secondary command buffer!");
+			}
+		}
+	}
+
+	for (uint32_t chunk = 1; chunk < workerCount; chunk++)
+	{
+		threads.emplace_back(&VulkanParallelCommandRecorder::workerLoop, this, chunk);
+	}
+}
+
+void VulkanParallelCommandRecorder::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobReady.notify_all();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	threads.clear();
+	stopping = false;
+
+	// destroying a pool frees its buffers
+	for (auto& workers : frames)
+	{
+		for (WorkerFrame& worker : workers)
+		{
+			if (worker.pool) worker.pool->destroy();
+			worker.pool.reset();
+			std::fill(std::begin(worker.secondaries), std::end(worker.secondaries), VK_NULL_HANDLE);
+		}
+	}
+	frames.clear();
+	workerCount = 0;
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanParallelCommandRecorder::record(VkCommandBuffer primary, uint32_t frameIndex,
+	const VkCommandBufferInheritanceInfo& inheritance, uint32_t drawCount, const RecordChunk& recordChunk, uint32_t passCount)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Parallel command recorder record called before initialization!");
+	}
+	if (passCount == 0 || passCount > MAX_PASSES)
+	{
+		throw std::runtime_error("Parallel command recorder record: invalid pass count");
+	}
+
+	std::vector<WorkerFrame>& workers = frames[frameIndex];
+	uint32_t chunkCount = std::clamp((drawCount + MIN_DRAWS_PER_CHUNK - 1) / MIN_DRAWS_PER_CHUNK, 1u, workerCount);
+	uint32_t chunkSize = (drawCount + chunkCount - 1) / std::max(chunkCount, 1u);
+	lastChunkCount = chunkCount;
+
+	std::function<void(uint32_t)> recordWorker = [&](uint32_t chunk)
+	{
+		CPU_PROFILE_ZONE("Record Chunk");
+		WorkerFrame& worker = workers[chunk];
+		worker.pool->reset();
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritance;
+
+		uint32_t begin = std::min(chunk * chunkSize, drawCount);
+		uint32_t end = std::min(begin + chunkSize, drawCount);
+		for (uint32_t pass = 0; pass < passCount; pass++)
+		{
+			if (vkBeginCommandBuffer(worker.secondaries[pass], &beginInfo) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to begin recording secondary command buffer!");
+			}
+
+			recordChunk(worker.secondaries[pass], pass, begin, end, chunk == 0, chunk == chunkCount - 1);
+
+			if (vkEndCommandBuffer(worker.secondaries[pass]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to record secondary command buffer!");
+			}
+		}
+	};
+
+	if (chunkCount > 1)
+	{
+		{
+			std::lock_guard<std::mutex> lock(jobMutex);
+			job = &recordWorker;
+			jobChunkCount = chunkCount;
+			pendingChunks = chunkCount - 1;
+			jobError = nullptr;
+			jobGeneration++;
+		}
+		jobReady.notify_all();
+	}
+
+	// the calling thread takes the first chunk; the workers still use recordWorker, so wait for them
+	// before anything it throws leaves this frame
+	std::exception_ptr error;
+	try
+	{
+		recordWorker(0);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+	if (chunkCount > 1)
+	{
+		std::unique_lock<std::mutex> lock(jobMutex);
+		jobDone.wait(lock, [this]() { return pendingChunks == 0; });
+		job = nullptr;
+		if (!error)
+		{
+			error = jobError;
+		}
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+
+	std::vector<VkCommandBuffer> secondaries;
+	secondaries.reserve(chunkCount * passCount);
+	for (uint32_t pass = 0; pass < passCount; pass++)
+	{
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			secondaries.push_back(workers[chunk].secondaries[pass]);
+		}
+	}
+	vkCmdExecuteCommands(primary, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+}
+
+void VulkanParallelCommandRecorder::workerLoop(uint32_t chunk)
+{
+	std::string name = "Record Worker " + std::to_string(chunk);
+	CpuProfiler::setThreadName(name.c_str());
+
+	uint64_t seenGeneration = 0;
+	for (;;)
+	{
+		const std::function<void(uint32_t)>* work = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobReady.wait(lock, [&]() { return stopping || jobGeneration != seenGeneration; });
+			if (stopping)
+			{
+				return;
+			}
+			seenGeneration = jobGeneration;
+			if (chunk >= jobChunkCount)
+			{
+				continue; // a small job, this worker sits it out
+			}
+			work = job;
+		}
+
+		std::exception_ptr error;
+		try
+		{
+			(*work)(chunk);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		std::lock_guard<std::mutex> lock(jobMutex);
+		if (error && !jobError)
+		{
+			jobError = error;
+		}
+		if (--pendingChunks == 0)
+		{
+			jobDone.notify_one();
+		}
+	}
+}
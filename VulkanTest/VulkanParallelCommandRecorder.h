@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "VulkanCommandPool.h"
+
+// Records one render pass worth of draws on several threads. The draw list is split into
+// contiguous chunks, each chunk goes into a secondary command buffer allocated from that
+// worker's own pool for the frame (pools are not thread safe), and the primary runs them in
+// chunk order with vkCmdExecuteCommands, so draw order is the same as inline recording.
+// With several passes over the same draw list (a depth pre-pass, then shading) every worker
+// records one secondary per pass and all chunks of a pass run before the next pass starts.
+// The render pass has to be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+// The worker threads live as long as the recorder: record() hands them their chunks, takes chunk 0
+// itself and waits until every chunk is done.
+class VulkanParallelCommandRecorder
+{
+public:
+	static constexpr uint32_t MAX_WORKERS = 8;
+	static constexpr uint32_t MIN_DRAWS_PER_CHUNK = 256; // fewer than this is not worth a thread
+	static constexpr uint32_t MAX_PASSES = 2;
+
+	// first is set for chunk 0, which also gets any work that is not part of the draw list; last for the
+	// chunk that runs last in its pass, even when it has no draws
+	using RecordChunk = std::function<void(VkCommandBuffer secondary, uint32_t pass, uint32_t begin, uint32_t end, bool first, bool last)>;
+
+	VulkanParallelCommandRecorder();
+	~VulkanParallelCommandRecorder();
+
+	VulkanParallelCommandRecorder(const VulkanParallelCommandRecorder&) = delete;
+	VulkanParallelCommandRecorder& operator=(const VulkanParallelCommandRecorder&) = delete;
+
+	void create(VkDevice vkdevice, uint32_t queueFamilyIndex, uint32_t numFrames);
+	void destroy();
+
+	// only call once the frame's fence has signalled; resets that frame's pools
+	void record(VkCommandBuffer primary, uint32_t frameIndex, const VkCommandBufferInheritanceInfo& inheritance,
+		uint32_t drawCount, const RecordChunk& recordChunk, uint32_t passCount = 1);
+
+	uint32_t getWorkerCount() const { return workerCount; }
+	uint32_t getLastChunkCount() const { return lastChunkCount; }
+
+private:
+	struct WorkerFrame
+	{
+		std::unique_ptr<VulkanCommandPool> pool;
+		VkCommandBuffer secondaries[MAX_PASSES] = {};
+	};
+
+	std::vector<std::vector<WorkerFrame>> frames; // [frame][worker]
+	uint32_t workerCount;
+	uint32_t lastChunkCount;
+
+	// thread n - 1 records chunk n of every job; everything below is guarded by jobMutex
+	std::vector<std::thread> threads;
+	std::mutex jobMutex;
+	std::condition_variable jobReady;
+	std::condition_variable jobDone;
+	const std::function<void(uint32_t)>* job;
+	uint32_t jobChunkCount;
+	uint64_t jobGeneration;
+	uint32_t pendingChunks;
+	std::exception_ptr jobError; // the first a worker threw, rethrown by record()
+	bool stopping;
+
+	VkDevice device;
+
+	void workerLoop(uint32_t chunk);
+};
@@ -0,0 +1,163 @@
+#include "VulkanPipelineCache.h"
+
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+
+VulkanPipelineCache::VulkanPipelineCache() : pipelineCache(VK_NULL_HANDLE), device(VK_NULL_HANDLE), deviceProperties{}
+{
+}
+
+VulkanPipelineCache::~VulkanPipelineCache()
+{
+	destroy();
+}
+
+void VulkanPipelineCache::create(VkDevice vkdevice, VkPhysicalDevice vkphysicaldevice, const std::string& path)
+{
+	device = vkdevice;
+	cachePath = path;
+	vkGetPhysicalDeviceProperties(vkphysicaldevice, &deviceProperties);
+
+	std::vector<char> initialData = loadValidatedCacheData();
+
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = initialData.size();
+	cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+	{
+		// a corrupt blob can still be rejected by the driver, retry with an empty cache
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+		if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline cache!");
+		}
+	}
+}
+
+void VulkanPipelineCache::save() const
+{
+	if (pipelineCache == VK_NULL_HANDLE || cachePath.empty())
+	{
+		return;
+	}
+
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+	{
+		return;
+	}
+
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+	{
+		std::cerr << "Warning: failed to read pipeline cache data, cache not saved." << std::endl;
+		return;
+	}
+
+	CacheFileHeader header{};
+	header.magic = CACHE_FILE_MAGIC;
+	header.vendorID = deviceProperties.vendorID;
+	header.deviceID = deviceProperties.deviceID;
+	header.driverVersion = deviceProperties.driverVersion;
+	memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = static_cast<uint64_t>(dataSize);
+
+	// write to a temp file first so a crash mid-write never leaves a truncated cache behind
+	std::string tmpPath = cachePath + ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Warning: could not open " << tmpPath << " for writing." << std::endl;
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), dataSize);
+	}
+	std::remove(cachePath.c_str());
+	std::rename(tmpPath.c_str(), cachePath.c_str());
+}
+
+void VulkanPipelineCache::destroy()
+{
+	if (pipelineCache != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineCache(device, pipelineCache, nullptr);
+		pipelineCache = VK_NULL_HANDLE;
+	}
+}
+
+VkPipelineCache VulkanPipelineCache::getVkPipelineCache() const
+{
+	if (pipelineCache == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Get pipeline cache called before initialization!");
+	}
+	return pipelineCache;
+}
+
+std::vector<char> VulkanPipelineCache::loadValidatedCacheData() const
+{
+	std::ifstream file(cachePath, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return {};
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize < sizeof(CacheFileHeader))
+	{
+		return {};
+	}
+
+	CacheFileHeader header{};
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	bool valid =
+		header.magic == CACHE_FILE_MAGIC &&
+		header.vendorID == deviceProperties.vendorID &&
+		header.deviceID == deviceProperties.deviceID &&
+		header.driverVersion == deviceProperties.driverVersion &&
+		memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+		header.dataSize == fileSize - sizeof(CacheFileHeader);
+
+	if (!valid)
+	{
+		std::cout << "Pipeline cache at " << cachePath << " is stale or from another device, rebuilding." << std::endl;
+		return {};
+	}
+
+	std::vector<char> data(static_cast<size_t>(header.dataSize));
+	file.read(data.data(), data.size());
+	if (!file)
+	{
+		return {};
+	}
+
+	// the driver's own header must agree as well (VkPipelineCacheHeaderVersionOne)
+	if (data.size() < 16 + VK_UUID_SIZE)
+	{
+		return {};
+	}
+	uint32_t driverHeaderVersion = 0;
+	uint32_t driverVendorID = 0;
+	uint32_t driverDeviceID = 0;
+	memcpy(&driverHeaderVersion, data.data() + 4, sizeof(uint32_t));
+	memcpy(&driverVendorID, data.data() + 8, sizeof(uint32_t));
+	memcpy(&driverDeviceID, data.data() + 12, sizeof(uint32_t));
+	if (driverHeaderVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		driverVendorID != deviceProperties.vendorID ||
+		driverDeviceID != deviceProperties.deviceID ||
+		memcmp(data.data() + 16, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		return {};
+	}
+
+	return data;
+}
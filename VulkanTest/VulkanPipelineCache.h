@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Wraps a VkPipelineCache that is persisted to disk between runs.
+// The blob on disk is prefixed with a small header so that a cache written by
+// a different GPU / driver is discarded instead of being handed to the driver.
+class VulkanPipelineCache
+{
+public:
+	VulkanPipelineCache();
+	~VulkanPipelineCache();
+
+	void create(VkDevice vkdevice, VkPhysicalDevice vkphysicaldevice, const std::string& path);
+	void save() const;
+	void destroy();
+
+	VkPipelineCache getVkPipelineCache() const;
+
+private:
+	VkPipelineCache pipelineCache;
+
+	VkDevice device;
+	VkPhysicalDeviceProperties deviceProperties;
+	std::string cachePath;
+
+	struct CacheFileHeader
+	{
+		uint32_t magic;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+	};
+
+	static constexpr uint32_t CACHE_FILE_MAGIC = 0x4D4B5043; // "MKPC"
+
+	std::vector<char> loadValidatedCacheData() const;
+};
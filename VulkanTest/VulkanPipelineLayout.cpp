@@ -14,12 +14,21 @@ void VulkanPipelineLayout::create(
 	VkDescriptorSetLayout descriptorSetLayout, 
 	uint32_t pushConstantRangeCount, 
 	const VkPushConstantRange* pPushConstantRanges)
+{
+	create(vkdevice, std::vector<VkDescriptorSetLayout>{ descriptorSetLayout }, pushConstantRangeCount, pPushConstantRanges);
+}
+
+void VulkanPipelineLayout::create(
+	VkDevice vkdevice,
+	const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts,
+	uint32_t pushConstantRangeCount,
+	const VkPushConstantRange* pPushConstantRanges)
 {
 	device = vkdevice;
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
 	pipelineLayoutInfo.pushConstantRangeCount = pushConstantRangeCount;
 	pipelineLayoutInfo.pPushConstantRanges = pPushConstantRanges;
 
@@ -16,6 +16,12 @@ public:
 		uint32_t pushConstantRangeCount = 0, 
 		const VkPushConstantRange* pPushConstantRanges = nullptr
 	);
+	void create(
+		VkDevice device,
+		const std::vector<VkDescriptorSetLayout>& descriptorSetLayouts,
+		uint32_t pushConstantRangeCount = 0,
+		const VkPushConstantRange* pPushConstantRanges = nullptr
+	);
 	void destroy();
 
 	VkPipelineLayout getVkPipelineLayout() const;
@@ -0,0 +1,110 @@
+#include "VulkanPipelineLibrary.h"
+#include "CpuProfiler.h"
+
+#include <future>
+
+VulkanPipelineLibrary::VulkanPipelineLibrary() : device(VK_NULL_HANDLE), m_pShaderModuleCache(nullptr), pipelineCache(VK_NULL_HANDLE)
+{
+}
+
+VulkanPipelineLibrary::~VulkanPipelineLibrary()
+{
+	destroy();
+}
+
+void VulkanPipelineLibrary::create(VkDevice vkdevice, VulkanShaderModuleCache* shaderModuleCache, VkPipelineCache vkPipelineCache)
+{
+	device = vkdevice;
+	m_pShaderModuleCache = shaderModuleCache;
+	pipelineCache = vkPipelineCache;
+}
+
+void VulkanPipelineLibrary::destroy()
+{
+	std::lock_guard<std::mutex> lock(libraryMutex);
+	for (auto& entry : entries)
+	{
+		if (entry.pipeline) entry.pipeline->destroy();
+		entry.pipeline.reset();
+		entry.built = false;
+	}
+	entries.clear();
+	handleLookup.clear();
+}
+
+PipelineHandle VulkanPipelineLibrary::requestPipeline(const GraphicsPipelineState& state)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Request pipeline called before initialization!");
+	}
+
+	std::lock_guard<std::mutex> lock(libraryMutex);
+	auto it = handleLookup.find(state);
+	if (it != handleLookup.end())
+	{
+		return it->second;
+	}
+
+	PipelineHandle handle = static_cast<PipelineHandle>(entries.size());
+	PipelineEntry entry{};
+	entry.state = state;
+	entry.pipeline = std::make_unique<VulkanGraphicsPipeline>();
+	entries.push_back(std::move(entry));
+	handleLookup.emplace(state, handle);
+	return handle;
+}
+
+void VulkanPipelineLibrary::prewarm()
+{
+	std::lock_guard<std::mutex> lock(libraryMutex);
+
+	std::vector<std::future<void>> jobs;
+	for (auto& entry : entries)
+	{
+		if (entry.built) continue;
+		PipelineEntry* pEntry = &entry;
+		jobs.push_back(std::async(std::launch::async, [this, pEntry]()
+			{
+				buildEntry(*pEntry);
+			}));
+	}
+
+	for (auto& job : jobs)
+	{
+		job.get();
+	}
+}
+
+VkPipeline VulkanPipelineLibrary::getVkPipeline(PipelineHandle handle)
+{
+	std::lock_guard<std::mutex> lock(libraryMutex);
+	if (handle >= entries.size())
+	{
+		throw std::runtime_error("Invalid pipeline handle!");
+	}
+
+	PipelineEntry& entry = entries[handle];
+	if (!entry.built)
+	{
+		buildEntry(entry); // lazy path, a hitch here means the state was not prewarmed
+	}
+	return entry.pipeline->getVkPipeline();
+}
+
+GraphicsPipelineState VulkanPipelineLibrary::getState(PipelineHandle handle) const
+{
+	std::lock_guard<std::mutex> lock(libraryMutex);
+	if (handle >= entries.size())
+	{
+		throw std::runtime_error("Invalid pipeline handle!");
+	}
+	return entries[handle].state;
+}
+
+void VulkanPipelineLibrary::buildEntry(PipelineEntry& entry)
+{
+	CPU_PROFILE_ZONE("Build Pipeline");
+	entry.pipeline->createFromState(device, entry.state, m_pShaderModuleCache, pipelineCache);
+	entry.built = true;
+}
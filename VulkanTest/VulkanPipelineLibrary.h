@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+#include "VulkanGraphicsPipeline.h"
+
+using PipelineHandle = uint32_t;
+constexpr PipelineHandle INVALID_PIPELINE_HANDLE = UINT32_MAX;
+
+// Owns every pipeline permutation used by the scene.
+// Requesting a state returns a stable handle; identical states share one handle/pipeline.
+// Pipelines are compiled lazily on first use, or ahead of time with prewarm().
+class VulkanPipelineLibrary
+{
+public:
+	VulkanPipelineLibrary();
+	~VulkanPipelineLibrary();
+
+	VulkanPipelineLibrary(const VulkanPipelineLibrary&) = delete;
+	VulkanPipelineLibrary& operator=(const VulkanPipelineLibrary&) = delete;
+
+	void create(VkDevice vkdevice, VulkanShaderModuleCache* shaderModuleCache, VkPipelineCache pipelineCache);
+	void destroy();
+
+	PipelineHandle requestPipeline(const GraphicsPipelineState& state);
+
+	// compiles every requested but not yet built pipeline, in parallel
+	void prewarm();
+
+	// locks the library and builds the pipeline if it was not prewarmed; hot paths resolve their handles
+	// once up front (VulkanRenderer::resolvePipelines) rather than calling this per draw
+	VkPipeline getVkPipeline(PipelineHandle handle);
+	GraphicsPipelineState getState(PipelineHandle handle) const;
+
+	size_t getPipelineCount() const { return entries.size(); }
+
+private:
+	struct PipelineEntry
+	{
+		GraphicsPipelineState state;
+		std::unique_ptr<VulkanGraphicsPipeline> pipeline;
+		bool built = false;
+	};
+
+	std::vector<PipelineEntry> entries;
+	std::unordered_map<GraphicsPipelineState, PipelineHandle> handleLookup;
+	mutable std::mutex libraryMutex;
+
+	VkDevice device;
+	VulkanShaderModuleCache* m_pShaderModuleCache;
+	VkPipelineCache pipelineCache;
+
+	void buildEntry(PipelineEntry& entry);
+};
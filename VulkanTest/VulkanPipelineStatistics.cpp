@@ -0,0 +1,77 @@
+#include "VulkanPipelineStatistics.h"
+
+VulkanPipelineStatistics::VulkanPipelineStatistics()
+	: queryPool(VK_NULL_HANDLE), frameCount(0), recordedFrameMask(0), fragmentInvocations(0), device(VK_NULL_HANDLE)
+{
+}
+
+VulkanPipelineStatistics::~VulkanPipelineStatistics()
+{
+	destroy();
+}
+
+void VulkanPipelineStatistics::create(VkDevice vkdevice, uint32_t numFrames)
+{
+	device = vkdevice;
+	frameCount = numFrames;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	poolInfo.queryCount = numFrames;
+	poolInfo.pipelineStatistics = getStatisticFlags();
+
+	if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline statistics query pool!");
+	}
+}
+
+void VulkanPipelineStatistics::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+	recordedFrameMask = 0;
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanPipelineStatistics::recordBegin(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Pipeline statistics record begin called before initialization!");
+	}
+
+	vkCmdResetQueryPool(commandBuffer, queryPool, frameIndex, 1);
+	vkCmdBeginQuery(commandBuffer, queryPool, frameIndex, 0);
+}
+
+void VulkanPipelineStatistics::recordEnd(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	vkCmdEndQuery(commandBuffer, queryPool, frameIndex);
+	recordedFrameMask |= 1u << frameIndex;
+}
+
+void VulkanPipelineStatistics::fetchResults(uint32_t frameIndex)
+{
+	if (frameIndex >= frameCount || (recordedFrameMask & (1u << frameIndex)) == 0)
+	{
+		return;
+	}
+
+	// no wait flag: after the fence the result is there, VK_NOT_READY just keeps the old value
+	uint64_t result = 0;
+	if (vkGetQueryPoolResults(device, queryPool, frameIndex, 1, sizeof(result), &result, sizeof(result),
+		VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+	{
+		fragmentInvocations = result;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <cstdint>
+
+// Counts fragment shader invocations of the scene pass with a pipeline statistics query, one per
+// frame in flight. Divided by the pixel count that gives the average overdraw, which is what the
+// depth pre-pass is meant to bring down to about 1. Needs the pipelineStatisticsQuery feature.
+class VulkanPipelineStatistics
+{
+public:
+	VulkanPipelineStatistics();
+	~VulkanPipelineStatistics();
+
+	VulkanPipelineStatistics(const VulkanPipelineStatistics&) = delete;
+	VulkanPipelineStatistics& operator=(const VulkanPipelineStatistics&) = delete;
+
+	void create(VkDevice vkdevice, uint32_t numFrames);
+	void destroy();
+
+	// outside a render pass, around it
+	void recordBegin(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	void recordEnd(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// call once the frame's fence has signalled; keeps the last value if the result is not there
+	void fetchResults(uint32_t frameIndex);
+
+	uint64_t getFragmentInvocations() const { return fragmentInvocations; }
+
+	// what secondary command buffers recorded inside the query have to inherit
+	static VkQueryPipelineStatisticFlags getStatisticFlags() { return VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT; }
+
+private:
+	VkQueryPool queryPool;
+	uint32_t frameCount;
+	uint32_t recordedFrameMask; // bit n set: frame n holds a query that was ended
+	uint64_t fragmentInvocations;
+
+	VkDevice device;
+};
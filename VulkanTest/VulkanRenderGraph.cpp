@@ -0,0 +1,1119 @@
+#include "VulkanRenderGraph.h"
+
+#include <algorithm>
+
+namespace
+{
+	VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool sameExtent(VkExtent2D a, VkExtent2D b)
+	{
+		return a.width == b.width && a.height == b.height;
+	}
+}
+
+VulkanRenderGraph::VulkanRenderGraph()
+	: compiled(false), executeCount(0), frameCount(0), culledPassCount(0), renderPassCount(0), barrierCount(0),
+	transientBytes(0), device(VK_NULL_HANDLE), allocator(nullptr)
+{
+}
+
+VulkanRenderGraph::~VulkanRenderGraph()
+{
+	destroy();
+}
+
+void VulkanRenderGraph::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames)
+{
+	device = vkdevice;
+	allocator = &memoryAllocator;
+	frameCount = numFrames;
+}
+
+void VulkanRenderGraph::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	destroyRetired(true);
+	destroyTransients(false);
+	releaseFramebuffers();
+	for (auto& entry : renderPassCache)
+	{
+		vkDestroyRenderPass(device, entry.second, nullptr);
+	}
+	renderPassCache.clear();
+
+	reset();
+	steps.clear();
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanRenderGraph::reset()
+{
+	resources.clear();
+	passes.clear();
+	compiled = false;
+}
+
+RenderGraphResource VulkanRenderGraph::importImage(const char* name, const RenderGraphImageInfo& info, const RenderGraphState& initialState)
+{
+	if (info.image == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Render graph import image: no image given!");
+	}
+
+	Resource resource;
+	resource.name = name;
+	resource.image = info;
+	resource.initialState = initialState;
+	return addResource(std::move(resource));
+}
+
+RenderGraphResource VulkanRenderGraph::importBuffer(const char* name, VkBuffer buffer, const RenderGraphState& initialState)
+{
+	Resource resource;
+	resource.name = name;
+	resource.buffer = buffer;
+	resource.isImage = false;
+	resource.initialState = initialState;
+	resource.initialState.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	return addResource(std::move(resource));
+}
+
+RenderGraphResource VulkanRenderGraph::createImage(const char* name, const RenderGraphImageInfo& info)
+{
+	uint32_t transientCount = static_cast<uint32_t>(std::count_if(resources.begin(), resources.end(),
+		[](const Resource& resource) { return resource.transientIndex != UINT32_MAX; }));
+
+	Resource resource;
+	resource.name = name;
+	resource.image = info;
+	resource.image.image = VK_NULL_HANDLE;
+	resource.image.view = VK_NULL_HANDLE;
+	resource.transientIndex = transientCount;
+	return addResource(std::move(resource));
+}
+
+void VulkanRenderGraph::exportResource(RenderGraphResource resource, VkImageLayout finalLayout)
+{
+	if (resource >= resources.size())
+	{
+		throw std::runtime_error("Render graph export resource: invalid resource");
+	}
+	if (resources[resource].transientIndex != UINT32_MAX)
+	{
+		throw std::runtime_error("Render graph export resource: transient images do not outlive the frame!");
+	}
+
+	resources[resource].exported = true;
+	resources[resource].finalLayout = resources[resource].isImage ? finalLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+uint32_t VulkanRenderGraph::addGraphicsPass(const char* name, RecordPass record, VkSubpassContents contents)
+{
+	Pass pass;
+	pass.name = name;
+	pass.record = std::move(record);
+	pass.graphics = true;
+	pass.contents = contents;
+	passes.push_back(std::move(pass));
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+uint32_t VulkanRenderGraph::addComputePass(const char* name, RecordPass record)
+{
+	Pass pass;
+	pass.name = name;
+	pass.record = std::move(record);
+	passes.push_back(std::move(pass));
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void VulkanRenderGraph::addColorAttachment(uint32_t pass, RenderGraphResource resource, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor)
+{
+	Use use = makeUse(resource, RenderGraphUsage::COLOR_ATTACHMENT, true);
+	use.attachment = AttachmentKind::COLOR;
+	use.loadOp = loadOp;
+	use.clearValue.color = clearColor;
+	addUse(pass, use);
+}
+
+void VulkanRenderGraph::addDepthAttachment(uint32_t pass, RenderGraphResource resource, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clearDepth)
+{
+	Use use = makeUse(resource, RenderGraphUsage::DEPTH_ATTACHMENT, true);
+	use.attachment = AttachmentKind::DEPTH;
+	use.loadOp = loadOp;
+	use.clearValue.depthStencil = clearDepth;
+	addUse(pass, use);
+}
+
+void VulkanRenderGraph::addRead(uint32_t pass, RenderGraphResource resource, RenderGraphUsage usage)
+{
+	if (usage == RenderGraphUsage::COLOR_ATTACHMENT || usage == RenderGraphUsage::DEPTH_ATTACHMENT)
+	{
+		throw std::runtime_error("Render graph add read: attachments go through addColorAttachment / addDepthAttachment");
+	}
+	addUse(pass, makeUse(resource, usage, false));
+}
+
+void VulkanRenderGraph::addWrite(uint32_t pass, RenderGraphResource resource, RenderGraphUsage usage)
+{
+	if (usage != RenderGraphUsage::STORAGE_VERTEX && usage != RenderGraphUsage::STORAGE_FRAGMENT
+		&& usage != RenderGraphUsage::STORAGE_COMPUTE)
+	{
+		throw std::runtime_error("Render graph add write: only storage usages can be written outside attachments");
+	}
+	addUse(pass, makeUse(resource, usage, true));
+}
+
+void VulkanRenderGraph::compile()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Render graph compile called before initialization!");
+	}
+
+	destroyRetired(false);
+	cullPasses();
+	buildSteps();
+	allocateTransients();
+	buildBarriers();
+	compiled = true;
+}
+
+void VulkanRenderGraph::execute(VkCommandBuffer commandBuffer)
+{
+	if (!compiled)
+	{
+		throw std::runtime_error("Render graph execute called before compile!");
+	}
+
+	for (const Step& step : steps)
+	{
+		recordBarriers(commandBuffer, step.barriers);
+
+		RenderGraphContext context{};
+		context.commandBuffer = commandBuffer;
+
+		const Pass& first = passes[step.passes[0]];
+		if (!first.graphics)
+		{
+			if (first.record) first.record(context);
+			continue;
+		}
+
+		context.renderPass = step.renderPass;
+		context.framebuffer = getFramebuffer(step);
+		context.extent = step.extent;
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = step.renderPass;
+		renderPassInfo.framebuffer = context.framebuffer;
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = step.extent;
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(step.clearValues.size());
+		renderPassInfo.pClearValues = step.clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, first.contents);
+		for (uint32_t subpass = 0; subpass < step.passes.size(); subpass++)
+		{
+			const Pass& pass = passes[step.passes[subpass]];
+			if (subpass > 0)
+			{
+				vkCmdNextSubpass(commandBuffer, pass.contents);
+			}
+			context.subpass = subpass;
+			if (pass.record) pass.record(context);
+		}
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	recordBarriers(commandBuffer, finalBarriers);
+	executeCount++;
+}
+
+VkRenderPass VulkanRenderGraph::getRenderPass(const std::string& passName) const
+{
+	const Pass& pass = findPass(passName);
+	if (!pass.graphics || pass.step >= steps.size())
+	{
+		throw std::runtime_error("Render graph get render pass: the pass was culled or is not a graphics pass!");
+	}
+	return steps[pass.step].renderPass;
+}
+
+uint32_t VulkanRenderGraph::getSubpass(const std::string& passName) const
+{
+	const Pass& pass = findPass(passName);
+	if (!pass.graphics || pass.step >= steps.size())
+	{
+		throw std::runtime_error("Render graph get subpass: the pass was culled or is not a graphics pass!");
+	}
+	return pass.subpass;
+}
+
+VkImageView VulkanRenderGraph::getImageView(RenderGraphResource resource) const
+{
+	if (resource >= resources.size() || !resources[resource].isImage)
+	{
+		throw std::runtime_error("Render graph get image view: invalid resource");
+	}
+
+	const Resource& target = resources[resource];
+	VkImageView view = target.transientIndex != UINT32_MAX && target.transientIndex < transients.size()
+		? transients[target.transientIndex].view
+		: target.image.view;
+	if (view == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Render graph get image view called before the image was created!");
+	}
+	return view;
+}
+
+void VulkanRenderGraph::releaseFramebuffers()
+{
+	for (auto& entry : framebufferCache)
+	{
+		vkDestroyFramebuffer(device, entry.second, nullptr);
+	}
+	framebufferCache.clear();
+}
+
+RenderGraphResource VulkanRenderGraph::addResource(Resource&& resource)
+{
+	resources.push_back(std::move(resource));
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+VulkanRenderGraph::Use VulkanRenderGraph::makeUse(RenderGraphResource resource, RenderGraphUsage usage, bool write) const
+{
+	if (resource >= resources.size())
+	{
+		throw std::runtime_error("Render graph: invalid resource");
+	}
+	const Resource& target = resources[resource];
+
+	Use use;
+	use.resource = resource;
+	use.write = write;
+
+	bool depth = (target.image.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0;
+	VkImageLayout readLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	VkAccessFlags storageAccess = VK_ACCESS_SHADER_READ_BIT | (write ? VK_ACCESS_SHADER_WRITE_BIT : 0);
+
+	switch (usage)
+	{
+	case RenderGraphUsage::COLOR_ATTACHMENT:
+		use.state = { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+		use.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		break;
+	case RenderGraphUsage::DEPTH_ATTACHMENT:
+		use.state = { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+		use.imageUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		break;
+	case RenderGraphUsage::SAMPLED_FRAGMENT:
+		use.state = { readLayout, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+		use.imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT;
+		break;
+	case RenderGraphUsage::SAMPLED_COMPUTE:
+		use.state = { readLayout, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+		use.imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT;
+		break;
+	case RenderGraphUsage::STORAGE_VERTEX:
+		use.state = { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, storageAccess };
+		use.imageUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+		break;
+	case RenderGraphUsage::STORAGE_FRAGMENT:
+		use.state = { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, storageAccess };
+		use.imageUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+		break;
+	case RenderGraphUsage::STORAGE_COMPUTE:
+		use.state = { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, storageAccess };
+		use.imageUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+		break;
+	case RenderGraphUsage::INDIRECT:
+		use.state = { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT };
+		break;
+	}
+
+	if (!target.isImage)
+	{
+		use.state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		use.imageUsage = 0;
+	}
+	else if (target.image.generalLayout)
+	{
+		use.state.layout = VK_IMAGE_LAYOUT_GENERAL;
+	}
+	return use;
+}
+
+void VulkanRenderGraph::addUse(uint32_t pass, Use use)
+{
+	if (pass >= passes.size())
+	{
+		throw std::runtime_error("Render graph: invalid pass");
+	}
+	Pass& target = passes[pass];
+	if (use.attachment != AttachmentKind::NONE && !target.graphics)
+	{
+		throw std::runtime_error("Render graph: attachments need a graphics pass!");
+	}
+
+	// one resource used several ways by a pass is synced once, for all of them
+	for (Use& existing : target.uses)
+	{
+		if (existing.resource != use.resource) continue;
+
+		if (existing.attachment != AttachmentKind::NONE || use.attachment != AttachmentKind::NONE)
+		{
+			throw std::runtime_error("Render graph: an attachment can not be used any other way by the same pass!");
+		}
+		if (existing.state.layout != use.state.layout)
+		{
+			throw std::runtime_error("Render graph: a pass uses one image in two layouts!");
+		}
+		existing.state.stages |= use.state.stages;
+		existing.state.access |= use.state.access;
+		existing.imageUsage |= use.imageUsage;
+		existing.write = existing.write || use.write;
+		return;
+	}
+	target.uses.push_back(use);
+}
+
+void VulkanRenderGraph::cullPasses()
+{
+	// walk back from the exported resources: a pass stays when something later needs what it writes
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t i = 0; i < resources.size(); i++)
+	{
+		needed[i] = resources[i].exported;
+	}
+
+	culledPassCount = 0;
+	for (size_t i = passes.size(); i-- > 0;)
+	{
+		Pass& pass = passes[i];
+		pass.culled = std::none_of(pass.uses.begin(), pass.uses.end(),
+			[&needed](const Use& use) { return use.write && needed[use.resource]; });
+		if (pass.culled)
+		{
+			culledPassCount++;
+			continue;
+		}
+
+		// a cleared attachment does not need what was in it before; anything else read or partially written does
+		for (const Use& use : pass.uses)
+		{
+			if (use.attachment != AttachmentKind::NONE && use.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD)
+			{
+				needed[use.resource] = false;
+			}
+		}
+		for (const Use& use : pass.uses)
+		{
+			if (use.attachment == AttachmentKind::NONE || use.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+			{
+				needed[use.resource] = true;
+			}
+		}
+	}
+}
+
+void VulkanRenderGraph::buildSteps()
+{
+	steps.clear();
+	for (uint32_t i = 0; i < passes.size(); i++)
+	{
+		Pass& pass = passes[i];
+		pass.step = UINT32_MAX;
+		pass.subpass = 0;
+		if (pass.culled) continue;
+
+		// the render pass to join may sit behind steps this pass has nothing to do with,
+		// e.g. the UI declared after a compute pass reading the scene's depth
+		uint32_t target = UINT32_MAX;
+		if (pass.graphics)
+		{
+			for (size_t s = steps.size(); s-- > 0;)
+			{
+				if (canMerge(steps[s], pass))
+				{
+					target = static_cast<uint32_t>(s);
+					break;
+				}
+				if (sharesResource(steps[s], pass))
+				{
+					break;
+				}
+			}
+		}
+
+		if (target != UINT32_MAX)
+		{
+			pass.subpass = static_cast<uint32_t>(steps[target].passes.size());
+			steps[target].passes.push_back(i);
+		}
+		else
+		{
+			Step step;
+			step.passes.push_back(i);
+			if (pass.graphics)
+			{
+				auto attachment = std::find_if(pass.uses.begin(), pass.uses.end(),
+					[](const Use& use) { return use.attachment != AttachmentKind::NONE; });
+				if (attachment == pass.uses.end())
+				{
+					throw std::runtime_error("Render graph: graphics pass without attachments!");
+				}
+				step.extent = resources[attachment->resource].image.extent;
+			}
+			steps.push_back(std::move(step));
+		}
+		pass.step = target != UINT32_MAX ? target : static_cast<uint32_t>(steps.size() - 1);
+
+		for (const Use& use : pass.uses)
+		{
+			if (use.attachment != AttachmentKind::NONE && !sameExtent(resources[use.resource].image.extent, steps[pass.step].extent))
+			{
+				throw std::runtime_error("Render graph: the attachments of a pass differ in size!");
+			}
+		}
+	}
+}
+
+bool VulkanRenderGraph::canMerge(const Step& step, const Pass& pass) const
+{
+	if (!passes[step.passes[0]].graphics)
+	{
+		return false;
+	}
+
+	bool sharesAttachment = false;
+	for (const Use& use : pass.uses)
+	{
+		if (use.attachment != AttachmentKind::NONE && !sameExtent(resources[use.resource].image.extent, step.extent))
+		{
+			return false;
+		}
+
+		for (uint32_t earlier : step.passes)
+		{
+			for (const Use& earlierUse : passes[earlier].uses)
+			{
+				if (earlierUse.resource != use.resource) continue;
+
+				// inside a render pass only attachments can be handed on, and only without clearing them again;
+				// anything else needs a barrier in between
+				if (use.attachment == AttachmentKind::NONE || earlierUse.attachment == AttachmentKind::NONE
+					|| use.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD)
+				{
+					return false;
+				}
+				sharesAttachment = true;
+			}
+		}
+	}
+	return sharesAttachment;
+}
+
+bool VulkanRenderGraph::sharesResource(const Step& step, const Pass& pass) const
+{
+	for (uint32_t earlier : step.passes)
+	{
+		for (const Use& earlierUse : passes[earlier].uses)
+		{
+			for (const Use& use : pass.uses)
+			{
+				if (earlierUse.resource == use.resource)
+				{
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+void VulkanRenderGraph::allocateTransients()
+{
+	// lifetimes in steps and usage flags, both only from passes that survived culling
+	std::vector<TransientImage> planned;
+	std::vector<VkImageUsageFlags> usages;
+	for (const Resource& resource : resources)
+	{
+		if (resource.transientIndex != UINT32_MAX)
+		{
+			planned.emplace_back();
+			usages.push_back(0);
+		}
+	}
+	for (const Pass& pass : passes)
+	{
+		if (pass.culled) continue;
+		for (const Use& use : pass.uses)
+		{
+			uint32_t index = resources[use.resource].transientIndex;
+			if (index == UINT32_MAX) continue;
+			usages[index] |= use.imageUsage;
+			planned[index].firstStep = std::min(planned[index].firstStep, pass.step);
+			planned[index].lastStep = std::max(planned[index].lastStep, pass.step);
+		}
+	}
+
+	std::vector<uint64_t> key;
+	for (const Resource& resource : resources)
+	{
+		if (resource.transientIndex == UINT32_MAX) continue;
+		const TransientImage& transient = planned[resource.transientIndex];
+		key.insert(key.end(), {
+			static_cast<uint64_t>(resource.image.format), resource.image.extent.width, resource.image.extent.height,
+			resource.image.aspect, resource.image.levelCount, usages[resource.transientIndex],
+			transient.firstStep, transient.lastStep });
+	}
+	if (key == transientKey)
+	{
+		return;
+	}
+
+	// the old images may still be in flight
+	destroyTransients(true);
+	transientKey = key;
+	transients = std::move(planned);
+
+	for (const Resource& resource : resources)
+	{
+		if (resource.transientIndex == UINT32_MAX || usages[resource.transientIndex] == 0) continue;
+		TransientImage& transient = transients[resource.transientIndex];
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { resource.image.extent.width, resource.image.extent.height, 1 };
+		imageInfo.mipLevels = resource.image.levelCount;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = resource.image.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = usages[resource.transientIndex];
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(device, &imageInfo, nullptr, &transient.image) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create render graph transient image!");
+		}
+		vkGetImageMemoryRequirements(device, transient.image, &transient.requirements);
+	}
+
+	// biggest first, each at the lowest offset that no image alive at the same time occupies
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < transients.size(); i++)
+	{
+		if (transients[i].image != VK_NULL_HANDLE) order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+		{
+			return transients[a].requirements.size > transients[b].requirements.size;
+		});
+
+	VkMemoryRequirements requirements{ 0, 1, ~0u };
+	std::vector<uint32_t> placed;
+	for (uint32_t index : order)
+	{
+		TransientImage& transient = transients[index];
+		VkDeviceSize offset = 0;
+		bool moved = true;
+		while (moved)
+		{
+			moved = false;
+			for (uint32_t other : placed)
+			{
+				const TransientImage& placedImage = transients[other];
+				bool aliveTogether = transient.firstStep <= placedImage.lastStep && placedImage.firstStep <= transient.lastStep;
+				bool overlaps = offset < placedImage.offset + placedImage.requirements.size
+					&& placedImage.offset < offset + transient.requirements.size;
+				if (aliveTogether && overlaps)
+				{
+					offset = alignUp(placedImage.offset + placedImage.requirements.size, transient.requirements.alignment);
+					moved = true;
+				}
+			}
+		}
+		transient.offset = offset;
+		placed.push_back(index);
+
+		requirements.size = std::max(requirements.size, offset + transient.requirements.size);
+		requirements.alignment = std::max(requirements.alignment, transient.requirements.alignment);
+		requirements.memoryTypeBits &= transient.requirements.memoryTypeBits;
+		transientBytes += transient.requirements.size;
+	}
+
+	if (placed.empty())
+	{
+		return;
+	}
+	if (requirements.memoryTypeBits == 0)
+	{
+		throw std::runtime_error("Render graph: no memory type fits every transient image!");
+	}
+
+	transientMemory = allocator->allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VulkanResourceKind::IMAGE);
+
+	for (const Resource& resource : resources)
+	{
+		if (resource.transientIndex == UINT32_MAX) continue;
+		TransientImage& transient = transients[resource.transientIndex];
+		if (transient.image == VK_NULL_HANDLE) continue;
+
+		vkBindImageMemory(device, transient.image, transientMemory.memory, transientMemory.offset + transient.offset);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = transient.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = resource.image.format;
+		// views of depth stencil images only see depth, so they can be sampled too
+		viewInfo.subresourceRange.aspectMask = (resource.image.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0
+			? static_cast<VkImageAspectFlags>(VK_IMAGE_ASPECT_DEPTH_BIT)
+			: resource.image.aspect;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = resource.image.levelCount;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(device, &viewInfo, nullptr, &transient.view) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create render graph transient image view!");
+		}
+	}
+}
+
+void VulkanRenderGraph::destroyTransients(bool deferred)
+{
+	if (deferred)
+	{
+		// framebuffers can point at the old views, so they go along
+		Retired entry;
+		entry.transients = std::move(transients);
+		entry.memory = transientMemory;
+		for (auto& framebuffer : framebufferCache)
+		{
+			entry.framebuffers.push_back(framebuffer.second);
+		}
+		framebufferCache.clear();
+		entry.executeIndex = executeCount;
+		retired.push_back(std::move(entry));
+	}
+	else
+	{
+		for (TransientImage& transient : transients)
+		{
+			if (transient.view != VK_NULL_HANDLE) vkDestroyImageView(device, transient.view, nullptr);
+			if (transient.image != VK_NULL_HANDLE) vkDestroyImage(device, transient.image, nullptr);
+		}
+		if (transientMemory.isValid())
+		{
+			allocator->free(transientMemory);
+		}
+	}
+
+	transients.clear();
+	transientMemory = VulkanAllocation{};
+	transientKey.clear();
+	transientBytes = 0;
+}
+
+void VulkanRenderGraph::destroyRetired(bool all)
+{
+	auto finished = [this, all](const Retired& entry) { return all || executeCount >= entry.executeIndex + frameCount; };
+
+	for (Retired& entry : retired)
+	{
+		if (!finished(entry)) continue;
+
+		for (VkFramebuffer framebuffer : entry.framebuffers)
+		{
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+		for (TransientImage& transient : entry.transients)
+		{
+			if (transient.view != VK_NULL_HANDLE) vkDestroyImageView(device, transient.view, nullptr);
+			if (transient.image != VK_NULL_HANDLE) vkDestroyImage(device, transient.image, nullptr);
+		}
+		if (entry.memory.isValid())
+		{
+			allocator->free(entry.memory);
+		}
+	}
+	retired.erase(std::remove_if(retired.begin(), retired.end(), finished), retired.end());
+}
+
+void VulkanRenderGraph::buildBarriers()
+{
+	states.assign(resources.size(), RenderGraphState{});
+	touched.assign(resources.size(), false);
+	for (size_t i = 0; i < resources.size(); i++)
+	{
+		states[i] = resources[i].initialState;
+	}
+
+	// store ops depend on whether a later step still reads the attachment
+	std::vector<uint32_t> lastStep(resources.size(), 0);
+	for (const Pass& pass : passes)
+	{
+		if (pass.culled) continue;
+		for (const Use& use : pass.uses)
+		{
+			lastStep[use.resource] = std::max(lastStep[use.resource], pass.step);
+		}
+	}
+
+	barrierCount = 0;
+	renderPassCount = 0;
+	for (uint32_t i = 0; i < steps.size(); i++)
+	{
+		Step& step = steps[i];
+		step.barriers = BarrierBatch{};
+		step.renderPass = VK_NULL_HANDLE;
+
+		const Pass& first = passes[step.passes[0]];
+		if (first.graphics)
+		{
+			step.renderPass = createRenderPass(i, lastStep);
+			renderPassCount++;
+		}
+		else
+		{
+			for (const Use& use : first.uses)
+			{
+				addBarrier(step.barriers, use.resource, use.state, use.write, false);
+			}
+		}
+	}
+
+	finalBarriers = BarrierBatch{};
+	for (RenderGraphResource i = 0; i < resources.size(); i++)
+	{
+		const Resource& resource = resources[i];
+		if (resource.exported && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED && resource.finalLayout != states[i].layout)
+		{
+			RenderGraphState finalState{ resource.finalLayout, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 };
+			addBarrier(finalBarriers, i, finalState, false, false);
+		}
+	}
+}
+
+void VulkanRenderGraph::addBarrier(BarrierBatch& batch, RenderGraphResource resource, const RenderGraphState& next, bool write, bool discard)
+{
+	const Resource& target = resources[resource];
+
+	// a transient's first use waits on whatever last used the same memory, this frame or an earlier one
+	if (!touched[resource])
+	{
+		touched[resource] = true;
+		if (target.transientIndex != UINT32_MAX)
+		{
+			const TransientImage& transient = transients[target.transientIndex];
+			RenderGraphState aliased{};
+			for (const TransientImage& other : transients)
+			{
+				if (other.image == VK_NULL_HANDLE) continue;
+				if (transient.offset < other.offset + other.requirements.size && other.offset < transient.offset + transient.requirements.size)
+				{
+					aliased.stages |= other.lastState.stages;
+					aliased.access |= other.lastState.access;
+				}
+			}
+			states[resource] = aliased;
+			discard = true;
+		}
+	}
+
+	RenderGraphState& current = states[resource];
+	bool layoutChange = target.isImage && current.layout != next.layout;
+	bool hazard = (current.access & WRITE_ACCESS) != 0 || (write && current.stages != 0);
+	if (!layoutChange && !hazard)
+	{
+		// reads after reads need no barrier, the next write waits on all of them together
+		RenderGraphState joined = current;
+		joined.stages |= next.stages;
+		joined.access |= next.access;
+		setState(resource, joined);
+		return;
+	}
+
+	VkPipelineStageFlags srcStages = current.stages != 0 ? current.stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	VkAccessFlags srcAccess = current.access & WRITE_ACCESS; // only writes have to be made available
+	if (target.isImage)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : current.layout;
+		barrier.newLayout = next.layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = target.transientIndex != UINT32_MAX ? transients[target.transientIndex].image : target.image.image;
+		barrier.subresourceRange = { target.image.aspect, 0, target.image.levelCount, target.image.baseArrayLayer, 1 };
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = next.access;
+		batch.imageBarriers.push_back(barrier);
+	}
+	else
+	{
+		batch.srcAccess |= srcAccess;
+		batch.dstAccess |= next.access;
+	}
+	batch.srcStages |= srcStages;
+	batch.dstStages |= next.stages;
+	barrierCount++;
+
+	setState(resource, next);
+}
+
+void VulkanRenderGraph::setState(RenderGraphResource resource, const RenderGraphState& state)
+{
+	states[resource] = state;
+	uint32_t transientIndex = resources[resource].transientIndex;
+	if (transientIndex != UINT32_MAX)
+	{
+		transients[transientIndex].lastState = state;
+	}
+}
+
+VkRenderPass VulkanRenderGraph::createRenderPass(uint32_t stepIndex, const std::vector<uint32_t>& lastStepOfResource)
+{
+	Step& step = steps[stepIndex];
+	step.attachments.clear();
+	step.clearValues.clear();
+
+	std::vector<VkAttachmentDescription> attachments;
+	std::vector<uint32_t> lastSubpass;          // per attachment
+	std::vector<RenderGraphState> lastSubpassUse; // per attachment
+	std::vector<std::vector<VkAttachmentReference>> colorReferences(step.passes.size());
+	std::vector<VkAttachmentReference> depthReferences(step.passes.size(), { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+	std::vector<VkSubpassDependency> dependencies;
+
+	for (uint32_t subpass = 0; subpass < step.passes.size(); subpass++)
+	{
+		const Pass& pass = passes[step.passes[subpass]];
+		for (const Use& use : pass.uses)
+		{
+			// canMerge keeps everything but attachments to a single subpass, so one barrier up front covers it
+			if (use.attachment == AttachmentKind::NONE)
+			{
+				addBarrier(step.barriers, use.resource, use.state, use.write, false);
+				continue;
+			}
+
+			uint32_t index = static_cast<uint32_t>(std::find(step.attachments.begin(), step.attachments.end(), use.resource) - step.attachments.begin());
+			if (index == step.attachments.size())
+			{
+				// first use in this render pass: the barrier in front of it does the layout transition,
+				// so the render pass itself never changes layouts
+				addBarrier(step.barriers, use.resource, use.state, use.write, use.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD);
+
+				VkAttachmentDescription description{};
+				description.format = resources[use.resource].image.format;
+				description.samples = VK_SAMPLE_COUNT_1_BIT;
+				description.loadOp = use.loadOp;
+				description.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				description.initialLayout = use.state.layout;
+				description.finalLayout = use.state.layout;
+				attachments.push_back(description);
+
+				step.attachments.push_back(use.resource);
+				step.clearValues.push_back(use.clearValue);
+				lastSubpass.push_back(subpass);
+				lastSubpassUse.push_back(use.state);
+			}
+			else
+			{
+				// handed on from an earlier subpass
+				VkSubpassDependency dependency{};
+				dependency.srcSubpass = lastSubpass[index];
+				dependency.dstSubpass = subpass;
+				dependency.srcStageMask = lastSubpassUse[index].stages;
+				dependency.dstStageMask = use.state.stages;
+				dependency.srcAccessMask = lastSubpassUse[index].access & WRITE_ACCESS;
+				dependency.dstAccessMask = use.state.access;
+				dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+				auto existing = std::find_if(dependencies.begin(), dependencies.end(), [&dependency](const VkSubpassDependency& other)
+					{
+						return other.srcSubpass == dependency.srcSubpass && other.dstSubpass == dependency.dstSubpass;
+					});
+				if (existing != dependencies.end())
+				{
+					existing->srcStageMask |= dependency.srcStageMask;
+					existing->dstStageMask |= dependency.dstStageMask;
+					existing->srcAccessMask |= dependency.srcAccessMask;
+					existing->dstAccessMask |= dependency.dstAccessMask;
+				}
+				else
+				{
+					dependencies.push_back(dependency);
+				}
+
+				attachments[index].finalLayout = use.state.layout;
+				lastSubpass[index] = subpass;
+				lastSubpassUse[index] = use.state;
+				setState(use.resource, use.state);
+			}
+
+			VkAttachmentReference reference{ index, use.state.layout };
+			if (use.attachment == AttachmentKind::COLOR)
+			{
+				colorReferences[subpass].push_back(reference);
+			}
+			else
+			{
+				depthReferences[subpass] = reference;
+			}
+		}
+	}
+
+	// nothing reads it after this render pass: the tile contents never have to be written out
+	for (uint32_t i = 0; i < attachments.size(); i++)
+	{
+		RenderGraphResource resource = step.attachments[i];
+		if (resources[resource].exported || lastStepOfResource[resource] > stepIndex)
+		{
+			attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		}
+	}
+
+	std::vector<uint64_t> key;
+	for (const VkAttachmentDescription& attachment : attachments)
+	{
+		key.insert(key.end(), { static_cast<uint64_t>(attachment.format), static_cast<uint64_t>(attachment.loadOp),
+			static_cast<uint64_t>(attachment.storeOp), static_cast<uint64_t>(attachment.initialLayout),
+			static_cast<uint64_t>(attachment.finalLayout) });
+	}
+	for (uint32_t subpass = 0; subpass < step.passes.size(); subpass++)
+	{
+		key.push_back(colorReferences[subpass].size());
+		for (const VkAttachmentReference& reference : colorReferences[subpass])
+		{
+			key.insert(key.end(), { reference.attachment, static_cast<uint64_t>(reference.layout) });
+		}
+		key.insert(key.end(), { depthReferences[subpass].attachment, static_cast<uint64_t>(depthReferences[subpass].layout) });
+	}
+	for (const VkSubpassDependency& dependency : dependencies)
+	{
+		key.insert(key.end(), { dependency.srcSubpass, dependency.dstSubpass, dependency.srcStageMask, dependency.dstStageMask,
+			dependency.srcAccessMask, dependency.dstAccessMask, dependency.dependencyFlags });
+	}
+
+	auto cached = renderPassCache.find(key);
+	if (cached != renderPassCache.end())
+	{
+		return cached->second;
+	}
+
+	std::vector<VkSubpassDescription> subpasses(step.passes.size());
+	for (uint32_t subpass = 0; subpass < subpasses.size(); subpass++)
+	{
+		subpasses[subpass].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[subpass].colorAttachmentCount = static_cast<uint32_t>(colorReferences[subpass].size());
+		subpasses[subpass].pColorAttachments = colorReferences[subpass].data();
+		subpasses[subpass].pDepthStencilAttachment = depthReferences[subpass].attachment != VK_ATTACHMENT_UNUSED
+			? &depthReferences[subpass]
+			: nullptr;
+	}
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
+	renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+	renderPassInfo.pSubpasses = subpasses.data();
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
+
+	VkRenderPass renderPass;
+	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create render graph render pass!");
+	}
+	renderPassCache.emplace(std::move(key), renderPass);
+	return renderPass;
+}
+
+VkFramebuffer VulkanRenderGraph::getFramebuffer(const Step& step)
+{
+	std::vector<VkImageView> views;
+	std::vector<uint64_t> key = { (uint64_t)(step.renderPass), step.extent.width, step.extent.height };
+	for (RenderGraphResource resource : step.attachments)
+	{
+		views.push_back(getImageView(resource));
+		key.push_back((uint64_t)(views.back()));
+	}
+
+	auto cached = framebufferCache.find(key);
+	if (cached != framebufferCache.end())
+	{
+		return cached->second;
+	}
+
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = step.renderPass;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+	framebufferInfo.pAttachments = views.data();
+	framebufferInfo.width = step.extent.width;
+	framebufferInfo.height = step.extent.height;
+	framebufferInfo.layers = 1;
+
+	VkFramebuffer framebuffer;
+	if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create render graph framebuffer!");
+	}
+	framebufferCache.emplace(std::move(key), framebuffer);
+	return framebuffer;
+}
+
+void VulkanRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) const
+{
+	if (batch.srcStages == 0)
+	{
+		return;
+	}
+
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = batch.srcAccess;
+	memoryBarrier.dstAccessMask = batch.dstAccess;
+	uint32_t memoryBarrierCount = (batch.srcAccess != 0 || batch.dstAccess != 0) ? 1 : 0;
+
+	vkCmdPipelineBarrier(commandBuffer, batch.srcStages, batch.dstStages, 0,
+		memoryBarrierCount, &memoryBarrier,
+		0, nullptr,
+		static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+}
+
+const VulkanRenderGraph::Pass& VulkanRenderGraph::findPass(const std::string& passName) const
+{
+	for (const Pass& pass : passes)
+	{
+		if (pass.name == passName)
+		{
+			return pass;
+		}
+	}
+	throw std::runtime_error("Render graph: no pass named " + passName);
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+#include <cstdint>
+
+#include "VulkanMemoryAllocator.h"
+
+using RenderGraphResource = uint32_t;
+constexpr RenderGraphResource INVALID_RENDER_GRAPH_RESOURCE = UINT32_MAX;
+
+// How a pass touches a resource, which decides the stages, access and image layout it is synced to
+enum class RenderGraphUsage : uint8_t
+{
+	COLOR_ATTACHMENT,
+	DEPTH_ATTACHMENT,
+	SAMPLED_FRAGMENT, // sampled by a fragment shader, read only
+	SAMPLED_COMPUTE,  // sampled by a compute shader, read only
+	STORAGE_VERTEX,   // storage buffer in a vertex shader
+	STORAGE_FRAGMENT, // storage buffer in a fragment shader
+	STORAGE_COMPUTE,  // storage buffer or image in a compute shader
+	INDIRECT          // indirect draw arguments and counts, read only
+};
+
+// The last access to a resource, which the barrier in front of its next use waits on
+struct RenderGraphState
+{
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkPipelineStageFlags stages = 0; // 0: nothing to wait for
+	VkAccessFlags access = 0;
+};
+
+struct RenderGraphImageInfo
+{
+	VkImage image = VK_NULL_HANDLE; // left null for transient images, the graph creates those
+	VkImageView view = VK_NULL_HANDLE;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent = { 0, 0 };
+	VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT; // depth and stencil together for combined formats
+	uint32_t levelCount = 1;
+	uint32_t baseArrayLayer = 0; // imported images only: the one layer of the image view is what gets synced
+	bool generalLayout = false; // kept in VK_IMAGE_LAYOUT_GENERAL for every use
+};
+
+// renderPass, subpass and framebuffer are only set for graphics passes
+struct RenderGraphContext
+{
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	VkExtent2D extent = { 0, 0 };
+};
+
+// Frame graph: every frame the passes are declared again with the resources they read and write,
+// in execution order, then compile() works out the rest:
+// - passes whose results nobody reads are culled, starting from the exported resources
+// - graphics passes drawing into the same attachments become subpasses of one render pass, also
+//   across unrelated passes in between, so e.g. the UI is drawn into the scene's color attachment
+//   without storing and loading it
+// - barriers and layout transitions are batched in front of each render pass or compute pass,
+//   subpass dependencies inside a render pass, store ops are DONT_CARE when nothing reads later
+// - transient images are placed in one allocation, sharing memory when their lifetimes do not overlap
+// Render passes, framebuffers and transient images are cached across frames, so a frame that
+// declares the same graph as the last one creates no Vulkan objects.
+class VulkanRenderGraph
+{
+public:
+	using RecordPass = std::function<void(const RenderGraphContext& context)>;
+
+	VulkanRenderGraph();
+	~VulkanRenderGraph();
+
+	VulkanRenderGraph(const VulkanRenderGraph&) = delete;
+	VulkanRenderGraph& operator=(const VulkanRenderGraph&) = delete;
+
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames);
+	void destroy();
+
+	// drops the last frame's declarations
+	void reset();
+
+	// initialState is where the previous user left the resource; ignored for buffers' layout
+	RenderGraphResource importImage(const char* name, const RenderGraphImageInfo& info, const RenderGraphState& initialState);
+	RenderGraphResource importBuffer(const char* name, VkBuffer buffer, const RenderGraphState& initialState);
+	// frame local image owned by the graph, its contents do not survive the frame
+	RenderGraphResource createImage(const char* name, const RenderGraphImageInfo& info);
+	// keeps the passes writing the resource and leaves it in finalLayout (UNDEFINED: as the last use left it)
+	void exportResource(RenderGraphResource resource, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	uint32_t addGraphicsPass(const char* name, RecordPass record, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+	uint32_t addComputePass(const char* name, RecordPass record);
+	void addColorAttachment(uint32_t pass, RenderGraphResource resource, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor = {});
+	void addDepthAttachment(uint32_t pass, RenderGraphResource resource, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clearDepth = { 1.0f, 0 });
+	void addRead(uint32_t pass, RenderGraphResource resource, RenderGraphUsage usage);
+	void addWrite(uint32_t pass, RenderGraphResource resource, RenderGraphUsage usage);
+
+	// culls, merges, derives barriers and creates what is missing; does not call the record functions.
+	// Only call once the frame's fence has signalled, it may destroy what older frames used
+	void compile();
+	void execute(VkCommandBuffer commandBuffer);
+
+	// after compile: the render pass and subpass a graphics pass ended up in, for pipelines and ImGui
+	VkRenderPass getRenderPass(const std::string& passName) const;
+	uint32_t getSubpass(const std::string& passName) const;
+	VkImageView getImageView(RenderGraphResource resource) const;
+
+	// framebuffers hold on to image views, drop them before the swap chain goes away (device idle)
+	void releaseFramebuffers();
+
+	uint32_t getPassCount() const { return static_cast<uint32_t>(passes.size()); }
+	uint32_t getCulledPassCount() const { return culledPassCount; }
+	uint32_t getRenderPassCount() const { return renderPassCount; }
+	uint32_t getBarrierCount() const { return barrierCount; }
+	VkDeviceSize getTransientBytes() const { return transientBytes; } // before aliasing
+	VkDeviceSize getTransientMemoryBytes() const { return transientMemory.size; }
+
+private:
+	static constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	enum class AttachmentKind : uint8_t
+	{
+		NONE,
+		COLOR,
+		DEPTH
+	};
+
+	struct Resource
+	{
+		std::string name;
+		RenderGraphImageInfo image;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		bool isImage = true;
+		bool exported = false;
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		RenderGraphState initialState;
+		uint32_t transientIndex = UINT32_MAX; // into transients, UINT32_MAX when imported
+	};
+
+	struct Use
+	{
+		RenderGraphResource resource = INVALID_RENDER_GRAPH_RESOURCE;
+		RenderGraphState state; // what the use needs
+		VkImageUsageFlags imageUsage = 0;
+		bool write = false;
+		AttachmentKind attachment = AttachmentKind::NONE;
+		VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		VkClearValue clearValue{};
+	};
+
+	struct Pass
+	{
+		std::string name;
+		RecordPass record;
+		bool graphics = false;
+		VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE;
+		std::vector<Use> uses;
+		bool culled = false;
+		uint32_t step = UINT32_MAX;
+		uint32_t subpass = 0;
+	};
+
+	struct BarrierBatch
+	{
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		VkAccessFlags srcAccess = 0; // buffers go through one memory barrier
+		VkAccessFlags dstAccess = 0;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+	};
+
+	// one render pass with its passes as subpasses, or a single compute pass
+	struct Step
+	{
+		BarrierBatch barriers; // in front of the step
+		std::vector<uint32_t> passes;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		std::vector<RenderGraphResource> attachments;
+		std::vector<VkClearValue> clearValues;
+		VkExtent2D extent = { 0, 0 };
+	};
+
+	struct TransientImage
+	{
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkMemoryRequirements requirements{};
+		VkDeviceSize offset = 0;
+		uint32_t firstStep = UINT32_MAX; // lifetime within the frame
+		uint32_t lastStep = 0;
+		RenderGraphState lastState;      // carried across frames, the memory is reused
+	};
+
+	// destroyed once every frame that could still use them has finished
+	struct Retired
+	{
+		std::vector<TransientImage> transients;
+		VulkanAllocation memory;
+		std::vector<VkFramebuffer> framebuffers;
+		uint64_t executeIndex = 0;
+	};
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<Step> steps;
+	BarrierBatch finalBarriers;
+	std::vector<RenderGraphState> states; // while compiling
+	std::vector<bool> touched;
+	bool compiled;
+
+	std::vector<TransientImage> transients;
+	std::vector<uint64_t> transientKey; // what the current transients were created for
+	VulkanAllocation transientMemory;
+
+	std::map<std::vector<uint64_t>, VkRenderPass> renderPassCache;
+	std::map<std::vector<uint64_t>, VkFramebuffer> framebufferCache;
+	std::vector<Retired> retired;
+
+	uint64_t executeCount;
+	uint32_t frameCount;
+
+	uint32_t culledPassCount;
+	uint32_t renderPassCount;
+	uint32_t barrierCount;
+	VkDeviceSize transientBytes;
+
+	VkDevice device;
+	VulkanMemoryAllocator* allocator;
+
+	RenderGraphResource addResource(Resource&& resource);
+	void addUse(uint32_t pass, Use use);
+	Use makeUse(RenderGraphResource resource, RenderGraphUsage usage, bool write) const;
+
+	void cullPasses();
+	void buildSteps();
+	bool canMerge(const Step& step, const Pass& pass) const;
+	bool sharesResource(const Step& step, const Pass& pass) const;
+	void allocateTransients();
+	void destroyTransients(bool deferred);
+	void buildBarriers();
+	void addBarrier(BarrierBatch& batch, RenderGraphResource resource, const RenderGraphState& next, bool write, bool discard);
+	void setState(RenderGraphResource resource, const RenderGraphState& state);
+	VkRenderPass createRenderPass(uint32_t stepIndex, const std::vector<uint32_t>& lastStepOfResource);
+	VkFramebuffer getFramebuffer(const Step& step);
+	void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) const;
+	void destroyRetired(bool all);
+	const Pass& findPass(const std::string& passName) const;
+};
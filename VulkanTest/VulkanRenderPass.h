@@ -4,7 +4,6 @@
 #include <stdexcept>
 #include <array>
 
-#include "VulkanDepthResources.h"
 
 class VulkanRenderPass
 {
@@ -12,7 +11,6 @@ public:
 	VulkanRenderPass();
 	~VulkanRenderPass();
 
-	void create(VkDevice device, VkPhysicalDevice physicalDevice, VkFormat colorAttachmentFormat);
 	void offscreen_rendering_create(VkDevice device, VkPhysicalDevice physicalDevice, VkFormat colorAttachmentFormat = VK_FORMAT_R32G32B32A32_SFLOAT);
 	void destroy();
 
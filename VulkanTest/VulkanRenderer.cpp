@@ -1,19 +1,30 @@
 #include "VulkanRenderer.h"
+#include "VulkanGpuCulling.h"
+#include "VulkanParallelCommandRecorder.h"
+#include "VulkanHiZPyramid.h"
+#include "VulkanClusteredLighting.h"
+#include "VulkanShadowCascades.h"
+#include "VulkanPipelineStatistics.h"
+#include "VulkanSceneCommandCache.h"
+#include "VulkanGpuProfiler.h"
 #include <stdexcept> // For runtime_error
 #include <iostream>  // For debug/error output
+#include <string>
+
+namespace
+{
+    const char* const SHADOW_ZONE_NAMES[] = { "Shadow Cascade 0", "Shadow Cascade 1", "Shadow Cascade 2", "Shadow Cascade 3" };
+    static_assert(sizeof(SHADOW_ZONE_NAMES) / sizeof(SHADOW_ZONE_NAMES[0]) == SHADOW_CASCADE_COUNT, "one profiler zone per cascade");
+}
 
 VulkanRenderer::VulkanRenderer(
     VulkanDevice& device,
     VulkanSwapChain& swapChain,
-    VulkanRenderPass& renderPass,
-    VulkanFramebuffers& framebuffers,
     VulkanCommandBuffers& commandBuffers,
     VulkanSyncObjects& syncObjects,
     int maxFramesInFlight
 ) : devices(device),
 swapChainObj(swapChain),
-vkRenderPass(renderPass),
-swapChainFramebuffersObj(framebuffers),
 vkCommandBuffers(commandBuffers),
 syncObjectsRef(syncObjects),
 MAX_FRAMES_IN_FLIGHT_RENDERER(maxFramesInFlight),
@@ -25,41 +36,444 @@ VulkanRenderer::~VulkanRenderer()
 {
 }
 
-void VulkanRenderer::recordSceneCommands(
-    VkCommandBuffer commandBuffer, 
-    const RenderPacket& packet, 
+void VulkanRenderer::addScenePasses(
+    VulkanRenderGraph& graph,
+    const RenderPacket& packet,
     uint32_t currentFrameIndex,
-    VkFramebuffer swapChainFramebuffer)
+    RenderGraphResource sceneColor,
+    RenderGraphResource depth,
+    VulkanSceneCommandCache* cache)
+{
+    writeFrameData(packet, currentFrameIndex);
+
+    // the pyramid keeps last frame's build until this frame's culling has read it
+    RenderGraphResource hiZ = INVALID_RENDER_GRAPH_RESOURCE;
+    if (packet.hiZPyramid)
+    {
+        RenderGraphImageInfo hiZInfo{};
+        hiZInfo.image = packet.hiZPyramid->getImage();
+        hiZInfo.view = packet.hiZPyramid->getImageView();
+        hiZInfo.format = VK_FORMAT_R32_SFLOAT;
+        hiZInfo.extent = packet.hiZPyramid->getExtent();
+        hiZInfo.levelCount = packet.hiZPyramid->getLevelCount();
+        hiZInfo.generalLayout = true;
+        hiZ = graph.importImage("HiZ", hiZInfo, { VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT });
+    }
+
+    // the previous frame's draws reading these buffers were waited on through the frame fence
+    RenderGraphResource indirect = INVALID_RENDER_GRAPH_RESOURCE;
+    RenderGraphResource count = INVALID_RENDER_GRAPH_RESOURCE;
+    RenderGraphResource instances = INVALID_RENDER_GRAPH_RESOURCE;
+    if (packet.gpuCulling)
+    {
+        indirect = graph.importBuffer("CullIndirect", packet.gpuCulling->getIndirectBuffer(currentFrameIndex), {});
+        count = graph.importBuffer("CullCount", packet.gpuCulling->getCountBuffer(currentFrameIndex), {});
+        instances = graph.importBuffer("CullInstances", packet.gpuCulling->getInstanceBuffer(currentFrameIndex), {});
+
+        uint32_t cull = graph.addComputePass("GpuCull", [this, &packet, currentFrameIndex](const RenderGraphContext& context)
+            {
+                uint32_t zone = beginGpuZone(context.commandBuffer, packet, "GPU Culling");
+                packet.gpuCulling->recordCull(context.commandBuffer, currentFrameIndex);
+                endGpuZone(context.commandBuffer, packet, zone);
+            });
+        graph.addWrite(cull, indirect, RenderGraphUsage::STORAGE_COMPUTE);
+        graph.addWrite(cull, count, RenderGraphUsage::STORAGE_COMPUTE);
+        graph.addWrite(cull, instances, RenderGraphUsage::STORAGE_COMPUTE);
+        if (packet.occlusionCulling && hiZ != INVALID_RENDER_GRAPH_RESOURCE)
+        {
+            graph.addRead(cull, hiZ, RenderGraphUsage::SAMPLED_COMPUTE);
+        }
+    }
+
+    // lights are binned into the view's clusters before the scene shades with them
+    RenderGraphResource clusters = INVALID_RENDER_GRAPH_RESOURCE;
+    RenderGraphResource lightIndices = INVALID_RENDER_GRAPH_RESOURCE;
+    if (packet.clusteredLighting)
+    {
+        clusters = graph.importBuffer("LightClusters", packet.clusteredLighting->getClusterBuffer(currentFrameIndex), {});
+        lightIndices = graph.importBuffer("LightIndices", packet.clusteredLighting->getIndexBuffer(currentFrameIndex), {});
+
+        uint32_t binning = graph.addComputePass("LightBinning", [this, &packet, currentFrameIndex](const RenderGraphContext& context)
+            {
+                uint32_t zone = beginGpuZone(context.commandBuffer, packet, "Light Binning");
+                packet.clusteredLighting->recordBinning(context.commandBuffer, currentFrameIndex);
+                endGpuZone(context.commandBuffer, packet, zone);
+            });
+        graph.addWrite(binning, clusters, RenderGraphUsage::STORAGE_COMPUTE);
+        graph.addWrite(binning, lightIndices, RenderGraphUsage::STORAGE_COMPUTE);
+    }
+
+    // cascades the packet redraws get a depth only pass each; the scene samples every layer
+    std::array<RenderGraphResource, SHADOW_CASCADE_COUNT> shadowLayers{};
+    if (packet.shadowCascades)
+    {
+        for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+        {
+            std::string name = "ShadowCascade" + std::to_string(cascade);
+            RenderGraphImageInfo layerInfo{};
+            layerInfo.image = packet.shadowCascades->getImage();
+            layerInfo.view = packet.shadowCascades->getCascadeView(cascade);
+            layerInfo.format = VulkanShadowCascades::DEPTH_FORMAT;
+            layerInfo.extent = packet.shadowCascades->getExtent();
+            layerInfo.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+            layerInfo.baseArrayLayer = cascade;
+            // last read by the previous frame's scene
+            shadowLayers[cascade] = graph.importImage(name.c_str(), layerInfo,
+                { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT });
+            if (!packet.shadowDraws[cascade].draw) continue;
+
+            uint32_t shadowPass = graph.addGraphicsPass(name.c_str(), [this, &packet, cascade](const RenderGraphContext& context)
+                {
+                    recordShadowCascade(context, packet, cascade);
+                });
+            graph.addDepthAttachment(shadowPass, shadowLayers[cascade], VK_ATTACHMENT_LOAD_OP_CLEAR);
+        }
+    }
+
+    if (!canUseSecondaries(packet))
+    {
+        cache = nullptr;
+    }
+    bool secondaries = cache != nullptr || isRecordedInParallel(packet);
+    uint32_t scene = graph.addGraphicsPass("Scene", [this, &packet, currentFrameIndex, cache](const RenderGraphContext& context)
+        {
+            recordScenePass(context, packet, currentFrameIndex, cache);
+        },
+        secondaries ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+    graph.addColorAttachment(scene, sceneColor, VK_ATTACHMENT_LOAD_OP_CLEAR, { {0.0f, 0.0f, 0.0f, 1.0f} });
+    graph.addDepthAttachment(scene, depth, VK_ATTACHMENT_LOAD_OP_CLEAR);
+    if (packet.gpuCulling)
+    {
+        graph.addRead(scene, indirect, RenderGraphUsage::INDIRECT);
+        graph.addRead(scene, count, RenderGraphUsage::INDIRECT);
+        graph.addRead(scene, instances, RenderGraphUsage::STORAGE_VERTEX);
+    }
+    if (packet.clusteredLighting)
+    {
+        graph.addRead(scene, clusters, RenderGraphUsage::STORAGE_FRAGMENT);
+        graph.addRead(scene, lightIndices, RenderGraphUsage::STORAGE_FRAGMENT);
+    }
+    if (packet.shadowCascades)
+    {
+        for (RenderGraphResource layer : shadowLayers)
+        {
+            graph.addRead(scene, layer, RenderGraphUsage::SAMPLED_FRAGMENT);
+        }
+    }
+
+    // next frame's occlusion test reads this frame's depth; without it the graph culls the build
+    if (hiZ != INVALID_RENDER_GRAPH_RESOURCE)
+    {
+        uint32_t build = graph.addComputePass("HiZBuild", [this, &packet](const RenderGraphContext& context)
+            {
+                uint32_t zone = beginGpuZone(context.commandBuffer, packet, "Hi-Z Build");
+                packet.hiZPyramid->recordBuild(context.commandBuffer);
+                endGpuZone(context.commandBuffer, packet, zone);
+            });
+        graph.addRead(build, depth, RenderGraphUsage::SAMPLED_COMPUTE);
+        graph.addWrite(build, hiZ, RenderGraphUsage::STORAGE_COMPUTE);
+        if (packet.buildHiZ)
+        {
+            graph.exportResource(hiZ);
+        }
+    }
+}
+
+void VulkanRenderer::writeFrameData(const RenderPacket& packet, uint32_t currentFrameIndex)
+{
+    if (packet.gpuCulling)
+    {
+        packet.gpuCulling->setCullData(currentFrameIndex, packet.cullFrustum,
+            packet.cullViewProjection, packet.occlusionCulling);
+    }
+}
+
+void VulkanRenderer::buildSceneKey(const RenderPacket& packet, uint32_t currentFrameIndex,
+    const RenderGraphContext& context, std::vector<uint64_t>& key)
+{
+    // everything recordSceneDraws turns into commands; data the commands only read is left out
+    auto add = [&key](auto value) { key.push_back((uint64_t)(value)); };
+    key.clear();
+
+    add(context.renderPass);
+    add(context.subpass);
+    add(context.extent.width);
+    add(context.extent.height);
+    add(packet.geometryVertexBuffer);
+    add(packet.geometryIndexBuffer);
+    add(packet.objectDataDescriptorSet);
+    add(packet.objectDataGeneration);
+    add(packet.instanceDescriptorSet);
+    add(packet.bindlessDescriptorSet);
+    add(packet.bindlessGeneration);
+    add(packet.pbrLayout);
+    add(packet.clusteredLighting ? packet.clusteredLighting->getDescriptorSet(currentFrameIndex) : VK_NULL_HANDLE);
+    add(packet.wireframeMode);
+    add(packet.depthPrepass);
+    add(packet.pipelineStatistics);
+    add(packet.gpuProfiler); // its timestamps are part of the recorded commands
+
+    add(packet.skyboxData.has_value() && packet.skyboxData->renderSkyBox);
+    if (packet.skyboxData.has_value())
+    {
+        add(packet.skyboxData->pipeline);
+        add(packet.skyboxData->vertexBuffer);
+        add(packet.skyboxData->descriptorSets[currentFrameIndex]);
+    }
+
+    add(packet.gpuCulling);
+    if (packet.gpuCulling)
+    {
+        add(packet.gpuCulling->getGeneration());
+        for (const GpuDrawGroup& group : packet.gpuCulling->getGroups())
+        {
+            add(group.material->pipelineHandle);
+            add(group.material->wireframePipelineHandle);
+            add(group.material->depthOnlyPipelineHandle);
+            add(group.material->depthEqualPipelineHandle);
+        }
+    }
+
+    add(packet.drawListGeneration);
+}
+
+bool VulkanRenderer::canUseSecondaries(const RenderPacket& packet) const
+{
+    return packet.pipelineStatistics == nullptr || devices.isInheritedQueriesEnabled();
+}
+
+bool VulkanRenderer::isRecordedInParallel(const RenderPacket& packet) const
+{
+    return canUseSecondaries(packet) && packet.parallelRecorder != nullptr && packet.pbrBatches.size() >= PARALLEL_RECORD_THRESHOLD;
+}
+
+void VulkanRenderer::recordScenePass(
+    const RenderGraphContext& context,
+    const RenderPacket& packet,
+    uint32_t currentFrameIndex,
+    VulkanSceneCommandCache* cache)
+{
+    // secondaries continue the graph's render pass; no framebuffer, so cached ones survive resizes
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = context.renderPass;
+    inheritance.subpass = context.subpass;
+    inheritance.framebuffer = VK_NULL_HANDLE;
+    if (packet.pipelineStatistics && devices.isInheritedQueriesEnabled())
+    {
+        inheritance.pipelineStatistics = VulkanPipelineStatistics::getStatisticFlags();
+    }
+
+    if (cache)
+    {
+        buildSceneKey(packet, currentFrameIndex, context, sceneKey);
+        VkCommandBuffer sceneCommands = cache->find(currentFrameIndex, sceneKey);
+        if (sceneCommands == VK_NULL_HANDLE)
+        {
+            resolvePipelines(packet);
+            // the parallel recorder's secondaries are one time submit, so cached ones are recorded on
+            // this thread; this only happens when something changed
+            sceneCommands = cache->beginRecording(currentFrameIndex, inheritance);
+            recordSceneDraws(sceneCommands, packet, currentFrameIndex);
+            cache->endRecording(currentFrameIndex, sceneKey);
+        }
+        vkCmdExecuteCommands(context.commandBuffer, 1, &sceneCommands);
+        return;
+    }
+
+    resolvePipelines(packet);
+    uint32_t batchCount = static_cast<uint32_t>(packet.pbrBatches.size());
+    if (isRecordedInParallel(packet))
+    {
+        // each pass's zone opens in its first chunk and closes in its last, the chunks run in order;
+        // slots are picked here, the workers only write the timestamps
+        uint32_t skyboxZone = VulkanGpuProfiler::INVALID_ZONE;
+        uint32_t passZones[VulkanParallelCommandRecorder::MAX_PASSES] = { VulkanGpuProfiler::INVALID_ZONE, VulkanGpuProfiler::INVALID_ZONE };
+        if (packet.gpuProfiler)
+        {
+            if (packet.depthPrepass)
+            {
+                passZones[0] = packet.gpuProfiler->prepareZone("Depth Pre-pass");
+            }
+            skyboxZone = packet.gpuProfiler->prepareZone("Skybox");
+            passZones[packet.depthPrepass ? 1 : 0] = packet.gpuProfiler->prepareZone("PBR");
+        }
+
+        // large draw lists are recorded on worker threads, no state carries over between secondaries
+        packet.parallelRecorder->record(context.commandBuffer, currentFrameIndex, inheritance, batchCount,
+            [&](VkCommandBuffer secondary, uint32_t pass, uint32_t begin, uint32_t end, bool first, bool last)
+            {
+                bool depthPass = packet.depthPrepass && pass == 0;
+                setViewportAndScissor(secondary, packet.renderExtent);
+                if (first && !depthPass)
+                {
+                    beginPreparedGpuZone(secondary, packet, skyboxZone);
+                    recordSkybox(secondary, packet, currentFrameIndex);
+                    endGpuZone(secondary, packet, skyboxZone);
+                }
+                if (first)
+                {
+                    beginPreparedGpuZone(secondary, packet, passZones[pass]);
+                }
+                recordPbrDraws(secondary, packet, currentFrameIndex, depthPass, first, begin, end);
+                if (last)
+                {
+                    endGpuZone(secondary, packet, passZones[pass]);
+                }
+            },
+            packet.depthPrepass ? 2 : 1);
+        return;
+    }
+
+    recordSceneDraws(context.commandBuffer, packet, currentFrameIndex);
+}
+
+void VulkanRenderer::resolvePipelines(const RenderPacket& packet)
+{
+    resolvedPipelines.assign(packet.pipelineLibrary->getPipelineCount(), VK_NULL_HANDLE);
+    auto resolve = [this, &packet](PipelineHandle handle)
+    {
+        if (handle != INVALID_PIPELINE_HANDLE && resolvedPipelines[handle] == VK_NULL_HANDLE)
+        {
+            resolvedPipelines[handle] = packet.pipelineLibrary->getVkPipeline(handle);
+        }
+    };
+    // whichever of a material's pipelines bindDrawState may pick
+    auto resolveMaterial = [&](const Material* material)
+    {
+        resolve(packet.wireframeMode ? material->wireframePipelineHandle : material->pipelineHandle);
+        if (packet.depthPrepass)
+        {
+            resolve(material->depthOnlyPipelineHandle);
+            resolve(material->depthEqualPipelineHandle);
+        }
+    };
+
+    if (packet.gpuCulling)
+    {
+        for (const GpuDrawGroup& group : packet.gpuCulling->getGroups())
+        {
+            resolveMaterial(group.material);
+        }
+    }
+    for (const DrawBatch& batch : packet.pbrBatches)
+    {
+        resolve(batch.pipelineHandle);
+        resolveMaterial(batch.material);
+    }
+}
+
+void VulkanRenderer::recordSceneDraws(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t currentFrameIndex)
 {
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = vkRenderPass.getVkRenderPass();
-    renderPassInfo.framebuffer = swapChainFramebuffer;
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = swapChainObj.getExtent();
+    uint32_t batchCount = static_cast<uint32_t>(packet.pbrBatches.size());
+    setViewportAndScissor(commandBuffer, packet.renderExtent);
+    if (packet.depthPrepass)
+    {
+        uint32_t zone = beginGpuZone(commandBuffer, packet, "Depth Pre-pass");
+        recordPbrDraws(commandBuffer, packet, currentFrameIndex, true, true, 0, batchCount);
+        endGpuZone(commandBuffer, packet, zone);
+    }
+    uint32_t zone = beginGpuZone(commandBuffer, packet, "Skybox");
+    recordSkybox(commandBuffer, packet, currentFrameIndex);
+    endGpuZone(commandBuffer, packet, zone);
 
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-    clearValues[1].depthStencil = { 1.0f, 0 };
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
+    zone = beginGpuZone(commandBuffer, packet, "PBR");
+    recordPbrDraws(commandBuffer, packet, currentFrameIndex, false, true, 0, batchCount);
+    endGpuZone(commandBuffer, packet, zone);
+}
 
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+void VulkanRenderer::recordShadowCascade(const RenderGraphContext& context, const RenderPacket& packet, uint32_t cascade)
+{
+    VkCommandBuffer commandBuffer = context.commandBuffer;
+    const ShadowCascadeDraws& draws = packet.shadowDraws[cascade];
+    uint32_t zone = beginGpuZone(commandBuffer, packet, SHADOW_ZONE_NAMES[cascade]);
 
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(context.extent.width);
+    viewport.height = static_cast<float>(context.extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.extent = context.extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    if (packet.shadowPipeline != VK_NULL_HANDLE && packet.geometryPositionBuffer != VK_NULL_HANDLE
+        && packet.geometryIndexBuffer != VK_NULL_HANDLE && !draws.batches.empty())
+    {
+        // one pipeline for every caster: depth only, positions only, no material is read
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.shadowPipeline);
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &packet.geometryPositionBuffer, &offset);
+
+        VkDescriptorSet sets[] = { packet.objectDataDescriptorSet, draws.instanceDescriptorSet };
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.shadowLayout,
+            1, 2, sets,
+            0, nullptr);
+
+        glm::mat4 lightViewProjection = packet.shadowCascades->getViewProjection(cascade);
+        vkCmdPushConstants(commandBuffer, packet.shadowLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &lightViewProjection);
+
+        VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+        for (const DrawBatch& batch : draws.batches)
+        {
+            if (batch.indexCount == 0) continue;
+            if (batch.indexType != boundIndexType)
+            {
+                vkCmdBindIndexBuffer(commandBuffer, packet.geometryIndexBuffer, 0, batch.indexType);
+                boundIndexType = batch.indexType;
+            }
+            vkCmdDrawIndexed(commandBuffer, batch.indexCount, batch.instanceCount, batch.firstIndex, batch.vertexOffset, batch.firstInstance);
+        }
+    }
+
+    endGpuZone(commandBuffer, packet, zone);
+
+    // cached cascades are only trusted once their draws made it into a frame
+    packet.shadowCascades->markRendered(cascade);
+}
+
+uint32_t VulkanRenderer::beginGpuZone(VkCommandBuffer commandBuffer, const RenderPacket& packet, const char* name)
+{
+    return packet.gpuProfiler ? packet.gpuProfiler->beginZone(commandBuffer, name) : VulkanGpuProfiler::INVALID_ZONE;
+}
+
+void VulkanRenderer::beginPreparedGpuZone(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t zone)
+{
+    if (packet.gpuProfiler)
+    {
+        packet.gpuProfiler->beginPreparedZone(commandBuffer, zone);
+    }
+}
+
+void VulkanRenderer::endGpuZone(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t zone)
+{
+    if (packet.gpuProfiler)
+    {
+        packet.gpuProfiler->endZone(commandBuffer, zone);
+    }
+}
+
+void VulkanRenderer::setViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent)
+{
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChainObj.getExtent().width);
-    viewport.height = static_cast<float>(swapChainObj.getExtent().height);
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor{};
     scissor.offset = { 0, 0 };
-    scissor.extent = swapChainObj.getExtent();
+    scissor.extent = extent;
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
 
+void VulkanRenderer::recordSkybox(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t currentFrameIndex)
+{
     if (packet.skyboxData.has_value() && packet.skyboxData->renderSkyBox)
     {
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.skyboxData->pipeline);
@@ -71,46 +485,151 @@ void VulkanRenderer::recordSceneCommands(
 
         vkCmdDraw(commandBuffer, 36, 1, 0, 0);
     }
+}
 
+void VulkanRenderer::recordPbrDraws(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t currentFrameIndex,
+    bool depthPass, bool drawGpuGroups, uint32_t firstBatch, uint32_t endBatch)
+{
     // --- draw pbr objects ---
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pbrPipeline);
+    // opaque / masked materials first, alpha blended ones on top of them
+    if (packet.geometryVertexBuffer != VK_NULL_HANDLE && packet.geometryIndexBuffer != VK_NULL_HANDLE)
+    {
+        // all static meshes share these, so they are bound once for the whole pass
+        VkBuffer vertexBuffers[] = { packet.geometryVertexBuffer };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    }
+
+    // bindless: every material lives in set 0, draws only push their material index
+    bool bindless = packet.bindlessDescriptorSet != VK_NULL_HANDLE;
+    if (bindless)
+    {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pbrLayout,
+            0, 1, &packet.bindlessDescriptorSet,
+            0, nullptr);
+    }
+
+    // per-object data is indexed by instance, one bind covers every draw
+    if (packet.objectDataDescriptorSet != VK_NULL_HANDLE)
+    {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pbrLayout,
+            1, 1, &packet.objectDataDescriptorSet,
+            0, nullptr);
+    }
 
-    for (uint32_t i = 0; i < packet.pbrRenderables.size(); i++)
+    // this frame's clustered lights, only read by shader.frag
+    if (packet.clusteredLighting && !depthPass)
     {
-        const auto& renderable = packet.pbrRenderables[i];
+        VkDescriptorSet lightSet = packet.clusteredLighting->getDescriptorSet(currentFrameIndex);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pbrLayout,
+            3, 1, &lightSet,
+            0, nullptr);
+    }
 
-        if (!renderable.vertexBuffer || !renderable.indexBuffer) continue; // skip
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM; // index buffer is only rebound when the width changes
+    VkDescriptorSet boundMaterialSet = VK_NULL_HANDLE;
+    uint32_t boundMaterialIndex = UINT32_MAX;
+    // binds whatever changed since the last draw, false when the draw has to be skipped
+    auto bindDrawState = [&](Material* material, PipelineHandle pipelineHandle, VkIndexType indexType)
+    {
+        // the depth pass only lays down opaque materials; once it has, they shade with an EQUAL test
+        if (depthPass)
+        {
+            pipelineHandle = material->depthOnlyPipelineHandle;
+        }
+        else if (packet.depthPrepass && material->depthEqualPipelineHandle != INVALID_PIPELINE_HANDLE)
+        {
+            pipelineHandle = material->depthEqualPipelineHandle;
+        }
+        if (packet.geometryIndexBuffer == VK_NULL_HANDLE || pipelineHandle == INVALID_PIPELINE_HANDLE) return false;
 
-     /*   VkPipeline pipelineToUse = renderable.material->doubleSided
-            ? packet.pbrPipeline_doubleSided
-            : packet.pbrPipeline;*/
+        VkPipeline pipelineToUse = resolvedPipelines[pipelineHandle];
+        if (pipelineToUse != boundPipeline)
+        {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineToUse);
+            boundPipeline = pipelineToUse;
+        }
 
-        VkBuffer vertexBuffers[] = { renderable.vertexBuffer->getVkBuffer() };
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        if (indexType != boundIndexType)
+        {
+            vkCmdBindIndexBuffer(commandBuffer, packet.geometryIndexBuffer, 0, indexType);
+            boundIndexType = indexType;
+        }
 
-        vkCmdBindIndexBuffer(commandBuffer, renderable.indexBuffer->getVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+        if (depthPass)
+        {
+            // depth.vert only reads the frame ubo from set 0, which every material set shares
+            if (!bindless && boundMaterialSet == VK_NULL_HANDLE)
+            {
+                boundMaterialSet = material->frameSpecificDescriptorSets[currentFrameIndex];
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pbrLayout,
+                    0, 1, &boundMaterialSet,
+                    0, nullptr);
+            }
+        }
+        else if (bindless)
+        {
+            uint32_t materialIndex = material->bindlessIndex;
+            if (materialIndex != boundMaterialIndex)
+            {
+                vkCmdPushConstants(commandBuffer, packet.pbrLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &materialIndex);
+                boundMaterialIndex = materialIndex;
+            }
+        }
+        else
+        {
+            VkDescriptorSet materialDescriptorSet = material->frameSpecificDescriptorSets[currentFrameIndex];
+            if (materialDescriptorSet != boundMaterialSet)
+            {
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pbrLayout,
+                    0, 1, &materialDescriptorSet,
+                    0, nullptr);
+                boundMaterialSet = materialDescriptorSet;
+            }
+        }
+        return true;
+    };
+
+    // GPU culled groups first: one indirect draw per material, instance ids come from the cull pass
+    if (packet.gpuCulling && drawGpuGroups)
+    {
+        VkDescriptorSet gpuInstanceSet = packet.gpuCulling->getInstanceDescriptorSet(currentFrameIndex);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pbrLayout,
+            2, 1, &gpuInstanceSet,
+            0, nullptr);
 
-        uint32_t dynamicOffset = i * static_cast<uint32_t>(packet.dynamicUboAlignment);
+        const auto& groups = packet.gpuCulling->getGroups();
+        for (uint32_t i = 0; i < groups.size(); i++)
+        {
+            PipelineHandle pipelineHandle = packet.wireframeMode
+                ? groups[i].material->wireframePipelineHandle
+                : groups[i].material->pipelineHandle;
+            if (!bindDrawState(groups[i].material, pipelineHandle, groups[i].indexType)) continue;
 
-        VkDescriptorSet materialDescriptorSet = renderable.material->frameSpecificDescriptorSets[currentFrameIndex];
-        
-        // --- ADD THIS LINE FOR DEBUGGING ---
-        //if (materialDescriptorSet == VK_NULL_HANDLE) {
-        //    std::cout << "!! ERROR: Binding NULL descriptor set for material: " << renderable.material->name << std::endl;
-        //}
-        // -----------------------------------
+            packet.gpuCulling->recordDraw(commandBuffer, currentFrameIndex, i);
+        }
+    }
 
+    // object ids for every batch instance, gl_InstanceIndex indexes straight into them
+    if (packet.instanceDescriptorSet != VK_NULL_HANDLE)
+    {
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pbrLayout,
-            0, 1, &materialDescriptorSet,
-            1, &dynamicOffset);
+            2, 1, &packet.instanceDescriptorSet,
+            0, nullptr);
+    }
+
+    // batches arrive in DrawSorter order: opaque grouped by state, then blended back to front
+    for (uint32_t i = firstBatch; i < endBatch; i++)
+    {
+        const auto& batch = packet.pbrBatches[i];
+
+        if (batch.indexCount == 0) continue; // skip
+        if (!bindDrawState(batch.material, batch.pipelineHandle, batch.indexType)) continue;
 
        /* uint32_t useOrm = renderable.material->useOrm ? 1 : 0;
         vkCmdPushConstants(commandBuffer, packet.pbrLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32_t), &useOrm);*/
 
-        vkCmdDrawIndexed(commandBuffer, renderable.indexCount, 1, 0, 0, 0);
+        vkCmdDrawIndexed(commandBuffer, batch.indexCount, batch.instanceCount, batch.firstIndex, batch.vertexOffset, batch.firstInstance);
     }
-
-    vkCmdEndRenderPass(commandBuffer);
 }
-
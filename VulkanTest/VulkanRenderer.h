@@ -5,10 +5,8 @@
 #include <vector>
 #include "VulkanDevice.h"
 #include "VulkanSwapChain.h"
-#include "VulkanRenderPass.h"
 #include "VulkanPipelineLayout.h"
 #include "VulkanGraphicsPipeline.h"
-#include "VulkanFramebuffers.h"
 #include "VulkanCommandBuffers.h"
 #include "VulkanDescriptorSets.h"
 #include "VulkanVertexBuffer.h"
@@ -17,6 +15,9 @@
 #include "VulkanSyncObjects.h"
 #include "ModelLoader.h" // For Vertex, UniformBufferObject (if not in a separate header)
 #include "Renderable.h"
+#include "VulkanRenderGraph.h"
+
+class VulkanSceneCommandCache;
 
 // Forward declare if UniformBufferObject is defined elsewhere and you don't want to include the full header
 // struct UniformBufferObject;
@@ -26,8 +27,6 @@ public:
     VulkanRenderer(
         VulkanDevice& device,
         VulkanSwapChain& swapChain,
-        VulkanRenderPass& renderPass,
-        VulkanFramebuffers& framebuffers,
         VulkanCommandBuffers& commandBuffers,
         VulkanSyncObjects& syncObjects,
         int maxFramesInFlight
@@ -42,15 +41,24 @@ public:
     VulkanRenderer(VulkanRenderer&&) = delete;
     VulkanRenderer& operator=(VulkanRenderer&&) = delete;
 
+    // below this many draws one thread records faster than handing out secondaries
+    static constexpr uint32_t PARALLEL_RECORD_THRESHOLD = 1024;
+
     uint32_t getCurrentFrame() const { return currentFrame; }
 
 
 
-    void recordSceneCommands(
-        VkCommandBuffer commandBuffer,
+    // Declares the frame's scene work on the graph: GPU culling, light binning, the shadow cascades the
+    // packet redraws, the scene pass drawing into sceneColor and depth, and the hi-z build from depth
+    // when packet.buildHiZ asks for it. With a cache the scene
+    // subpass is replayed from its secondary while nothing that was recorded changed.
+    void addScenePasses(
+        VulkanRenderGraph& graph,
         const RenderPacket& packet,
         uint32_t currentFrameIndex,
-        VkFramebuffer swapChainFramebuffer
+        RenderGraphResource sceneColor,
+        RenderGraphResource depth,
+        VulkanSceneCommandCache* cache
     );
 
 
@@ -61,11 +69,42 @@ private:
     // References to Vulkan components (owned by HelloTriangleApplication)
     VulkanDevice& devices; // Renamed to avoid conflict with member name in HelloTriangleApplication
     VulkanSwapChain& swapChainObj;
-    VulkanRenderPass& vkRenderPass; // Using a different name to avoid confusion if original was also named renderPass
-    VulkanFramebuffers& swapChainFramebuffersObj;
     VulkanCommandBuffers& vkCommandBuffers;
     VulkanSyncObjects& syncObjectsRef;
     const int MAX_FRAMES_IN_FLIGHT_RENDERER;
 
     uint32_t currentFrame = 0;
+    std::vector<uint64_t> sceneKey; // reused every frame
+    // VkPipeline by PipelineHandle for everything the scene draws this frame, null for unused handles;
+    // the library locks and may compile, so the parallel recorder's workers only read this
+    std::vector<VkPipeline> resolvedPipelines;
+
+    // CPU side per-frame writes the recorded commands depend on, done whether they are recorded or replayed
+    void writeFrameData(const RenderPacket& packet, uint32_t currentFrameIndex);
+    void buildSceneKey(const RenderPacket& packet, uint32_t currentFrameIndex, const RenderGraphContext& context,
+        std::vector<uint64_t>& key);
+    // inside the scene subpass; contents are secondaries when the cache or the parallel recorder is used
+    void recordScenePass(const RenderGraphContext& context, const RenderPacket& packet, uint32_t currentFrameIndex,
+        VulkanSceneCommandCache* cache);
+    void recordSceneDraws(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t currentFrameIndex);
+    void resolvePipelines(const RenderPacket& packet);
+    // secondaries only run inside the active statistics query with inheritedQueries; without it the
+    // scene is recorded inline whenever the query is on
+    bool canUseSecondaries(const RenderPacket& packet) const;
+    bool isRecordedInParallel(const RenderPacket& packet) const;
+    // one cascade's casters into its layer, then tells the cascades the layer is up to date
+    void recordShadowCascade(const RenderGraphContext& context, const RenderPacket& packet, uint32_t cascade);
+
+    // profiler zones, no-ops without packet.gpuProfiler; never in the primary inside a subpass whose
+    // contents are secondaries. The parallel recorder's workers begin zones prepared on this thread
+    uint32_t beginGpuZone(VkCommandBuffer commandBuffer, const RenderPacket& packet, const char* name);
+    void beginPreparedGpuZone(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t zone);
+    void endGpuZone(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t zone);
+
+    // each records into whatever buffer it is given, so the inline and secondary paths share them
+    void setViewportAndScissor(VkCommandBuffer commandBuffer, VkExtent2D extent);
+    void recordSkybox(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t currentFrameIndex);
+    // depthPass records the pre-pass: opaque draws only, with their depth only pipelines
+    void recordPbrDraws(VkCommandBuffer commandBuffer, const RenderPacket& packet, uint32_t currentFrameIndex,
+        bool depthPass, bool drawGpuGroups, uint32_t firstBatch, uint32_t endBatch);
 };
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "VulkanSceneCommandCache.h"
+
+VulkanSceneCommandCache::VulkanSceneCommandCache()
+	: lastReplayed(false), recordCount(0), pool(VK_NULL_HANDLE), device(VK_NULL_HANDLE)
+{
+}
+
+VulkanSceneCommandCache::~VulkanSceneCommandCache()
+{
+	destroy();
+}
+
+void VulkanSceneCommandCache::create(VkDevice vkdevice, VkCommandPool commandPool, uint32_t numFrames)
+{
+	device = vkdevice;
+	pool = commandPool;
+
+	std::vector<VkCommandBuffer> commandBuffers(numFrames);
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+
+	if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate scene command cache buffers!");
+	}
+
+	entries.resize(commandBuffers.size());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		entries[i].commandBuffer = commandBuffers[i];
+	}
+}
+
+void VulkanSceneCommandCache::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::vector<VkCommandBuffer> commandBuffers;
+	for (const Entry& entry : entries)
+	{
+		commandBuffers.push_back(entry.commandBuffer);
+	}
+	if (!commandBuffers.empty())
+	{
+		vkFreeCommandBuffers(device, pool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+	}
+	entries.clear();
+	pool = VK_NULL_HANDLE;
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanSceneCommandCache::invalidate()
+{
+	for (Entry& entry : entries)
+	{
+		entry.valid = false;
+	}
+}
+
+VkCommandBuffer VulkanSceneCommandCache::find(uint32_t frameIndex, const std::vector<uint64_t>& key)
+{
+	const Entry& entry = entryAt(frameIndex);
+	lastReplayed = entry.valid && entry.key == key;
+	return lastReplayed ? entry.commandBuffer : VK_NULL_HANDLE;
+}
+
+VkCommandBuffer VulkanSceneCommandCache::beginRecording(uint32_t frameIndex, const VkCommandBufferInheritanceInfo& inheritance)
+{
+	Entry& entry = entryAt(frameIndex);
+	entry.valid = false;
+	vkResetCommandBuffer(entry.commandBuffer, 0);
+
+	// executed many times, so no one time submit flag
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritance;
+	if (vkBeginCommandBuffer(entry.commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin recording cached scene command buffer!");
+	}
+	return entry.commandBuffer;
+}
+
+void VulkanSceneCommandCache::endRecording(uint32_t frameIndex, const std::vector<uint64_t>& key)
+{
+	Entry& entry = entryAt(frameIndex);
+	if (vkEndCommandBuffer(entry.commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record cached scene command buffer!");
+	}
+	entry.key = key;
+	entry.valid = true;
+	recordCount++;
+}
+
+VulkanSceneCommandCache::Entry& VulkanSceneCommandCache::entryAt(uint32_t frameIndex)
+{
+	if (device == VK_NULL_HANDLE || frameIndex >= entries.size())
+	{
+		throw std::runtime_error("Scene command cache: invalid frame index");
+	}
+	return entries[frameIndex];
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+// Keeps the scene subpass as one secondary command buffer per frame in flight, together with the key
+// it was recorded from. While a frame's key still matches, the buffer is executed again as is and
+// nothing is recorded; per-frame data (camera, transforms, cull parameters) lives in buffers the
+// commands only read. The key is whatever the recording depended on, built by VulkanRenderer.
+// The buffers inherit no framebuffer, so a resize only changes the key's extent.
+class VulkanSceneCommandCache
+{
+public:
+	VulkanSceneCommandCache();
+	~VulkanSceneCommandCache();
+
+	VulkanSceneCommandCache(const VulkanSceneCommandCache&) = delete;
+	VulkanSceneCommandCache& operator=(const VulkanSceneCommandCache&) = delete;
+
+	// commandPool needs VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
+	void create(VkDevice vkdevice, VkCommandPool commandPool, uint32_t numFrames);
+	void destroy();
+
+	void invalidate();
+
+	// the frame's buffer when it was recorded with the same key, VK_NULL_HANDLE otherwise
+	VkCommandBuffer find(uint32_t frameIndex, const std::vector<uint64_t>& key);
+
+	// only call once the frame's fence has signalled; resets and begins the frame's buffer to continue
+	// the render pass and subpass in inheritance
+	VkCommandBuffer beginRecording(uint32_t frameIndex, const VkCommandBufferInheritanceInfo& inheritance);
+	void endRecording(uint32_t frameIndex, const std::vector<uint64_t>& key);
+
+	bool wasLastReplayed() const { return lastReplayed; }
+	uint64_t getRecordCount() const { return recordCount; }
+
+private:
+	struct Entry
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		std::vector<uint64_t> key;
+		bool valid = false;
+	};
+
+	std::vector<Entry> entries; // one per frame in flight
+	bool lastReplayed;
+	uint64_t recordCount;
+
+	VkCommandPool pool;
+	VkDevice device;
+
+	Entry& entryAt(uint32_t frameIndex);
+};
@@ -0,0 +1,81 @@
+#include "VulkanShaderModuleCache.h"
+
+#include <fstream>
+
+VulkanShaderModuleCache::VulkanShaderModuleCache() : device(VK_NULL_HANDLE)
+{
+}
+
+VulkanShaderModuleCache::~VulkanShaderModuleCache()
+{
+	destroy();
+}
+
+void VulkanShaderModuleCache::create(VkDevice vkdevice)
+{
+	device = vkdevice;
+}
+
+void VulkanShaderModuleCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	for (auto& [path, shaderModule] : shaderModules)
+	{
+		vkDestroyShaderModule(device, shaderModule, nullptr);
+	}
+	shaderModules.clear();
+}
+
+VkShaderModule VulkanShaderModuleCache::getShaderModule(const std::string& path)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Get shader module called before initialization!");
+	}
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	auto it = shaderModules.find(path);
+	if (it != shaderModules.end())
+	{
+		return it->second;
+	}
+
+	VkShaderModule shaderModule = createShaderModule(device, readFile(path));
+	shaderModules.emplace(path, shaderModule);
+	return shaderModule;
+}
+
+std::vector<char> VulkanShaderModuleCache::readFile(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open file: " + filename);
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+	file.close();
+
+	return buffer;
+}
+
+VkShaderModule VulkanShaderModuleCache::createShaderModule(VkDevice vkdevice, const std::vector<char>& code)
+{
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size();
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(vkdevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create shader module!");
+	}
+
+	return shaderModule;
+}
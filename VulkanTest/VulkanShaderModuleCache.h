@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+// Owns every VkShaderModule created from a .spv path so each file is read and
+// compiled into a module only once, no matter how many pipelines use it.
+// Thread safe so pipelines can be built from worker threads.
+class VulkanShaderModuleCache
+{
+public:
+	VulkanShaderModuleCache();
+	~VulkanShaderModuleCache();
+
+	void create(VkDevice vkdevice);
+	void destroy();
+
+	VkShaderModule getShaderModule(const std::string& path);
+
+	static std::vector<char> readFile(const std::string& filename);
+	static VkShaderModule createShaderModule(VkDevice vkdevice, const std::vector<char>& code);
+
+private:
+	std::unordered_map<std::string, VkShaderModule> shaderModules;
+	std::mutex cacheMutex;
+
+	VkDevice device;
+};
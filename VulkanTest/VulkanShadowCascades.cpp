@@ -0,0 +1,283 @@
+#include "VulkanShadowCascades.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "VulkanImage.h"
+#include "VulkanCommandBuffers.h"
+#include "FrustumCuller.h"
+
+namespace
+{
+	// below this the light counts as unchanged, the UI renormalizes the direction every frame
+	constexpr float LIGHT_DIRECTION_EPSILON = 1e-6f;
+}
+
+VulkanShadowCascades::VulkanShadowCascades()
+	: lightView(1.0f), lightDirection(0.0f), hasLightDirection(false), drawnCascadeCount(0),
+	image(VK_NULL_HANDLE), arrayView(VK_NULL_HANDLE), sampler(VK_NULL_HANDLE), device(VK_NULL_HANDLE),
+	allocator(nullptr)
+{
+}
+
+VulkanShadowCascades::~VulkanShadowCascades()
+{
+	destroy();
+}
+
+void VulkanShadowCascades::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool)
+{
+	device = vkdevice;
+	allocator = &memoryAllocator;
+
+	VulkanImage::createImage(device, *allocator, MAP_SIZE, MAP_SIZE, 1, CASCADE_COUNT,
+		DEPTH_FORMAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageAllocation);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	viewInfo.format = DEPTH_FORMAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = CASCADE_COUNT;
+
+	if (vkCreateImageView(device, &viewInfo, nullptr, &arrayView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create shadow cascade array view!");
+	}
+
+	cascadeViews.resize(CASCADE_COUNT, VK_NULL_HANDLE);
+	for (uint32_t cascade = 0; cascade < CASCADE_COUNT; cascade++)
+	{
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.subresourceRange.baseArrayLayer = cascade;
+		viewInfo.subresourceRange.layerCount = 1;
+		if (vkCreateImageView(device, &viewInfo, nullptr, &cascadeViews[cascade]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create shadow cascade layer view!");
+		}
+	}
+
+	// hardware PCF: linear filtering of the compare results, outside the map counts as lit
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+	samplerInfo.compareEnable = VK_TRUE;
+	samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = 0.0f;
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create shadow cascade sampler!");
+	}
+
+	// the scene samples every layer from the first frame on, whether or not it was drawn yet
+	VkCommandBuffer commandBuffer = VulkanCommandBuffers::beginSingleTimeCommands(device, commandPool);
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, CASCADE_COUNT };
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VulkanCommandBuffers::endSingleTimeCommands(commandBuffer, device, graphicsQueue, commandPool);
+
+	invalidateAll();
+}
+
+void VulkanShadowCascades::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	if (sampler != VK_NULL_HANDLE)
+	{
+		vkDestroySampler(device, sampler, nullptr);
+		sampler = VK_NULL_HANDLE;
+	}
+	for (VkImageView view : cascadeViews)
+	{
+		vkDestroyImageView(device, view, nullptr);
+	}
+	cascadeViews.clear();
+	if (arrayView != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(device, arrayView, nullptr);
+		arrayView = VK_NULL_HANDLE;
+	}
+
+	VulkanImage::destroyImage(device, *allocator, image, imageAllocation);
+	hasLightDirection = false;
+	device = VK_NULL_HANDLE;
+}
+
+uint32_t VulkanShadowCascades::update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float shadowDistance,
+	const glm::vec3& direction, const BoundingVolume& sceneBounds)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Shadow cascades update called before initialization!");
+	}
+
+	// a turning light moves every shadow, nothing cached survives it
+	glm::vec3 newDirection = glm::normalize(direction);
+	if (!hasLightDirection || glm::dot(newDirection, lightDirection) < 1.0f - LIGHT_DIRECTION_EPSILON)
+	{
+		lightDirection = newDirection;
+		glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		lightView = glm::lookAt(glm::vec3(0.0f), lightDirection, up);
+		hasLightDirection = true;
+		invalidateAll();
+	}
+
+	// light space depth range of every caster, so nothing between the light and a cascade is clipped
+	float minZ = 0.0f;
+	float maxZ = 0.0f;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 sign((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+		float z = glm::vec3(lightView * glm::vec4(sceneBounds.center + sign * sceneBounds.extents, 1.0f)).z;
+		minZ = corner == 0 ? z : std::min(minZ, z);
+		maxZ = corner == 0 ? z : std::max(maxZ, z);
+	}
+
+	// slice spheres depend on the field of view and the split depths only, not on where the camera looks
+	float tanHalfX = 1.0f / std::abs(projection[0][0]);
+	float tanHalfY = 1.0f / std::abs(projection[1][1]);
+	float spread = tanHalfX * tanHalfX + tanHalfY * tanHalfY; // squared corner offset per unit of depth
+	glm::mat4 inverseView = glm::inverse(view);
+
+	uint32_t drawMask = 0;
+	float sliceNear = nearPlane;
+	for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+	{
+		Cascade& cascade = cascades[i];
+		float fraction = static_cast<float>(i + 1) / CASCADE_COUNT;
+		float logarithmic = nearPlane * std::pow(shadowDistance / nearPlane, fraction);
+		float uniform = nearPlane + (shadowDistance - nearPlane) * fraction;
+		float sliceFar = glm::mix(uniform, logarithmic, SPLIT_LAMBDA);
+		cascade.splitDepth = sliceFar;
+
+		// smallest sphere through the slice's near and far corners, centered on the view axis
+		float centerDepth = std::min(0.5f * (sliceNear + sliceFar) * (1.0f + spread), sliceFar);
+		float farOffset = sliceFar - centerDepth;
+		float radius = std::sqrt(farOffset * farOffset + sliceFar * sliceFar * spread);
+		radius = std::ceil(radius * 16.0f) / 16.0f; // float noise must not resize the cascade
+		glm::vec3 worldCenter = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+		glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(worldCenter, 1.0f));
+		sliceNear = sliceFar;
+
+		if (isCached(i) && cascade.valid
+			&& std::abs(lightCenter.x - cascade.center.x) + radius <= cascade.halfSize
+			&& std::abs(lightCenter.y - cascade.center.y) + radius <= cascade.halfSize)
+		{
+			continue; // the slice is still inside what the layer covers
+		}
+
+		// whole texels only, so a moving camera slides the map instead of resampling it
+		cascade.halfSize = isCached(i) ? radius * CACHE_MARGIN : radius;
+		float texelSize = 2.0f * cascade.halfSize / MAP_SIZE;
+		cascade.center = glm::floor(glm::vec2(lightCenter) / texelSize) * texelSize;
+
+		float nearZ = std::max(maxZ, lightCenter.z + cascade.halfSize);
+		float farZ = std::min(minZ, lightCenter.z - cascade.halfSize);
+		glm::mat4 lightProjection = glm::orthoRH_ZO(
+			cascade.center.x - cascade.halfSize, cascade.center.x + cascade.halfSize,
+			cascade.center.y - cascade.halfSize, cascade.center.y + cascade.halfSize,
+			-nearZ, -farZ);
+		cascade.viewProjection = lightProjection * lightView;
+		cascade.valid = false;
+		drawMask |= 1u << i;
+	}
+
+	drawnCascadeCount = 0;
+	for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+	{
+		drawnCascadeCount += (drawMask >> i) & 1u;
+	}
+	return drawMask;
+}
+
+void VulkanShadowCascades::invalidate(const BoundingVolume& worldBounds)
+{
+	for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+	{
+		if (isCached(i) && cascades[i].valid && Frustum::fromMatrix(cascades[i].viewProjection).intersects(worldBounds))
+		{
+			cascades[i].valid = false;
+		}
+	}
+}
+
+void VulkanShadowCascades::invalidateAll()
+{
+	for (Cascade& cascade : cascades)
+	{
+		cascade.valid = false;
+	}
+}
+
+void VulkanShadowCascades::markRendered(uint32_t cascade)
+{
+	cascades.at(cascade).valid = true;
+}
+
+void VulkanShadowCascades::writeLighting(SceneLightingUBO& lighting, bool enabled) const
+{
+	for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+	{
+		lighting.cascadeViewProjection[i] = cascades[i].viewProjection;
+		lighting.cascadeSplits[i] = cascades[i].splitDepth;
+		lighting.cascadeTexelSizes[i] = 2.0f * cascades[i].halfSize / MAP_SIZE;
+	}
+	lighting.shadowParams = glm::vec4(enabled ? 1.0f : 0.0f, DEPTH_BIAS, NORMAL_OFFSET, 1.0f / MAP_SIZE);
+}
+
+VkImage VulkanShadowCascades::getImage() const
+{
+	if (image == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Get shadow cascade image called before initialization!");
+	}
+	return image;
+}
+
+VkImageView VulkanShadowCascades::getArrayView() const
+{
+	if (arrayView == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Get shadow cascade array view called before initialization!");
+	}
+	return arrayView;
+}
+
+VkImageView VulkanShadowCascades::getCascadeView(uint32_t cascade) const
+{
+	if (cascade >= cascadeViews.size())
+	{
+		throw std::runtime_error("Get shadow cascade view called before initialization!");
+	}
+	return cascadeViews[cascade];
+}
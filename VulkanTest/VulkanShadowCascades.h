@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "VulkanMemoryAllocator.h"
+#include "BoundingVolume.h"
+#include "Lights.h"
+
+// Cascaded shadow maps for the directional light. The view frustum up to the shadow distance is cut
+// into CASCADE_COUNT slices (a blend of logarithmic and uniform splits), each covered by one layer of
+// a depth array rendered from the light. Every cascade is fitted around its slice's bounding sphere,
+// whose size does not change as the camera turns, and its origin is snapped to whole texels, so edges
+// do not shimmer as the camera moves.
+// Cascade 0 is redrawn every frame with every caster. The others only hold static casters and cover
+// CACHE_MARGIN times what their slice needs; they are kept across frames and only redrawn once the
+// light turns, the camera leaves the covered area, or a static caster inside them moves (invalidate).
+// Dynamic casters therefore only shadow within cascade 0.
+// The layers rest in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, shader.frag samples them through
+// the array view with a compare sampler.
+class VulkanShadowCascades
+{
+public:
+	static constexpr uint32_t CASCADE_COUNT = SHADOW_CASCADE_COUNT;
+	static constexpr uint32_t MAP_SIZE = 2048;
+	static constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+	static constexpr float SPLIT_LAMBDA = 0.75f;   // 1 logarithmic splits, 0 uniform
+	static constexpr float CACHE_MARGIN = 1.5f;    // cached cascades cover this times their slice's sphere
+	static constexpr float DEPTH_BIAS = 0.0002f;   // on top of the pipeline's slope scaled bias
+	static constexpr float NORMAL_OFFSET = 1.5f;   // in texels of the cascade, see shader.frag
+
+	VulkanShadowCascades();
+	~VulkanShadowCascades();
+
+	VulkanShadowCascades(const VulkanShadowCascades&) = delete;
+	VulkanShadowCascades& operator=(const VulkanShadowCascades&) = delete;
+
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool);
+	void destroy();
+
+	// every frame shadows are on, before the lighting ubo is written. view / projection are the camera's
+	// (projection y flip does not matter), sceneBounds encloses every caster. Returns a bit per cascade
+	// that has to be drawn this frame
+	uint32_t update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float shadowDistance,
+		const glm::vec3& direction, const BoundingVolume& sceneBounds);
+	// a static caster moved: call with its bounds before and after, cached cascades touching them are redrawn
+	void invalidate(const BoundingVolume& worldBounds);
+	void invalidateAll();
+	// once the cascade's draws are recorded; until then update() keeps asking for it
+	void markRendered(uint32_t cascade);
+
+	void writeLighting(SceneLightingUBO& lighting, bool enabled) const;
+
+	// cascade 0 follows the camera every frame, the rest are cached and only hold static casters
+	static bool isCached(uint32_t cascade) { return cascade > 0; }
+	glm::mat4 getViewProjection(uint32_t cascade) const { return cascades.at(cascade).viewProjection; }
+	uint32_t getDrawnCascadeCount() const { return drawnCascadeCount; } // by the last update()
+
+	VkImage getImage() const;
+	VkImageView getArrayView() const;
+	VkImageView getCascadeView(uint32_t cascade) const;
+	VkSampler getSampler() const { return sampler; }
+	VkExtent2D getExtent() const { return { MAP_SIZE, MAP_SIZE }; }
+
+private:
+	struct Cascade
+	{
+		glm::mat4 viewProjection{ 1.0f };
+		glm::vec2 center{ 0.0f };  // light space, snapped to texels
+		float halfSize = 0.0f;     // half the covered width in world units
+		float splitDepth = 0.0f;   // view depth the cascade reaches
+		bool valid = false;        // the layer holds what viewProjection describes
+	};
+
+	std::array<Cascade, CASCADE_COUNT> cascades;
+	glm::mat4 lightView;
+	glm::vec3 lightDirection;
+	bool hasLightDirection;
+	uint32_t drawnCascadeCount;
+
+	VkImage image;
+	VulkanAllocation imageAllocation;
+	VkImageView arrayView;                 // every cascade, sampled by shader.frag
+	std::vector<VkImageView> cascadeViews; // one layer each, the depth attachment of its pass
+	VkSampler sampler;
+
+	VkDevice device;
+	VulkanMemoryAllocator* allocator;
+};
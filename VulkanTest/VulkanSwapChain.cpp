@@ -25,6 +25,11 @@ VkSwapchainKHR VulkanSwapChain::getSwapChain() const
 	return swapChain;
 }
 
+std::vector<VkImage> VulkanSwapChain::getImages() const
+{
+	return swapChainImages;
+}
+
 std::vector<VkImageView> VulkanSwapChain::getImageViews() const
 {
 	return swapChainImageViews;
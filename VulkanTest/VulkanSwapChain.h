@@ -23,6 +23,7 @@ public:
 	~VulkanSwapChain();
 
 	VkSwapchainKHR getSwapChain() const;
+	std::vector<VkImage> getImages() const;
 	std::vector<VkImageView> getImageViews() const;
 	VkExtent2D getExtent() const;
 	VkFormat getImageFormat() const;
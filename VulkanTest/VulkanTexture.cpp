@@ -4,7 +4,7 @@
 #include <stb_image.h>
 
 
-VulkanTexture::VulkanTexture() : textureImage(VK_NULL_HANDLE), textureImageMemory(VK_NULL_HANDLE), textureImageView(VK_NULL_HANDLE), textureSampler(VK_NULL_HANDLE), device(VK_NULL_HANDLE)
+VulkanTexture::VulkanTexture() : textureImage(VK_NULL_HANDLE), textureImageView(VK_NULL_HANDLE), textureSampler(VK_NULL_HANDLE), device(VK_NULL_HANDLE), allocator(nullptr)
 {
 }
 
@@ -31,17 +31,7 @@ void VulkanTexture::destroy()
 		textureImageView = VK_NULL_HANDLE;
 	}
 	
-	if (textureImage != VK_NULL_HANDLE)
-	{
-		vkDestroyImage(device, textureImage, nullptr);
-		textureImage = VK_NULL_HANDLE;
-	}
-
-	if (textureImageMemory != VK_NULL_HANDLE)
-	{
-		vkFreeMemory(device, textureImageMemory, nullptr);
-		textureImageMemory = VK_NULL_HANDLE;
-	}
+	VulkanImage::destroyImage(device, *allocator, textureImage, textureImageAllocation);
 	device = VK_NULL_HANDLE;
 }
 
@@ -74,9 +64,10 @@ VkSampler VulkanTexture::getSampler() const
 }
 
 
-void VulkanTexture::createTexture2D(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, const std::string& path, bool sRGB)
+void VulkanTexture::createTexture2D(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, const std::string& path, bool sRGB)
 {
 	this->device = vkdevice;
+	allocator = &memoryAllocator;
 	int texWidth, texHeight, texChannels;
 	stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 
@@ -88,36 +79,34 @@ void VulkanTexture::createTexture2D(VkDevice vkdevice, VkPhysicalDevice vkphysde
 	VkDeviceSize imageSize = texWidth * texHeight * 4;
 
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	VulkanAllocation stagingBufferAllocation;
 
 	VulkanBuffer::createBuffer(
 		vkdevice,
-		vkphysdevice,
+		*allocator,
 		imageSize,
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 		stagingBuffer,
-		stagingBufferMemory
+		stagingBufferAllocation
 	);
 
-	void* data;
-	vkMapMemory(vkdevice, stagingBufferMemory, 0, imageSize, 0, &data);
+	void* data = stagingBufferAllocation.mappedData;
 	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(vkdevice, stagingBufferMemory);
 
 	stbi_image_free(pixels);
 
 	VkFormat format = sRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
 
 	VulkanImage::createImage(
-		vkdevice, vkphysdevice,
+		vkdevice, *allocator,
 		texWidth, texHeight,
 		1, 1,
 		VK_FORMAT_R8G8B8A8_SRGB,
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		textureImage, textureImageMemory
+		textureImage, textureImageAllocation
 	);
 
 	VulkanImage::transitionImageLayout(vkdevice, graphicsQueue, commandPool, textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
@@ -126,17 +115,17 @@ void VulkanTexture::createTexture2D(VkDevice vkdevice, VkPhysicalDevice vkphysde
 
 	VulkanImage::transitionImageLayout(vkdevice, graphicsQueue, commandPool, textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-	vkDestroyBuffer(vkdevice, stagingBuffer, nullptr);
-	vkFreeMemory(vkdevice, stagingBufferMemory, nullptr);
+	VulkanBuffer::destroyBuffer(vkdevice, *allocator, stagingBuffer, stagingBufferAllocation);
 
 	createTextureImageView(device, VK_FORMAT_R8G8B8A8_SRGB);
 	createTextureSampler(device, vkphysdevice, 1);
 }
 
 // This function loads the HDR but DOES NOT create a cubemap. It creates a simple 2D float texture.
-void VulkanTexture::createTextureHDR(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, const std::string& path)
+void VulkanTexture::createTextureHDR(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, const std::string& path)
 {
 	device = vkdevice;
+	allocator = &memoryAllocator;
 	int texWidth, texHeight, texChannels;
 	float* pixels = stbi_loadf(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 	if (!pixels) { throw std::runtime_error("Failed to load HDR image file!"); }
@@ -145,31 +134,29 @@ void VulkanTexture::createTextureHDR(VkDevice vkdevice, VkPhysicalDevice vkphysd
 
 	// Create staging buffer and copy data (this part of your code was correct)
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	VulkanAllocation stagingBufferAllocation;
 	VulkanBuffer::createBuffer(
 		vkdevice,
-		vkphysdevice,
+		*allocator,
 		imageSize, 
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-		stagingBuffer, stagingBufferMemory
+		stagingBuffer, stagingBufferAllocation
 	);
-	void* data;
-	vkMapMemory(vkdevice, stagingBufferMemory, 0, imageSize, 0, &data);
+	void* data = stagingBufferAllocation.mappedData;
 	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(vkdevice, stagingBufferMemory);
 	stbi_image_free(pixels);
 
 	// Create the destination 2D image (NOT a cubemap)
 	VulkanImage::createImage(
-		vkdevice, vkphysdevice,
+		vkdevice, *allocator,
 		texWidth, texHeight,
 		1, 1,
 		VK_FORMAT_R32G32B32A32_SFLOAT, // Float format for HDR
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // Just needs to be sampled
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		textureImage, textureImageMemory
+		textureImage, textureImageAllocation
 	);
 
 	// Transition layout and copy from staging buffer (this part of your code was also correct)
@@ -177,36 +164,37 @@ void VulkanTexture::createTextureHDR(VkDevice vkdevice, VkPhysicalDevice vkphysd
 	VulkanImage::copyBufferToImage(vkdevice, commandPool, graphicsQueue, stagingBuffer, textureImage, texWidth, texHeight);
 	VulkanImage::transitionImageLayout(vkdevice, graphicsQueue, commandPool, textureImage, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-	vkDestroyBuffer(vkdevice, stagingBuffer, nullptr);
-	vkFreeMemory(vkdevice, stagingBufferMemory, nullptr);
+	VulkanBuffer::destroyBuffer(vkdevice, *allocator, stagingBuffer, stagingBufferAllocation);
 
 	// Create the image view and sampler
 	textureImageView = VulkanImage::createImageView(device, textureImage, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT);
 	createTextureSampler(device, vkphysdevice, 1); // Assuming this is your existing sampler function
 }
 
-void VulkanTexture::createCubemap(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, uint32_t width, uint32_t height, uint32_t mipLevels)
+void VulkanTexture::createCubemap(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t width, uint32_t height, uint32_t mipLevels)
 {
 	device = vkdevice;
-	VulkanImage::createCubeMapImage(vkdevice, vkphysdevice, width, height, mipLevels, textureImage, textureImageMemory);
+	allocator = &memoryAllocator;
+	VulkanImage::createCubeMapImage(vkdevice, *allocator, width, height, mipLevels, textureImage, textureImageAllocation);
 	textureImageView = VulkanImage::createCubeMapView(vkdevice, textureImage, mipLevels);
 	createTextureSampler(device, vkphysdevice, mipLevels);
 }
 
-void VulkanTexture::createRenderableTexture(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage)
+void VulkanTexture::createRenderableTexture(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage)
 {
 	this->device = vkdevice;
+	allocator = &memoryAllocator;
 	uint32_t mipLevels = 1;
 
 	VulkanImage::createImage(
-		device, vkphysdevice,
+		device, *allocator,
 		width, height,
 		mipLevels, 1,
 		format,
 		VK_IMAGE_TILING_OPTIMAL,
 		usage,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		textureImage, textureImageMemory
+		textureImage, textureImageAllocation
 	);
 
 	textureImageView = VulkanImage::createImageView(
@@ -221,12 +209,14 @@ void VulkanTexture::createRenderableTexture(VkDevice vkdevice, VkPhysicalDevice
 void VulkanTexture::createTexture2DFromMemory(
 	VkDevice device, 
 	VkPhysicalDevice physicalDevice, 
+	VulkanMemoryAllocator& memoryAllocator, 
 	VkQueue graphicsQueue, 
 	VkCommandPool commandPool, 
 	const unsigned char* pixelData, 
 	int width, int height, int channels, bool sRGB)
 {
 	this->device = device;
+	allocator = &memoryAllocator;
 
 	if (!pixelData) {
 		throw std::runtime_error("Cannot create texture from null pixel data!");
@@ -235,19 +225,18 @@ void VulkanTexture::createTexture2DFromMemory(
 	VkDeviceSize imageSize = width * height * 4;
 
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	VulkanAllocation stagingBufferAllocation;
 	VulkanBuffer::createBuffer(
 		device,
-		physicalDevice,
+		*allocator,
 		imageSize,
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 		stagingBuffer,
-		stagingBufferMemory
+		stagingBufferAllocation
 	);
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
+	void* data = stagingBufferAllocation.mappedData;
 
 	if (channels == 4)
 	{
@@ -266,22 +255,21 @@ void VulkanTexture::createTexture2DFromMemory(
 	}
 	else
 	{
-		vkUnmapMemory(device, stagingBufferMemory);
+		VulkanBuffer::destroyBuffer(device, *allocator, stagingBuffer, stagingBufferAllocation);
 		throw std::runtime_error("Unsupported texture channel count for in-memory loading: " + std::to_string(channels));
 	}
 
-	vkUnmapMemory(device, stagingBufferMemory);
 
 	VkFormat format = sRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
 	VulkanImage::createImage(
-		device, physicalDevice,
+		device, *allocator,
 		width, height,
 		1, 1,
 		format,
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		textureImage, textureImageMemory
+		textureImage, textureImageAllocation
 	);
 
 	VulkanImage::transitionImageLayout(
@@ -300,8 +288,7 @@ void VulkanTexture::createTexture2DFromMemory(
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
 	);
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	VulkanBuffer::destroyBuffer(device, *allocator, stagingBuffer, stagingBufferAllocation);
 
 	createTextureImageView(device, format);
 	createTextureSampler(device, physicalDevice, 1);
@@ -14,13 +14,14 @@ public:
 	~VulkanTexture();
 
 	//void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkCommandPool commandPool, VkQueue graphicsQueue, const std::string& path, bool skybox = false);
-	void createTexture2D(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, const std::string& path,  bool sRGB = false);
-	void createTextureHDR(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, const std::string& path);
-	void createCubemap(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, uint32_t width, uint32_t height, uint32_t mipLevel);
+	void createTexture2D(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, const std::string& path,  bool sRGB = false);
+	void createTextureHDR(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, const std::string& path);
+	void createCubemap(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t width, uint32_t height, uint32_t mipLevel);
 	// for creating an empty render target
 	void createRenderableTexture(
 		VkDevice vkdevice,
 		VkPhysicalDevice vkphysdevice,
+		VulkanMemoryAllocator& memoryAllocator,
 		uint32_t width,
 		uint32_t height,
 		VkFormat format,
@@ -30,6 +31,7 @@ public:
 	void createTexture2DFromMemory(
 		VkDevice device,
 		VkPhysicalDevice physicalDevice,
+		VulkanMemoryAllocator& memoryAllocator,
 		VkQueue graphicsQueue,
 		VkCommandPool commandPool,
 		const unsigned char* pixelData,
@@ -47,11 +49,12 @@ public:
 
 private:
 	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
+	VulkanAllocation textureImageAllocation;
 	VkImageView textureImageView;
 	VkSampler textureSampler;
 
 	VkDevice device;
+	VulkanMemoryAllocator* allocator;
 
 	void createTextureImageView(VkDevice vkdevice, VkFormat format);
 	void createSkyboxHdrImageView(VkDevice vkdevice);
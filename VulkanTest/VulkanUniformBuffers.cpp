@@ -1,8 +1,8 @@
 #include "VulkanUniformBuffers.h"
 
 VulkanUniformBuffers::VulkanUniformBuffers()
-	: uniformBuffers({}), uniformBuffersMemory({}), uniformBuffersMapped({}),
-	device(VK_NULL_HANDLE), frameCount(0), isDynamic(false), dynamicAlignment(0), bufferSize(0)
+	: uniformBuffers({}), uniformBuffersAllocation({}), uniformBuffersMapped({}),
+	device(VK_NULL_HANDLE), allocator(nullptr), frameCount(0), isDynamic(false), dynamicAlignment(0), bufferSize(0)
 {
 }
 
@@ -70,10 +70,11 @@ VulkanUniformBuffers::~VulkanUniformBuffers()
 //	
 //}
 
-void VulkanUniformBuffers::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, uint32_t numFrames,
+void VulkanUniformBuffers::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames,
 	VkDeviceSize perFrameBufferSize, bool isDynamic)
 {
 	device = vkdevice;
+	allocator = &memoryAllocator;
 	frameCount = numFrames;
 	this->isDynamic = isDynamic;
 	this->bufferSize = perFrameBufferSize; // Store the size of a single frame's data
@@ -86,52 +87,36 @@ void VulkanUniformBuffers::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevi
 	}
 
 	uniformBuffers.resize(frameCount);
-	uniformBuffersMemory.resize(frameCount);
+	uniformBuffersAllocation.resize(frameCount);
 	uniformBuffersMapped.resize(frameCount);
 
+	// written by the CPU every frame: lands directly in VRAM when resizable BAR is exposed
+	VkMemoryPropertyFlags memoryProperties = allocator->getDirectWriteMemoryProperties();
+
 	for (size_t i = 0; i < frameCount; i++)
 	{
 		VulkanBuffer::createBuffer(
 			device,
-			vkphysdevice,
+			*allocator,
 			bufferSize, // CORRECT: Always use the passed-in size
 			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			memoryProperties,
 			uniformBuffers[i],
-			uniformBuffersMemory[i]
+			uniformBuffersAllocation[i]
 		);
 
-		vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0, &uniformBuffersMapped[i]);
+		uniformBuffersMapped[i] = uniformBuffersAllocation[i].mappedData;
 	}
 }
 
 void VulkanUniformBuffers::destroy()
 {
-	if (!uniformBuffers.empty())
+	for (size_t i = 0; i < uniformBuffers.size(); i++)
 	{
-		for (size_t i = 0; i < frameCount; i++)
-		{
-			if (uniformBuffers[i] != VK_NULL_HANDLE)
-			{
-				vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-				uniformBuffers[i] = VK_NULL_HANDLE;
-			}
-		}
-		uniformBuffers.clear();
-	}
-
-	if (!uniformBuffersMemory.empty())
-	{
-		for (size_t i = 0; i < frameCount; i++)
-		{
-			if (uniformBuffersMemory[i] != VK_NULL_HANDLE)
-			{
-				vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
-				uniformBuffersMemory[i] = VK_NULL_HANDLE;
-			}
-		}
-		uniformBuffersMemory.clear();
+		VulkanBuffer::destroyBuffer(device, *allocator, uniformBuffers[i], uniformBuffersAllocation[i]);
 	}
+	uniformBuffers.clear();
+	uniformBuffersAllocation.clear();
 	uniformBuffersMapped.clear();
 }
 template<typename T>
@@ -155,22 +140,6 @@ void VulkanUniformBuffers::update(uint32_t frameIndex, const T& ubo)
 	memcpy(uniformBuffersMapped[frameIndex], &ubo, sizeof(T));
 }
 
-void VulkanUniformBuffers::updateDynamic(uint32_t frameIndex, uint32_t objectIndex, const ObjectUniformBufferObject& ubo)
-{
-	if (!isDynamic)
-	{
-		throw std::runtime_error("updateDynamic called on non-dynamic UBO");
-	}
-	if (frameIndex >= frameCount)
-	{
-		throw std::runtime_error("Update dynamic uniform buffer: invalid frame index");
-	}
-
-	// Calculate the aligned offset for the object
-	VkDeviceSize offset = objectIndex * dynamicAlignment;
-	memcpy(static_cast<char*>(uniformBuffersMapped[frameIndex]) + offset, &ubo, sizeof(ubo));
-}
-
 // ONLY CALL IF UBO IS FOR UPDATING SceneLightingUBO!!!
 void VulkanUniformBuffers::updateLights(uint32_t frameIndex, SceneLightingUBO& lightUbo)
 {
@@ -212,19 +181,6 @@ void* VulkanUniformBuffers::getMappedMemory(uint32_t frameIndex) const
 	return uniformBuffersMapped[frameIndex];
 }
 
-VkDeviceSize VulkanUniformBuffers::totalObjectDataBufferSize(VkPhysicalDevice physdevice)
-{
-	VkDeviceSize objectDataUboAlignedSize;
-	
-	VkPhysicalDeviceProperties properties;
-	vkGetPhysicalDeviceProperties(physdevice, &properties);
-	VkDeviceSize minUboAlignment = properties.limits.minUniformBufferOffsetAlignment;
-
-	objectDataUboAlignedSize = (sizeof(ObjectUniformBufferObject) + minUboAlignment - 1) & ~(minUboAlignment - 1);
-
-	return objectDataUboAlignedSize * VulkanGlobals::MAX_EXPECTED_OBJECTS;
-}
-
 // Explicit template instantiations
 template void VulkanUniformBuffers::update<FrameUniformBufferObject>(uint32_t frameIndex, const FrameUniformBufferObject& ubo);
 template void VulkanUniformBuffers::update<TessellationUBO>(uint32_t frameIndex, const TessellationUBO& ubo);
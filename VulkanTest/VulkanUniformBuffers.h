@@ -18,10 +18,11 @@ struct FrameUniformBufferObject
 	// Later add lighting global data like camera position, ambietn light, etc
 };
 
+// one element of the std430 object array in set 1, stride must match shader.vert
 struct ObjectUniformBufferObject 
 {
 	alignas(16) glm::mat4 model;
-	// Later could add material IDs or other per-object shader params
+	alignas(16) glm::mat3x4 normalMatrix; // inverse transpose of model's upper 3x3, a std430 mat3 (vec4 padded columns)
 };
 
 struct TessellationUBO {
@@ -53,7 +54,7 @@ public:
 	VulkanUniformBuffers();
 	~VulkanUniformBuffers();
 
-	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, uint32_t numFrames, 
+	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VulkanMemoryAllocator& memoryAllocator, uint32_t numFrames, 
 		VkDeviceSize perFrameBufferSize,
 		bool isDynamic = false);
 
@@ -63,8 +64,6 @@ public:
 	template<typename T>
 	void update(uint32_t frameIndex, const T& ubo);
 
-	void updateDynamic(uint32_t frameIndex, uint32_t objectIndex, const ObjectUniformBufferObject& ubo);
-
 	void updateLights(uint32_t frameIndex, SceneLightingUBO& lightUbo);
 
 	VkBuffer getBuffer(uint32_t frameIndex) const;
@@ -73,17 +72,16 @@ public:
 
 	void* getMappedMemory(uint32_t frameIndex) const;
 
-	static VkDeviceSize totalObjectDataBufferSize(VkPhysicalDevice physdevice);
-
 	VkDeviceSize getDynamicAlignment() const { return dynamicAlignment; }
 
 private:
 	std::vector<VkBuffer> uniformBuffers;
-	std::vector<VkDeviceMemory> uniformBuffersMemory;
+	std::vector<VulkanAllocation> uniformBuffersAllocation;
 	std::vector<void*> uniformBuffersMapped;
 	VkDeviceSize bufferSize;
 
 	VkDevice device;
+	VulkanMemoryAllocator* allocator;
 	uint32_t frameCount;
 
 	bool isDynamic;
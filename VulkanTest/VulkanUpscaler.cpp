@@ -0,0 +1,194 @@
+#include "VulkanUpscaler.h"
+
+VulkanUpscaler::VulkanUpscaler()
+	: sampler(VK_NULL_HANDLE), setLayout(VK_NULL_HANDLE), descriptorPool(VK_NULL_HANDLE), pipelineLayout(VK_NULL_HANDLE),
+	device(VK_NULL_HANDLE)
+{
+}
+
+VulkanUpscaler::~VulkanUpscaler()
+{
+	destroy();
+}
+
+void VulkanUpscaler::create(VkDevice vkdevice, uint32_t numFrames, VkRenderPass renderPass, uint32_t subpass,
+	VulkanShaderModuleCache* shaderModuleCache, VkPipelineCache pipelineCache)
+{
+	device = vkdevice;
+
+	// bilinear taps are what the 9 tap filter is built from
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = 0.0f;
+
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create upscale sampler!");
+	}
+
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create upscale descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = numFrames;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = numFrames;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create upscale descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(numFrames, setLayout);
+	descriptorSets.resize(numFrames);
+	sourceViews.assign(numFrames, VK_NULL_HANDLE);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = numFrames;
+	allocInfo.pSetLayouts = layouts.data();
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate upscale descriptor sets!");
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(SourceSize);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create upscale pipeline layout!");
+	}
+
+	pipeline.createFullscreen(device, pipelineLayout, renderPass, subpass,
+		"shaders/fullscreen.vert.spv", "shaders/upscale.frag.spv",
+		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+		shaderModuleCache, pipelineCache);
+}
+
+void VulkanUpscaler::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	pipeline.destroy();
+	if (pipelineLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		pipelineLayout = VK_NULL_HANDLE;
+	}
+	if (descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		descriptorPool = VK_NULL_HANDLE;
+	}
+	descriptorSets.clear();
+	sourceViews.clear();
+	if (setLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+		setLayout = VK_NULL_HANDLE;
+	}
+	if (sampler != VK_NULL_HANDLE)
+	{
+		vkDestroySampler(device, sampler, nullptr);
+		sampler = VK_NULL_HANDLE;
+	}
+	device = VK_NULL_HANDLE;
+}
+
+void VulkanUpscaler::setSource(uint32_t frameIndex, VkImageView sourceView)
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Upscaler set source called before initialization!");
+	}
+	if (sourceViews.at(frameIndex) == sourceView)
+	{
+		return;
+	}
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = sourceView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSets[frameIndex];
+	write.dstBinding = 0;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.descriptorCount = 1;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+	sourceViews[frameIndex] = sourceView;
+}
+
+void VulkanUpscaler::record(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkExtent2D sourceExtent, VkExtent2D outputExtent)
+{
+	if (device == VK_NULL_HANDLE || sourceViews.at(frameIndex) == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Upscaler record called before initialization!");
+	}
+
+	VkViewport viewport{};
+	viewport.width = static_cast<float>(outputExtent.width);
+	viewport.height = static_cast<float>(outputExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.extent = outputExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	SourceSize size{};
+	size.width = static_cast<float>(sourceExtent.width);
+	size.height = static_cast<float>(sourceExtent.height);
+	size.inverseWidth = 1.0f / size.width;
+	size.inverseHeight = 1.0f / size.height;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.getVkPipeline());
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[frameIndex], 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SourceSize), &size);
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
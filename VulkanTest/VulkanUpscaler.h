@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+#include "VulkanGraphicsPipeline.h"
+#include "VulkanShaderModuleCache.h"
+
+// Draws the scene colour target onto the swap chain image with a Catmull-Rom filter (upscale.frag),
+// which keeps edges sharper than plain bilinear when the scene renders below the output size.
+// Recorded by the frame graph's Upscale pass, whose render pass the UI is merged into. The source is
+// a graph transient, so its view can change whenever the render extent does; setSource rewrites the
+// frame's descriptor set only when it has.
+class VulkanUpscaler
+{
+public:
+	VulkanUpscaler();
+	~VulkanUpscaler();
+
+	VulkanUpscaler(const VulkanUpscaler&) = delete;
+	VulkanUpscaler& operator=(const VulkanUpscaler&) = delete;
+
+	// renderPass / subpass are the Upscale pass's in the compiled frame graph
+	void create(VkDevice vkdevice, uint32_t numFrames, VkRenderPass renderPass, uint32_t subpass,
+		VulkanShaderModuleCache* shaderModuleCache, VkPipelineCache pipelineCache);
+	void destroy();
+
+	// once the frame's fence has signalled; sourceView is sampled in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	void setSource(uint32_t frameIndex, VkImageView sourceView);
+	// inside the Upscale subpass, covering the whole of outputExtent
+	void record(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkExtent2D sourceExtent, VkExtent2D outputExtent);
+
+private:
+	struct SourceSize
+	{
+		float width;
+		float height;
+		float inverseWidth;
+		float inverseHeight;
+	};
+
+	VkSampler sampler;
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool descriptorPool;
+	std::vector<VkDescriptorSet> descriptorSets;
+	std::vector<VkImageView> sourceViews; // what each frame's set points at
+	VkPipelineLayout pipelineLayout;
+	VulkanGraphicsPipeline pipeline;
+
+	VkDevice device;
+};
@@ -1,6 +1,6 @@
 #include "VulkanVertexBuffer.h"
 
-VulkanVertexBuffer::VulkanVertexBuffer() : device(VK_NULL_HANDLE), vertexBuffer(VK_NULL_HANDLE), vertexBufferMemory(VK_NULL_HANDLE)
+VulkanVertexBuffer::VulkanVertexBuffer() : device(VK_NULL_HANDLE), allocator(nullptr), vertexBuffer(VK_NULL_HANDLE)
 {
 }
 
@@ -9,37 +9,36 @@ VulkanVertexBuffer::~VulkanVertexBuffer()
 	destroy();
 }
 
-void VulkanVertexBuffer::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, const std::vector<Vertex>& vertices)
+void VulkanVertexBuffer::create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, const std::vector<Vertex>& vertices)
 {
 	device = vkdevice;
+	allocator = &memoryAllocator;
 
 	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
 
 	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	VulkanAllocation stagingBufferAllocation;
 
 	VulkanBuffer::createBuffer(
 		device,
-		vkphysdevice,
+		*allocator,
 		bufferSize,
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer, stagingBufferMemory
+		stagingBuffer, stagingBufferAllocation
 	);
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+	void* data = stagingBufferAllocation.mappedData;
 	memcpy(data, vertices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
 
 	VulkanBuffer::createBuffer(
 		device,
-		vkphysdevice,
+		*allocator,
 		bufferSize,
 		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		vertexBuffer,
-		vertexBufferMemory
+		vertexBufferAllocation
 	);
 
 	VulkanBuffer::copyBuffer(
@@ -51,22 +50,16 @@ void VulkanVertexBuffer::create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice
 		bufferSize
 	);
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	VulkanBuffer::destroyBuffer(device, *allocator, stagingBuffer, stagingBufferAllocation);
 }
 
 void VulkanVertexBuffer::destroy()
 {
-	if (vertexBuffer != VK_NULL_HANDLE)
+	if (device == VK_NULL_HANDLE)
 	{
-		vkDestroyBuffer(device, vertexBuffer, nullptr);
-		vertexBuffer = VK_NULL_HANDLE;
-	}
-	if (vertexBufferMemory != VK_NULL_HANDLE)
-	{
-		vkFreeMemory(device, vertexBufferMemory, nullptr);
-		vertexBufferMemory = VK_NULL_HANDLE;
+		return;
 	}
+	VulkanBuffer::destroyBuffer(device, *allocator, vertexBuffer, vertexBufferAllocation);
 }
 
 VkBuffer VulkanVertexBuffer::getVkBuffer() const
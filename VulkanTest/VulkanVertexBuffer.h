@@ -12,15 +12,16 @@ public:
 	VulkanVertexBuffer();
 	~VulkanVertexBuffer();
 
-	void create(VkDevice vkdevice, VkPhysicalDevice vkphysdevice, VkQueue graphicsQueue, VkCommandPool commandPool, const std::vector<Vertex>& vertices);
+	void create(VkDevice vkdevice, VulkanMemoryAllocator& memoryAllocator, VkQueue graphicsQueue, VkCommandPool commandPool, const std::vector<Vertex>& vertices);
 	void destroy();
 
 	VkBuffer getVkBuffer() const;
 
 private:
 	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
+	VulkanAllocation vertexBufferAllocation;
 
 	VkDevice device;
+	VulkanMemoryAllocator* allocator;
 };
 
@@ -13,6 +13,8 @@
 #include <memory>
 #include <map>
 #include <algorithm>
+#include <future>
+#include <random>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -32,15 +34,36 @@
 #include "VulkanDescriptorSetLayout.h"
 #include "VulkanPipelineLayout.h"
 #include "VulkanGraphicsPipeline.h"
-#include "VulkanFramebuffers.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanPipelineCache.h"
+#include "VulkanShaderModuleCache.h"
+#include "VulkanPipelineLibrary.h"
 #include "VulkanCommandPool.h"
 #include "VulkanCommandBuffers.h"
 #include "VulkanVertexBuffer.h"
 #include "VulkanIndexBuffer.h"
 #include "VulkanUniformBuffers.h"
+#include "VulkanFrameAllocator.h"
+#include "VulkanObjectDataBuffer.h"
+#include "VulkanBindlessMaterials.h"
+#include "FrustumCuller.h"
+#include "TransformSystem.h"
+#include "DrawSorter.h"
+#include "DrawBatcher.h"
+#include "VulkanGpuCulling.h"
+#include "VulkanParallelCommandRecorder.h"
+#include "VulkanHiZPyramid.h"
+#include "VulkanClusteredLighting.h"
+#include "VulkanShadowCascades.h"
+#include "VulkanPipelineStatistics.h"
+#include "VulkanDynamicResolution.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanUpscaler.h"
+#include "VulkanSceneCommandCache.h"
+#include "VulkanRenderGraph.h"
 #include "VulkanTexture.h"
 #include "VulkanDepthResources.h"
-#include "VulkanDescriptorPool.h"
+#include "VulkanDescriptorAllocator.h"
 #include "VulkanDescriptorSets.h"
 #include "VulkanSyncObjects.h"
 #include "VulkanRenderer.h"
@@ -53,6 +76,7 @@
 #include "Lights.h"
 #include "AssetManager.h"
 #include "ImGuiManager.h"
+#include "CpuProfiler.h"
 
 
 const std::vector<const char*> validationLayers = {
@@ -93,11 +117,18 @@ class VulkanEngine
 public:
 	void run()
 	{
+		// startup goes into the history as one long frame, asset loading and pipeline builds show in the trace
+		CpuProfiler::setThreadName("Main");
+		CpuProfiler::beginFrame();
 		initWindow();
 		initVulkan();
+		CpuProfiler::endFrame();
 		mainLoop();
 		cleanup();
 	}
+
+	// before run(): renders at this scale with the dynamic resolution controller off, for benchmarks
+	void setFixedRenderScale(float renderScale) { m_FixedRenderScale = renderScale; }
 private:
 	std::unique_ptr<Window> window;
 
@@ -109,10 +140,12 @@ private:
 
 	std::unique_ptr<VulkanSwapChain> swapChainObj;
 
-	std::unique_ptr<VulkanRenderPass> renderPass;
-	std::unique_ptr<VulkanDescriptorPool> descriptorPool;
+	std::unique_ptr<VulkanRenderGraph> m_RenderGraph; // every frame's passes, barriers and render passes
+	std::unique_ptr<VulkanDescriptorAllocator> m_DescriptorAllocator; // grows on demand, so streamed assets never exhaust it
 
-	std::unique_ptr<VulkanDescriptorSetLayout> m_pbrDescriptorSetLayout;
+	std::unique_ptr<VulkanDescriptorSetLayout> m_pbrDescriptorSetLayout; // set 0: per-material sets, or the bindless set
+	std::unique_ptr<VulkanDescriptorSetLayout> m_objectDataDescriptorSetLayout; // set 1: per-object data
+	std::unique_ptr<VulkanDescriptorSetLayout> m_transientDescriptorSetLayout;
 	//std::unique_ptr<VulkanDescriptorSets> m_pbrDescriptorSets;
 	std::unique_ptr<VulkanPipelineLayout> m_pbrPipelineLayout;
 
@@ -122,15 +155,21 @@ private:
 	std::unique_ptr<VulkanVertexBuffer> m_skyboxCubeVertexBuffer;
 
 	//std::unique_ptr<VulkanGraphicsPipeline> m_GraphicsPipelineFill;
-	std::unique_ptr<VulkanGraphicsPipeline> m_GraphicsPipelinePBR;
-	std::unique_ptr<VulkanGraphicsPipeline> m_GraphicsPipelineWireframe;
+	std::unique_ptr<VulkanPipelineLibrary> m_PipelineLibrary; // pbr + wireframe permutations, one per material state
 	bool m_WireframeMode = false;
+	bool m_WireframeSupported = false;
 	std::unique_ptr<VulkanGraphicsPipeline> m_GraphicsPipelineSkybox;
 
-	std::unique_ptr<VulkanFramebuffers> swapChainFramebuffers;
+	std::unique_ptr<VulkanMemoryAllocator> m_MemoryAllocator;
+	std::unique_ptr<VulkanPipelineCache> m_PipelineCache;
+	std::unique_ptr<VulkanShaderModuleCache> m_ShaderModuleCache;
+	const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
 
 	std::unique_ptr<VulkanCommandPool> commandPool;
 	std::unique_ptr<VulkanCommandBuffers> commandBuffers;
+	std::unique_ptr<VulkanParallelCommandRecorder> m_ParallelRecorder; // per-thread, per-frame pools for secondaries
+	std::unique_ptr<VulkanSceneCommandCache> m_SceneCommandCache; // scene subpass recorded once per frame, replayed while unchanged
+	bool m_CommandReplayEnabled = true;
 
 	std::unique_ptr<VulkanSyncObjects> syncObjects;
 
@@ -151,6 +190,46 @@ private:
 	std::unique_ptr<AssetManager> m_AssetManager;
 
 	std::vector<RenderableObject> renderableObjects;
+	std::unique_ptr<FrustumCuller> m_FrustumCuller; // world bounds of renderableObjects, same indices
+	std::unique_ptr<TransformSystem> m_TransformSystem; // one root node per renderable, same indices
+	std::vector<uint32_t> m_ChangedTransforms;
+	std::vector<uint32_t> m_VisibleRenderables;
+	DrawSorter m_DrawSorter;
+	std::vector<DrawItem> m_DrawItems; // visible renderables in draw order
+	// The camera's draw list: culling, order, batches and instance ids are only rebuilt when something
+	// they depend on moved. Unchanged frames reuse it and keep the scene key, so cached commands replay
+	std::vector<DrawBatch> m_DrawBatches;
+	std::vector<DrawBatch> m_RebuiltBatches; // scratch for the comparison with the previous list
+	std::vector<uint32_t> m_DrawInstanceIds;
+	uint32_t m_DrawInstanceBase = 0;          // where the ids landed in the frame allocator, batches are offset by it
+	uint64_t m_DrawListGeneration = 0;        // bumped whenever m_DrawBatches changes
+	bool m_DrawListDirty = true;              // renderables or their transforms changed
+	glm::mat4 m_DrawListViewProjection{ 0.0f };
+	bool m_DrawListWireframe = false;
+	bool m_DrawListGpuCulling = false;
+	uint32_t m_DrawListVisible = 0;
+	uint32_t m_DrawListCulled = 0;
+	uint32_t m_DrawListBindsUnsorted = 0;
+	uint32_t m_DrawListBindsSorted = 0;
+	std::unique_ptr<VulkanGpuCulling> m_GpuCulling; // null when the device can not draw indirect
+	bool m_GpuCullingEnabled = true;
+	std::vector<uint32_t> m_BlendedRenderables; // still culled and sorted on the CPU when GPU culling is on
+	std::vector<std::pair<uint32_t, glm::mat4>> m_AnimatedRenderables; // dynamic renderables and their rest transform
+	bool m_AnimateObjects = false; // off by default, an unchanged scene replays its cached commands
+	float m_AnimationTime = 0.0f;
+	std::unique_ptr<VulkanHiZPyramid> m_HiZPyramid; // last frame's depth for GPU occlusion culling, with m_GpuCulling
+	bool m_OcclusionCullingEnabled = true;
+	bool m_HiZBuiltLastFrame = false; // the pyramid is only valid right after a frame that built it
+	bool m_DepthPrepassEnabled = true;
+	std::unique_ptr<VulkanPipelineStatistics> m_PipelineStatistics; // overdraw readout, null without the feature
+	std::unique_ptr<VulkanDynamicResolution> m_DynamicResolution; // render scale from measured GPU frame time
+	std::unique_ptr<VulkanUpscaler> m_Upscaler; // scene colour onto the swap chain, before the UI
+	std::unique_ptr<VulkanGpuProfiler> m_GpuProfiler; // per pass GPU timestamps, and the IBL bake's
+	VkExtent2D m_RenderExtent{ 0, 0 }; // scene colour, depth and hi-z: the swap chain extent times the render scale
+	bool m_DynamicResolutionEnabled = true;
+	float m_RenderScaleSetting = 1.0f; // the UI's scale, applied while the controller is off
+	float m_TargetFrameTime = VulkanDynamicResolution::DEFAULT_TARGET_MS;
+	float m_FixedRenderScale = 0.0f; // from the command line, 0 when not given
 
 	std::unique_ptr<VulkanTexture> skyboxTexture;
 	std::unique_ptr<VulkanTexture> irradianceMap;
@@ -159,10 +238,25 @@ private:
 
 	// UniformBuffers
 	std::unique_ptr<VulkanUniformBuffers> frameUboManager;
-	std::unique_ptr<VulkanUniformBuffers> objectDataDUBManager;
+	std::unique_ptr<VulkanFrameAllocator> m_FrameAllocator; // per-frame transient data
+	std::unique_ptr<VulkanObjectDataBuffer> m_ObjectDataBuffer; // static + dirty tracked dynamic transforms
 	std::unique_ptr<VulkanUniformBuffers> lightingUboManager;
 	std::unique_ptr<VulkanUniformBuffers> materialUboManager;
+	std::unique_ptr<VulkanBindlessMaterials> m_BindlessMaterials; // replaces materialUboManager + per-material sets when supported
+	bool m_BindlessEnabled = false;
 	SceneLightingUBO sceneLights{}; // CPU SIDE DATA
+	std::unique_ptr<VulkanClusteredLighting> m_ClusteredLighting; // point and spot lights, binned into view clusters every frame
+	std::vector<PointLight> m_PointLights;
+	std::vector<SpotLight> m_SpotLights;
+	bool m_LocalLightsEnabled = true;
+	bool m_LocalLightsUploaded = false; // what m_ClusteredLighting currently holds
+	std::unique_ptr<VulkanShadowCascades> m_ShadowCascades; // sun shadows, distant cascades cached across frames
+	std::unique_ptr<VulkanPipelineLayout> m_ShadowPipelineLayout;
+	PipelineHandle m_ShadowPipeline = INVALID_PIPELINE_HANDLE;
+	bool m_ShadowsEnabled = true;
+	BoundingVolume m_SceneBounds{}; // world box around every renderable, grown when one moves out of it
+	std::vector<uint32_t> m_ShadowCasters; // per cascade scratch, reused every frame
+	std::vector<DrawItem> m_ShadowDrawItems;
 	//std::unique_ptr<VulkanUniformBuffers> tessellationUboManager;
 	//TessellationUBO tessUboData; // CPU SIDE DATA
 	size_t tessLevelIndex = 0;
@@ -171,7 +265,6 @@ private:
 
 	// IMGUI
 	std::unique_ptr<ImGuiManager> m_imguiManager;
-	std::unique_ptr<VulkanFramebuffers> m_imguiFramebuffers;
 
 	void initWindow()
 	{
@@ -216,21 +309,68 @@ private:
 		devices = std::make_unique<VulkanDevice>();
 		devices->createDevices(instance->getVkInstance(), surface->getVkSurface(), deviceExtensions, validationLayers);
 
+		// every buffer / image created from here on is sub-allocated through this
+		m_MemoryAllocator = std::make_unique<VulkanMemoryAllocator>();
+		m_MemoryAllocator->create(devices->getLogicalDevice(), devices->getPhysicalDevice());
+
+		m_PipelineCache = std::make_unique<VulkanPipelineCache>();
+		m_PipelineCache->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), PIPELINE_CACHE_PATH);
+
+		m_ShaderModuleCache = std::make_unique<VulkanShaderModuleCache>();
+		m_ShaderModuleCache->create(devices->getLogicalDevice());
+
+		m_PipelineLibrary = std::make_unique<VulkanPipelineLibrary>();
+		m_PipelineLibrary->create(devices->getLogicalDevice(), m_ShaderModuleCache.get(), m_PipelineCache->getVkPipelineCache());
+
 		swapChainObj = std::make_unique<VulkanSwapChain>();
 		swapChainObj->create(devices->getPhysicalDevice(), devices->getLogicalDevice(), surface->getVkSurface(), window->getGlfwWindow());
 
-		renderPass = std::make_unique<VulkanRenderPass>();
-		renderPass->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), swapChainObj->getImageFormat());
-
+		m_BindlessEnabled = devices->isDescriptorIndexingEnabled();
+		uint32_t bindlessTextureCount = 0;
 		m_pbrDescriptorSetLayout = std::make_unique<VulkanDescriptorSetLayout>();
-		m_pbrDescriptorSetLayout->create(devices->getLogicalDevice());
+		if (m_BindlessEnabled)
+		{
+			bindlessTextureCount = VulkanBindlessMaterials::getTextureCapacity(devices->getPhysicalDevice());
+			m_pbrDescriptorSetLayout->createForBindless(devices->getLogicalDevice(), bindlessTextureCount);
+		}
+		else
+		{
+			m_pbrDescriptorSetLayout->create(devices->getLogicalDevice());
+		}
 
-		/*VkPushConstantRange pbrPipelinePushConstantRange{};
+		m_objectDataDescriptorSetLayout = std::make_unique<VulkanDescriptorSetLayout>();
+		m_objectDataDescriptorSetLayout->createForObjectData(devices->getLogicalDevice());
+
+		m_transientDescriptorSetLayout = std::make_unique<VulkanDescriptorSetLayout>();
+		m_transientDescriptorSetLayout->createForTransientData(devices->getLogicalDevice());
+
+		m_ClusteredLighting = std::make_unique<VulkanClusteredLighting>();
+		m_ClusteredLighting->create(devices->getLogicalDevice(), *m_MemoryAllocator, VulkanGlobals::MAX_FRAMES_IN_FLIGHT);
+
+		// bindless material index
+		VkPushConstantRange pbrPipelinePushConstantRange{};
 		pbrPipelinePushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 		pbrPipelinePushConstantRange.offset = 0;
-		pbrPipelinePushConstantRange.size = sizeof(uint32_t);*/
+		pbrPipelinePushConstantRange.size = sizeof(uint32_t);
 		m_pbrPipelineLayout = std::make_unique<VulkanPipelineLayout>();
-		m_pbrPipelineLayout->create(devices->getLogicalDevice(), m_pbrDescriptorSetLayout->getVkDescriptorSetLayout());
+		m_pbrPipelineLayout->create(devices->getLogicalDevice(), {
+			m_pbrDescriptorSetLayout->getVkDescriptorSetLayout(),
+			m_objectDataDescriptorSetLayout->getVkDescriptorSetLayout(),
+			m_transientDescriptorSetLayout->getVkDescriptorSetLayout(), // instance object ids
+			m_ClusteredLighting->getDescriptorSetLayout() // set 3: clustered point and spot lights
+		}, m_BindlessEnabled ? 1 : 0, &pbrPipelinePushConstantRange);
+
+		// shadow casters: same object data and instance ids, the cascade's matrix as a push constant
+		VkPushConstantRange shadowPushConstantRange{};
+		shadowPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		shadowPushConstantRange.offset = 0;
+		shadowPushConstantRange.size = sizeof(glm::mat4);
+		m_ShadowPipelineLayout = std::make_unique<VulkanPipelineLayout>();
+		m_ShadowPipelineLayout->create(devices->getLogicalDevice(), {
+			m_pbrDescriptorSetLayout->getVkDescriptorSetLayout(), // unused, keeps the set numbers of the pbr layout
+			m_objectDataDescriptorSetLayout->getVkDescriptorSetLayout(),
+			m_transientDescriptorSetLayout->getVkDescriptorSetLayout()
+		}, 1, &shadowPushConstantRange);
 
 		m_skyboxDescriptorSetLayout = std::make_unique<VulkanDescriptorSetLayout>();
 		m_skyboxDescriptorSetLayout->createForSkybox(devices->getLogicalDevice());
@@ -252,66 +392,121 @@ private:
 		//	VK_CULL_MODE_BACK_BIT,
 		//	VK_FRONT_FACE_CLOCKWISE
 		//);
-		m_GraphicsPipelinePBR = std::make_unique<VulkanGraphicsPipeline>();
-		m_GraphicsPipelinePBR->create(
-			devices->getLogicalDevice(),
-			m_pbrPipelineLayout->getVkPipelineLayout(),
-			renderPass->getVkRenderPass(),
-			"shaders/vert.spv",
-			"shaders/frag.spv",
-			//"shaders/tess.tesc.spv",
-			//"shaders/tess.tese.spv",
-			VK_POLYGON_MODE_FILL,
-			VK_CULL_MODE_NONE,
-			//VK_CULL_MODE_BACK_BIT,
-			VK_FRONT_FACE_COUNTER_CLOCKWISE
-		);
 
-		VkPhysicalDeviceFeatures deviceFeatures;
-		vkGetPhysicalDeviceFeatures(devices->getPhysicalDevice(), &deviceFeatures);
-		if (deviceFeatures.fillModeNonSolid)
+		commandPool = std::make_unique<VulkanCommandPool>();
+		commandPool->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), surface->getVkSurface());
+
+		m_ShadowCascades = std::make_unique<VulkanShadowCascades>();
+		m_ShadowCascades->create(devices->getLogicalDevice(), *m_MemoryAllocator, devices->getGraphicsQueue(), commandPool->getVkCommandPool());
+
+		m_ParallelRecorder = std::make_unique<VulkanParallelCommandRecorder>();
+		m_ParallelRecorder->create(devices->getLogicalDevice(),
+			findQueueFamilies(devices->getPhysicalDevice(), surface->getVkSurface()).graphicsFamily.value(),
+			VulkanGlobals::MAX_FRAMES_IN_FLIGHT);
+
+		uint32_t graphicsFamily = findQueueFamilies(devices->getPhysicalDevice(), surface->getVkSurface()).graphicsFamily.value();
+		m_GpuProfiler = std::make_unique<VulkanGpuProfiler>();
+		m_GpuProfiler->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), graphicsFamily, VulkanGlobals::MAX_FRAMES_IN_FLIGHT);
+
+		m_DynamicResolution = std::make_unique<VulkanDynamicResolution>();
+		m_DynamicResolution->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), graphicsFamily,
+			VulkanGlobals::MAX_FRAMES_IN_FLIGHT);
+		if (m_FixedRenderScale > 0.0f)
 		{
-			m_GraphicsPipelineWireframe = std::make_unique<VulkanGraphicsPipeline>();
-			m_GraphicsPipelineWireframe->create(
-				devices->getLogicalDevice(),
-				m_pbrPipelineLayout->getVkPipelineLayout(),
-				renderPass->getVkRenderPass(),
-				"shaders/vert.spv",
-				"shaders/wireframe.frag.spv",
-				//"shaders/tess.tesc.spv",
-				//"shaders/tess.tese.spv",
-				VK_POLYGON_MODE_LINE,
-				VK_CULL_MODE_BACK_BIT,
-				VK_FRONT_FACE_COUNTER_CLOCKWISE
-			);
+			m_DynamicResolutionEnabled = false;
+			m_DynamicResolution->setEnabled(false);
+			m_DynamicResolution->setScale(m_FixedRenderScale);
+			m_DynamicResolution->update();
 		}
+		m_RenderScaleSetting = m_DynamicResolution->getScale();
+		m_RenderExtent = m_DynamicResolution->scaleExtent(swapChainObj->getExtent());
 
-		// Skybox Graphics Pipeline
-		m_GraphicsPipelineSkybox = std::make_unique<VulkanGraphicsPipeline>();
-		m_GraphicsPipelineSkybox->createSkybox(
-			devices->getLogicalDevice(),
-			m_skyboxPipelineLayout->getVkPipelineLayout(),
-			renderPass->getVkRenderPass(),
-			"shaders/skybox.vert.spv",
-			"shaders/skybox.frag.spv"
+		depthResourceObj = std::make_unique<VulkanDepthResources>();
+		depthResourceObj->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, devices->getGraphicsQueue(), commandPool->getVkCommandPool(), m_RenderExtent);
+
+		commandBuffers = std::make_unique<VulkanCommandBuffers>();
+		commandBuffers->create(devices->getLogicalDevice(), commandPool->getVkCommandPool(), VulkanGlobals::MAX_FRAMES_IN_FLIGHT);
+
+		m_SceneCommandCache = std::make_unique<VulkanSceneCommandCache>();
+		m_SceneCommandCache->create(devices->getLogicalDevice(), commandPool->getVkCommandPool(), VulkanGlobals::MAX_FRAMES_IN_FLIGHT);
+
+		syncObjects = std::make_unique<VulkanSyncObjects>();
+		syncObjects->create(devices->getLogicalDevice(), VulkanGlobals::MAX_FRAMES_IN_FLIGHT, static_cast<uint32_t>(swapChainObj->getImageViews().size()));
+
+		renderer = std::make_unique<VulkanRenderer>(
+			*devices,            // Pass by reference
+			*swapChainObj,
+			*commandBuffers,
+			*syncObjects,
+			VulkanGlobals::MAX_FRAMES_IN_FLIGHT
 		);
-		// ---------------------------
 
-		commandPool = std::make_unique<VulkanCommandPool>();
-		commandPool->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), surface->getVkSurface());
+		// The render passes come out of the frame graph. An empty frame declares the same attachments
+		// and subpasses as every later one, so pipelines created against it stay compatible. Every
+		// cascade is marked for drawing so the shadow passes exist too
+		m_RenderGraph = std::make_unique<VulkanRenderGraph>();
+		m_RenderGraph->create(devices->getLogicalDevice(), *m_MemoryAllocator, VulkanGlobals::MAX_FRAMES_IN_FLIGHT);
+		RenderPacket warmupPacket{};
+		warmupPacket.shadowCascades = m_ShadowCascades.get();
+		for (ShadowCascadeDraws& draws : warmupPacket.shadowDraws)
+		{
+			draws.draw = true;
+		}
+		buildFrameGraph(warmupPacket, 0, 0);
 
-		depthResourceObj = std::make_unique<VulkanDepthResources>();
-		depthResourceObj->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), devices->getGraphicsQueue(), commandPool->getVkCommandPool(), swapChainObj->getExtent());
+		// The skybox pipeline is compiled on a worker thread while the main thread carries on with
+		// asset setup. The pbr permutations depend on the loaded materials and are requested from
+		// the pipeline library once the assets are in.
+		// Both the pipeline cache and the shader module cache are safe to share between threads.
+		VkDevice logicalDevice = devices->getLogicalDevice();
+		VkRenderPass mainRenderPass = m_RenderGraph->getRenderPass("Scene");
+		VkPipelineLayout skyboxPipelineLayout = m_skyboxPipelineLayout->getVkPipelineLayout();
+		VkPipelineCache pipelineCache = m_PipelineCache->getVkPipelineCache();
+		VulkanShaderModuleCache* shaderModuleCache = m_ShaderModuleCache.get();
+
+		m_Upscaler = std::make_unique<VulkanUpscaler>();
+		m_Upscaler->create(logicalDevice, VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
+			m_RenderGraph->getRenderPass("Upscale"), m_RenderGraph->getSubpass("Upscale"), shaderModuleCache, pipelineCache);
+
+		// load the shared modules up front so the workers only ever hit the cache for them
+		shaderModuleCache->getShaderModule("shaders/vert.spv");
 
-		swapChainFramebuffers = std::make_unique<VulkanFramebuffers>();
-		swapChainFramebuffers->create(devices->getLogicalDevice(), swapChainObj->getImageViews(), depthResourceObj->getDepthImageView(), renderPass->getVkRenderPass(), swapChainObj->getExtent());
+		std::vector<std::future<void>> pipelineJobs;
+
+		VkPhysicalDeviceFeatures deviceFeatures;
+		vkGetPhysicalDeviceFeatures(devices->getPhysicalDevice(), &deviceFeatures);
+		m_WireframeSupported = deviceFeatures.fillModeNonSolid == VK_TRUE;
+
+		// Skybox Graphics Pipeline
+		m_GraphicsPipelineSkybox = std::make_unique<VulkanGraphicsPipeline>();
+		pipelineJobs.push_back(std::async(std::launch::async, [=]()
+			{
+				m_GraphicsPipelineSkybox->createSkybox(
+					logicalDevice,
+					skyboxPipelineLayout,
+					mainRenderPass,
+					"shaders/skybox.vert.spv",
+					"shaders/skybox.frag.spv",
+					shaderModuleCache,
+					pipelineCache
+				);
+			}));
+		// ---------------------------
 
 		// --- assets ---
 
-		m_AssetManager = std::make_unique<AssetManager>(devices.get(), commandPool.get());
+		m_AssetManager = std::make_unique<AssetManager>(devices.get(), m_MemoryAllocator.get(), commandPool.get());
 
 
 		loadAssetsAndCreateRenderables();
+
+		// join the pipeline workers, get() rethrows anything that failed on a worker thread
+		for (auto& job : pipelineJobs)
+		{
+			job.get();
+		}
+
+		assignMaterialPipelines();
 		
 
 		// --- 1. Define Counts ---
@@ -320,33 +515,30 @@ private:
 		const uint32_t SAMPLERS_PER_PBR_SET = 8; // Because your layout still has the separate occlusion sampler
 
 		// --- 2. Calculate Per-Category Set Counts ---
-		uint32_t pbrMaterialSets = materialCount * framesInFlight;
+		uint32_t pbrMaterialSets = m_BindlessEnabled ? 0 : materialCount * framesInFlight; // bindless sets use their own pool
 		uint32_t skyboxSets = framesInFlight;
 		uint32_t iblConversionSets = 3;
 		uint32_t totalSets = pbrMaterialSets + skyboxSets + iblConversionSets;
 
 		// --- 3. Calculate Total Per-Type Descriptor Needs ---
 		uint32_t totalUbos = (3 * pbrMaterialSets) + (1 * skyboxSets) + 2; // PBR UBOs + Skybox UBO + 2 for IBL gens
-		uint32_t totalDynamicUbos = 1 * pbrMaterialSets;                  // PBR Dynamic UBO
 		uint32_t totalSamplers = (SAMPLERS_PER_PBR_SET * pbrMaterialSets) + (1 * skyboxSets) + 3; // PBR Samplers + Skybox Sampler + 3 for IBL gens
 
-		// --- 4. Create the Pool Size Vector ---
-		std::vector<VkDescriptorPoolSize> poolSizes = {
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, totalUbos },
-			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, totalDynamicUbos },
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, totalSamplers }
+		// --- 4. Per-set ratios: the first pool fits the startup scene, later loads chain more pools ---
+		std::vector<DescriptorPoolSizeRatio> poolRatios = {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, static_cast<float>(totalUbos) / totalSets },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<float>(totalSamplers) / totalSets }
 		};
-	
-		descriptorPool = std::make_unique<VulkanDescriptorPool>(); // load descriptor pool after populating renderableObjects
-		// materials * frames (maxsets) + skybox * frames + 3 conversion sets
-		descriptorPool->create(devices->getLogicalDevice(), totalSets, poolSizes);
+
+		m_DescriptorAllocator = std::make_unique<VulkanDescriptorAllocator>(); // load descriptor pool after populating renderableObjects
+		m_DescriptorAllocator->create(devices->getLogicalDevice(), totalSets, poolRatios);
 
 		auto hdrSourceTexture = std::make_unique <VulkanTexture>();
-		hdrSourceTexture->createTextureHDR(devices->getLogicalDevice(), devices->getPhysicalDevice(), devices->getGraphicsQueue(), commandPool->getVkCommandPool(), "textures/skybox/kloppenheim_06_puresky_4k.hdr");
+		hdrSourceTexture->createTextureHDR(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, devices->getGraphicsQueue(), commandPool->getVkCommandPool(), "textures/skybox/kloppenheim_06_puresky_4k.hdr");
 
 		const uint32_t cubemapSize = 1024;
 		skyboxTexture = std::make_unique<VulkanTexture>();
-		skyboxTexture->createCubemap(devices->getLogicalDevice(), devices->getPhysicalDevice(), cubemapSize, cubemapSize, 1);
+		skyboxTexture->createCubemap(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, cubemapSize, cubemapSize, 1);
 
 		loadCubeModel(); // loads m_skyboxCubeBuffer
 
@@ -357,44 +549,68 @@ private:
 
 		// --- uniform buffers ---
 		frameUboManager = std::make_unique<VulkanUniformBuffers>();
-		frameUboManager->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), VulkanGlobals::MAX_FRAMES_IN_FLIGHT, sizeof(FrameUniformBufferObject));
+		frameUboManager->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, VulkanGlobals::MAX_FRAMES_IN_FLIGHT, sizeof(FrameUniformBufferObject));
+
+		m_FrameAllocator = std::make_unique<VulkanFrameAllocator>();
+		m_FrameAllocator->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
+			m_transientDescriptorSetLayout->getVkDescriptorSetLayout());
 
-		objectDataDUBManager = std::make_unique<VulkanUniformBuffers>();
-		objectDataDUBManager->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
-			VulkanUniformBuffers::totalObjectDataBufferSize(devices->getPhysicalDevice()),
-			true);
+		m_ObjectDataBuffer = std::make_unique<VulkanObjectDataBuffer>();
+		m_ObjectDataBuffer->create(devices->getLogicalDevice(), *m_MemoryAllocator, devices->getGraphicsQueue(), commandPool->getVkCommandPool(),
+			VulkanGlobals::MAX_FRAMES_IN_FLIGHT, m_objectDataDescriptorSetLayout->getVkDescriptorSetLayout(),
+			static_cast<uint32_t>(renderableObjects.size()), VulkanGlobals::INITIAL_DYNAMIC_OBJECT_CAPACITY);
+
+		if (devices->isIndirectDrawEnabled())
+		{
+			m_GpuCulling = std::make_unique<VulkanGpuCulling>();
+			m_GpuCulling->create(devices->getLogicalDevice(), *m_MemoryAllocator, VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
+				m_transientDescriptorSetLayout->getVkDescriptorSetLayout(), devices->isDrawIndirectCountEnabled());
+			createHiZPyramid();
+		}
+		registerRenderableObjects();
+
+		if (devices->isPipelineStatisticsEnabled())
+		{
+			m_PipelineStatistics = std::make_unique<VulkanPipelineStatistics>();
+			m_PipelineStatistics->create(devices->getLogicalDevice(), VulkanGlobals::MAX_FRAMES_IN_FLIGHT);
+		}
 
 		lightingUboManager = std::make_unique<VulkanUniformBuffers>();
-		lightingUboManager->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), VulkanGlobals::MAX_FRAMES_IN_FLIGHT, sizeof(SceneLightingUBO));
+		lightingUboManager->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, VulkanGlobals::MAX_FRAMES_IN_FLIGHT, sizeof(SceneLightingUBO));
 
 		sceneLights.dirLight.direction = glm::normalize(glm::vec4(-0.5, -1.0f, -0.5f, 0.0f));
 		sceneLights.dirLight.color = glm::vec4(1.0f, 1.0f, 1.0f, 10.0f); //w intensity
+		createSceneLights();
 
 		VkPhysicalDeviceProperties properties;
 		vkGetPhysicalDeviceProperties(devices->getPhysicalDevice(), &properties);
 		size_t minUboAlignment = properties.limits.minUniformBufferOffsetAlignment;
 		size_t alignedMaterialUboSize = getAlignedUboSize(sizeof(MaterialUBO), minUboAlignment);
-		VkDeviceSize totalMaterialUboSize = alignedMaterialUboSize * m_AssetManager->getMaterials().size();
-		materialUboManager = std::make_unique<VulkanUniformBuffers>();
-		VkDeviceSize materialUboSize = sizeof(MaterialUBO) * m_AssetManager->getMaterials().size();
-		materialUboManager->create(
-			devices->getLogicalDevice(),
-			devices->getPhysicalDevice(),
-			VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
-			//materialUboSize,
-			totalMaterialUboSize,
-			false
-		);
-		// populate materialUbo
-		int materialIndex = 0;
-		for (auto const& [name, material] : m_AssetManager->getMaterials())
+		if (!m_BindlessEnabled)
 		{
-			for (int frame = 0; frame < VulkanGlobals::MAX_FRAMES_IN_FLIGHT; ++frame)
+			VkDeviceSize totalMaterialUboSize = alignedMaterialUboSize * m_AssetManager->getMaterials().size();
+			materialUboManager = std::make_unique<VulkanUniformBuffers>();
+			VkDeviceSize materialUboSize = sizeof(MaterialUBO) * m_AssetManager->getMaterials().size();
+			materialUboManager->create(
+				devices->getLogicalDevice(),
+				devices->getPhysicalDevice(),
+				*m_MemoryAllocator,
+				VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
+				//materialUboSize,
+				totalMaterialUboSize,
+				false
+			);
+			// populate materialUbo
+			int materialIndex = 0;
+			for (auto const& [name, material] : m_AssetManager->getMaterials())
 			{
-				char* mappedData = static_cast<char*>(materialUboManager->getMappedMemory(frame));
-				memcpy(mappedData + (materialIndex * alignedMaterialUboSize), &material->uboData, sizeof(MaterialUBO));
+				for (int frame = 0; frame < VulkanGlobals::MAX_FRAMES_IN_FLIGHT; ++frame)
+				{
+					char* mappedData = static_cast<char*>(materialUboManager->getMappedMemory(frame));
+					memcpy(mappedData + (materialIndex * alignedMaterialUboSize), &material->uboData, sizeof(MaterialUBO));
+				}
+				materialIndex++;
 			}
-			materialIndex++;
 		}
 
 		//tessellationUboManager = std::make_unique<VulkanUniformBuffers>();
@@ -406,6 +622,9 @@ private:
 		generatePrefilerMap(); // generates prefilterMap of skybox
 		generateBrdfLut();
 
+		m_PipelineCache->save(); // persist everything compiled during startup
+		m_MemoryAllocator->printStats();
+
 		IblPacket iblPacket{};
 		iblPacket.irradianceImageView = irradianceMap->getImageView();
 		iblPacket.irradianceSampler = irradianceMap->getSampler();
@@ -413,26 +632,46 @@ private:
 		iblPacket.prefilterSampler = prefilterMap->getSampler();
 		iblPacket.brdfLutImageView = brdfLut->getImageView();
 		iblPacket.brdfLutSampler = brdfLut->getSampler();
+		iblPacket.shadowMapImageView = m_ShadowCascades->getArrayView();
+		iblPacket.shadowMapSampler = m_ShadowCascades->getSampler();
 
-		//m_pbrDescriptorSets = std::make_unique<VulkanDescriptorSets>();
-		VulkanDescriptorSets::createForMaterials(
-			devices->getLogicalDevice(),
-			descriptorPool->getVkDescriptorPool(),
-			m_pbrDescriptorSetLayout->getVkDescriptorSetLayout(),
-			VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
-			frameUboManager->getBuffers(),
-			objectDataDUBManager->getBuffers(),
-			lightingUboManager->getBuffers(),
-			materialUboManager->getBuffers(),
-			m_AssetManager->getMaterials(),
-			iblPacket,
-			alignedMaterialUboSize
-		);
+		if (m_BindlessEnabled)
+		{
+			// materials loaded later only need another registerMaterials call, no new sets
+			m_BindlessMaterials = std::make_unique<VulkanBindlessMaterials>();
+			m_BindlessMaterials->create(
+				devices->getLogicalDevice(),
+				*m_MemoryAllocator,
+				VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
+				m_pbrDescriptorSetLayout->getVkDescriptorSetLayout(),
+				bindlessTextureCount,
+				frameUboManager->getBuffers(),
+				lightingUboManager->getBuffers(),
+				iblPacket
+			);
+			m_BindlessMaterials->registerMaterials(m_AssetManager->getMaterials());
+		}
+		else
+		{
+			//m_pbrDescriptorSets = std::make_unique<VulkanDescriptorSets>();
+			VulkanDescriptorSets::createForMaterials(
+				devices->getLogicalDevice(),
+				*m_DescriptorAllocator,
+				m_pbrDescriptorSetLayout->getVkDescriptorSetLayout(),
+				VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
+				frameUboManager->getBuffers(),
+				lightingUboManager->getBuffers(),
+				materialUboManager->getBuffers(),
+				m_AssetManager->getMaterials(),
+				iblPacket,
+				alignedMaterialUboSize
+			);
+		}
 
 		m_skyboxDescriptorSets = std::make_unique<VulkanDescriptorSets>();
 		m_skyboxDescriptorSets->createForSkybox(
 			devices->getLogicalDevice(),
-			descriptorPool->getVkDescriptorPool(),
+			*m_DescriptorAllocator,
 			m_skyboxDescriptorSetLayout->getVkDescriptorSetLayout(),
 			VulkanGlobals::MAX_FRAMES_IN_FLIGHT,
 			frameUboManager->getBuffers(),
@@ -440,33 +679,7 @@ private:
 		);
 
 
-		commandBuffers = std::make_unique<VulkanCommandBuffers>();
-		commandBuffers->create(devices->getLogicalDevice(), commandPool->getVkCommandPool(), VulkanGlobals::MAX_FRAMES_IN_FLIGHT);
-
-		syncObjects = std::make_unique<VulkanSyncObjects>();
-		syncObjects->create(devices->getLogicalDevice(), VulkanGlobals::MAX_FRAMES_IN_FLIGHT, static_cast<uint32_t>(swapChainObj->getImageViews().size()));
-
-		m_imguiManager = std::make_unique<ImGuiManager>(
-			*window,
-			*instance,
-			*devices,
-			*surface,
-			*swapChainObj,
-			*commandPool
-		);
-		m_imguiFramebuffers = std::make_unique<VulkanFramebuffers>();
-		m_imguiFramebuffers->createForImGui(devices->getLogicalDevice(), swapChainObj->getImageViews(), m_imguiManager->getRenderPass(), swapChainObj->getExtent());
-
-		renderer = std::make_unique<VulkanRenderer>(
-			*devices,            // Pass by reference
-			*swapChainObj,
-			*renderPass,
-			//*m_pbrPipelineLayout,
-			*swapChainFramebuffers,
-			*commandBuffers,
-			*syncObjects,
-			VulkanGlobals::MAX_FRAMES_IN_FLIGHT
-		);
+		createImGuiManager();
 
 		camera = std::make_unique<Camera>(
 			glm::vec3(2.0f, 2.0f, 2.0f),       // startPosition
@@ -495,11 +708,13 @@ private:
 
 		while (window && !window->shouldClose())
 		{
+			CpuProfiler::beginFrame();
 			auto currentTime = std::chrono::high_resolution_clock::now();
 			deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 			startTime = currentTime;
 			accumulatedTime += deltaTime;
 
+			CpuProfileZone inputZone("Input");
 			window->pollEvents();
 
 			ImGuiIO& io = ImGui::GetIO();
@@ -509,22 +724,75 @@ private:
 			}
 			m_imguiManager->newFrame();
 			//m_imguiManager->buildUI(m_WireframeMode, tessUboData);
+			inputZone.end();
 
 			uint32_t uboFrameIndex = renderer->getCurrentFrame();
 
+			// everything below rewrites this frame's memory, so the GPU has to be done with it first
+			CpuProfileZone fenceZone("Wait Fence");
+			VkFence uboFrameFence = syncObjects->getInFlightFence(uboFrameIndex);
+			vkWaitForFences(devices->getLogicalDevice(), 1, &uboFrameFence, VK_TRUE, UINT64_MAX);
+			fenceZone.end();
+
+			CpuProfileZone uboZone("Update UBOs");
+			m_FrameAllocator->beginFrame(uboFrameIndex);
+			if (m_AnimateObjects)
+			{
+				animateRenderables(deltaTime);
+			}
+			applyTransformChanges(); // before anything reads bounds or object data
+
+			// this slot's last frame is done, its GPU time may move the render scale
+			m_GpuProfiler->fetchResults(uboFrameIndex);
+			m_DynamicResolution->fetchResults(uboFrameIndex);
+			m_DynamicResolution->setEnabled(m_DynamicResolutionEnabled);
+			m_DynamicResolution->setTargetFrameTime(m_TargetFrameTime);
+			if (!m_DynamicResolutionEnabled)
+			{
+				m_DynamicResolution->setScale(m_RenderScaleSetting);
+			}
+			if (m_DynamicResolution->update())
+			{
+				resizeRenderTargets();
+			}
+			m_RenderScaleSetting = m_DynamicResolution->getScale();
+
 			//tessUboData.displacementScale = 0.0f;
 			//tessellationUboManager->update(uboFrameIndex, tessUboData);
-			frameUboManager->update(uboFrameIndex, frameUboUpdate());
+			FrameUniformBufferObject frameUbo = frameUboUpdate();
+			frameUboManager->update(uboFrameIndex, frameUbo);
 
 			sceneLights.viewPosition = glm::vec4(camera->getCameraPosition(), 1.0f);
+			uint32_t shadowCascadeMask = 0;
+			if (m_ShadowsEnabled)
+			{
+				shadowCascadeMask = m_ShadowCascades->update(frameUbo.view, camera->getProjectionMatrix(), camera->getNearPlane(),
+					std::min(camera->getFarPlane(), VulkanGlobals::SHADOW_DISTANCE), glm::vec3(sceneLights.dirLight.direction), m_SceneBounds);
+			}
+			m_ShadowCascades->writeLighting(sceneLights, m_ShadowsEnabled);
 			lightingUboManager->update(uboFrameIndex, sceneLights);
+			if (m_LocalLightsEnabled != m_LocalLightsUploaded)
+			{
+				m_ClusteredLighting->setLights(m_LocalLightsEnabled ? m_PointLights : std::vector<PointLight>{},
+					m_LocalLightsEnabled ? m_SpotLights : std::vector<SpotLight>{});
+				m_LocalLightsUploaded = m_LocalLightsEnabled;
+			}
+			m_ClusteredLighting->update(uboFrameIndex, frameUbo.view, frameUbo.proj,
+				camera->getNearPlane(), camera->getFarPlane(), m_RenderExtent);
 
-			updateObjectUniforms(uboFrameIndex);
-
-			VkPipeline pipelineToUse = m_WireframeMode
-				? m_GraphicsPipelineWireframe->getVkPipeline()
-				: m_GraphicsPipelinePBR->getVkPipeline();
+			m_ObjectDataBuffer->update(uboFrameIndex); // only dirty dynamic objects are copied
+			bool gpuCulling = m_GpuCulling && m_GpuCullingEnabled;
+			if (gpuCulling)
+			{
+				m_GpuCulling->update(uboFrameIndex);
+			}
+			if (m_PipelineStatistics)
+			{
+				m_PipelineStatistics->fetchResults(uboFrameIndex);
+			}
+			uboZone.end();
 
+			CpuProfileZone packetZone("Build Packet");
 			SkyboxData skyboxDataPacket{};
 			skyboxDataPacket.pipeline = m_GraphicsPipelineSkybox->getVkPipeline();
 			skyboxDataPacket.pipelineLayout = m_skyboxPipelineLayout->getVkPipelineLayout();
@@ -533,13 +801,95 @@ private:
 			skyboxDataPacket.renderSkyBox = !m_WireframeMode;
 
 			RenderPacket renderPacket{};
-			renderPacket.pbrPipeline = pipelineToUse;
-			//renderPacket.pbrPipeline_doubleSided = m_GraphicsPipeline_doubleSided->getVkPipeline();
+			renderPacket.pipelineLibrary = m_PipelineLibrary.get();
+			renderPacket.wireframeMode = m_WireframeMode;
 			renderPacket.pbrLayout = m_pbrPipelineLayout->getVkPipelineLayout();
-			renderPacket.pbrRenderables = renderableObjects;
-			renderPacket.dynamicUboAlignment = objectDataDUBManager->getDynamicAlignment();
+			renderPacket.renderExtent = m_RenderExtent;
+			renderPacket.parallelRecorder = m_ParallelRecorder.get();
+
+			// only what the camera can see goes into the packet
+			glm::mat4 viewProjection = camera->getProjectionMatrix() * camera->calculateViewMatrix();
+			Frustum frustum = Frustum::fromMatrix(viewProjection);
+			if (gpuCulling)
+			{
+				// the compute pass handles everything else, only blended renderables need sorting here
+				renderPacket.gpuCulling = m_GpuCulling.get();
+				renderPacket.cullFrustum = frustum;
+				renderPacket.cullViewProjection = frameUbo.proj * frameUbo.view;
+
+				// the pyramid is rebuilt every frame occlusion is on, and only trusted the frame after;
+				// with it off nothing needs the build and the frame graph culls it
+				bool occlusion = m_OcclusionCullingEnabled;
+				renderPacket.occlusionCulling = occlusion && m_HiZBuiltLastFrame;
+				renderPacket.hiZPyramid = m_HiZPyramid.get();
+				renderPacket.buildHiZ = occlusion;
+				m_HiZBuiltLastFrame = occlusion;
+			}
+			else
+			{
+				m_HiZBuiltLastFrame = false;
+			}
+			renderPacket.depthPrepass = m_DepthPrepassEnabled && !m_WireframeMode;
+			renderPacket.pipelineStatistics = m_PipelineStatistics.get();
+			renderPacket.gpuProfiler = m_GpuProfiler->isSupported() && m_GpuProfiler->isEnabled() ? m_GpuProfiler.get() : nullptr;
+			renderPacket.clusteredLighting = m_ClusteredLighting.get();
+			renderPacket.objectDataGeneration = m_ObjectDataBuffer->getDescriptorGeneration();
+			if (m_DrawListDirty || viewProjection != m_DrawListViewProjection
+				|| m_WireframeMode != m_DrawListWireframe || gpuCulling != m_DrawListGpuCulling)
+			{
+				rebuildDrawList(frustum, gpuCulling);
+				m_DrawListDirty = false;
+				m_DrawListViewProjection = viewProjection;
+				m_DrawListWireframe = m_WireframeMode;
+				m_DrawListGpuCulling = gpuCulling;
+			}
+
+			// the ids live in per frame memory, so they are copied every frame; allocated before anything
+			// else in the frame their offset, and with it the batches, stays put
+			size_t instanceIdBytes = m_DrawInstanceIds.size() * sizeof(uint32_t);
+			FrameAllocation instanceIds = m_FrameAllocator->allocate(instanceIdBytes, sizeof(uint32_t));
+			memcpy(instanceIds.mappedData, m_DrawInstanceIds.data(), instanceIdBytes);
+			uint32_t instanceBase = instanceIds.offset / sizeof(uint32_t);
+			if (instanceBase != m_DrawInstanceBase)
+			{
+				for (DrawBatch& batch : m_DrawBatches)
+				{
+					batch.firstInstance = batch.firstInstance - m_DrawInstanceBase + instanceBase;
+				}
+				m_DrawInstanceBase = instanceBase;
+				m_DrawListGeneration++;
+			}
+			// moved back out after drawFrame, the list is kept without copying it
+			renderPacket.pbrBatches = std::move(m_DrawBatches);
+			renderPacket.drawListGeneration = m_DrawListGeneration;
+			renderPacket.instanceDescriptorSet = instanceIds.descriptorSet;
+
+			uint32_t shadowBatches = 0;
+			if (m_ShadowsEnabled)
+			{
+				renderPacket.shadowCascades = m_ShadowCascades.get();
+				for (uint32_t cascade = 0; cascade < VulkanShadowCascades::CASCADE_COUNT; cascade++)
+				{
+					if ((shadowCascadeMask & (1u << cascade)) == 0) continue;
+					buildShadowCascadeDraws(cascade, renderPacket.shadowDraws[cascade]);
+					shadowBatches += static_cast<uint32_t>(renderPacket.shadowDraws[cascade].batches.size());
+				}
+			}
+			renderPacket.shadowPipeline = m_PipelineLibrary->getVkPipeline(m_ShadowPipeline);
+			renderPacket.shadowLayout = m_ShadowPipelineLayout->getVkPipelineLayout();
+			renderPacket.geometryPositionBuffer = m_AssetManager->getGeometryBuffer()->getPositionBuffer();
+			renderPacket.geometryVertexBuffer = m_AssetManager->getGeometryBuffer()->getVertexBuffer();
+			renderPacket.geometryIndexBuffer = m_AssetManager->getGeometryBuffer()->getIndexBuffer();
+			renderPacket.objectDataDescriptorSet = m_ObjectDataBuffer->getDescriptorSet(uboFrameIndex);
+			if (m_BindlessMaterials)
+			{
+				renderPacket.bindlessDescriptorSet = m_BindlessMaterials->getDescriptorSet(uboFrameIndex);
+				renderPacket.bindlessGeneration = m_BindlessMaterials->getDescriptorGeneration();
+			}
 			renderPacket.skyboxData = skyboxDataPacket;
+			packetZone.end();
 
+			CpuProfileZone uiZone("Build UI");
 			SceneDebugContextPacket debugContextPacket
 			{
 				m_WireframeMode,
@@ -547,12 +897,61 @@ private:
 				sceneLights,
 				camera.get(),
 				deltaTime,
-				renderableObjects
+				renderableObjects,
+				m_DrawListVisible,
+				m_DrawListCulled,
+				m_DrawListBindsUnsorted,
+				m_DrawListBindsSorted,
+				static_cast<uint32_t>(renderPacket.pbrBatches.size()) + (gpuCulling ? static_cast<uint32_t>(m_GpuCulling->getGroups().size()) : 0),
+				m_GpuCulling ? &m_GpuCullingEnabled : nullptr
 			};
+			debugContextPacket.occlusionCulling = m_GpuCulling ? &m_OcclusionCullingEnabled : nullptr;
+			debugContextPacket.depthPrepass = &m_DepthPrepassEnabled;
+			debugContextPacket.animateObjects = m_AnimatedRenderables.empty() ? nullptr : &m_AnimateObjects;
+			debugContextPacket.commandReplay = &m_CommandReplayEnabled;
+			debugContextPacket.sceneCommandsReplayed = m_CommandReplayEnabled && m_SceneCommandCache->wasLastReplayed();
+			debugContextPacket.sceneCommandRecords = m_SceneCommandCache->getRecordCount();
+			debugContextPacket.graphPasses = m_RenderGraph->getPassCount();
+			debugContextPacket.graphCulledPasses = m_RenderGraph->getCulledPassCount();
+			debugContextPacket.graphRenderPasses = m_RenderGraph->getRenderPassCount();
+			debugContextPacket.graphBarriers = m_RenderGraph->getBarrierCount();
+			debugContextPacket.localLights = &m_LocalLightsEnabled;
+			debugContextPacket.localLightCount = m_ClusteredLighting->getLightCount();
+			debugContextPacket.clusterLightIndices = m_ClusteredLighting->getLightIndexCount();
+			debugContextPacket.busiestClusterLights = m_ClusteredLighting->getBusiestClusterLightCount();
+			debugContextPacket.shadows = &m_ShadowsEnabled;
+			debugContextPacket.shadowCascadesDrawn = m_ShadowsEnabled ? m_ShadowCascades->getDrawnCascadeCount() : 0;
+			debugContextPacket.shadowBatches = shadowBatches;
+			debugContextPacket.dynamicResolution = m_DynamicResolution->isTimingSupported() ? &m_DynamicResolutionEnabled : nullptr;
+			debugContextPacket.renderScale = &m_RenderScaleSetting;
+			debugContextPacket.targetFrameTime = &m_TargetFrameTime;
+			debugContextPacket.renderExtent = m_RenderExtent;
+			debugContextPacket.gpuFrameTime = m_DynamicResolution->getGpuTime();
+			debugContextPacket.gpuProfiler = m_GpuProfiler->isSupported() ? m_GpuProfiler.get() : nullptr;
+			if (gpuCulling)
+			{
+				// the read back counts lag a couple of frames behind the blended ones
+				uint32_t frustumCulled = m_GpuCulling->getFrustumCulledCount();
+				uint32_t occlusionCulled = m_GpuCulling->getOcclusionCulledCount();
+				uint32_t gpuCulled = std::min(frustumCulled + occlusionCulled, m_GpuCulling->getObjectCount());
+				debugContextPacket.frustumCulledObjects = frustumCulled;
+				debugContextPacket.occlusionCulledObjects = occlusionCulled;
+				debugContextPacket.visibleRenderables += m_GpuCulling->getObjectCount() - gpuCulled;
+				debugContextPacket.culledRenderables += gpuCulled;
+			}
+			if (m_PipelineStatistics)
+			{
+				VkExtent2D extent = m_RenderExtent;
+				debugContextPacket.overdraw = static_cast<float>(m_PipelineStatistics->getFragmentInvocations())
+					/ static_cast<float>(std::max(extent.width * extent.height, 1u));
+			}
 
 			m_imguiManager->buildUI(debugContextPacket);
+			uiZone.end();
 			drawFrame(renderPacket);
+			m_DrawBatches = std::move(renderPacket.pbrBatches);
 			window->endFrame();
+			CpuProfiler::endFrame();
 		}
 
 		if (devices->isInitialized())
@@ -567,6 +966,7 @@ private:
 		VkFence currentFrameFence = syncObjects->getInFlightFence(frameIndex);
 		vkWaitForFences(devices->getLogicalDevice(), 1, &currentFrameFence, VK_TRUE, UINT64_MAX);
 
+		CpuProfileZone acquireZone("Acquire");
 		uint32_t imageIndex;
 		VkResult result = vkAcquireNextImageKHR(
 			devices->getLogicalDevice(),
@@ -587,9 +987,11 @@ private:
 		{
 			throw std::runtime_error("failed to acquire swap chain image!");
 		}
+		acquireZone.end();
 
 		vkResetFences(devices->getLogicalDevice(), 1, &currentFrameFence);
 
+		CpuProfileZone recordZone("Record");
 		VkCommandBuffer cmd = commandBuffers->getCommandBuffer(frameIndex);
 		vkResetCommandBuffer(cmd, 0);
 
@@ -600,27 +1002,34 @@ private:
 			throw std::runtime_error("failed to begin recording command buffer!");
 		}
 
-		// SCENE ARTIST (draw scene)
-		renderer->recordSceneCommands(
-			cmd, 
-			renderPacket, 
-			frameIndex, 
-			swapChainFramebuffers->getFramebuffer(imageIndex)
-		);
-		// UI ARTIST (draws imgui UI)
-		m_imguiManager->render(
-			cmd,
-			m_imguiFramebuffers->getFramebuffer(imageIndex),
-			swapChainObj->getExtent()
-		);
+		// scene, UI and everything between them come out of the frame graph
+		buildFrameGraph(renderPacket, frameIndex, imageIndex);
+
+		// the query covers the whole graph, UI subpass included: it can not begin inside a subpass
+		// whose contents are secondaries
+		m_DynamicResolution->recordBegin(cmd, frameIndex);
+		m_GpuProfiler->beginFrame(cmd, frameIndex);
+		if (renderPacket.pipelineStatistics)
+		{
+			renderPacket.pipelineStatistics->recordBegin(cmd, frameIndex);
+		}
+		m_RenderGraph->execute(cmd);
+		if (renderPacket.pipelineStatistics)
+		{
+			renderPacket.pipelineStatistics->recordEnd(cmd, frameIndex);
+		}
+		m_GpuProfiler->endFrame(cmd);
+		m_DynamicResolution->recordEnd(cmd, frameIndex);
 
 		if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to record command buffer!");
 		}
 		// --- Finished recording ---
+		recordZone.end();
 
 		// -- Submit to GPU --
+		CpuProfileZone submitZone("Submit");
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 		VkSemaphore waitSemaphores[] = { syncObjects->getImageAvailableSemaphore(frameIndex) };
@@ -637,6 +1046,7 @@ private:
 		if (vkQueueSubmit(devices->getGraphicsQueue(), 1, &submitInfo, currentFrameFence) != VK_SUCCESS) {
 			throw std::runtime_error("failed to submit draw command buffer!");
 		}
+		submitZone.end();
 
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -648,7 +1058,9 @@ private:
 		presentInfo.pSwapchains = swapChains;
 		presentInfo.pImageIndices = &imageIndex;
 
+		CpuProfileZone presentZone("Present");
 		result = vkQueuePresentKHR(devices->getPresentQueue(), &presentInfo);
+		presentZone.end();
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
 			framebufferResized = false;
@@ -670,28 +1082,50 @@ private:
 		cleanupSwapChain();
 
 		swapChainObj->create(devices->getPhysicalDevice(), devices->getLogicalDevice(), surface->getVkSurface(), window->getGlfwWindow());
-		depthResourceObj->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), devices->getGraphicsQueue(), commandPool->getVkCommandPool(), swapChainObj->getExtent());
-		swapChainFramebuffers->create(devices->getLogicalDevice(), swapChainObj->getImageViews(), depthResourceObj->getDepthImageView(), renderPass->getVkRenderPass(), swapChainObj->getExtent());
+		m_RenderExtent = m_DynamicResolution->scaleExtent(swapChainObj->getExtent());
+		depthResourceObj->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, devices->getGraphicsQueue(), commandPool->getVkCommandPool(), m_RenderExtent);
+		if (m_GpuCulling)
+		{
+			createHiZPyramid();
+		}
 
-		m_imguiManager = std::make_unique<ImGuiManager>(
-			*window,
-			*instance,
-			*devices,
-			*surface,
-			*swapChainObj,
-			*commandPool
-		);
-		m_imguiFramebuffers->createForImGui(devices->getLogicalDevice(), swapChainObj->getImageViews(), m_imguiManager->getRenderPass(), swapChainObj->getExtent());
+		// the graph's render passes outlive the swap chain, so the UI goes back into the same subpass
+		createImGuiManager();
+	}
+
+	// The render scale moved: depth and the hi-z pyramid are recreated at the new extent, the scene
+	// colour transient follows the next time the graph is built. Waits for the device like a swap
+	// chain resize, which is why the controller only changes the scale in steps
+	void resizeRenderTargets()
+	{
+		VkExtent2D extent = m_DynamicResolution->scaleExtent(swapChainObj->getExtent());
+		if (extent.width == m_RenderExtent.width && extent.height == m_RenderExtent.height)
+		{
+			return;
+		}
+
+		vkDeviceWaitIdle(devices->getLogicalDevice());
+
+		if (m_HiZPyramid) m_HiZPyramid->destroy();
+		depthResourceObj->destroy();
+		m_RenderGraph->releaseFramebuffers(); // built on the depth view
+
+		m_RenderExtent = extent;
+		depthResourceObj->create(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, devices->getGraphicsQueue(), commandPool->getVkCommandPool(), m_RenderExtent);
+		if (m_GpuCulling)
+		{
+			createHiZPyramid();
+		}
 	}
 
 	void cleanupSwapChain()
 	{
 		if (m_imguiManager) m_imguiManager.reset();
 
+		if (m_HiZPyramid) m_HiZPyramid->destroy(); // built from the depth buffer
 		depthResourceObj->destroy();
 
-		swapChainFramebuffers->destroy();
-		m_imguiFramebuffers->destroy();
+		if (m_RenderGraph) m_RenderGraph->releaseFramebuffers(); // built on the swap chain and depth views
 
 		swapChainObj->destroy();
 	}
@@ -712,6 +1146,22 @@ private:
 		{
 		}
 		renderableObjects.clear();
+		m_FrustumCuller.reset();
+		m_BlendedRenderables.clear();
+
+		if (m_GpuCulling) m_GpuCulling->destroy();
+		m_GpuCulling.reset();
+		m_HiZPyramid.reset();
+
+		if (m_PipelineStatistics) m_PipelineStatistics->destroy();
+		m_PipelineStatistics.reset();
+
+		if (m_DynamicResolution) m_DynamicResolution->destroy();
+		m_DynamicResolution.reset();
+		if (m_GpuProfiler) m_GpuProfiler->destroy();
+		m_GpuProfiler.reset();
+		if (m_Upscaler) m_Upscaler->destroy();
+		m_Upscaler.reset();
 
 		if (m_AssetManager) m_AssetManager.reset();
 
@@ -733,14 +1183,25 @@ private:
 		if (frameUboManager) frameUboManager->destroy();
 		frameUboManager.reset();
 
-		if (objectDataDUBManager) objectDataDUBManager->destroy();
-		objectDataDUBManager.reset();
+		if (m_FrameAllocator) m_FrameAllocator->destroy();
+		m_FrameAllocator.reset();
+
+		if (m_ObjectDataBuffer) m_ObjectDataBuffer->destroy();
+		m_ObjectDataBuffer.reset();
 
 		if (lightingUboManager) lightingUboManager->destroy();
 		lightingUboManager.reset();
 
+		if (m_ClusteredLighting) m_ClusteredLighting->destroy();
+		m_ClusteredLighting.reset();
+
+		if (m_ShadowCascades) m_ShadowCascades->destroy();
+		m_ShadowCascades.reset();
+
 		if (materialUboManager) materialUboManager->destroy();
 		materialUboManager.reset();
+		if (m_BindlessMaterials) m_BindlessMaterials->destroy();
+		m_BindlessMaterials.reset();
 
 		//if (tessellationUboManager) tessellationUboManager->destroy();
 		//tessellationUboManager.reset();
@@ -751,45 +1212,70 @@ private:
 	/*	if (m_pbrDescriptorSets) m_pbrDescriptorSets->destroy();
 		m_pbrDescriptorSets.reset();*/
 
-		if (descriptorPool) descriptorPool->destroy();
-		descriptorPool.reset();
+		if (m_DescriptorAllocator) m_DescriptorAllocator->destroy();
+		m_DescriptorAllocator.reset();
 
 	/*	if (m_GraphicsPipelineFill) m_GraphicsPipelineFill->destroy();
 		m_GraphicsPipelineFill.reset();*/
 
-		if (m_GraphicsPipelinePBR) m_GraphicsPipelinePBR->destroy();
-		m_GraphicsPipelinePBR.reset();
-
-		if (m_GraphicsPipelineWireframe) m_GraphicsPipelineWireframe->destroy();
-		m_GraphicsPipelineWireframe.reset();
+		if (m_PipelineLibrary) m_PipelineLibrary->destroy();
+		m_PipelineLibrary.reset();
 
 		if (m_GraphicsPipelineSkybox) m_GraphicsPipelineSkybox->destroy();
 		m_GraphicsPipelineSkybox.reset();
 
+		if (m_ShaderModuleCache) m_ShaderModuleCache->destroy();
+		m_ShaderModuleCache.reset();
+
+		if (m_PipelineCache)
+		{
+			m_PipelineCache->save();
+			m_PipelineCache->destroy();
+		}
+		m_PipelineCache.reset();
+
 		if (m_pbrPipelineLayout) m_pbrPipelineLayout->destroy();
 		m_pbrPipelineLayout.reset();
 
+		if (m_ShadowPipelineLayout) m_ShadowPipelineLayout->destroy();
+		m_ShadowPipelineLayout.reset();
+
 		if (m_skyboxPipelineLayout) m_skyboxPipelineLayout->destroy();
 		m_skyboxPipelineLayout.reset();
 
 		if (m_pbrDescriptorSetLayout) m_pbrDescriptorSetLayout->destroy();
 		m_pbrDescriptorSetLayout.reset();
 
+		if (m_objectDataDescriptorSetLayout) m_objectDataDescriptorSetLayout->destroy();
+		m_objectDataDescriptorSetLayout.reset();
+
+		if (m_transientDescriptorSetLayout) m_transientDescriptorSetLayout->destroy();
+		m_transientDescriptorSetLayout.reset();
+
 		if (m_skyboxDescriptorSetLayout) m_skyboxDescriptorSetLayout->destroy();
 		m_skyboxDescriptorSetLayout.reset();
 
-		if (renderPass) renderPass->destroy();
-		renderPass.reset();
+		if (m_RenderGraph) m_RenderGraph->destroy();
+		m_RenderGraph.reset();
 
 		if (commandBuffers) commandBuffers.reset();
 
+		if (m_SceneCommandCache) m_SceneCommandCache->destroy();
+		m_SceneCommandCache.reset();
+
+		if (m_ParallelRecorder) m_ParallelRecorder->destroy();
+		m_ParallelRecorder.reset();
+
 		if (commandPool) commandPool->destroy();
 		commandPool.reset();
 
 		depthResourceObj.reset();
-		swapChainFramebuffers.reset();
 		swapChainObj.reset();
 
+		// last of the device resources, everything above has handed its memory back by now
+		if (m_MemoryAllocator) m_MemoryAllocator->destroy();
+		m_MemoryAllocator.reset();
+
 		if (devices) devices.reset();
 		
 		if (surface) surface.reset();
@@ -816,6 +1302,142 @@ private:
 	}
 	
 
+	// ImGui draws in the frame graph's last subpass, into the scene's color attachment
+	void createImGuiManager()
+	{
+		m_imguiManager = std::make_unique<ImGuiManager>(
+			*window,
+			*instance,
+			*devices,
+			*surface,
+			*swapChainObj,
+			*commandPool,
+			m_RenderGraph->getRenderPass("ImGui"),
+			m_RenderGraph->getSubpass("ImGui")
+		);
+	}
+
+	// Declares and compiles the frame: the renderer's scene passes into the scene colour target and the
+	// depth buffer at the render extent, the upscale into the acquired swap chain image, then the UI on
+	// top. Only call once the frame's fence has signalled
+	void buildFrameGraph(const RenderPacket& renderPacket, uint32_t frameIndex, uint32_t imageIndex)
+	{
+		m_RenderGraph->reset();
+
+		// the acquire semaphore is waited on at the color output stage, the barrier chains onto it
+		RenderGraphImageInfo backbufferInfo{};
+		backbufferInfo.image = swapChainObj->getImages()[imageIndex];
+		backbufferInfo.view = swapChainObj->getImageViews()[imageIndex];
+		backbufferInfo.format = swapChainObj->getImageFormat();
+		backbufferInfo.extent = swapChainObj->getExtent();
+		RenderGraphResource backbuffer = m_RenderGraph->importImage("Backbuffer", backbufferInfo,
+			{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 });
+		m_RenderGraph->exportResource(backbuffer, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+		// the previous frame may still be writing depth or building the pyramid from it
+		VkFormat depthFormat = VulkanDepthResources::findDepthFormat(devices->getPhysicalDevice());
+		RenderGraphImageInfo depthInfo{};
+		depthInfo.image = depthResourceObj->getDepthImage();
+		depthInfo.view = depthResourceObj->getDepthImageView();
+		depthInfo.format = depthFormat;
+		depthInfo.extent = m_RenderExtent;
+		depthInfo.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (VulkanImage::hasStencilComponent(depthFormat))
+		{
+			depthInfo.aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+		RenderGraphResource depth = m_RenderGraph->importImage("Depth", depthInfo,
+			{ VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT });
+
+		RenderGraphImageInfo sceneColorInfo{};
+		sceneColorInfo.format = swapChainObj->getImageFormat();
+		sceneColorInfo.extent = m_RenderExtent;
+		RenderGraphResource sceneColor = m_RenderGraph->createImage("SceneColor", sceneColorInfo);
+
+		renderer->addScenePasses(*m_RenderGraph, renderPacket, frameIndex, sceneColor, depth,
+			m_CommandReplayEnabled ? m_SceneCommandCache.get() : nullptr);
+
+		// every pixel is written, so the backbuffer's old contents are not loaded
+		uint32_t upscale = m_RenderGraph->addGraphicsPass("Upscale", [this, frameIndex](const RenderGraphContext& context)
+			{
+				uint32_t zone = m_GpuProfiler->beginZone(context.commandBuffer, "Upscale");
+				m_Upscaler->record(context.commandBuffer, frameIndex, m_RenderExtent, context.extent);
+				m_GpuProfiler->endZone(context.commandBuffer, zone);
+			});
+		m_RenderGraph->addRead(upscale, sceneColor, RenderGraphUsage::SAMPLED_FRAGMENT);
+		m_RenderGraph->addColorAttachment(upscale, backbuffer, VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+
+		// loads what the upscale drew, so the graph makes it a subpass of the upscale's render pass
+		uint32_t ui = m_RenderGraph->addGraphicsPass("ImGui", [this](const RenderGraphContext& context)
+			{
+				uint32_t zone = m_GpuProfiler->beginZone(context.commandBuffer, "ImGui");
+				m_imguiManager->render(context.commandBuffer);
+				m_GpuProfiler->endZone(context.commandBuffer, zone);
+			});
+		m_RenderGraph->addColorAttachment(ui, backbuffer, VK_ATTACHMENT_LOAD_OP_LOAD);
+
+		m_RenderGraph->compile();
+
+		// the transient's view changes whenever the render extent does; null during the warm-up build
+		if (m_Upscaler)
+		{
+			m_Upscaler->setSource(frameIndex, m_RenderGraph->getImageView(sceneColor));
+		}
+	}
+
+	// Scatters point and spot lights over the scene's bounds; fixed seed, so every run looks the same
+	void createSceneLights()
+	{
+		glm::vec3 sceneMin = m_SceneBounds.center - m_SceneBounds.extents;
+		glm::vec3 sceneMax = m_SceneBounds.center + m_SceneBounds.extents;
+		float sceneSize = std::max(glm::length(sceneMax - sceneMin), 1.0f);
+
+		std::mt19937 random(1234u);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		auto randomPosition = [&]() { return glm::mix(sceneMin, sceneMax, glm::vec3(unit(random), unit(random), unit(random))); };
+		auto randomColor = [&](float intensity) { return glm::vec4(0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random), intensity); };
+
+		m_PointLights.clear();
+		for (uint32_t i = 0; i < VulkanGlobals::SCENE_POINT_LIGHTS; i++)
+		{
+			PointLight light{};
+			light.position = randomPosition();
+			light.range = sceneSize * (0.03f + 0.05f * unit(random));
+			light.color = randomColor(5.0f);
+			m_PointLights.push_back(light);
+		}
+
+		m_SpotLights.clear();
+		for (uint32_t i = 0; i < VulkanGlobals::SCENE_SPOT_LIGHTS; i++)
+		{
+			SpotLight light{};
+			light.position = randomPosition();
+			light.range = sceneSize * (0.08f + 0.08f * unit(random));
+			light.direction = glm::normalize(glm::vec3(unit(random) - 0.5f, -1.0f, unit(random) - 0.5f)); // mostly down
+			light.innerAngle = glm::radians(15.0f);
+			light.outerAngle = glm::radians(30.0f);
+			light.color = randomColor(20.0f);
+			m_SpotLights.push_back(light);
+		}
+		m_LocalLightsUploaded = !m_LocalLightsEnabled; // uploaded by the first frame
+	}
+
+	// (Re)builds the hi-z pyramid for the current depth buffer and points the GPU culler at it
+	void createHiZPyramid()
+	{
+		if (!m_HiZPyramid)
+		{
+			m_HiZPyramid = std::make_unique<VulkanHiZPyramid>();
+		}
+		m_HiZPyramid->create(devices->getLogicalDevice(), *m_MemoryAllocator, devices->getGraphicsQueue(),
+			commandPool->getVkCommandPool(), depthResourceObj->getDepthImageView(), m_RenderExtent);
+		m_GpuCulling->setHiZPyramid(m_HiZPyramid->getImageView(), m_HiZPyramid->getSampler(),
+			m_HiZPyramid->getExtent(), m_HiZPyramid->getLevelCount());
+		m_HiZBuiltLastFrame = false; // the new pyramid holds nothing yet
+	}
+
 	// Update Uniform Buffers here
 	FrameUniformBufferObject frameUboUpdate()
 	{
@@ -840,8 +1462,90 @@ private:
 		return ubo;
 	}
 
+	// Requests a pipeline permutation for every loaded material (cull mode from doubleSided,
+	// blending from alphaMode, shader.frag specialized to the maps it has) plus its wireframe
+	// variant, then compiles them all up front. Materials with the same mask share a variant.
+	// Handles requested later are compiled on first use and land in the pipeline cache.
+	void assignMaterialPipelines()
+	{
+		GraphicsPipelineState baseState{};
+		baseState.pipelineLayout = m_pbrPipelineLayout->getVkPipelineLayout();
+		baseState.renderPass = m_RenderGraph->getRenderPass("Scene");
+		baseState.vertShaderPath = "shaders/vert.spv";
+		baseState.fragShaderPath = m_BindlessEnabled ? "shaders/frag_bindless.spv" : "shaders/frag.spv";
+		baseState.polygonMode = VK_POLYGON_MODE_FILL;
+		baseState.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		baseState.vertexLayout = PipelineVertexLayout::PBR_FULL;
+
+		for (auto& [name, material] : m_AssetManager->getMaterials())
+		{
+			GraphicsPipelineState state = baseState;
+			state.cullMode = material->doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+			state.materialFeatures = material->getFeatureMask();
+			switch (material->alphaMode)
+			{
+			case Material::AlphaMode::MASK_MODE:
+				state.blendMode = PipelineBlendMode::MASK_MODE;
+				break;
+			case Material::AlphaMode::BLEND_MODE:
+				state.blendMode = PipelineBlendMode::BLEND_MODE;
+				state.depthWrite = false;
+				break;
+			default:
+				state.blendMode = PipelineBlendMode::OPAQUE_MODE;
+				break;
+			}
+			material->pipelineHandle = m_PipelineLibrary->requestPipeline(state);
+
+			// depth pre-pass: positions only, then shade with EQUAL and no depth writes. Masked materials
+			// would need their alpha test in the pre-pass, so they stay on the LESS pipeline
+			if (material->alphaMode == Material::AlphaMode::OPAQUE_MODE)
+			{
+				GraphicsPipelineState depthState = state;
+				depthState.vertShaderPath = "shaders/depth.vert.spv";
+				depthState.fragShaderPath.clear();
+				depthState.vertexLayout = PipelineVertexLayout::POSITION_ONLY;
+				depthState.colorWrite = false;
+				depthState.materialFeatures = MATERIAL_FEATURE_ALL; // no fragment stage, every material shares it
+				material->depthOnlyPipelineHandle = m_PipelineLibrary->requestPipeline(depthState);
+
+				GraphicsPipelineState equalState = state;
+				equalState.depthWrite = false;
+				equalState.depthCompareOp = VK_COMPARE_OP_EQUAL;
+				material->depthEqualPipelineHandle = m_PipelineLibrary->requestPipeline(equalState);
+			}
+
+			if (m_WireframeSupported)
+			{
+				GraphicsPipelineState wireState = baseState;
+				wireState.fragShaderPath = "shaders/wireframe.frag.spv";
+				wireState.polygonMode = VK_POLYGON_MODE_LINE;
+				wireState.cullMode = VK_CULL_MODE_BACK_BIT;
+				material->wireframePipelineHandle = m_PipelineLibrary->requestPipeline(wireState);
+			}
+		}
+
+		// one caster pipeline for every material: positions only, both faces, biased depth. Masked
+		// materials cast as if opaque, the alpha test would need the full vertex stream
+		GraphicsPipelineState shadowState{};
+		shadowState.pipelineLayout = m_ShadowPipelineLayout->getVkPipelineLayout();
+		shadowState.renderPass = m_RenderGraph->getRenderPass("ShadowCascade0");
+		shadowState.vertShaderPath = "shaders/shadow.vert.spv";
+		shadowState.vertexLayout = PipelineVertexLayout::POSITION_STREAM;
+		shadowState.cullMode = VK_CULL_MODE_NONE;
+		shadowState.depthBias = true;
+		shadowState.colorWrite = false;
+		shadowState.colorAttachment = false;
+		m_ShadowPipeline = m_PipelineLibrary->requestPipeline(shadowState);
+
+		m_PipelineLibrary->prewarm();
+		std::cout << "Pipeline library: " << m_PipelineLibrary->getPipelineCount() << " unique pipeline(s) for "
+			<< m_AssetManager->getMaterials().size() << " material(s)" << std::endl;
+	}
+
 	void loadAssetsAndCreateRenderables()
 	{
+		CPU_PROFILE_ZONE("Load Assets");
 		//SceneObjectDefinition MetalBall{};
 		//MetalBall.name = "Metal_PBR_Preview";
 		//MetalBall.meshPath = "";
@@ -946,6 +1650,7 @@ private:
 		emissiveBall.meshPath = "models/gltf/CompareEmissiveStrength.glb";
 		emissiveBall.rotationAngles = glm::vec3(0.0f, 0.0f, 0.0f);
 		emissiveBall.position = glm::vec3(-5.0f, 0.0f, 0.0f);
+		emissiveBall.isStatic = false; // orbits the helmet while objects are animated
 
 		SceneObjectDefinition roughnessBall{};
 		roughnessBall.meshFileType = MeshFileType::FILE_GLTF;
@@ -980,18 +1685,226 @@ private:
 		}
 	}
 
-	void updateObjectUniforms(uint32_t currentFrameIndex)
+	// hands every renderable an id in the object data buffer; static ones are uploaded on the next update
+	void registerRenderableObjects()
 	{
-		if (!objectDataDUBManager || renderableObjects.empty())
+		m_TransformSystem = std::make_unique<TransformSystem>();
+		for (const auto& renderable : renderableObjects)
 		{
-			return;
+			m_TransformSystem->addNode(TransformSystem::INVALID_NODE, renderable.modelMatrix);
+		}
+		m_TransformSystem->update();
+		m_DrawListDirty = true;
+
+		m_FrustumCuller = std::make_unique<FrustumCuller>();
+		m_FrustumCuller->resize(static_cast<uint32_t>(renderableObjects.size()));
+		for (uint32_t i = 0; i < renderableObjects.size(); i++)
+		{
+			auto& renderable = renderableObjects[i];
+			renderable.modelMatrix = m_TransformSystem->getWorldMatrix(i);
+			renderable.objectIndex = m_ObjectDataBuffer->addObject(renderable.modelMatrix, m_TransformSystem->getNormalMatrix(i), renderable.isStatic);
+			BoundingVolume worldBounds = renderable.localBounds.transformed(renderable.modelMatrix);
+			m_FrustumCuller->setBounds(i, worldBounds);
+			growSceneBounds(worldBounds, i == 0);
+		}
+
+		m_AnimatedRenderables.clear();
+		for (uint32_t i = 0; i < renderableObjects.size(); i++)
+		{
+			if (!renderableObjects[i].isStatic)
+			{
+				m_AnimatedRenderables.emplace_back(i, renderableObjects[i].modelMatrix);
+			}
+		}
+
+		m_BlendedRenderables.clear();
+		for (uint32_t i = 0; i < renderableObjects.size(); i++)
+		{
+			if (!VulkanGpuCulling::isCandidate(renderableObjects[i]))
+			{
+				m_BlendedRenderables.push_back(i);
+			}
+		}
+		if (m_GpuCulling)
+		{
+			m_GpuCulling->setObjects(renderableObjects); // needs the object ids assigned above
 		}
-		for (uint32_t i = 0; i < renderableObjects.size(); ++i)
+	}
+
+	// widens m_SceneBounds to enclose worldBounds; replace starts over from it
+	void growSceneBounds(const BoundingVolume& worldBounds, bool replace = false)
+	{
+		glm::vec3 boundsMin = worldBounds.center - worldBounds.extents;
+		glm::vec3 boundsMax = worldBounds.center + worldBounds.extents;
+		if (!replace)
 		{
-			const auto& renderable = renderableObjects[i];
-			ObjectUniformBufferObject objectUbo{};
-			objectUbo.model = renderable.modelMatrix;
-			objectDataDUBManager->updateDynamic(currentFrameIndex, i, objectUbo);
+			boundsMin = glm::min(boundsMin, m_SceneBounds.center - m_SceneBounds.extents);
+			boundsMax = glm::max(boundsMax, m_SceneBounds.center + m_SceneBounds.extents);
+		}
+		m_SceneBounds.center = (boundsMin + boundsMax) * 0.5f;
+		m_SceneBounds.extents = (boundsMax - boundsMin) * 0.5f;
+		m_SceneBounds.radius = glm::length(m_SceneBounds.extents);
+	}
+
+	// Culls the casters of one cascade against its light frustum and batches them like the scene's draws.
+	// Cached cascades outlive this frame's dynamic transforms, so they only take static casters
+	void buildShadowCascadeDraws(uint32_t cascade, ShadowCascadeDraws& draws)
+	{
+		Frustum lightFrustum = Frustum::fromMatrix(m_ShadowCascades->getViewProjection(cascade));
+		m_FrustumCuller->cull(lightFrustum, m_ShadowCasters);
+		bool staticOnly = VulkanShadowCascades::isCached(cascade);
+
+		m_ShadowDrawItems.clear();
+		for (uint32_t index : m_ShadowCasters)
+		{
+			const auto& renderable = renderableObjects[index];
+			if (renderable.material->alphaMode == Material::AlphaMode::BLEND_MODE) continue;
+			if (staticOnly && !renderable.isStatic) continue;
+
+			// no pipeline or depth: group by material then mesh, so the batcher merges as much as it can
+			DrawItem item{};
+			item.key = DrawSorter::makeKey(false, 0, renderable.material->sortId, renderable.indexType,
+				renderable.meshSortId, 0.0f);
+			item.renderableIndex = index;
+			m_ShadowDrawItems.push_back(item);
+		}
+		m_DrawSorter.sort(m_ShadowDrawItems);
+
+		FrameAllocation instanceIds = m_FrameAllocator->allocate(m_ShadowDrawItems.size() * sizeof(uint32_t), sizeof(uint32_t));
+		DrawBatcher::build(renderableObjects, m_ShadowDrawItems, false,
+			instanceIds.offset / sizeof(uint32_t), static_cast<uint32_t*>(instanceIds.mappedData), draws.batches);
+		draws.instanceDescriptorSet = instanceIds.descriptorSet;
+		draws.draw = true;
+	}
+
+	// Culls, orders and batches what the camera sees. The batches only count as changed, with a new
+	// generation and so a new scene key, when they differ from the previous list: a moving camera that
+	// keeps the same draws still replays the cached scene commands
+	void rebuildDrawList(const Frustum& frustum, bool gpuCulling)
+	{
+		CPU_PROFILE_ZONE("Rebuild Draw List");
+		if (gpuCulling)
+		{
+			// the rest is culled on the GPU
+			m_VisibleRenderables.clear();
+			for (uint32_t index : m_BlendedRenderables)
+			{
+				const auto& renderable = renderableObjects[index];
+				if (frustum.intersects(renderable.localBounds.transformed(renderable.modelMatrix)))
+				{
+					m_VisibleRenderables.push_back(index);
+				}
+			}
+			// only the blended share, the UI adds the GPU's counts on top
+			m_DrawListVisible = static_cast<uint32_t>(m_VisibleRenderables.size());
+			m_DrawListCulled = static_cast<uint32_t>(m_BlendedRenderables.size()) - m_DrawListVisible;
+		}
+		else
+		{
+			m_FrustumCuller->cull(frustum, m_VisibleRenderables);
+			m_DrawListVisible = m_FrustumCuller->getVisibleCount();
+			m_DrawListCulled = m_FrustumCuller->getCulledCount();
+		}
+
+		buildDrawOrder();
+		m_DrawListBindsUnsorted = DrawSorter::countBinds(renderableObjects, m_DrawItems, m_WireframeMode);
+		m_DrawSorter.sort(m_DrawItems);
+		m_DrawListBindsSorted = DrawSorter::countBinds(renderableObjects, m_DrawItems, m_WireframeMode);
+
+		// neighbours sharing mesh and material collapse into one instanced draw
+		m_DrawInstanceIds.resize(m_DrawItems.size());
+		DrawBatcher::build(renderableObjects, m_DrawItems, m_WireframeMode, m_DrawInstanceBase, m_DrawInstanceIds.data(), m_RebuiltBatches);
+		if (!sameBatches(m_RebuiltBatches, m_DrawBatches))
+		{
+			m_DrawBatches.swap(m_RebuiltBatches);
+			m_DrawListGeneration++;
+		}
+	}
+
+	static bool sameBatches(const std::vector<DrawBatch>& a, const std::vector<DrawBatch>& b)
+	{
+		return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const DrawBatch& x, const DrawBatch& y)
+			{
+				return x.firstIndex == y.firstIndex && x.vertexOffset == y.vertexOffset && x.indexCount == y.indexCount
+					&& x.indexType == y.indexType && x.material == y.material && x.pipelineHandle == y.pipelineHandle
+					&& x.firstInstance == y.firstInstance && x.instanceCount == y.instanceCount;
+			});
+	}
+
+	// one sort key per visible renderable, depth measured along the view direction to the bounds center
+	void buildDrawOrder()
+	{
+		glm::vec3 cameraPosition = camera->getCameraPosition();
+		glm::vec3 cameraDirection = camera->getCameraDirection();
+		float farPlane = camera->getFarPlane();
+
+		m_DrawItems.clear();
+		m_DrawItems.reserve(m_VisibleRenderables.size());
+		for (uint32_t index : m_VisibleRenderables)
+		{
+			const auto& renderable = renderableObjects[index];
+			const Material& material = *renderable.material;
+
+			glm::vec3 center = glm::vec3(renderable.modelMatrix * glm::vec4(renderable.localBounds.center, 1.0f));
+			float depth = glm::dot(center - cameraPosition, cameraDirection) / farPlane;
+
+			DrawItem item{};
+			item.key = DrawSorter::makeKey(
+				material.alphaMode == Material::AlphaMode::BLEND_MODE,
+				m_WireframeMode ? material.wireframePipelineHandle : material.pipelineHandle,
+				material.sortId,
+				renderable.indexType,
+				renderable.meshSortId,
+				depth);
+			item.renderableIndex = index;
+			m_DrawItems.push_back(item);
+		}
+	}
+
+	// moving a static renderable works but re-uploads it through a staging copy, flag movers as dynamic.
+	// Takes effect with the next frame's applyTransformChanges
+	void setRenderableTransform(size_t renderableIndex, const glm::mat4& model)
+	{
+		m_TransformSystem->setLocalMatrix(static_cast<uint32_t>(renderableIndex), model);
+	}
+
+	// turns the dynamic renderables around the world's up axis, the transform system hands the
+	// change to the object data and cullers; static casters and their cached shadows are left alone
+	void animateRenderables(float deltaTime)
+	{
+		m_AnimationTime += deltaTime;
+		glm::mat4 orbit = glm::rotate(glm::mat4(1.0f), m_AnimationTime * glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		for (const auto& animated : m_AnimatedRenderables)
+		{
+			setRenderableTransform(animated.first, orbit * animated.second);
+		}
+	}
+
+	// resolves every transform set since the last frame and pushes the results to the object data,
+	// the cullers and the shadow cache
+	void applyTransformChanges()
+	{
+		m_TransformSystem->update(&m_ChangedTransforms);
+		if (!m_ChangedTransforms.empty())
+		{
+			m_DrawListDirty = true; // bounds, culling and blended order move with them
+		}
+		for (uint32_t index : m_ChangedTransforms)
+		{
+			auto& renderable = renderableObjects[index];
+			BoundingVolume oldBounds = renderable.localBounds.transformed(renderable.modelMatrix);
+			renderable.modelMatrix = m_TransformSystem->getWorldMatrix(index);
+			m_ObjectDataBuffer->setTransform(renderable.objectIndex, renderable.modelMatrix, m_TransformSystem->getNormalMatrix(index));
+			BoundingVolume worldBounds = renderable.localBounds.transformed(renderable.modelMatrix);
+			m_FrustumCuller->setBounds(index, worldBounds);
+			if (m_GpuCulling) m_GpuCulling->setBounds(index, worldBounds);
+			growSceneBounds(worldBounds);
+			if (renderable.isStatic)
+			{
+				// its old shadow is baked into the cached cascades, and so is the spot it moves to
+				m_ShadowCascades->invalidate(oldBounds);
+				m_ShadowCascades->invalidate(worldBounds);
+			}
 		}
 	}
 
@@ -1013,7 +1926,7 @@ private:
 
 		// descriptor set for 2D HDR texture that is being sampled NOW
 		auto conversionDescriptorSet = std::make_unique<VulkanDescriptorSets>();
-		conversionDescriptorSet->createForCubeMapConversion(devices->getLogicalDevice(), descriptorPool->getVkDescriptorPool(), conversionLayout->getVkDescriptorSetLayout(), hdrSourceTexture);
+		conversionDescriptorSet->createForCubeMapConversion(devices->getLogicalDevice(), *m_DescriptorAllocator, conversionLayout->getVkDescriptorSetLayout(), hdrSourceTexture);
 		
 		auto conversionPipeline = std::make_unique<VulkanGraphicsPipeline>();
 		conversionPipeline->createForConversion(
@@ -1021,7 +1934,9 @@ private:
 			conversionPipelineLayout->getVkPipelineLayout(),
 			conversionRenderPass->getVkRenderPass(),
 			"shaders/equidirect_to_cube.vert.spv",
-			"shaders/equidirect_to_cube.frag.spv"
+			"shaders/equidirect_to_cube.frag.spv",
+			m_ShaderModuleCache.get(),
+			m_PipelineCache->getVkPipelineCache()
 		);
 
 		std::vector<VkFramebuffer> framebuffers(6);
@@ -1078,6 +1993,7 @@ private:
 		};
 	
 		VkCommandBuffer cmd = VulkanCommandBuffers::beginSingleTimeCommands(devices->getLogicalDevice(), commandPool->getVkCommandPool());
+		uint32_t bakeZone = m_GpuProfiler->beginBakeZone(cmd, "Equirect To Cubemap");
 
 		for (uint32_t i = 0; i < 6; i++)
 		{
@@ -1123,8 +2039,10 @@ private:
 
 		}
 
+		m_GpuProfiler->endBakeZone(cmd, bakeZone);
 		VulkanCommandBuffers::endSingleTimeCommands(cmd, devices->getLogicalDevice(), devices->getGraphicsQueue(), commandPool->getVkCommandPool());
 		vkQueueWaitIdle(devices->getGraphicsQueue());
+		m_GpuProfiler->resolveBakeZones();
 
 		VulkanImage::transitionImageLayout(
 			devices->getLogicalDevice(),
@@ -1166,7 +2084,7 @@ private:
 		std::cout << "Generating Irradiance Map..." << std::endl;
 		const uint32_t irradianceMapSize = 32;
 		irradianceMap = std::make_unique<VulkanTexture>();
-		irradianceMap->createCubemap(devices->getLogicalDevice(), devices->getPhysicalDevice(), irradianceMapSize, irradianceMapSize, 1);
+		irradianceMap->createCubemap(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, irradianceMapSize, irradianceMapSize, 1);
 
 		auto conversionRenderPass = std::make_unique<VulkanRenderPass>();
 		conversionRenderPass->offscreen_rendering_create(devices->getLogicalDevice(), devices->getPhysicalDevice());
@@ -1185,7 +2103,7 @@ private:
 		auto irradianceConvDescriptorSet = std::make_unique<VulkanDescriptorSets>();
 		irradianceConvDescriptorSet->createForSkybox(
 			devices->getLogicalDevice(),
-			descriptorPool->getVkDescriptorPool(),
+			*m_DescriptorAllocator,
 			irradianceLayout->getVkDescriptorSetLayout(),
 			1, // Only need one set for this process
 			frameUboManager->getBuffers(), // This is a bit of a hack, we only need the layout
@@ -1198,7 +2116,9 @@ private:
 			irradiancePipelineLayout->getVkPipelineLayout(),
 			conversionRenderPass->getVkRenderPass(),
 			"shaders/equidirect_to_cube.vert.spv", // We can reuse the same vertex shader
-			"shaders/irradiance.frag.spv"
+			"shaders/irradiance.frag.spv",
+			m_ShaderModuleCache.get(),
+			m_PipelineCache->getVkPipelineCache()
 		);
 
 		std::vector<VkFramebuffer> framebuffers(6);
@@ -1255,6 +2175,7 @@ private:
 		};
 
 		VkCommandBuffer cmd = VulkanCommandBuffers::beginSingleTimeCommands(devices->getLogicalDevice(), commandPool->getVkCommandPool());
+		uint32_t bakeZone = m_GpuProfiler->beginBakeZone(cmd, "Irradiance");
 
 		for (uint32_t i = 0; i < 6; i++)
 		{
@@ -1298,8 +2219,10 @@ private:
 			vkCmdEndRenderPass(cmd);
 		}
 
+		m_GpuProfiler->endBakeZone(cmd, bakeZone);
 		VulkanCommandBuffers::endSingleTimeCommands(cmd, devices->getLogicalDevice(), devices->getGraphicsQueue(), commandPool->getVkCommandPool());
 		vkQueueWaitIdle(devices->getGraphicsQueue());
+		m_GpuProfiler->resolveBakeZones();
 
 		VulkanImage::transitionImageLayout(
 			devices->getLogicalDevice(),
@@ -1341,7 +2264,7 @@ private:
 		const uint32_t maxMipLevels = static_cast<uint32_t>(floor(log2(prefilterMapSize))) + 1;
 
 		prefilterMap = std::make_unique<VulkanTexture>();
-		prefilterMap->createCubemap(devices->getLogicalDevice(), devices->getPhysicalDevice(), prefilterMapSize, prefilterMapSize, maxMipLevels);
+		prefilterMap->createCubemap(devices->getLogicalDevice(), devices->getPhysicalDevice(), *m_MemoryAllocator, prefilterMapSize, prefilterMapSize, maxMipLevels);
 
 		auto conversionRenderPass = std::make_unique<VulkanRenderPass>();
 		conversionRenderPass->offscreen_rendering_create(devices->getLogicalDevice(), devices->getPhysicalDevice());
@@ -1367,7 +2290,7 @@ private:
 		auto prefilterDescriptorSet = std::make_unique<VulkanDescriptorSets>();
 		prefilterDescriptorSet->createForSkybox(
 			devices->getLogicalDevice(),
-			descriptorPool->getVkDescriptorPool(),
+			*m_DescriptorAllocator,
 			prefilerDescriptorSetLayout->getVkDescriptorSetLayout(),
 			1, // Only need one set for this process
 			frameUboManager->getBuffers(), // This is a bit of a hack, we only need the layout
@@ -1380,7 +2303,9 @@ private:
 			prefilterPipelineLayout->getVkPipelineLayout(),
 			conversionRenderPass->getVkRenderPass(),
 			"shaders/equidirect_to_cube.vert.spv",
-			"shaders/prefilter.frag.spv" // NEW shader
+			"shaders/prefilter.frag.spv", // NEW shader
+			m_ShaderModuleCache.get(),
+			m_PipelineCache->getVkPipelineCache()
 		);
 
 
@@ -1452,6 +2377,7 @@ private:
 			// Remember to set the viewport to mipWidth and mipHeight!
 
 			VkCommandBuffer cmd = VulkanCommandBuffers::beginSingleTimeCommands(devices->getLogicalDevice(), commandPool->getVkCommandPool());
+			uint32_t bakeZone = m_GpuProfiler->beginBakeZone(cmd, ("Prefilter Mip " + std::to_string(mip)).c_str());
 
 
 			for (uint32_t i = 0; i < 6; i++)
@@ -1497,8 +2423,10 @@ private:
 
 				vkCmdEndRenderPass(cmd);
 			}
+			m_GpuProfiler->endBakeZone(cmd, bakeZone);
 			VulkanCommandBuffers::endSingleTimeCommands(cmd, devices->getLogicalDevice(), devices->getGraphicsQueue(), commandPool->getVkCommandPool());
 			vkQueueWaitIdle(devices->getGraphicsQueue());
+			m_GpuProfiler->resolveBakeZones();
 
 			for (uint32_t i = 0; i < 6; i++)
 			{
@@ -1545,6 +2473,7 @@ private:
 		brdfLut->createRenderableTexture(
 			devices->getLogicalDevice(),
 			devices->getPhysicalDevice(),
+			*m_MemoryAllocator,
 			lutSize, lutSize,
 			VK_FORMAT_R16G16_SFLOAT,
 			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
@@ -1581,12 +2510,15 @@ private:
 			brdfPipelineLayout->getVkPipelineLayout(),
 			conversionRenderPass->getVkRenderPass(),
 			"shaders/brdf.vert.spv", // A simple passthrough/fullscreen triangle shader
-			"shaders/brdf.frag.spv"
+			"shaders/brdf.frag.spv",
+			m_ShaderModuleCache.get(),
+			m_PipelineCache->getVkPipelineCache()
 		);
 
 
 		// 4. Record commands to render a single fullscreen quad
 		VkCommandBuffer cmd = VulkanCommandBuffers::beginSingleTimeCommands(devices->getLogicalDevice(), commandPool->getVkCommandPool());
+		uint32_t bakeZone = m_GpuProfiler->beginBakeZone(cmd, "BRDF LUT");
 
 		// Transition layout to be a render target
 		VulkanImage::transitionImageLayout(devices->getLogicalDevice(), devices->getGraphicsQueue(), commandPool->getVkCommandPool(), brdfLut->getImage(), VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
@@ -1617,8 +2549,10 @@ private:
 		vkCmdDraw(cmd, 3, 1, 0, 0); // Draw 1 triangle (3 vertices)
 		vkCmdEndRenderPass(cmd);
 
+		m_GpuProfiler->endBakeZone(cmd, bakeZone);
 		VulkanCommandBuffers::endSingleTimeCommands(cmd, devices->getLogicalDevice(), devices->getGraphicsQueue(), commandPool->getVkCommandPool());
 		vkQueueWaitIdle(devices->getGraphicsQueue());
+		m_GpuProfiler->resolveBakeZones();
 
 		// Transition layout to be a shader resource for sampling
 		VulkanImage::transitionImageLayout(
@@ -1710,7 +2644,7 @@ private:
 
 		m_skyboxCubeVertexBuffer->create(
 			devices->getLogicalDevice(),
-			devices->getPhysicalDevice(),
+			*m_MemoryAllocator,
 			devices->getGraphicsQueue(),
 			commandPool->getVkCommandPool(),
 			verticesForBuffer
@@ -1719,10 +2653,19 @@ private:
 
 };
 
-int main()
+int main(int argc, char** argv)
 {
 	VulkanEngine app;
 
+	// --render-scale <0.5 - 1.0>: fixed scene resolution, dynamic resolution off
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--render-scale" && i + 1 < argc)
+		{
+			app.setFixedRenderScale(std::strtof(argv[++i], nullptr));
+		}
+	}
+
 	try 
 	{
 		app.run();
@@ -1,15 +1,32 @@
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe shader.vert -o vert.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe shader.frag -o frag.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe wireframe.frag -o wireframe.frag.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe tess.vert -o tess.vert.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe tess.tesc -o tess.tesc.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe tess.tese -o tess.tese.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe skybox.vert -o skybox.vert.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe skybox.frag -o skybox.frag.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe equidirect_to_cube.vert -o equidirect_to_cube.vert.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe equidirect_to_cube.frag -o equidirect_to_cube.frag.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe irradiance.frag -o irradiance.frag.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe prefilter.frag -o prefilter.frag.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe brdf.vert -o brdf.vert.spv
-C:\VulkanSDK\1.4.313.0\Bin\glslc.exe brdf.frag -o brdf.frag.spv
-pause
+@echo off
+rem Compiles every shader to SPIR-V next to this file. Runs as the project's pre-build step, the .spv
+rem outputs are not kept in git; "nopause" skips the pause at the end when called from a build.
+setlocal
+cd /d "%~dp0"
+set GLSLC=C:\VulkanSDK\1.4.313.0\Bin\glslc.exe
+if defined VULKAN_SDK set GLSLC=%VULKAN_SDK%\Bin\glslc.exe
+
+"%GLSLC%" shader.vert -o vert.spv || exit /b 1
+"%GLSLC%" depth.vert -o depth.vert.spv || exit /b 1
+"%GLSLC%" shadow.vert -o shadow.vert.spv || exit /b 1
+"%GLSLC%" shader.frag -o frag.spv || exit /b 1
+"%GLSLC%" -DBINDLESS shader.frag -o frag_bindless.spv || exit /b 1
+"%GLSLC%" wireframe.frag -o wireframe.frag.spv || exit /b 1
+"%GLSLC%" tess.vert -o tess.vert.spv || exit /b 1
+"%GLSLC%" tess.tesc -o tess.tesc.spv || exit /b 1
+"%GLSLC%" tess.tese -o tess.tese.spv || exit /b 1
+"%GLSLC%" skybox.vert -o skybox.vert.spv || exit /b 1
+"%GLSLC%" skybox.frag -o skybox.frag.spv || exit /b 1
+"%GLSLC%" equidirect_to_cube.vert -o equidirect_to_cube.vert.spv || exit /b 1
+"%GLSLC%" equidirect_to_cube.frag -o equidirect_to_cube.frag.spv || exit /b 1
+"%GLSLC%" irradiance.frag -o irradiance.frag.spv || exit /b 1
+"%GLSLC%" prefilter.frag -o prefilter.frag.spv || exit /b 1
+"%GLSLC%" brdf.vert -o brdf.vert.spv || exit /b 1
+"%GLSLC%" brdf.frag -o brdf.frag.spv || exit /b 1
+"%GLSLC%" cull.comp -o cull.comp.spv || exit /b 1
+"%GLSLC%" hiz.comp -o hiz.comp.spv || exit /b 1
+"%GLSLC%" cluster.comp -o cluster.comp.spv || exit /b 1
+"%GLSLC%" fullscreen.vert -o fullscreen.vert.spv || exit /b 1
+"%GLSLC%" upscale.frag -o upscale.frag.spv || exit /b 1
+
+if not "%1"=="nopause" pause
@@ -0,0 +1,40 @@
+//depth.vert
+
+#version 450
+
+// Depth pre-pass: same transform as shader.vert, no fragment stage
+layout(binding = 0) uniform FrameUbo {
+    mat4 view;
+    mat4 proj;
+} frameData;
+
+struct ObjectData {
+    mat4 model;
+    mat3 normalMatrix; // unused here, keeps shader.vert's stride
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer StaticObjectBuffer {
+    ObjectData objects[];
+} staticObjects;
+
+layout(std430, set = 1, binding = 1) readonly buffer DynamicObjectBuffer {
+    ObjectData objects[];
+} dynamicObjects;
+
+const uint DYNAMIC_OBJECT_BIT = 0x80000000u;
+
+layout(std430, set = 2, binding = 0) readonly buffer InstanceObjectIds {
+    uint ids[];
+} instanceObjects;
+
+layout(location = 0) in vec3 inPosition;
+
+invariant gl_Position;
+
+void main() {
+    uint objectId = instanceObjects.ids[gl_InstanceIndex];
+    mat4 model = (objectId & DYNAMIC_OBJECT_BIT) != 0u
+        ? dynamicObjects.objects[objectId & ~DYNAMIC_OBJECT_BIT].model
+        : staticObjects.objects[objectId].model;
+    gl_Position = frameData.proj * frameData.view * model * vec4(inPosition, 1.0);
+}
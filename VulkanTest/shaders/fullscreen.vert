@@ -0,0 +1,13 @@
+//fullscreen.vert
+
+#version 450
+
+// One triangle covering the target, no vertex buffer: draw 3 vertices.
+// uv (0,0) is the top left of the target, matching the image being sampled
+layout(location = 0) out vec2 outUV;
+
+void main()
+{
+    outUV = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(outUV * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -1,18 +1,84 @@
-//shader.frag (frag.spv)
+//shader.frag (frag.spv, frag_bindless.spv with -DBINDLESS)
 
 #version 450
 
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
 layout(location = 0) in vec2 inTexCoord;
 layout(location = 1) in vec3 inFragPosWorld;
 layout(location = 2) in vec3 inNormalWorld;
 
 layout(location = 0) out vec4 outColor;
 
+#ifdef BINDLESS
+// frag_bindless.spv: every material in one set, see VulkanBindlessMaterials
+layout(binding = 1) uniform SceneLightingUBO
+{
+    vec4 lightDir;
+    vec4 lightColor;
+    vec4 viewPos;
+    mat4 cascadeViewProjection[4];
+    vec4 cascadeSplits;     // view depth each cascade reaches
+    vec4 cascadeTexelSizes; // world units per shadow map texel
+    vec4 shadowParams;      // x shadows on, y depth bias, z normal offset in texels, w 1 / shadow map size
+} sceneUbo;
+
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+struct MaterialData
+{
+    vec4 baseColorFactor;
+    vec4 emissiveFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float alphaCutoff;
+    int alphaMode; // 0 opaque, 1 mask, 2 blend
+
+    uint albedoTexture; // indices into textures[], NO_TEXTURE when absent
+    uint normalTexture;
+    uint metallicRoughnessTexture;
+    uint occlusionTexture;
+    uint emissiveTexture;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+layout(std430, binding = 2) readonly buffer MaterialBuffer
+{
+    MaterialData materials[];
+};
+
+// IBL SAMPLERS
+layout(binding = 3) uniform samplerCube irradianceMap;
+layout(binding = 4) uniform samplerCube prefilterMap;
+layout(binding = 5) uniform sampler2D brdfLut;
+
+layout(binding = 6) uniform sampler2D textures[];
+
+layout(binding = 7) uniform sampler2DArrayShadow shadowMap;
+
+layout(push_constant) uniform PushConstants {
+    uint materialIndex;
+} pushConstants;
+
+// the material index is uniform across a draw, so no nonuniformEXT is needed
+#define ALBEDO_MAP textures[material.albedoTexture]
+#define METALLIC_ROUGHNESS_MAP textures[material.metallicRoughnessTexture]
+#define OCCLUSION_MAP textures[material.occlusionTexture]
+#define EMISSIVE_MAP textures[material.emissiveTexture]
+#else
 layout(binding = 2) uniform SceneLightingUBO
 {
     vec4 lightDir;
     vec4 lightColor;
     vec4 viewPos;
+    mat4 cascadeViewProjection[4];
+    vec4 cascadeSplits;     // view depth each cascade reaches
+    vec4 cascadeTexelSizes; // world units per shadow map texel
+    vec4 shadowParams;      // x shadows on, y depth bias, z normal offset in texels, w 1 / shadow map size
 } sceneUbo;
 
 layout(binding = 3) uniform MaterialUBO
@@ -27,8 +93,8 @@ layout(binding = 3) uniform MaterialUBO
     int hasMetallicRoughnessMap;
     int hasOcclusionMap;
     int hasEmissiveMap;
-    float padding1; 
-    int padding2;
+    float alphaCutoff;
+    int alphaMode; // 0 opaque, 1 mask, 2 blend
     int padding3;
 } material;
 
@@ -47,10 +113,78 @@ layout(binding = 9) uniform samplerCube irradianceMap;
 layout(binding = 10) uniform samplerCube prefilterMap;
 layout(binding = 11) uniform sampler2D brdfLut;
 
+// SHADOW CASCADES, one array layer each
+layout(binding = 12) uniform sampler2DArrayShadow shadowMap;
+
+#define ALBEDO_MAP albedoMap
+#define METALLIC_ROUGHNESS_MAP metallicRoughnessMap
+#define OCCLUSION_MAP occlusionMap
+#define EMISSIVE_MAP emissiveMap
+#endif
+
+// Pipeline variants (VulkanGraphicsPipeline::createFromState): a variant is compiled with only the
+// texture fetches its material uses, and the alpha test and blended output only where its blend
+// mode needs them, instead of branching on the material per fragment
+layout(constant_id = 0) const uint MATERIAL_FEATURES = 0xFu; // MaterialFeatureBits
+layout(constant_id = 1) const int ALPHA_MODE = 0; // 0 opaque, 1 mask, 2 blend
+
+const uint FEATURE_ALBEDO_MAP = 1u;
+const uint FEATURE_METALLIC_ROUGHNESS_MAP = 2u;
+const uint FEATURE_OCCLUSION_MAP = 4u;
+const uint FEATURE_EMISSIVE_MAP = 8u;
+
+#define HAS_ALBEDO_MAP ((MATERIAL_FEATURES & FEATURE_ALBEDO_MAP) != 0u)
+#define HAS_METALLIC_ROUGHNESS_MAP ((MATERIAL_FEATURES & FEATURE_METALLIC_ROUGHNESS_MAP) != 0u)
+#define HAS_OCCLUSION_MAP ((MATERIAL_FEATURES & FEATURE_OCCLUSION_MAP) != 0u)
+#define HAS_EMISSIVE_MAP ((MATERIAL_FEATURES & FEATURE_EMISSIVE_MAP) != 0u)
+
 // layout(push_constant) uniform PushConstants {
 //     uint useOrm;
 // } pushConstants;
 
+// CLUSTERED LIGHTS, set 3: see VulkanClusteredLighting and cluster.comp
+const uint LIGHT_SPOT = 1u;
+
+struct Light
+{
+    vec4 position;  // xyz world position, w range
+    vec4 color;     // w intensity
+    vec4 direction; // spot lights only
+    float spotCosInner;
+    float spotCosOuter;
+    uint type;
+    uint padding;
+};
+
+layout(set = 3, binding = 0) uniform ClusterData
+{
+    mat4 view;
+    mat4 inverseProjection;
+    uvec4 gridSize; // xyz clusters, w light count
+    vec2 tileSize;
+    float nearPlane;
+    float farPlane;
+    float sliceScale;
+    float sliceBias;
+    uint indexCapacity;
+    uint padding;
+} clusterData;
+
+layout(std430, set = 3, binding = 1) readonly buffer LightBuffer
+{
+    Light lights[];
+};
+
+layout(std430, set = 3, binding = 2) readonly buffer ClusterBuffer
+{
+    uvec2 clusters[]; // offset into lightIndices, count
+};
+
+layout(std430, set = 3, binding = 3) readonly buffer LightIndexBuffer
+{
+    uint lightIndices[];
+};
+
 const float PI = 3.14159265359;
 
 // --- PBR Functions (from LearnOpenGL PBR) ---
@@ -96,7 +230,98 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0)
     return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
+// Cook-Torrance for one light, radiance already attenuated
+vec3 directLighting(vec3 N, vec3 V, vec3 L, vec3 radiance, vec3 albedo, float metallic, float roughness, vec3 F0)
+{
+    vec3 H = normalize(V + L);
+    float NDF = distributionGGX(N, H, roughness);
+    float G = geometrySmith(N, V, L, roughness);
+    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+    vec3 numerator = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // Add small epsilon to prevent division by zero.
+    vec3 specular = numerator / denominator;
+    // Non-Metals (metallic = 0) reflect all lights diffusely.
+    vec3 kD = vec3(1.0) - F;
+    kD *= 1.0 - metallic;
+    float NdotL = max(dot(N, L), 0.0);
+    return (kD * albedo / PI + specular) * radiance * NdotL;
+}
+
+// inverse square falloff, smoothly windowed to reach zero at the light's range
+float rangeAttenuation(float lightDistance, float range)
+{
+    float ratio = lightDistance / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / (lightDistance * lightDistance + 1.0);
+}
+
+// distance along the view direction, from the world position so it does not depend on how the
+// projection maps depth
+float fragmentViewDepth()
+{
+    return -(clusterData.view * vec4(inFragPosWorld, 1.0)).z;
+}
+
+// index of the cluster this fragment falls into, same grid as cluster.comp
+uint clusterIndex(float viewDepth)
+{
+    uvec3 grid = clusterData.gridSize.xyz;
+    uint slice = uint(max(log(viewDepth) * clusterData.sliceScale + clusterData.sliceBias, 0.0));
+    uvec2 tile = uvec2(gl_FragCoord.xy / clusterData.tileSize);
+    tile = min(tile, grid.xy - 1u);
+    slice = min(slice, grid.z - 1u);
+    return tile.x + grid.x * (tile.y + grid.y * slice);
+}
+
+// directional light visibility from the first cascade reaching this far whose map covers the
+// fragment, 3x3 PCF on the compare sampler. viewDepth is linear (fragmentViewDepth), like the splits
+float directionalShadow(vec3 N, vec3 L, float viewDepth)
+{
+    if (sceneUbo.shadowParams.x == 0.0)
+    {
+        return 1.0;
+    }
+    int cascade = 0;
+    while (cascade < 4 && viewDepth > sceneUbo.cascadeSplits[cascade])
+    {
+        cascade++;
+    }
+
+    float texel = sceneUbo.shadowParams.w;
+    for (; cascade < 4; cascade++)
+    {
+        // pushing the lookup out along the normal, more at grazing angles, keeps lit surfaces from shadowing themselves
+        float normalOffset = sceneUbo.cascadeTexelSizes[cascade] * sceneUbo.shadowParams.z * (1.0 - max(dot(N, L), 0.0));
+        vec4 shadowPosition = sceneUbo.cascadeViewProjection[cascade] * vec4(inFragPosWorld + N * normalOffset, 1.0);
+        vec2 uv = shadowPosition.xy * 0.5 + 0.5;
+        // outside this map, the PCF taps included: the next, wider cascade may still cover it
+        if (any(lessThan(uv, vec2(texel))) || any(greaterThan(uv, vec2(1.0 - texel))))
+        {
+            continue;
+        }
+        float depth = shadowPosition.z - sceneUbo.shadowParams.y;
+        if (depth >= 1.0)
+        {
+            return 1.0;
+        }
+
+        float lit = 0.0;
+        for (int y = -1; y <= 1; y++)
+        {
+            for (int x = -1; x <= 1; x++)
+            {
+                lit += texture(shadowMap, vec4(uv + vec2(x, y) * texel, float(cascade), depth));
+            }
+        }
+        return lit / 9.0;
+    }
+    return 1.0; // past the last cascade
+}
+
 void main() {
+#ifdef BINDLESS
+    MaterialData material = materials[pushConstants.materialIndex];
+#endif
     // --- Material Property Setup ---
     // vec3 albedo = texture(albedoMap, inTexCoord).rgb;
     // vec3 ormData = texture(ormMap, inTexCoord).rgb;
@@ -106,33 +331,40 @@ void main() {
 
     // float ao, roughness, metallic;
     vec3 albedo = material.baseColorFactor.rgb;
-    if (material.hasAlbedoMap == 1)
+    float alpha = material.baseColorFactor.a;
+    if (HAS_ALBEDO_MAP)
+    {
+        vec4 albedoSample = texture(ALBEDO_MAP, inTexCoord);
+        albedo *= albedoSample.rgb;
+        alpha *= albedoSample.a;
+    }
+    if (ALPHA_MODE == 1 && alpha < material.alphaCutoff)
     {
-        albedo *= texture(albedoMap, inTexCoord).rgb;
+        discard;
     }
 
     float metallic = material.metallicFactor;
     float roughness = material.roughnessFactor;
     float ao = 1.0;
     // vec4 orm = vec4(1.0, 0.5, 0.0, 1.0);
-    if (material.hasMetallicRoughnessMap == 1)
+    if (HAS_METALLIC_ROUGHNESS_MAP)
     {
-        vec4 mr = texture(metallicRoughnessMap, inTexCoord);
+        vec4 mr = texture(METALLIC_ROUGHNESS_MAP, inTexCoord);
         roughness *= mr.g;
         metallic *= mr.b;
         // ao = mr.r;
 
     }
-    if (material.hasOcclusionMap == 1) // override if there is occlusion map
+    if (HAS_OCCLUSION_MAP) // override if there is occlusion map
     {
-        ao = texture(occlusionMap, inTexCoord).r; 
+        ao = texture(OCCLUSION_MAP, inTexCoord).r; 
     }
   
     
     vec3 emission = material.emissiveFactor.rgb;
-    if (material.hasEmissiveMap == 1)
+    if (HAS_EMISSIVE_MAP)
     {
-        emission *= texture(emissiveMap, inTexCoord).rgb;
+        emission *= texture(EMISSIVE_MAP, inTexCoord).rgb;
     }
 
 
@@ -161,23 +393,30 @@ void main() {
     F0 = mix(F0, albedo, metallic);
 
     // --- Start Direct Lighting Calculation ---
-    // (loop if multiple lights)
-    // for Lo is our outgoing radiance for single light
-    vec3 Lo = vec3(0.0);
-    vec3 L = normalize(-sceneUbo.lightDir.xyz);
-    vec3 H = normalize(V + L);
-    vec3 radiance = sceneUbo.lightColor.rgb * sceneUbo.lightColor.w;
-    float NDF = distributionGGX(N, H, roughness);
-    float G = geometrySmith(N, V, L, roughness);
-    vec3 F_direct = fresnelSchlick(max(dot(H, V), 0.0), F0);
-    vec3 numerator = NDF * G * F_direct;
-    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // Add small epsilon to prevent division by zero.
-    vec3 specular_direct = numerator / denominator;
-    // Non-Metals (metallic = 0) reflect all lights diffusely.
-    vec3 kD_direct = vec3(1.0) - F_direct;
-    kD_direct *= 1.0 - metallic;
-    float NdotL = max(dot(N, L), 0.0);
-    Lo += (kD_direct * albedo / PI + specular_direct) * radiance * NdotL;
+    // for Lo is our outgoing radiance, summed over the directional light and this cluster's lights
+    float viewDepth = fragmentViewDepth();
+    vec3 sunDirection = normalize(-sceneUbo.lightDir.xyz);
+    float sunVisibility = directionalShadow(N, sunDirection, viewDepth);
+    vec3 Lo = directLighting(N, V, sunDirection, sceneUbo.lightColor.rgb * sceneUbo.lightColor.w * sunVisibility,
+        albedo, metallic, roughness, F0);
+
+    uvec2 cluster = clusters[clusterIndex(viewDepth)];
+    for (uint i = 0; i < cluster.y; i++)
+    {
+        Light light = lights[lightIndices[cluster.x + i]];
+        vec3 toLight = light.position.xyz - inFragPosWorld;
+        float lightDistance = length(toLight);
+        vec3 L = toLight / max(lightDistance, 0.0001);
+        float attenuation = rangeAttenuation(lightDistance, light.position.w);
+        if (light.type == LIGHT_SPOT)
+        {
+            float cosAngle = dot(-L, light.direction.xyz);
+            attenuation *= smoothstep(light.spotCosOuter, light.spotCosInner, cosAngle);
+        }
+        if (attenuation <= 0.0) continue;
+
+        Lo += directLighting(N, V, L, light.color.rgb * light.color.w * attenuation, albedo, metallic, roughness, F0);
+    }
     // --- End Direct Lighting Calculation ---
 
     // --- Start Indirect Lighting Calculation ---
@@ -208,5 +447,5 @@ void main() {
     color = color / (color + vec3(1.0)); // Basic Reinhard tone mapping
     // color = pow(color, vec3(1.0/2.2)); // Apply gamma correction
 
-    outColor = vec4(color, 1.0);
+    outColor = vec4(color, ALPHA_MODE == 2 ? alpha : 1.0);
 }
\ No newline at end of file
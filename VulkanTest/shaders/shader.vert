@@ -7,28 +7,55 @@ layout(binding = 0) uniform FrameUbo {
     mat4 proj;
 } frameData;
 
-layout(binding = 1) uniform ObjectUbo { // Per-object data
+struct ObjectData {
     mat4 model;
-} objectData;
+    mat3 normalMatrix; // inverse transpose of model's upper 3x3, computed by the TransformSystem
+};
+
+// Per-object data, indexed by object id. Ids with the top bit set are dynamic objects
+// (rewritten per frame), the rest live in the static buffer uploaded once.
+layout(std430, set = 1, binding = 0) readonly buffer StaticObjectBuffer {
+    ObjectData objects[];
+} staticObjects;
+
+layout(std430, set = 1, binding = 1) readonly buffer DynamicObjectBuffer {
+    ObjectData objects[];
+} dynamicObjects;
+
+const uint DYNAMIC_OBJECT_BIT = 0x80000000u;
+
+// Object ids of every instanced batch this frame, a batch's firstInstance points at its range
+layout(std430, set = 2, binding = 0) readonly buffer InstanceObjectIds {
+    uint ids[];
+} instanceObjects;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec3 inNormal;
 
+// must match depth.vert bit for bit, the main pass tests EQUAL against the pre-pass depth
+invariant gl_Position;
+
 layout(location = 0) out vec2 fragTexCoord;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 
 void main() {
-    gl_Position = frameData.proj * frameData.view * objectData.model * vec4(inPosition, 1.0);
+    uint objectId = instanceObjects.ids[gl_InstanceIndex];
+    bool dynamicObject = (objectId & DYNAMIC_OBJECT_BIT) != 0u;
+    mat4 model = dynamicObject
+        ? dynamicObjects.objects[objectId & ~DYNAMIC_OBJECT_BIT].model
+        : staticObjects.objects[objectId].model;
+    mat3 normalMatrix = dynamicObject
+        ? dynamicObjects.objects[objectId & ~DYNAMIC_OBJECT_BIT].normalMatrix
+        : staticObjects.objects[objectId].normalMatrix;
+    gl_Position = frameData.proj * frameData.view * model * vec4(inPosition, 1.0);
     
     // Pass world-space position and normal to fragment shader
-    fragPosWorld = vec3(objectData.model * vec4(inPosition, 1.0));
+    fragPosWorld = vec3(model * vec4(inPosition, 1.0));
     
-    // Calculate the normal matrix to correctly transform normals
-    // (avoids issues with non-uniform scaling)
-    mat3 normalMatrix = transpose(inverse(mat3(objectData.model)));
+    // precomputed per object, correct under non-uniform scaling
     fragNormalWorld = normalize(normalMatrix * inNormal);
 
     fragTexCoord = inTexCoord;
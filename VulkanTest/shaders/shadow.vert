@@ -0,0 +1,38 @@
+//shadow.vert
+
+#version 450
+
+// Shadow cascades: depth only from the light, reads the position only vertex stream
+// (VulkanGeometryBuffer::getPositionBuffer), so every vertex fetch is 12 bytes
+struct ObjectData {
+    mat4 model;
+    mat3 normalMatrix; // unused here, keeps shader.vert's stride
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer StaticObjectBuffer {
+    ObjectData objects[];
+} staticObjects;
+
+layout(std430, set = 1, binding = 1) readonly buffer DynamicObjectBuffer {
+    ObjectData objects[];
+} dynamicObjects;
+
+const uint DYNAMIC_OBJECT_BIT = 0x80000000u;
+
+layout(std430, set = 2, binding = 0) readonly buffer InstanceObjectIds {
+    uint ids[];
+} instanceObjects;
+
+layout(push_constant) uniform PushConstants {
+    mat4 lightViewProjection; // the cascade being rendered
+} pushConstants;
+
+layout(location = 0) in vec3 inPosition;
+
+void main() {
+    uint objectId = instanceObjects.ids[gl_InstanceIndex];
+    mat4 model = (objectId & DYNAMIC_OBJECT_BIT) != 0u
+        ? dynamicObjects.objects[objectId & ~DYNAMIC_OBJECT_BIT].model
+        : staticObjects.objects[objectId].model;
+    gl_Position = pushConstants.lightViewProjection * model * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,58 @@
+//upscale.frag
+
+#version 450
+
+// Resamples the scene colour target to the swap chain with a Catmull-Rom filter. The 4x4 texel
+// footprint is folded into 9 bilinear taps: the two middle weights of each axis are merged into one
+// tap between their texels. At a render scale of 1 every pixel lands on a texel centre and the
+// filter returns that texel unchanged.
+layout(binding = 0) uniform sampler2D sceneColor; // linear filtering, clamp to edge
+
+layout(push_constant) uniform PushConstants {
+    vec2 sourceSize;        // scene colour extent in texels
+    vec2 inverseSourceSize;
+} pushConstants;
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+vec4 sampleCatmullRom(vec2 uv)
+{
+    vec2 samplePos = uv * pushConstants.sourceSize;
+    vec2 texPos1 = floor(samplePos - 0.5) + 0.5; // centre of the texel left of / above the sample
+    vec2 f = samplePos - texPos1;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+    vec2 w12 = w1 + w2;
+    vec2 offset12 = w2 / w12;
+
+    vec2 uv0 = (texPos1 - 1.0) * pushConstants.inverseSourceSize;
+    vec2 uv3 = (texPos1 + 2.0) * pushConstants.inverseSourceSize;
+    vec2 uv12 = (texPos1 + offset12) * pushConstants.inverseSourceSize;
+
+    vec4 result = vec4(0.0);
+    result += texture(sceneColor, vec2(uv0.x, uv0.y)) * w0.x * w0.y;
+    result += texture(sceneColor, vec2(uv12.x, uv0.y)) * w12.x * w0.y;
+    result += texture(sceneColor, vec2(uv3.x, uv0.y)) * w3.x * w0.y;
+
+    result += texture(sceneColor, vec2(uv0.x, uv12.y)) * w0.x * w12.y;
+    result += texture(sceneColor, vec2(uv12.x, uv12.y)) * w12.x * w12.y;
+    result += texture(sceneColor, vec2(uv3.x, uv12.y)) * w3.x * w12.y;
+
+    result += texture(sceneColor, vec2(uv0.x, uv3.y)) * w0.x * w3.y;
+    result += texture(sceneColor, vec2(uv12.x, uv3.y)) * w12.x * w3.y;
+    result += texture(sceneColor, vec2(uv3.x, uv3.y)) * w3.x * w3.y;
+
+    // the negative lobes can undershoot next to hard edges
+    return max(result, vec4(0.0));
+}
+
+void main()
+{
+    outColor = vec4(sampleCatmullRom(inUV).rgb, 1.0);
+}